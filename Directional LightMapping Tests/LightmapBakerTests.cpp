@@ -0,0 +1,401 @@
+#include "TestFramework.h"
+#include "LightmapBaker.h"
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct TestMesh {
+    std::string material;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+};
+
+// Quad around center spanning +-tangent and +-bitangent, facing tangent x bitangent, with its lightmap
+// UVs filling the given rectangle
+void addQuad(TestMesh& mesh, const glm::vec3& center, const glm::vec3& tangent, const glm::vec3& bitangent,
+    const glm::vec2& uvMin = glm::vec2(0.0f), const glm::vec2& uvMax = glm::vec2(1.0f)) {
+    const glm::vec2 corners[4] = { glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, -1.0f), glm::vec2(1.0f, 1.0f), glm::vec2(-1.0f, 1.0f) };
+    unsigned int first = static_cast<unsigned int>(mesh.vertices.size());
+    for (const glm::vec2& corner : corners) {
+        Vertex vertex = {};
+        vertex.Position = center + tangent * corner.x + bitangent * corner.y;
+        vertex.Normal = glm::normalize(glm::cross(tangent, bitangent));
+        vertex.TexCoords = corner * 0.5f + 0.5f;
+        vertex.LightmapTexCoords = uvMin + (uvMax - uvMin) * vertex.TexCoords;
+        vertex.Tangent = glm::normalize(tangent);
+        vertex.Bitangent = glm::normalize(bitangent);
+        mesh.vertices.push_back(vertex);
+    }
+    for (unsigned int index : { 0u, 1u, 2u, 0u, 2u, 3u }) {
+        mesh.indices.push_back(first + index);
+    }
+}
+
+// 4x4 floor facing up around the origin
+TestMesh makeFloor() {
+    TestMesh floor;
+    floor.material = "floor";
+    addQuad(floor, glm::vec3(0.0f), glm::vec3(2.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -2.0f));
+    return floor;
+}
+
+// Horizontal plate facing down, casting a square shadow under a light from above
+TestMesh makePlate(const std::string& material, const glm::vec3& center, float halfSize) {
+    TestMesh plate;
+    plate.material = material;
+    addQuad(plate, center, glm::vec3(halfSize, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, halfSize));
+    return plate;
+}
+
+// Box with its six faces in a 3x2 grid of lightmap charts
+TestMesh makeBox(const std::string& material, const glm::vec3& center, const glm::vec3& halfSize) {
+    TestMesh box;
+    box.material = material;
+    for (int face = 0; face < 6; face++) {
+        int axis = face / 2;
+        float sign = face % 2 ? -1.0f : 1.0f;
+        glm::vec3 normal(0.0f);
+        glm::vec3 tangent(0.0f);
+        normal[axis] = sign;
+        tangent[(axis + 1) % 3] = 1.0f;
+        glm::vec3 bitangent = glm::cross(normal, tangent);
+        auto scaled = [&](const glm::vec3& direction) { return direction * glm::dot(glm::abs(direction), halfSize); };
+
+        glm::vec2 cell(static_cast<float>(face % 3), static_cast<float>(face / 3));
+        glm::vec2 cellSize(1.0f / 3.0f, 0.5f);
+        addQuad(box, center + scaled(normal), scaled(tangent), scaled(bitangent), cell * cellSize + 0.05f, (cell + 1.0f) * cellSize - 0.05f);
+    }
+    return box;
+}
+
+// Floor, back wall and a box standing on the floor
+std::vector<TestMesh> makeRoom() {
+    TestMesh wall;
+    wall.material = "wall";
+    addQuad(wall, glm::vec3(0.0f, 1.0f, -2.0f), glm::vec3(2.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    return { makeFloor(), wall, makeBox("prop", glm::vec3(-0.5f, 0.4f, 0.0f), glm::vec3(0.4f)) };
+}
+
+// A point light over the room and a dim sun at an angle
+std::vector<BakeLight> roomLights() {
+    std::vector<BakeLight> lights(2);
+    lights[0].type = BakeLightType::Point;
+    lights[0].position = glm::vec3(0.5f, 2.5f, 1.0f);
+    lights[0].color = glm::vec3(3.0f, 2.5f, 2.0f);
+    lights[0].attenuationQuadratic = 0.2f;
+    lights[1].direction = glm::normalize(glm::vec3(0.4f, -1.0f, -0.3f));
+    lights[1].color = glm::vec3(0.4f);
+    return lights;
+}
+
+BakedScene buildScene(const std::vector<TestMesh>& meshes) {
+    BakedScene scene;
+    for (const TestMesh& mesh : meshes) {
+        BakedMeshRange range = scene.appendMesh(mesh.vertices.size(), mesh.indices.size(), mesh.material);
+        std::copy(mesh.vertices.begin(), mesh.vertices.end(), scene.vertices.begin() + range.firstVertex);
+        std::copy(mesh.indices.begin(), mesh.indices.end(), scene.indices.begin() + range.firstIndex);
+    }
+    return scene;
+}
+
+// Lights only, straight down: a texel depends on the light and on what is directly above it
+LightmapBakeOptions testOptions() {
+    LightmapBakeOptions options;
+    options.resolution = 32;
+    options.skySamples = 0;
+    options.dilation = 0;
+    options.tileSize = 8;
+    options.threads = 2;
+    return options;
+}
+
+// With the sky and dilation, so incremental bakes also have to redo those right
+LightmapBakeOptions roomOptions() {
+    LightmapBakeOptions options = testOptions();
+    options.skySamples = 8;
+    options.dilation = 2;
+    return options;
+}
+
+std::vector<BakeLight> sunFromAbove() {
+    std::vector<BakeLight> lights(1);
+    lights[0].direction = glm::vec3(0.0f, -1.0f, 0.0f);
+    return lights;
+}
+
+size_t countDirty(const LightmapDirtyRegion& region, size_t lightmap) {
+    size_t count = 0;
+    for (uint8_t dirty : region.texels[lightmap]) {
+        count += dirty;
+    }
+    return count;
+}
+
+size_t countCovered(const DirectionalLightmap& lightmap) {
+    size_t count = 0;
+    for (uint8_t covered : lightmap.coverage) {
+        count += covered;
+    }
+    return count;
+}
+
+// Texel of the floor lightmap over the given floor position; rows run from the top like the images
+size_t floorTexelIndex(float x, float z) {
+    const int resolution = testOptions().resolution;
+    int column = static_cast<int>((x + 2.0f) / 4.0f * resolution);
+    int row = static_cast<int>((z + 2.0f) / 4.0f * resolution);
+    return static_cast<size_t>(row) * resolution + column;
+}
+
+uint8_t floorTexel(const LightmapDirtyRegion& region, float x, float z) {
+    return region.texels[0][floorTexelIndex(x, z)];
+}
+
+bool sameLightmaps(const std::vector<DirectionalLightmap>& a, const std::vector<DirectionalLightmap>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].material != b[i].material || a[i].width != b[i].width || a[i].height != b[i].height ||
+            a[i].layers != b[i].layers || a[i].coverage != b[i].coverage) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Bakes the edited room against the previous bake and from scratch; both have to give the same
+// lightmaps and the same meshes in every texel's dependencies
+LightmapBake checkIncrementalBake(const LightmapBake& previous, const std::vector<TestMesh>& meshes, const std::vector<BakeLight>& lights,
+    const LightmapBakeOptions& options, LightmapBakeStats& stats) {
+    BakedScene scene = buildScene(meshes);
+    LightmapBake incremental = bakeLightmaps(scene, lights, options, &previous, &stats);
+    LightmapBake full = bakeLightmaps(scene, lights, options);
+
+    CHECK(sameLightmaps(incremental.lightmaps, full.lightmaps));
+    CHECK_EQUAL(full.dependencies.size(), incremental.dependencies.size());
+    for (size_t i = 0; i < full.dependencies.size() && i < incremental.dependencies.size(); i++) {
+        CHECK(incremental.dependencies[i].meshes == full.dependencies[i].meshes);
+    }
+    return incremental;
+}
+
+size_t countModified(const LightmapBake& bake) {
+    size_t count = 0;
+    for (const DirectionalLightmap& lightmap : bake.lightmaps) {
+        count += lightmap.modified;
+    }
+    return count;
+}
+
+} // namespace
+
+TEST_CASE(dirtyRegionOfAnUnchangedSceneIsEmpty) {
+    std::vector<TestMesh> meshes = { makeFloor(), makePlate("plate", glm::vec3(0.0f, 1.0f, 0.0f), 0.5f) };
+    BakedScene scene = buildScene(meshes);
+    LightmapBake previous = bakeLightmaps(scene, sunFromAbove(), testOptions());
+
+    LightmapDirtyRegion region = findLightmapDirtyRegion(previous, scene, sunFromAbove(), testOptions());
+
+    CHECK_EQUAL(size_t(0), region.dirtyTexels);
+    CHECK(region.coveredTexels > 0);
+    CHECK_EQUAL(size_t(2), region.texels.size());
+    CHECK_EQUAL(size_t(0), countDirty(region, 0));
+    CHECK_EQUAL(size_t(0), countDirty(region, 1));
+}
+
+TEST_CASE(dirtyRegionFollowsAnOccluderMovedIntoTheLightPath) {
+    std::vector<TestMesh> meshes = { makeFloor(), makePlate("plate", glm::vec3(10.0f, 1.0f, 0.0f), 0.5f) };
+    LightmapBake previous = bakeLightmaps(buildScene(meshes), sunFromAbove(), testOptions());
+
+    // Off to the side the plate shadowed nothing; above the floor's center it blocks the light rays there
+    meshes[1] = makePlate("plate", glm::vec3(0.0f, 1.0f, 0.0f), 0.5f);
+    LightmapDirtyRegion region = findLightmapDirtyRegion(previous, buildScene(meshes), sunFromAbove(), testOptions());
+
+    CHECK(floorTexel(region, 0.0f, 0.0f) != 0);
+    CHECK(floorTexel(region, 0.3f, -0.3f) != 0);
+    CHECK_EQUAL(0, static_cast<int>(floorTexel(region, 1.5f, 1.5f)));
+    CHECK_EQUAL(0, static_cast<int>(floorTexel(region, -1.5f, 0.0f)));
+    CHECK(region.dirtyTexels < region.coveredTexels);
+}
+
+TEST_CASE(dirtyRegionCoversEveryTexelAChangedLightReaches) {
+    // The plate faces away from the light, so none of its texels depend on it
+    std::vector<TestMesh> meshes = { makeFloor(), makePlate("plate", glm::vec3(10.0f, 1.0f, 0.0f), 0.5f) };
+    BakedScene scene = buildScene(meshes);
+    std::vector<BakeLight> lights = sunFromAbove();
+    LightmapBake previous = bakeLightmaps(scene, lights, testOptions());
+
+    lights[0].color = glm::vec3(0.5f, 0.25f, 0.1f);
+    LightmapDirtyRegion region = findLightmapDirtyRegion(previous, scene, lights, testOptions());
+
+    CHECK_EQUAL(countCovered(previous.lightmaps[0]), countDirty(region, 0));
+    CHECK_EQUAL(size_t(0), countDirty(region, 1));
+}
+
+TEST_CASE(dirtyRegionRetracesASwappedMesh) {
+    std::vector<TestMesh> meshes = { makeFloor(), makePlate("plate", glm::vec3(10.0f, 1.0f, 0.0f), 0.5f) };
+    LightmapBake previous = bakeLightmaps(buildScene(meshes), sunFromAbove(), testOptions());
+
+    // Another plate in the same slot, with the same material and lightmap
+    meshes[1] = makePlate("plate", glm::vec3(10.0f, 2.0f, 0.0f), 0.75f);
+    BakedScene scene = buildScene(meshes);
+    LightmapDirtyRegion region = findLightmapDirtyRegion(previous, scene, sunFromAbove(), testOptions());
+
+    CHECK_EQUAL(1, region.previousLightmaps[1]);
+    LightmapBake current = bakeLightmaps(scene, sunFromAbove(), testOptions());
+    CHECK(countDirty(region, 1) >= countCovered(current.lightmaps[1]));
+    CHECK_EQUAL(size_t(0), countDirty(region, 0));
+}
+
+TEST_CASE(incrementalBakeOfAnUnchangedRoomTracesNothing) {
+    std::vector<TestMesh> meshes = makeRoom();
+    LightmapBake previous = bakeLightmaps(buildScene(meshes), roomLights(), roomOptions());
+
+    LightmapBakeStats stats;
+    LightmapBake incremental = checkIncrementalBake(previous, meshes, roomLights(), roomOptions(), stats);
+
+    CHECK_EQUAL(size_t(0), stats.texels);
+    CHECK(stats.reusedTexels > 0);
+    CHECK_EQUAL(size_t(0), countModified(incremental));
+}
+
+TEST_CASE(incrementalBakeMatchesAFullBakeAfterMovingAProp) {
+    std::vector<TestMesh> meshes = makeRoom();
+    LightmapBake previous = bakeLightmaps(buildScene(meshes), roomLights(), roomOptions());
+
+    meshes[2] = makeBox("prop", glm::vec3(0.6f, 0.4f, -0.8f), glm::vec3(0.4f));
+    LightmapBakeStats stats;
+    checkIncrementalBake(previous, meshes, roomLights(), roomOptions(), stats);
+
+    CHECK(stats.texels > 0);
+    CHECK(stats.reusedTexels > 0);
+}
+
+TEST_CASE(incrementalBakeMatchesAFullBakeAfterALightEdit) {
+    std::vector<TestMesh> meshes = makeRoom();
+    std::vector<BakeLight> lights = roomLights();
+    LightmapBake previous = bakeLightmaps(buildScene(meshes), lights, roomOptions());
+
+    lights[0].color *= 0.5f;
+    LightmapBakeStats stats;
+    checkIncrementalBake(previous, meshes, lights, roomOptions(), stats);
+
+    CHECK(stats.texels > 0);
+}
+
+TEST_CASE(incrementalBakeMatchesAFullBakeAfterAddingAndRemovingAMesh) {
+    std::vector<TestMesh> meshes = makeRoom();
+    LightmapBake previous = bakeLightmaps(buildScene(meshes), roomLights(), roomOptions());
+
+    meshes.push_back(makeBox("crate", glm::vec3(-1.2f, 0.25f, 1.2f), glm::vec3(0.25f)));
+    LightmapBakeStats added;
+    LightmapBake withCrate = checkIncrementalBake(previous, meshes, roomLights(), roomOptions(), added);
+    CHECK_EQUAL(size_t(4), withCrate.lightmaps.size());
+
+    meshes.pop_back();
+    LightmapBakeStats removed;
+    LightmapBake withoutCrate = checkIncrementalBake(withCrate, meshes, roomLights(), roomOptions(), removed);
+    CHECK_EQUAL(size_t(3), withoutCrate.lightmaps.size());
+    CHECK(removed.texels > 0);
+    CHECK(removed.reusedTexels > 0);
+}
+
+TEST_CASE(incrementalBakeMatchesAFullBakeAfterRemovingALight) {
+    std::vector<TestMesh> meshes = makeRoom();
+    std::vector<BakeLight> lights = roomLights();
+    LightmapBake previous = bakeLightmaps(buildScene(meshes), lights, roomOptions());
+
+    lights.pop_back();
+    LightmapBakeStats stats;
+    checkIncrementalBake(previous, meshes, lights, roomOptions(), stats);
+
+    CHECK(stats.texels > 0);
+}
+
+TEST_CASE(incrementalBakeRebakesEverythingAfterAnOptionsChange) {
+    std::vector<TestMesh> meshes = makeRoom();
+    LightmapBakeOptions options = roomOptions();
+    LightmapBake previous = bakeLightmaps(buildScene(meshes), roomLights(), options);
+
+    options.skySamples = 4;
+    LightmapBakeStats stats;
+    checkIncrementalBake(previous, meshes, roomLights(), options, stats);
+
+    CHECK(stats.texels > 0);
+    CHECK_EQUAL(size_t(0), stats.reusedTexels);
+}
+
+TEST_CASE(bakeRecordRoundTripsThroughItsFile) {
+    TempDirectory directory("lightmap-bake");
+    std::string path = directory.path("room.lightmapbake");
+    LightmapBake bake = bakeLightmaps(buildScene(makeRoom()), roomLights(), roomOptions());
+
+    LightmapBake loaded;
+    CHECK(bake.write(path));
+    CHECK(loaded.read(path));
+    CHECK_EQUAL(bake.optionsHash, loaded.optionsHash);
+    CHECK(loaded.meshHashes == bake.meshHashes);
+    CHECK(loaded.lightHashes == bake.lightHashes);
+    CHECK(sameLightmaps(loaded.lightmaps, bake.lightmaps));
+    CHECK_EQUAL(bake.dependencies.size(), loaded.dependencies.size());
+    for (size_t i = 0; i < bake.dependencies.size() && i < loaded.dependencies.size(); i++) {
+        CHECK(loaded.dependencies[i].meshes == bake.dependencies[i].meshes);
+        CHECK(loaded.dependencies[i].offsets == bake.dependencies[i].offsets);
+        CHECK(loaded.dependencies[i].entries == bake.dependencies[i].entries);
+    }
+}
+
+TEST_CASE(bakeGivesTheSameLightmapsOnOneAndManyThreads) {
+    BakedScene scene = buildScene(makeRoom());
+    LightmapBakeOptions options = roomOptions();
+    options.tileSize = 4; // Enough tiles for the workers to steal from each other
+
+    options.threads = 1;
+    std::vector<DirectionalLightmap> single = bakeDirectionalLightmaps(scene, roomLights(), options);
+    options.threads = 4;
+    LightmapBakeStats stats;
+    std::vector<DirectionalLightmap> parallel = bakeDirectionalLightmaps(scene, roomLights(), options, &stats);
+
+    CHECK_EQUAL(4u, stats.threads);
+    CHECK(sameLightmaps(single, parallel));
+}
+
+TEST_CASE(bakeOfASunFromAboveLightsAnOpenFloorEquallyAlongTheBasis) {
+    // Each basis direction leans 1/sqrt(3) toward the normal, so each layer holds color / (sqrt(3) pi)
+    std::vector<BakeLight> lights = sunFromAbove();
+    lights[0].color = glm::vec3(1.0f, 0.5f, 2.0f);
+    std::vector<DirectionalLightmap> lightmaps = bakeDirectionalLightmaps(buildScene({ makeFloor() }), lights, testOptions());
+    const float scale = 1.0f / (std::sqrt(3.0f) * 3.14159265f);
+
+    CHECK_EQUAL(size_t(1), lightmaps.size());
+    const DirectionalLightmap& floor = lightmaps[0];
+    CHECK(countCovered(floor) > 0);
+    for (size_t texel = 0; texel < floor.coverage.size(); texel++) {
+        if (!floor.coverage[texel]) {
+            continue;
+        }
+        for (const std::vector<glm::vec3>& layer : floor.layers) {
+            for (int c = 0; c < 3; c++) {
+                CHECK(std::abs(layer[texel][c] - lights[0].color[c] * scale) < 1e-4f);
+            }
+        }
+    }
+}
+
+TEST_CASE(bakeLeavesATexelUnderAnOccluderDark) {
+    std::vector<TestMesh> meshes = { makeFloor(), makePlate("plate", glm::vec3(0.0f, 1.0f, 0.0f), 0.5f) };
+    std::vector<DirectionalLightmap> lightmaps = bakeDirectionalLightmaps(buildScene(meshes), sunFromAbove(), testOptions());
+
+    size_t shadowed = floorTexelIndex(0.0f, 0.0f);
+    size_t open = floorTexelIndex(1.5f, 1.5f);
+    CHECK_EQUAL(1, static_cast<int>(lightmaps[0].coverage[shadowed]));
+    for (const std::vector<glm::vec3>& layer : lightmaps[0].layers) {
+        CHECK_EQUAL(0.0f, layer[shadowed].x);
+        CHECK_EQUAL(0.0f, layer[shadowed].y);
+        CHECK_EQUAL(0.0f, layer[shadowed].z);
+        CHECK(layer[open].x > 0.0f);
+    }
+}
@@ -0,0 +1,133 @@
+#include "TestFramework.h"
+#include "MaterialTable.h"
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+TextureShape makeShape(int width, int height, GLenum internalFormat = GL_RGBA8) {
+    TextureShape shape;
+    shape.internalFormat = internalFormat;
+    shape.width = width;
+    shape.height = height;
+    shape.levels = 1;
+    return shape;
+}
+
+bool slotEmpty(const MaterialTableEntry& entry, int slot) {
+    return entry.textures[slot][0] == MATERIAL_SLOT_EMPTY && entry.textures[slot][1] == MATERIAL_SLOT_EMPTY;
+}
+
+} // namespace
+
+TEST_CASE(packMaterialEntryFillsTheSlotsOfResolvedTextures) {
+    std::unordered_map<GLuint, TextureSlot> slots = { { 10, { 0, 3 } }, { 11, { 1, 0 } } };
+    std::vector<MaterialTextureRef> textures = {
+        { 0, 10, glm::vec2(2.0f, 2.0f) },
+        { 2, 11, glm::vec2(1.0f, 1.0f) },
+    };
+    MaterialTableEntry entry;
+
+    CHECK(packMaterialEntry(textures, slots, entry));
+    CHECK_EQUAL(0u, entry.textures[0][0]);
+    CHECK_EQUAL(3u, entry.textures[0][1]);
+    CHECK_EQUAL(1u, entry.textures[2][0]);
+    CHECK_EQUAL(0u, entry.textures[2][1]);
+    CHECK_EQUAL(2.0f, entry.tiling[0].x);
+    CHECK_EQUAL(2.0f, entry.tiling[0].y);
+    for (int slot : { 1, 3, 4, 5, 6, 7, 8, 9 }) {
+        CHECK(slotEmpty(entry, slot));
+        CHECK_EQUAL(1.0f, entry.tiling[slot].x);
+    }
+}
+
+TEST_CASE(packMaterialEntryLeavesUnresolvedTexturesAndOutsideUnitsEmpty) {
+    std::unordered_map<GLuint, TextureSlot> slots = { { 10, { 0, 0 } }, { 12, TextureSlot() } };
+    std::vector<MaterialTextureRef> textures = {
+        { 0, 10, glm::vec2(1.0f) },
+        { 1, 11, glm::vec2(1.0f) },                   // Not resolved
+        { 5, 12, glm::vec2(1.0f) },                   // Resolved to an empty slot
+        { MATERIAL_TABLE_SLOTS, 10, glm::vec2(1.0f) }, // Past the table
+        { -1, 10, glm::vec2(1.0f) },
+    };
+    MaterialTableEntry entry;
+
+    CHECK(!packMaterialEntry(textures, slots, entry));
+    CHECK(!slotEmpty(entry, 0));
+    CHECK(slotEmpty(entry, 1));
+    CHECK(slotEmpty(entry, 5));
+}
+
+TEST_CASE(packMaterialEntryKeepsTheTilingOfFallbackSlots) {
+    std::unordered_map<GLuint, TextureSlot> slots;
+    std::vector<MaterialTextureRef> textures = { { 6, 20, glm::vec2(3.0f, 4.0f) } };
+    MaterialTableEntry entry;
+
+    // The shader reads the classic sampler for this slot, but its tiling only from the table
+    CHECK(!packMaterialEntry(textures, slots, entry));
+    CHECK(slotEmpty(entry, 6));
+    CHECK_EQUAL(3.0f, entry.tiling[6].x);
+    CHECK_EQUAL(4.0f, entry.tiling[6].y);
+}
+
+TEST_CASE(assignArrayLayersGroupsShapesMostTexturesFirst) {
+    TextureShape small = makeShape(256, 256);
+    TextureShape large = makeShape(1024, 1024);
+    std::vector<std::pair<GLuint, TextureShape>> textures = {
+        { 1, small }, { 2, large }, { 3, large }, { 2, large }, { 4, large },
+    };
+
+    TextureArrayLayout layout = assignArrayLayers(textures, 16, 6);
+
+    CHECK_EQUAL(size_t(2), layout.arrays.size());
+    CHECK(layout.arrays[0] == large);
+    CHECK(layout.arrays[1] == small);
+    // The repeated texture gets one layer; layers keep first-seen order
+    CHECK_EQUAL(size_t(3), layout.layers[0].size());
+    CHECK_EQUAL(0u, layout.slots[2].x);
+    CHECK_EQUAL(0u, layout.slots[2].y);
+    CHECK_EQUAL(2u, layout.slots[4].y);
+    CHECK_EQUAL(1u, layout.slots[1].x);
+    CHECK_EQUAL(0u, layout.slots[1].y);
+    CHECK(layout.unplaced.empty());
+}
+
+TEST_CASE(assignArrayLayersSplitsAShapeAtMaxLayers) {
+    TextureShape shape = makeShape(512, 512, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+    std::vector<std::pair<GLuint, TextureShape>> textures;
+    for (GLuint texture = 1; texture <= 5; texture++) {
+        textures.push_back({ texture, shape });
+    }
+
+    TextureArrayLayout layout = assignArrayLayers(textures, 2, 6);
+
+    CHECK_EQUAL(size_t(3), layout.arrays.size());
+    CHECK_EQUAL(size_t(2), layout.layers[0].size());
+    CHECK_EQUAL(size_t(2), layout.layers[1].size());
+    CHECK_EQUAL(size_t(1), layout.layers[2].size());
+    CHECK_EQUAL(1u, layout.slots[3].x);
+    CHECK_EQUAL(0u, layout.slots[3].y);
+    CHECK_EQUAL(2u, layout.slots[5].x);
+    CHECK(layout.unplaced.empty());
+}
+
+TEST_CASE(assignArrayLayersReportsTexturesPastMaxArraysAsUnplaced) {
+    TextureShape common = makeShape(512, 512);
+    TextureShape rare = makeShape(128, 64);
+    TextureShape other = makeShape(64, 64);
+    std::vector<std::pair<GLuint, TextureShape>> textures = {
+        { 1, rare }, { 2, common }, { 3, common }, { 4, common }, { 5, other }, { 6, other }, { 7, common }, { 8, common },
+    };
+
+    // Two arrays of two layers: the common shape takes both, its fifth texture and the other shapes overflow
+    TextureArrayLayout layout = assignArrayLayers(textures, 2, 2);
+
+    CHECK_EQUAL(size_t(2), layout.arrays.size());
+    CHECK(layout.arrays[0] == common);
+    CHECK(layout.arrays[1] == common);
+    CHECK_EQUAL(size_t(0), layout.slots.count(1));
+    CHECK_EQUAL(size_t(0), layout.slots.count(5));
+    std::vector<GLuint> expectedUnplaced = { 8, 5, 6, 1 };
+    CHECK(layout.unplaced == expectedUnplaced);
+}
@@ -0,0 +1,152 @@
+#include "TestFramework.h"
+#include "ProgramBinaryCache.h"
+#include "Hash.h"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+DriverInfo testDriver() {
+    DriverInfo driver;
+    driver.vendor = "Vendor";
+    driver.renderer = "Renderer 9000";
+    driver.version = "4.6.0 Driver 100.1";
+    return driver;
+}
+
+ProgramBinaryEntry makeEntry(uint64_t sourceHash, const DriverInfo& driver) {
+    ProgramBinaryEntry entry;
+    entry.key = programBinaryKey(sourceHash, driver);
+    entry.sourceHash = sourceHash;
+    entry.driverHash = driver.hash();
+    entry.binaryFormat = 0x8e21;
+    entry.binarySize = 1234;
+    entry.binaryHash = 0xfeedface12345678ull;
+    return entry;
+}
+
+void writeText(const std::string& path, const std::string& text) {
+    std::ofstream out(path, std::ios::trunc);
+    out << text;
+}
+
+} // namespace
+
+TEST_CASE(programBinaryKeyChangesWithTheDriverVersion) {
+    DriverInfo driver = testDriver();
+    DriverInfo updated = driver;
+    updated.version = "4.6.0 Driver 100.2";
+
+    CHECK(programBinaryKey(1, driver) == programBinaryKey(1, testDriver()));
+    CHECK(programBinaryKey(1, driver) != programBinaryKey(1, updated));
+    CHECK(programBinaryKey(1, driver) != programBinaryKey(2, driver));
+
+    // The fields are separated, so moving text from one to the next is a different driver
+    DriverInfo shifted = driver;
+    shifted.renderer = "Renderer 900";
+    shifted.version = "0" + driver.version;
+    CHECK(driver.hash() != shifted.hash());
+}
+
+TEST_CASE(programBinaryIndexRoundTrips) {
+    TempDirectory directory("program-binary-index");
+    DriverInfo driver = testDriver();
+    ProgramBinaryIndex index;
+    index.insert(makeEntry(1, driver));
+    index.insert(makeEntry(2, driver));
+    CHECK(index.save(directory.path("index.txt")));
+
+    ProgramBinaryIndex loaded;
+    CHECK(loaded.load(directory.path("index.txt")));
+    CHECK_EQUAL(size_t(2), loaded.size());
+    for (uint64_t sourceHash : { 1ull, 2ull }) {
+        ProgramBinaryEntry expected = makeEntry(sourceHash, driver);
+        const ProgramBinaryEntry* entry = loaded.find(expected.key);
+        CHECK(entry != nullptr);
+        if (entry) {
+            CHECK_EQUAL(expected.sourceHash, entry->sourceHash);
+            CHECK_EQUAL(expected.driverHash, entry->driverHash);
+            CHECK_EQUAL(expected.binaryFormat, entry->binaryFormat);
+            CHECK_EQUAL(expected.binarySize, entry->binarySize);
+            CHECK_EQUAL(expected.binaryHash, entry->binaryHash);
+        }
+    }
+
+    // A missing index is an empty cache, not an error
+    CHECK(loaded.load(directory.path("missing.txt")));
+    CHECK_EQUAL(size_t(0), loaded.size());
+}
+
+TEST_CASE(programBinaryIndexDiscardsAnIndexItCannotTrust) {
+    TempDirectory directory("program-binary-index-bad");
+    DriverInfo driver = testDriver();
+    ProgramBinaryIndex index;
+    index.insert(makeEntry(1, driver));
+    CHECK(index.save(directory.path("index.txt")));
+
+    std::ifstream in(directory.path("index.txt"));
+    std::string header;
+    std::string line;
+    std::getline(in, header);
+    std::getline(in, line);
+    in.close();
+
+    ProgramBinaryIndex loaded;
+    writeText(directory.path("version.txt"), "program-binary-index 2\n" + line + "\n");
+    CHECK(!loaded.load(directory.path("version.txt")));
+    CHECK_EQUAL(size_t(0), loaded.size());
+
+    // A good entry followed by a damaged one: nothing is kept
+    writeText(directory.path("corrupt.txt"), header + "\n" + line + "\n12ab 34 zz\n");
+    CHECK(!loaded.load(directory.path("corrupt.txt")));
+    CHECK_EQUAL(size_t(0), loaded.size());
+
+    writeText(directory.path("header.txt"), "scene-cache 1\n" + line + "\n");
+    CHECK(!loaded.load(directory.path("header.txt")));
+    CHECK_EQUAL(size_t(0), loaded.size());
+}
+
+TEST_CASE(programBinaryIndexErasesOtherDriversEntries) {
+    DriverInfo driver = testDriver();
+    DriverInfo old = driver;
+    old.version = "4.6.0 Driver 99.0";
+    ProgramBinaryIndex index;
+    index.insert(makeEntry(1, driver));
+    index.insert(makeEntry(2, old));
+    index.insert(makeEntry(3, old));
+
+    std::vector<uint64_t> stale = index.eraseOtherDrivers(driver.hash());
+
+    std::vector<uint64_t> expected = { makeEntry(2, old).key, makeEntry(3, old).key };
+    std::sort(stale.begin(), stale.end());
+    std::sort(expected.begin(), expected.end());
+    CHECK(stale == expected);
+    CHECK_EQUAL(size_t(1), index.size());
+    CHECK(index.find(makeEntry(1, driver).key) != nullptr);
+}
+
+TEST_CASE(readProgramBinaryFileRejectsASizeOrHashMismatch) {
+    TempDirectory directory("program-binary-blob");
+    std::vector<uint8_t> binary = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    std::string path = programBinaryPath(directory.path(""), 42);
+    CHECK(writeProgramBinaryFile(path, binary));
+
+    ProgramBinaryEntry entry;
+    entry.binarySize = binary.size();
+    entry.binaryHash = hashBytes(binary.data(), binary.size());
+    std::vector<uint8_t> read;
+    CHECK(readProgramBinaryFile(path, entry, read));
+    CHECK(read == binary);
+
+    ProgramBinaryEntry wrongSize = entry;
+    wrongSize.binarySize = binary.size() + 1;
+    CHECK(!readProgramBinaryFile(path, wrongSize, read));
+
+    // Same size, one byte changed on disk
+    binary[4] ^= 0xff;
+    CHECK(writeProgramBinaryFile(path, binary));
+    CHECK(!readProgramBinaryFile(path, entry, read));
+
+    CHECK(!readProgramBinaryFile(programBinaryPath(directory.path(""), 43), entry, read));
+}
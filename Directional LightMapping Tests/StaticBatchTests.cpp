@@ -0,0 +1,168 @@
+#include "TestFramework.h"
+#include "Material.h"
+#include "RenderQueue.h"
+#include "StaticBatch.h"
+#include <memory>
+
+namespace {
+
+std::unique_ptr<Material> makeMaterial(GLuint program, uint32_t textureSetId, bool blended = false, uint32_t drawGroupId = 0) {
+    auto material = std::make_unique<Material>("fixtures/materials/Plain.xml");
+    material->shaderProgram = program;
+    material->textureSetId = textureSetId;
+    material->blendingEnabled = blended;
+    material->drawGroupId = drawGroupId;
+    return material;
+}
+
+std::vector<Vertex> makeVertices(size_t count, float x) {
+    std::vector<Vertex> vertices(count);
+    for (size_t i = 0; i < count; i++) {
+        vertices[i].Position = glm::vec3(x, static_cast<float>(i), 0.0f);
+    }
+    return vertices;
+}
+
+BatchDraw makeDraw(const Material& material, uint32_t meshIndex, uint32_t firstIndex, uint32_t indexCount, float viewDepth = 1.0f) {
+    BatchRange range;
+    range.firstIndex = firstIndex;
+    range.indexCount = indexCount;
+    range.firstVertex = meshIndex * 100;
+    range.meshIndex = meshIndex;
+    return { RenderQueue::makeSortKey(material, 1, viewDepth, meshIndex), &material, range };
+}
+
+} // namespace
+
+TEST_CASE(packMeshAppendsAfterPreviousMeshes) {
+    std::vector<Vertex> packedVertices;
+    std::vector<unsigned int> packedIndices;
+    std::vector<Vertex> first = makeVertices(3, 1.0f);
+    std::vector<Vertex> second = makeVertices(4, 2.0f);
+    const unsigned int firstIndices[] = { 0, 1, 2 };
+    const unsigned int secondIndices[] = { 0, 1, 2, 2, 3, 0 };
+
+    BatchRange a = packMesh(packedVertices, packedIndices, first.data(), first.size(), firstIndices, 3);
+    BatchRange b = packMesh(packedVertices, packedIndices, second.data(), second.size(), secondIndices, 6);
+
+    CHECK_EQUAL(0u, a.firstVertex);
+    CHECK_EQUAL(3u, a.vertexCount);
+    CHECK_EQUAL(0u, a.firstIndex);
+    CHECK_EQUAL(3u, a.indexCount);
+    CHECK_EQUAL(3u, b.firstVertex);
+    CHECK_EQUAL(4u, b.vertexCount);
+    CHECK_EQUAL(3u, b.firstIndex);
+    CHECK_EQUAL(6u, b.indexCount);
+
+    CHECK_EQUAL(size_t(7), packedVertices.size());
+    CHECK_EQUAL(size_t(9), packedIndices.size());
+    CHECK_EQUAL(2.0f, packedVertices[b.firstVertex].Position.x);
+    CHECK_EQUAL(3.0f, packedVertices[b.firstVertex + 3].Position.y);
+}
+
+TEST_CASE(packMeshKeepsIndicesRelativeToTheMesh) {
+    std::vector<Vertex> packedVertices = makeVertices(10, 0.0f);
+    std::vector<unsigned int> packedIndices(5, 0u);
+    std::vector<Vertex> mesh = makeVertices(3, 1.0f);
+    const unsigned int indices[] = { 2, 1, 0 };
+
+    BatchRange range = packMesh(packedVertices, packedIndices, mesh.data(), mesh.size(), indices, 3);
+
+    // The base vertex of the indirect command does the offsetting, not the index data
+    CHECK_EQUAL(10u, range.firstVertex);
+    CHECK_EQUAL(5u, range.firstIndex);
+    CHECK_EQUAL(2u, packedIndices[5]);
+    CHECK_EQUAL(1u, packedIndices[6]);
+    CHECK_EQUAL(0u, packedIndices[7]);
+}
+
+TEST_CASE(buildIndirectCommandsGroupsDrawsByMaterial) {
+    auto brick = makeMaterial(1, 1);
+    auto stone = makeMaterial(2, 2);
+    std::vector<BatchDraw> draws = {
+        makeDraw(*brick, 0, 0, 30),
+        makeDraw(*stone, 1, 30, 60),
+        makeDraw(*brick, 2, 90, 12),
+    };
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<IndirectDrawGroup> groups;
+
+    buildIndirectCommands(draws, commands, groups);
+
+    CHECK_EQUAL(size_t(3), commands.size());
+    CHECK_EQUAL(size_t(2), groups.size());
+    CHECK(groups[0].material == brick.get());
+    CHECK_EQUAL(0u, groups[0].firstCommand);
+    CHECK_EQUAL(2u, groups[0].commandCount);
+    CHECK(groups[1].material == stone.get());
+    CHECK_EQUAL(2u, groups[1].firstCommand);
+    CHECK_EQUAL(1u, groups[1].commandCount);
+
+    // Each command draws its mesh's range once, with the mesh index as the base instance
+    for (const auto& command : commands) {
+        CHECK_EQUAL(1u, command.instanceCount);
+        CHECK_EQUAL(static_cast<GLint>(command.baseInstance * 100), command.baseVertex);
+    }
+    const DrawElementsIndirectCommand& stoneCommand = commands[groups[1].firstCommand];
+    CHECK_EQUAL(1u, stoneCommand.baseInstance);
+    CHECK_EQUAL(30u, stoneCommand.firstIndex);
+    CHECK_EQUAL(60u, stoneCommand.count);
+}
+
+TEST_CASE(buildIndirectCommandsMergesMaterialTableDrawGroups) {
+    auto brick = makeMaterial(1, 1, false, 7);
+    auto stone = makeMaterial(1, 2, false, 7);
+    auto glass = makeMaterial(1, 3, false, 0);
+    std::vector<BatchDraw> draws = {
+        makeDraw(*brick, 0, 0, 3),
+        makeDraw(*glass, 1, 3, 3),
+        makeDraw(*stone, 2, 6, 3),
+    };
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<IndirectDrawGroup> groups;
+
+    buildIndirectCommands(draws, commands, groups);
+
+    // Brick and stone differ only in their table entry, so one multi-draw covers both
+    CHECK_EQUAL(size_t(2), groups.size());
+    CHECK(groups[0].material == glass.get());
+    CHECK_EQUAL(1u, groups[0].commandCount);
+    CHECK_EQUAL(7u, groups[1].material->drawGroupId);
+    CHECK_EQUAL(2u, groups[1].commandCount);
+}
+
+TEST_CASE(buildIndirectCommandsDrawsBlendedMeshesLastBackToFront) {
+    auto opaque = makeMaterial(1, 1);
+    auto glass = makeMaterial(2, 2, true);
+    std::vector<BatchDraw> draws = {
+        makeDraw(*glass, 0, 0, 3, 5.0f),
+        makeDraw(*glass, 1, 3, 3, 20.0f),
+        makeDraw(*opaque, 2, 6, 3, 1.0f),
+        makeDraw(*glass, 3, 9, 3, 5.0f),
+    };
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<IndirectDrawGroup> groups;
+
+    buildIndirectCommands(draws, commands, groups);
+
+    CHECK_EQUAL(size_t(4), commands.size());
+    CHECK_EQUAL(2u, commands[0].baseInstance);
+    CHECK_EQUAL(1u, commands[1].baseInstance);
+    // Equal depths keep the scene's mesh order
+    CHECK_EQUAL(0u, commands[2].baseInstance);
+    CHECK_EQUAL(3u, commands[3].baseInstance);
+}
+
+TEST_CASE(buildIndirectCommandsClearsThePreviousFrame) {
+    auto brick = makeMaterial(1, 1);
+    std::vector<BatchDraw> draws = { makeDraw(*brick, 0, 0, 3) };
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<IndirectDrawGroup> groups;
+    buildIndirectCommands(draws, commands, groups);
+
+    draws.clear();
+    buildIndirectCommands(draws, commands, groups);
+
+    CHECK(commands.empty());
+    CHECK(groups.empty());
+}
@@ -0,0 +1,140 @@
+#include "TestFramework.h"
+#include "Camera.h"
+#include "FrameConstants.h"
+#include "GLRecorder.h"
+#include "GLStateTracker.h"
+#include "Material.h"
+#include "RenderQueue.h"
+#include "SubmissionCheck.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// Programs, textures and uniform buffers are cached process-wide, so every test records into one backend
+GLRecorder& recorder() {
+    static GLRecorder instance;
+    if (!instance.installed()) {
+        instance.install();
+    }
+    return instance;
+}
+
+// The fixture materials drawn through the render queue, as the level's meshes are
+struct RecordedScene {
+    std::vector<std::unique_ptr<Material>> materials;
+    std::vector<const Material*> meshMaterials;
+    std::vector<GLuint> meshVaos;
+    FrameConstants frame;
+    GLStateTracker state;
+    RenderQueue queue;
+    unsigned int framesDrawn = 0;
+
+    RecordedScene() {
+        recorder().resetCounters();
+        for (const char* name : { "Brick", "Stone", "Glass", "Legacy" }) {
+            materials.push_back(std::make_unique<Material>(std::string("fixtures/materials/") + name + ".xml"));
+        }
+        // Brick and stone twice each, one glass pane, one legacy mesh
+        for (size_t materialIndex : { 0, 0, 1, 1, 2, 3 }) {
+            meshMaterials.push_back(materials[materialIndex].get());
+            meshVaos.push_back(createMeshVao());
+        }
+        frame.create();
+    }
+
+    static GLuint createMeshVao() {
+        const unsigned int indices[] = { 0, 1, 2, 2, 3, 0 };
+        GLuint vao, ebo;
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+        glGenBuffers(1, &ebo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        return vao;
+    }
+
+    // Starts a new frame of counters and submits every mesh
+    void draw() {
+        recorder().resetCounters();
+        Camera camera(glm::vec3(0.0f, 2.0f, 10.0f - static_cast<float>(framesDrawn)), glm::vec3(0.0f, 1.0f, 0.0f),
+            -90.0f, 0.0f, 6.0f, 0.1f, 45.0f, 0.1f, 500.0f);
+        frame.update(camera, 16.0f / 9.0f, false, false);
+        state.beginFrame();
+
+        queue.clear();
+        for (uint32_t i = 0; i < meshVaos.size(); i++) {
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(static_cast<float>(i) * 2.0f, 0.0f, 0.0f));
+            queue.submit(*meshMaterials[i], meshVaos[i], 6, &model, static_cast<float>(i) + 1.0f, i);
+        }
+        queue.sort();
+        queue.execute(frame, state);
+        framesDrawn++;
+    }
+};
+
+} // namespace
+
+TEST_CASE(fixtureMaterialsLoadWithoutGLErrors) {
+    RecordedScene scene;
+    SubmissionCheck check(recorder());
+
+    CHECK_EQUAL(0ull, check.loadErrors());
+    for (const auto& material : scene.materials) {
+        CHECK(material->shaderProgram != 0);
+    }
+    // Brick, stone and glass share the lit program
+    CHECK_EQUAL(scene.materials[0]->shaderProgram, scene.materials[2]->shaderProgram);
+    CHECK(scene.materials[0]->shaderProgram != scene.materials[3]->shaderProgram);
+}
+
+TEST_CASE(renderQueueFramesStayWithinTheSubmissionLimits) {
+    RecordedScene scene;
+    SubmissionCheck check(recorder());
+    std::ostringstream errors;
+
+    for (int frame = 0; frame < 4; frame++) {
+        scene.draw();
+        CHECK(check.checkFrame(scene.meshMaterials, 0, errors));
+        CHECK_EQUAL(static_cast<unsigned long long>(scene.meshVaos.size()), recorder().draws());
+    }
+
+    CHECK(check.passed());
+    if (!check.passed()) {
+        std::cerr << errors.str();
+        check.printReport(std::cerr);
+    }
+}
+
+TEST_CASE(submissionCheckCatchesARedundantProgramBind) {
+    RecordedScene scene;
+    SubmissionCheck check(recorder());
+    std::ostringstream errors;
+
+    scene.draw();
+    CHECK(check.checkFrame(scene.meshMaterials, 0, errors));
+
+    // A bind that bypasses the state tracker repeats the program the glass pane, drawn last, left bound
+    scene.draw();
+    glUseProgram(scene.materials[2]->shaderProgram);
+    CHECK(!check.checkFrame(scene.meshMaterials, 0, errors));
+
+    CHECK(!check.passed());
+    CHECK(errors.str().find("redundant binds") != std::string::npos);
+}
+
+TEST_CASE(submissionCheckLimitsDrawsToTheVisibleMeshes) {
+    RecordedScene scene;
+    SubmissionCheck check(recorder());
+    std::ostringstream errors;
+
+    // Every mesh was drawn, but only half of them count as visible
+    scene.draw();
+    std::vector<const Material*> visible(scene.meshMaterials.begin(), scene.meshMaterials.begin() + 3);
+    CHECK(!check.checkFrame(visible, 0, errors));
+    CHECK(errors.str().find("draws") != std::string::npos);
+}
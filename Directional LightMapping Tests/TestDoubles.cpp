@@ -0,0 +1,65 @@
+// Stand-ins for the loaders that live in the application's main file. They only create GL
+// objects, so the tests run against the GLRecorder and never read image files.
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "GLDispatch.h"
+#include "FileSystemUtils.h"
+#include "MipGenerator.h"
+#include "TextureCompression.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Assets resolve into the committed fixtures; the post-build step runs from the project directory
+std::string FileSystemUtils::getAssetFilePath(const std::string& path) {
+    return "fixtures/" + path;
+}
+
+GLuint compileShader(const char* vertexSrc, const char* fragmentSrc, const std::string& shaderName) {
+    GLuint shaders[2] = { glCreateShader(GL_VERTEX_SHADER), glCreateShader(GL_FRAGMENT_SHADER) };
+    const char* sources[2] = { vertexSrc, fragmentSrc };
+    GLuint program = glCreateProgram();
+    for (int i = 0; i < 2; i++) {
+        glShaderSource(shaders[i], 1, &sources[i], nullptr);
+        glCompileShader(shaders[i]);
+        glAttachShader(program, shaders[i]);
+    }
+    glLinkProgram(program);
+
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        std::cerr << "Test shader " << shaderName << " failed to link" << std::endl;
+    }
+    glDeleteShader(shaders[0]);
+    glDeleteShader(shaders[1]);
+    return program;
+}
+
+GLuint loadTextureFromFile(const char*, const std::string&, BlockFormat& format, const MipOptions&) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    const unsigned char texel[4] = { 255, 255, 255, 255 };
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+    format = BlockFormat::None;
+    return texture;
+}
+
+GLuint loadCubemap(const std::vector<std::string>&) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    return texture;
+}
+
+GLuint loadLightmapArray(const std::vector<std::string>& layers, BlockFormat& format, const MipOptions&, int& firstLayer) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, 1, 1, static_cast<GLsizei>(layers.size()));
+    format = BlockFormat::None;
+    firstLayer = 0;
+    return texture;
+}
@@ -0,0 +1,56 @@
+#ifndef TEST_FRAMEWORK_H
+#define TEST_FRAMEWORK_H
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Self-registering test cases. The test executable runs all of them as a post-build step and
+// exits non-zero if any check failed, which fails the build.
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+std::vector<TestCase>& testRegistry();
+void reportCheckFailure(const char* file, int line, const std::string& message);
+
+struct TestRegistration {
+    TestRegistration(const char* name, void (*run)()) { testRegistry().push_back({ name, run }); }
+};
+
+// Empty directory under the system temp directory for tests of on-disk formats, removed again
+// with everything in it when the test ends
+class TempDirectory {
+public:
+    explicit TempDirectory(const std::string& name);
+    ~TempDirectory();
+
+    std::string path(const std::string& file) const;
+
+private:
+    std::string directory_;
+};
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static TestRegistration name##Registration(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) reportCheckFailure(__FILE__, __LINE__, #condition); \
+    } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+    do { \
+        const auto expectedValue = (expected); \
+        const auto actualValue = (actual); \
+        if (!(expectedValue == actualValue)) { \
+            std::ostringstream message; \
+            message << #actual << " is " << actualValue << ", expected " << expectedValue; \
+            reportCheckFailure(__FILE__, __LINE__, message.str()); \
+        } \
+    } while (0)
+
+#endif
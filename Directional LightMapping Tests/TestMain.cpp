@@ -0,0 +1,56 @@
+#include "TestFramework.h"
+#include <exception>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+unsigned int currentFailures = 0;
+
+} // namespace
+
+std::vector<TestCase>& testRegistry() {
+    static std::vector<TestCase> registry;
+    return registry;
+}
+
+void reportCheckFailure(const char* file, int line, const std::string& message) {
+    std::cerr << file << "(" << line << "): check failed: " << message << std::endl;
+    currentFailures++;
+}
+
+TempDirectory::TempDirectory(const std::string& name)
+    : directory_((std::filesystem::temp_directory_path() / ("dlm-tests-" + name)).string()) {
+    std::filesystem::remove_all(directory_);
+    std::filesystem::create_directories(directory_);
+}
+
+TempDirectory::~TempDirectory() {
+    std::error_code ec;
+    std::filesystem::remove_all(directory_, ec);
+}
+
+std::string TempDirectory::path(const std::string& file) const {
+    return (std::filesystem::path(directory_) / file).string();
+}
+
+// Runs every registered test; the exit code is the number of failed tests
+int main() {
+    unsigned int failedTests = 0;
+    for (const auto& test : testRegistry()) {
+        currentFailures = 0;
+        try {
+            test.run();
+        }
+        catch (const std::exception& e) {
+            reportCheckFailure(test.name, 0, std::string("exception: ") + e.what());
+        }
+        std::cout << (currentFailures == 0 ? "[ ok ] " : "[FAIL] ") << test.name << std::endl;
+        if (currentFailures != 0) {
+            failedTests++;
+        }
+    }
+
+    std::cout << testRegistry().size() - failedTests << " of " << testRegistry().size() << " tests passed" << std::endl;
+    return static_cast<int>(failedTests);
+}
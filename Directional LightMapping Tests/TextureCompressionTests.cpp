@@ -0,0 +1,189 @@
+#include "TestFramework.h"
+#include "TextureCache.h"
+#include "TextureCompression.h"
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace {
+
+// 4x4 RGBA block like a patch of a photographed surface: colors along a ramp between two nearby
+// shades with a little noise, and alpha fading in the other direction
+std::vector<uint8_t> gradientBlock() {
+    const int noise[16] = { 2, -3, 0, 3, -1, 1, -2, 0, 3, -2, 1, -3, 0, 2, -1, 1 };
+    std::vector<uint8_t> rgba(16 * 4);
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            int i = y * 4 + x;
+            float t = (x + y * 4) / 15.0f;
+            uint8_t* texel = rgba.data() + i * 4;
+            texel[0] = static_cast<uint8_t>(100 + 60 * t + noise[i]);
+            texel[1] = static_cast<uint8_t>(120 + 50 * t - noise[15 - i]);
+            texel[2] = static_cast<uint8_t>(140 + 10 * t + noise[(i + 5) % 16]);
+            texel[3] = static_cast<uint8_t>(255 - 120 * (y + x * 4) / 15);
+        }
+    }
+    return rgba;
+}
+
+double blockPsnr(const std::vector<uint8_t>& original, const uint8_t* decoded, int channels) {
+    double squaredError = 0.0;
+    for (int texel = 0; texel < 16; texel++) {
+        for (int c = 0; c < channels; c++) {
+            double difference = static_cast<double>(original[texel * 4 + c]) - decoded[texel * 4 + c];
+            squaredError += difference * difference;
+        }
+    }
+    double meanSquaredError = squaredError / (16.0 * channels);
+    return meanSquaredError <= 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+std::vector<uint8_t> readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+// A source file to fingerprint and the cache written for it: an 8x8 gradient encoded to BC3 with mips
+struct CachedTexture {
+    TempDirectory directory{ "texture-cache" };
+    std::string sourcePath = directory.path("gradient.png");
+    CompressedImage image;
+    uint64_t mipSettingsHash = MipOptions().hash();
+
+    CachedTexture() {
+        std::vector<uint8_t> pixels(8 * 8 * 4);
+        for (size_t i = 0; i < pixels.size(); i++) {
+            pixels[i] = static_cast<uint8_t>(i * 7);
+        }
+        writeFile(sourcePath, pixels);
+        image = compressImage(pixels.data(), 8, 8, 4, BlockFormat::BC3, MipOptions());
+
+        SourceFingerprint source;
+        CHECK(TextureCache::write(sourcePath, image, mipSettingsHash, 1.0, source));
+    }
+
+    bool read(uint64_t settingsHash, CompressedImage& cached) const {
+        SourceFingerprint source;
+        return TextureCache::read(sourcePath, BlockFormat::BC3, settingsHash, cached, source);
+    }
+};
+
+} // namespace
+
+TEST_CASE(bc1KeepsAGradientBlockAboveThePsnrFloor) {
+    std::vector<uint8_t> rgba = gradientBlock();
+    uint8_t block[8];
+    uint8_t decoded[16 * 4];
+    encodeBC1Block(rgba.data(), block);
+    decodeBC1Block(block, decoded);
+
+    CHECK(blockPsnr(rgba, decoded, 3) > 33.0);
+    CHECK_EQUAL(255, static_cast<int>(decoded[3]));
+}
+
+TEST_CASE(bc3KeepsAGradientBlockAboveThePsnrFloor) {
+    std::vector<uint8_t> rgba = gradientBlock();
+    uint8_t block[16];
+    uint8_t decoded[16 * 4];
+    encodeBC3Block(rgba.data(), block);
+    decodeBC3Block(block, decoded);
+
+    CHECK(blockPsnr(rgba, decoded, 4) > 33.0);
+
+    // Alpha has its own endpoints and eight steps, so the fade holds up on its own too
+    std::vector<uint8_t> alphaOnly(rgba.size(), 0);
+    std::vector<uint8_t> decodedAlpha(rgba.size(), 0);
+    for (int texel = 0; texel < 16; texel++) {
+        alphaOnly[texel * 4] = rgba[texel * 4 + 3];
+        decodedAlpha[texel * 4] = decoded[texel * 4 + 3];
+    }
+    CHECK(blockPsnr(alphaOnly, decodedAlpha.data(), 1) > 32.0);
+}
+
+TEST_CASE(bc5KeepsBothChannelsOfAGradientBlockAboveThePsnrFloor) {
+    std::vector<uint8_t> rgba = gradientBlock();
+    uint8_t block[16];
+    uint8_t decoded[16 * 4];
+    encodeBC5Block(rgba.data(), block);
+    decodeBC5Block(block, decoded);
+
+    CHECK(blockPsnr(rgba, decoded, 2) > 38.0);
+    CHECK_EQUAL(0, static_cast<int>(decoded[2]));
+    CHECK_EQUAL(255, static_cast<int>(decoded[3]));
+}
+
+TEST_CASE(textureCacheRoundTripsAnImage) {
+    CachedTexture texture;
+    CompressedImage cached;
+
+    CHECK(texture.read(texture.mipSettingsHash, cached));
+    CHECK(cached.format == BlockFormat::BC3);
+    CHECK_EQUAL(8u, cached.width);
+    CHECK_EQUAL(8u, cached.height);
+    CHECK_EQUAL(size_t(4), cached.levels.size());
+    CHECK(cached.data == texture.image.data);
+    for (size_t level = 0; level < cached.levels.size() && level < texture.image.levels.size(); level++) {
+        CHECK_EQUAL(texture.image.levels[level].width, cached.levels[level].width);
+        CHECK_EQUAL(texture.image.levels[level].offset, cached.levels[level].offset);
+        CHECK_EQUAL(texture.image.levels[level].size, cached.levels[level].size);
+    }
+}
+
+TEST_CASE(textureCacheRejectsATruncatedFile) {
+    CachedTexture texture;
+    std::string cachePath = TextureCache::cachePathFor(texture.sourcePath);
+    std::vector<uint8_t> bytes = readFile(cachePath);
+    CompressedImage cached;
+
+    bytes.resize(bytes.size() - 1);
+    writeFile(cachePath, bytes);
+    CHECK(!texture.read(texture.mipSettingsHash, cached));
+
+    // Cut inside the header
+    bytes.resize(sizeof(TextureCacheHeader) - 4);
+    writeFile(cachePath, bytes);
+    CHECK(!texture.read(texture.mipSettingsHash, cached));
+}
+
+TEST_CASE(textureCacheRejectsACorruptLevelTable) {
+    CachedTexture texture;
+    std::string cachePath = TextureCache::cachePathFor(texture.sourcePath);
+    const std::vector<uint8_t> bytes = readFile(cachePath);
+    CompressedImage cached;
+
+    // A level pointing past the data, a level of the wrong size, and one level too many in the header
+    CompressedMipLevel* levels[2];
+    std::vector<uint8_t> pastEnd = bytes;
+    std::vector<uint8_t> wrongSize = bytes;
+    levels[0] = reinterpret_cast<CompressedMipLevel*>(pastEnd.data() + sizeof(TextureCacheHeader)) + 1;
+    levels[1] = reinterpret_cast<CompressedMipLevel*>(wrongSize.data() + sizeof(TextureCacheHeader)) + 2;
+    levels[0]->offset = texture.image.data.size();
+    levels[1]->size += 16;
+    std::vector<uint8_t> extraLevel = bytes;
+    reinterpret_cast<TextureCacheHeader*>(extraLevel.data())->levelCount++;
+
+    for (const std::vector<uint8_t>* corrupt : { &pastEnd, &wrongSize, &extraLevel }) {
+        writeFile(cachePath, *corrupt);
+        CHECK(!texture.read(texture.mipSettingsHash, cached));
+    }
+
+    writeFile(cachePath, bytes);
+    CHECK(texture.read(texture.mipSettingsHash, cached));
+}
+
+TEST_CASE(textureCacheRejectsOtherMipSettings) {
+    CachedTexture texture;
+    CompressedImage cached;
+
+    MipOptions box;
+    box.filter = MipFilter::Box;
+    CHECK(box.hash() != texture.mipSettingsHash);
+    CHECK(!texture.read(box.hash(), cached));
+    CHECK(texture.read(texture.mipSettingsHash, cached));
+}
@@ -0,0 +1,185 @@
+#include "TestFramework.h"
+#include "TextureResidency.h"
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Uncompressed RGBA8 mip chain of a square texture, largest level first
+std::vector<size_t> squareLevels(int size) {
+    std::vector<size_t> levels;
+    for (int level = size; level >= 1; level /= 2) {
+        levels.push_back(static_cast<size_t>(level) * level * 4);
+    }
+    return levels;
+}
+
+size_t bytesFrom(const std::vector<size_t>& levels, int baseLevel) {
+    size_t bytes = 0;
+    for (size_t level = baseLevel; level < levels.size(); level++) {
+        bytes += levels[level];
+    }
+    return bytes;
+}
+
+// One frame of a scripted camera path: the textures in view and the level each needs
+using ScriptedFrame = std::vector<std::pair<uint32_t, int>>;
+
+void playFrame(TextureResidency& residency, const ScriptedFrame& frame) {
+    residency.beginFrame();
+    for (const auto& [texture, level] : frame) {
+        residency.request(texture, level);
+    }
+    residency.update();
+}
+
+// Two 1024 textures and a budget that holds one of them and the other's always-resident levels
+struct TwoTextureLevel {
+    std::vector<size_t> levels = squareLevels(1024);
+    ResidencyOptions options;
+    TextureResidency residency;
+    uint32_t a = 0;
+    uint32_t b = 0;
+
+    explicit TwoTextureLevel(size_t maxStreamInBytesPerFrame) : residency(makeOptions(maxStreamInBytesPerFrame)) {
+        a = residency.addTexture(levels, 1024, 1024);
+        b = residency.addTexture(levels, 1024, 1024);
+    }
+
+    ResidencyOptions makeOptions(size_t maxStreamInBytesPerFrame) {
+        options.budgetBytes = bytesFrom(levels, 0) + bytesFrom(levels, 4) + 1024;
+        options.alwaysResidentSize = 64;
+        options.maxStreamInBytesPerFrame = maxStreamInBytesPerFrame;
+        return options;
+    }
+};
+
+} // namespace
+
+TEST_CASE(residencyStaysWithinTheBudgetAlongAPath) {
+    ResidencyOptions options;
+    options.budgetBytes = size_t(12) << 20;
+    options.maxStreamInBytesPerFrame = size_t(2) << 20;
+    TextureResidency residency(options);
+    std::vector<size_t> large = squareLevels(1024);
+    std::vector<size_t> medium = squareLevels(512);
+    for (int i = 0; i < 6; i++) {
+        residency.addTexture(large, 1024, 1024);
+        residency.addTexture(medium, 512, 512);
+    }
+
+    // Walks past the objects: each comes into view blurred, is seen up close, then falls behind
+    std::vector<ScriptedFrame> path;
+    for (uint32_t step = 0; step < 14; step++) {
+        ScriptedFrame frame;
+        for (uint32_t texture = 0; texture < 12; texture++) {
+            int distance = static_cast<int>(texture) - static_cast<int>(step);
+            if (distance >= -1 && distance <= 3) {
+                frame.push_back({ texture, distance < 0 ? 1 : distance });
+            }
+        }
+        path.push_back(frame);
+    }
+
+    for (const ScriptedFrame& frame : path) {
+        playFrame(residency, frame);
+        CHECK(residency.residentBytes() <= options.budgetBytes);
+
+        size_t resident = 0;
+        for (uint32_t texture = 0; texture < residency.textureCount(); texture++) {
+            resident += bytesFrom(texture % 2 == 0 ? large : medium, residency.residentLevel(texture));
+        }
+        CHECK_EQUAL(resident, residency.residentBytes());
+    }
+    CHECK(residency.stats().peakResidentBytes > options.budgetBytes); // Everything starts resident
+}
+
+TEST_CASE(residencyEvictsTheLeastRecentlyUsedTexturesFirst) {
+    ResidencyOptions options;
+    std::vector<size_t> levels = squareLevels(1024);
+    // Room for three full textures and the always-resident levels of the fourth
+    options.budgetBytes = 3 * bytesFrom(levels, 0) + bytesFrom(levels, 4) + 1024;
+    options.maxStreamInBytesPerFrame = size_t(64) << 20;
+    TextureResidency residency(options);
+    for (int i = 0; i < 4; i++) {
+        residency.addTexture(levels, 1024, 1024);
+    }
+
+    // Out of view from the start, so the only texture given up
+    playFrame(residency, { { 0, 0 }, { 1, 0 }, { 2, 0 } });
+    CHECK_EQUAL(residency.floorLevel(3), residency.residentLevel(3));
+
+    // Seen last in order 2, 0, 1: turning to 3 gives up 2, which was used longest ago
+    playFrame(residency, { { 2, 0 } });
+    playFrame(residency, { { 0, 0 } });
+    playFrame(residency, { { 1, 0 } });
+    playFrame(residency, { { 3, 0 } });
+
+    CHECK_EQUAL(residency.floorLevel(2), residency.residentLevel(2));
+    CHECK_EQUAL(0, residency.residentLevel(0));
+    CHECK_EQUAL(0, residency.residentLevel(1));
+    CHECK_EQUAL(0, residency.residentLevel(3));
+}
+
+TEST_CASE(residencyNeverDropsTheAlwaysResidentLevels) {
+    ResidencyOptions options;
+    options.budgetBytes = 1; // Nothing fits
+    options.alwaysResidentSize = 64;
+    TextureResidency residency(options);
+    uint32_t large = residency.addTexture(squareLevels(1024), 1024, 1024);
+    uint32_t small = residency.addTexture(squareLevels(32), 32, 32);
+
+    CHECK_EQUAL(4, residency.floorLevel(large)); // 64x64
+    CHECK_EQUAL(0, residency.floorLevel(small));
+
+    playFrame(residency, {});
+    playFrame(residency, { { large, 0 }, { small, 0 } });
+    playFrame(residency, { { large, 9 } });
+
+    CHECK_EQUAL(4, residency.residentLevel(large));
+    CHECK_EQUAL(0, residency.residentLevel(small));
+    CHECK(residency.stats().overBudgetFrames > 0);
+}
+
+TEST_CASE(residencyStreamsInWithinThePerFrameCap) {
+    // 300 KB a frame: 128 and 256 do not fit together, and every larger level exceeds the cap alone
+    TwoTextureLevel level(300 * 1024);
+    TextureResidency& residency = level.residency;
+
+    playFrame(residency, { { level.a, 0 } });
+    CHECK_EQUAL(0, residency.residentLevel(level.a));
+    CHECK_EQUAL(4, residency.residentLevel(level.b));
+
+    // Turning to b evicts a at once, but b only sharpens by what the cap allows each frame
+    std::vector<int> expected = { 3, 2, 1, 0 };
+    for (int frame = 0; frame < 4; frame++) {
+        unsigned long long before = residency.stats().bytesStreamedIn;
+        playFrame(residency, { { level.b, 0 } });
+        CHECK_EQUAL(4, residency.residentLevel(level.a));
+        CHECK_EQUAL(expected[frame], residency.residentLevel(level.b));
+
+        unsigned long long streamed = residency.stats().bytesStreamedIn - before;
+        CHECK(streamed <= level.options.maxStreamInBytesPerFrame || streamed == level.levels[expected[frame]]);
+    }
+}
+
+TEST_CASE(residencyCountsHitsAndMissesPerRequestedTexture) {
+    TwoTextureLevel level(300 * 1024);
+    TextureResidency& residency = level.residency;
+
+    playFrame(residency, { { level.a, 0 } });                  // Hit: a starts resident, b is evicted
+    playFrame(residency, { { level.b, 0 }, { level.b, 2 } });  // One request for b, at 3 after the cap: miss
+    playFrame(residency, { { level.b, 3 } });                  // Hit, and nothing sharper is streamed
+    playFrame(residency, { { level.b, 0 } });                  // Miss at 2
+    playFrame(residency, { { level.b, 0 } });                  // Miss at 1
+    playFrame(residency, { { level.b, 0 } });                  // Hit at 0
+    playFrame(residency, {});                                  // No requests
+
+    const ResidencyStats& stats = residency.stats();
+    CHECK_EQUAL(6ull, stats.requests);
+    CHECK_EQUAL(3ull, stats.hits);
+    CHECK_EQUAL(3ull, stats.misses);
+    CHECK_EQUAL(4ull, stats.levelsStreamedIn);
+    CHECK_EQUAL(8ull, stats.levelsEvicted);
+    CHECK_EQUAL(static_cast<unsigned long long>(bytesFrom(level.levels, 0) - bytesFrom(level.levels, 4)), stats.bytesStreamedIn);
+}
@@ -0,0 +1,14 @@
+#version 460 core
+in vec2 TexCoords;
+out vec4 FragColor;
+
+uniform sampler2D diffuseTexture;
+uniform vec3 viewPos;
+uniform int visualizeNormals;
+uniform int visualizeShadowIntensity;
+uniform float shininess = 8.0;
+
+void main() {
+    vec4 albedo = texture(diffuseTexture, TexCoords);
+    FragColor = visualizeNormals != 0 ? vec4(0.5) : vec4(albedo.rgb * shininess * 0.125, albedo.a);
+}
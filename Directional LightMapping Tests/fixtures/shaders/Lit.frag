@@ -0,0 +1,20 @@
+#version 460 core
+in vec2 TexCoords;
+out vec4 FragColor;
+
+layout(std140, binding = 2) uniform MaterialParams {
+    float shininess;
+    vec3 specularColor;
+};
+
+uniform sampler2D diffuseTexture;
+uniform sampler2D lightmap0;
+uniform sampler2D lightmap1;
+uniform sampler2D lightmap2;
+uniform vec2 diffuseTextureTiling;
+
+void main() {
+    vec3 light = texture(lightmap0, TexCoords).rgb + texture(lightmap1, TexCoords).rgb + texture(lightmap2, TexCoords).rgb;
+    vec4 albedo = texture(diffuseTexture, TexCoords * diffuseTextureTiling);
+    FragColor = vec4(albedo.rgb * light + specularColor * shininess, albedo.a);
+}
@@ -0,0 +1,21 @@
+#version 460 core
+// Test shader in the layout of the level shaders: camera state from the frame block
+layout(location = 0) in vec3 aPos;
+layout(location = 2) in vec2 aTexCoords;
+
+layout(std140, binding = 0) uniform FrameConstants {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec4 viewPos;
+    ivec4 flags;
+};
+
+uniform mat4 model;
+
+out vec2 TexCoords;
+
+void main() {
+    TexCoords = aTexCoords;
+    gl_Position = viewProj * model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,288 @@
+#include "Culling.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+void AABB::expand(const glm::vec3& point) {
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+void AABB::expand(const AABB& box) {
+    min = glm::min(min, box.min);
+    max = glm::max(max, box.max);
+}
+
+AABB computeBounds(const Vertex* vertices, size_t count) {
+    AABB box;
+    for (size_t i = 0; i < count; i++) {
+        box.expand(vertices[i].Position);
+    }
+    return box;
+}
+
+AABB transformBounds(const AABB& box, const glm::mat4& transform) {
+    if (box.isEmpty()) {
+        return box;
+    }
+
+    AABB result;
+    result.min = glm::vec3(transform[3]);
+    result.max = glm::vec3(transform[3]);
+    for (int column = 0; column < 3; column++) {
+        for (int row = 0; row < 3; row++) {
+            float a = transform[column][row] * box.min[column];
+            float b = transform[column][row] * box.max[column];
+            result.min[row] += std::min(a, b);
+            result.max[row] += std::max(a, b);
+        }
+    }
+    return result;
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4& m) {
+    // Rows of the matrix; glm stores columns
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    }
+
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0]; // Left
+    frustum.planes[1] = rows[3] - rows[0]; // Right
+    frustum.planes[2] = rows[3] + rows[1]; // Bottom
+    frustum.planes[3] = rows[3] - rows[1]; // Top
+    frustum.planes[4] = rows[3] + rows[2]; // Near
+    frustum.planes[5] = rows[3] - rows[2]; // Far
+
+    for (auto& plane : frustum.planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) {
+            plane = plane / length;
+        }
+    }
+    return frustum;
+}
+
+Frustum::Result Frustum::classify(const AABB& box) const {
+    glm::vec3 center = box.center();
+    glm::vec3 extent = box.extent();
+
+    Result result = Inside;
+    for (const auto& plane : planes) {
+        glm::vec3 normal = glm::vec3(plane);
+        float distance = glm::dot(normal, center) + plane.w;
+        float radius = glm::dot(glm::abs(normal), extent);
+        if (distance < -radius) {
+            return Outside;
+        }
+        if (distance < radius) {
+            result = Intersecting;
+        }
+    }
+    return result;
+}
+
+void CullingStats::print(std::ostream& out) const {
+    out << "Culling: " << meshesVisible << " visible, " << meshesCulled << " culled"
+        << " (BVH nodes visited " << nodesVisited << ", mesh bounds tested " << meshesTested << ")" << std::endl;
+}
+
+void BoundingVolumeHierarchy::build(const std::vector<AABB>& bounds) {
+    nodes_.clear();
+    itemBounds_ = bounds;
+    items_.resize(bounds.size());
+    for (uint32_t i = 0; i < items_.size(); i++) {
+        items_[i] = i;
+    }
+
+    if (!items_.empty()) {
+        nodes_.reserve(2 * items_.size() / MAX_LEAF_SIZE + 1);
+        buildNode(0, static_cast<uint32_t>(items_.size()));
+    }
+}
+
+uint32_t BoundingVolumeHierarchy::buildNode(uint32_t begin, uint32_t end) {
+    uint32_t index = static_cast<uint32_t>(nodes_.size());
+    nodes_.push_back(Node());
+
+    AABB bounds;
+    AABB centers;
+    for (uint32_t i = begin; i < end; i++) {
+        bounds.expand(itemBounds_[items_[i]]);
+        centers.expand(itemBounds_[items_[i]].center());
+    }
+
+    Node node;
+    node.bounds = bounds;
+    node.rightChild = 0;
+    node.itemBegin = begin;
+    node.itemCount = end - begin;
+
+    if (end - begin > MAX_LEAF_SIZE) {
+        // Split at the median centre along the axis where the centres spread the most
+        glm::vec3 spread = centers.max - centers.min;
+        int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+        uint32_t middle = begin + (end - begin) / 2;
+        std::nth_element(items_.begin() + begin, items_.begin() + middle, items_.begin() + end,
+            [&](uint32_t a, uint32_t b) {
+                return itemBounds_[a].center()[axis] < itemBounds_[b].center()[axis];
+            });
+
+        buildNode(begin, middle);
+        node.rightChild = buildNode(middle, end);
+    }
+
+    nodes_[index] = node;
+    return index;
+}
+
+void BoundingVolumeHierarchy::cull(const Frustum& frustum, std::vector<uint32_t>& visible, CullingStats& stats) const {
+    size_t visibleBefore = visible.size();
+
+    if (!nodes_.empty()) {
+        uint32_t stack[64];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0) {
+            const Node& node = nodes_[stack[--stackSize]];
+            stats.nodesVisited++;
+
+            Frustum::Result result = frustum.classify(node.bounds);
+            if (result == Frustum::Outside) {
+                continue;
+            }
+
+            if (result == Frustum::Inside) {
+                visible.insert(visible.end(), items_.begin() + node.itemBegin, items_.begin() + node.itemBegin + node.itemCount);
+            }
+            else if (node.rightChild == 0) {
+                for (uint32_t i = node.itemBegin; i < node.itemBegin + node.itemCount; i++) {
+                    stats.meshesTested++;
+                    if (frustum.intersects(itemBounds_[items_[i]])) {
+                        visible.push_back(items_[i]);
+                    }
+                }
+            }
+            else {
+                uint32_t left = static_cast<uint32_t>(&node - nodes_.data()) + 1;
+                stack[stackSize++] = node.rightChild;
+                stack[stackSize++] = left;
+            }
+        }
+    }
+
+    unsigned int visibleCount = static_cast<unsigned int>(visible.size() - visibleBefore);
+    stats.meshesVisible += visibleCount;
+    stats.meshesCulled += static_cast<unsigned int>(items_.size()) - visibleCount;
+}
+
+namespace {
+
+glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t) {
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return 0.5f * ((2.0f * p1) + (p2 - p0) * t +
+        (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+        (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+glm::vec3 samplePath(const std::vector<glm::vec3>& points, float t) {
+    size_t count = points.size();
+    float segment = t * count;
+    size_t i = static_cast<size_t>(segment) % count;
+    float local = segment - std::floor(segment);
+    return catmullRom(points[(i + count - 1) % count], points[i], points[(i + 1) % count], points[(i + 2) % count], local);
+}
+
+void runCullingBenchmark(size_t meshCount, size_t frameCount) {
+    const float worldSize = 2000.0f;
+
+    // Synthetic level: boxes of varying size scattered over a flat area
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-worldSize * 0.5f, worldSize * 0.5f);
+    std::uniform_real_distribution<float> height(0.0f, 40.0f);
+    std::uniform_real_distribution<float> size(0.5f, 12.0f);
+    std::vector<AABB> bounds(meshCount);
+    for (auto& box : bounds) {
+        glm::vec3 center(position(rng), height(rng), position(rng));
+        glm::vec3 halfSize(size(rng), size(rng), size(rng));
+        box.min = center - halfSize;
+        box.max = center + halfSize;
+    }
+
+    auto buildStart = std::chrono::steady_clock::now();
+    BoundingVolumeHierarchy bvh;
+    bvh.build(bounds);
+    double buildMs = millisecondsSince(buildStart);
+
+    // Camera path through the level, looking along the direction of travel
+    std::vector<glm::vec3> path;
+    const int controlPoints = 8;
+    for (int i = 0; i < controlPoints; i++) {
+        float angle = glm::radians(360.0f * i / controlPoints);
+        float radius = worldSize * (i % 2 == 0 ? 0.35f : 0.2f);
+        path.push_back(glm::vec3(std::cos(angle) * radius, 10.0f + 5.0f * (i % 3), std::sin(angle) * radius));
+    }
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+
+    std::vector<uint32_t> visible;
+    visible.reserve(meshCount);
+    CullingStats bvhStats;
+    double bvhMs = 0.0;
+    double bruteMs = 0.0;
+    size_t bruteVisible = 0;
+    size_t mismatches = 0;
+
+    for (size_t frame = 0; frame < frameCount; frame++) {
+        float t = static_cast<float>(frame) / frameCount;
+        glm::vec3 eye = samplePath(path, t);
+        glm::vec3 target = samplePath(path, t + 0.5f / (controlPoints * 4.0f));
+        glm::mat4 view = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+        Frustum frustum = Frustum::fromMatrix(projection * view);
+
+        visible.clear();
+        auto start = std::chrono::steady_clock::now();
+        bvh.cull(frustum, visible, bvhStats);
+        bvhMs += millisecondsSince(start);
+        size_t frameVisible = visible.size();
+
+        // Reference: test every mesh
+        size_t bruteCount = 0;
+        start = std::chrono::steady_clock::now();
+        for (const auto& box : bounds) {
+            if (frustum.intersects(box)) {
+                bruteCount++;
+            }
+        }
+        bruteMs += millisecondsSince(start);
+        bruteVisible += bruteCount;
+
+        // Fully contained subtrees are accepted without per-mesh tests, so the sets must still match
+        if (bruteCount != frameVisible) {
+            mismatches++;
+        }
+    }
+
+    double frames = static_cast<double>(std::max<size_t>(frameCount, 1));
+    std::cout << "Culling benchmark: " << meshCount << " meshes, " << frameCount << " frames" << std::endl;
+    std::cout << "  BVH build: " << buildMs << " ms, " << bvh.nodeCount() << " nodes" << std::endl;
+    std::cout << "  brute force: " << bruteMs / frames << " ms/frame, " << bruteVisible / frames << " visible" << std::endl;
+    std::cout << "  BVH:         " << bvhMs / frames << " ms/frame (" << bruteMs / std::max(bvhMs, 0.0001) << "x), "
+        << bvhStats.meshesVisible / frames << " visible, " << bvhStats.meshesCulled / frames << " culled" << std::endl;
+    std::cout << "  per frame: " << bvhStats.nodesVisited / frames << " nodes visited, "
+        << bvhStats.meshesTested / frames << " mesh bounds tested" << std::endl;
+    if (mismatches > 0) {
+        std::cerr << "  " << mismatches << " frames where BVH and brute force disagree" << std::endl;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Vertex.h"
+
+struct AABB {
+    glm::vec3 min = glm::vec3(1e30f);
+    glm::vec3 max = glm::vec3(-1e30f);
+
+    bool isEmpty() const { return min.x > max.x; }
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extent() const { return (max - min) * 0.5f; }
+
+    void expand(const glm::vec3& point);
+    void expand(const AABB& box);
+};
+
+AABB computeBounds(const Vertex* vertices, size_t count);
+
+// Bounds of the box after an affine transform (Arvo's method)
+AABB transformBounds(const AABB& box, const glm::mat4& transform);
+
+// Six planes (left, right, bottom, top, near, far) with normals pointing inwards
+struct Frustum {
+    glm::vec4 planes[6];
+
+    enum Result { Outside, Intersecting, Inside };
+
+    // Gribb/Hartmann extraction from a view-projection matrix with a -1..1 clip depth range
+    static Frustum fromMatrix(const glm::mat4& viewProj);
+
+    Result classify(const AABB& box) const;
+    bool intersects(const AABB& box) const { return classify(box) != Outside; }
+};
+
+// Per-frame counters; visible + culled equals the number of meshes in the hierarchy
+struct CullingStats {
+    unsigned int nodesVisited = 0;
+    unsigned int meshesTested = 0;  // Individual bounds tests in partially visible leaves
+    unsigned int meshesVisible = 0;
+    unsigned int meshesCulled = 0;
+
+    void print(std::ostream& out) const;
+};
+
+// Binary BVH over mesh bounds, split at the median of the longest axis. Nodes are stored
+// depth-first so the left child always follows its parent. Subtrees entirely inside the
+// frustum are accepted without testing their contents.
+class BoundingVolumeHierarchy {
+public:
+    static const uint32_t MAX_LEAF_SIZE = 4;
+
+    void build(const std::vector<AABB>& bounds);
+
+    // Appends the indices of meshes whose bounds intersect the frustum
+    void cull(const Frustum& frustum, std::vector<uint32_t>& visible, CullingStats& stats) const;
+
+    size_t nodeCount() const { return nodes_.size(); }
+    size_t itemCount() const { return items_.size(); }
+
+private:
+    struct Node {
+        AABB bounds;
+        uint32_t rightChild; // Zero for leaves; the left child is the next node
+        uint32_t itemBegin;  // Items of the whole subtree are contiguous in items_
+        uint32_t itemCount;
+    };
+
+    uint32_t buildNode(uint32_t begin, uint32_t end);
+
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> items_;
+    std::vector<AABB> itemBounds_;
+};
+
+// Closed Catmull-Rom loop through the control points, t in [0, 1); used for benchmark camera paths
+glm::vec3 samplePath(const std::vector<glm::vec3>& points, float t);
+
+// Replays a looping camera path over a synthetic scene and compares BVH culling with testing every mesh
+void runCullingBenchmark(size_t meshCount, size_t frameCount);
+
+#endif
@@ -1,16 +1,46 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-#include <GL/glew.h>
+#include "GLDispatch.h"
 #include <GLFW/glfw3.h>
 #include <vector>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <random>
 #include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <cmath>
+#include <cctype>
 #include "Camera.h"
 #include "FileSystemUtils.h"
 #include "Material.h"
+#include "Vertex.h"
+#include "SceneCache.h"
+#include "TextureLoader.h"
+#include "GLStats.h"
+#include "FrameConstants.h"
+#include "GLStateTracker.h"
+#include "RenderQueue.h"
+#include "StaticBatch.h"
+#include "MeshTransform.h"
+#include "Hash.h"
+#include "Culling.h"
+#include "VertexPacking.h"
+#include "MeshOptimizer.h"
+#include "ProcessMemory.h"
+#include "ThreadPool.h"
+#include "ShaderProgramCache.h"
+#include "TextureCache.h"
+#include "MaterialTable.h"
+#include "TextureResidency.h"
+#include "Profiler.h"
+#include "FlythroughBenchmark.h"
+#include "GLRecorder.h"
+#include "SubmissionCheck.h"
+#include "LightmapBaker.h"
 
 // Asset Importer
 #include <assimp/Importer.hpp>
@@ -40,38 +70,116 @@ float lastY = HEIGHT / 2.0f;
 bool firstMouse = true;
 float deltaTime = 0.0f; // Time between current frame and last frame
 float lastFrame = 0.0f; // Time of last frame
-double previousTime = 0.0;
-int frameCount = 0;
+double previousTime = 0.0; // Start of the current frame rate sample
+int frameCount = 0;        // Frames since previousTime
 bool useSSBump = true; // Flag to toggle between SSBump and Normal Map shaders
 bool lKeyPressed = false;
 bool nKeyPressed = false;
 bool iKeyPressed = false;
+bool gKeyPressed = false;
+bool pKeyPressed = false;
+bool kKeyPressed = false;
+GLCallStats lastFrameGLStats;
+StateTrackerStats lastFrameStateStats;
+CullingStats lastFrameCullingStats;
 static bool visualizeNormals = false;
 static bool visualizeshadowIntensity = false;
 
-Camera camera(glm::vec3(0.0f, 5.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), -180.0f, 0.0f, 6.0f, 0.1f, 45.0f, 0.1f, 500.0f);
+// Speed, mouse sensitivity, field of view and clip planes are the same for every camera
+Camera makeCamera(const glm::vec3& position, float yaw, float pitch) {
+    return Camera(position, glm::vec3(0.0f, 1.0f, 0.0f), yaw, pitch, 6.0f, 0.1f, 45.0f, 0.1f, 500.0f);
+}
 
-struct Vertex {
-    glm::vec3 Position;
-    glm::vec3 Normal;
-    glm::vec2 TexCoords;         // For diffuse texture
-    glm::vec2 LightmapTexCoords; // For lightmap texture
-    glm::vec3 Tangent;
-    glm::vec3 Bitangent;
+Camera camera = makeCamera(glm::vec3(0.0f, 5.0f, 0.0f), -180.0f, 0.0f);
+FrameConstants frameConstants;
+GLStateTracker glState;
+RenderQueue renderQueue;
+
+// Frames are drawn here: the window's framebuffer, or an offscreen one in benchmark runs
+GLuint sceneFramebuffer = 0;
+
+// Camera path control points recorded with the 'K' key, for --benchmark
+const std::string cameraPathFile = "camera_path.txt";
+
+// Pack all level geometry into one shared buffer and draw it with multi-draw-indirect
+const bool useStaticBatching = true;
+
+// Upload PackedVertex (24 bytes) instead of Vertex (64 bytes). Needs shaders that
+// dequantize positions and rebuild the bitangent, see VertexPacking.h.
+const bool usePackedVertices = false;
+VertexPackingReport vertexPackingTotal;
+
+StaticBatch staticBatch(usePackedVertices);
+
+// Meshes are tested against the camera frustum through a BVH over their world-space bounds
+const bool useFrustumCulling = true;
+BoundingVolumeHierarchy levelBVH;
+std::vector<uint32_t> visibleMeshes;
+
+// Materials read their textures and tilings from one GPU table indexed per draw, so the static batch
+// draws once per program and parameter set instead of once per material. Uses bindless handles where
+// GL_ARB_bindless_texture exists, otherwise copies the 2D textures into arrays. Needs shaders that
+// handle MATERIAL_TABLE, see MaterialTable.h.
+const bool useMaterialTable = false;
+const bool allowBindlessTextures = true;
+MaterialTable materialTable;
+
+// Keeps the level's 2D textures within a VRAM budget: mips are streamed in and out by the distance and
+// screen coverage of the meshes using them, least recently used textures are evicted first and the
+// small levels always stay. Off while the material table is on, since its handles and array copies
+// are taken from the textures once.
+const bool useTextureStreaming = true;
+ResidencyOptions textureStreamingOptions;
+TextureResidency textureResidency(textureStreamingOptions);
+
+struct StreamedTexture {
+    GLuint id;
+    std::string path;
+    BlockFormat format;
+    MipOptions mips;
+    int width;
+    int height;
+    int levelCount;
 };
+std::vector<StreamedTexture> streamedTextures;
+std::unordered_map<GLuint, uint32_t> streamedTextureIndices;
+
+// Linked shader binaries are kept here between runs, keyed on source and driver
+const bool useProgramBinaryCache = true;
+const char* PROGRAM_BINARY_CACHE_DIR = "shader_cache";
 
 struct Mesh {
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
-    mutable unsigned int VAO;
+    mutable unsigned int VAO = 0;
+    GLsizei indexCount = 0;
+    BatchRange batchRange; // Location in the static batch for meshes without their own buffers
+    bool worldSpace = false; // Vertices were pre-transformed at load, so no model matrix is needed
+    AABB bounds; // In the mesh's vertex space until the level is loaded, then in world space
+    VertexPackingReport packingReport; // Filled when the mesh was uploaded as PackedVertex
     std::shared_ptr<Material> material;
 
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::shared_ptr<Material> material)
-        : vertices(vertices), indices(indices), material(material) {
-        setupMesh();
+    // Keeps the CPU arrays, which are moved in rather than copied
+    Mesh(std::vector<Vertex>&& vertices, std::vector<unsigned int>&& indices, std::shared_ptr<Material> material)
+        : vertices(std::move(vertices)), indices(std::move(indices)), material(material) {
+        setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
+    }
+
+    // Uploads straight from external storage (e.g. the memory-mapped scene cache) without keeping a CPU copy
+    Mesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexDataCount, std::shared_ptr<Material> material)
+        : material(material) {
+        setupMesh(vertexData, vertexCount, indexData, indexDataCount, &packingReport);
+    }
+
+    // Geometry lives in the shared static batch
+    Mesh(const BatchRange& range, const VertexPackingReport& packingReport, std::shared_ptr<Material> material)
+        : indexCount(static_cast<GLsizei>(range.indexCount)), batchRange(range), packingReport(packingReport), material(material) {
     }
 
-    void setupMesh() const {
+    void setupMesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexDataCount,
+        VertexPackingReport* report = nullptr) {
+        indexCount = static_cast<GLsizei>(indexDataCount);
+
         // Set up the VAO, VBO, and EBO as before
         glGenVertexArrays(1, &VAO);
         glBindVertexArray(VAO);
@@ -80,11 +188,33 @@ struct Mesh {
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexDataCount * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
+
+        if (usePackedVertices) {
+            std::vector<PackedVertex> packed(vertexCount);
+            PositionDequantization dequantization = packVertices(vertexData, vertexCount, packed.data());
+            if (report) {
+                *report = measurePackingError(vertexData, packed.data(), vertexCount, dequantization);
+            }
+
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
+            setupPackedVertexAttributes();
+
+            // A single instance carries the mesh's dequantization
+            unsigned int dequantizationVBO;
+            glGenBuffers(1, &dequantizationVBO);
+            glBindBuffer(GL_ARRAY_BUFFER, dequantizationVBO);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(PositionDequantization), &dequantization, GL_STATIC_DRAW);
+            setupDequantizationAttributes();
+
+            glBindVertexArray(0);
+            return;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertexData, GL_STATIC_DRAW);
 
         // Vertex Attributes setup
         glEnableVertexAttribArray(0);
@@ -107,21 +237,13 @@ struct Mesh {
 
         glBindVertexArray(0);
     }
-
-    void Draw(const Camera& camera, const glm::mat4& modelMatrix, float aspectRatio) const {
-        // Apply the material
-        material->apply(modelMatrix, camera, aspectRatio);
-
-        // Bind VAO and draw the mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-    }
 };
 
 std::vector<Mesh> meshes;
 
 void processInput(GLFWwindow* window) {
+    PROFILE_SCOPE("processInput");
+
     // Handle movement keys
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
         camera.processKeyboardInput(GLFW_KEY_W, deltaTime);
@@ -137,11 +259,6 @@ void processInput(GLFWwindow* window) {
         visualizeNormals = !visualizeNormals;
         nKeyPressed = true;
         std::cout << "Visualize Normals: " << (visualizeNormals ? "ON" : "OFF") << std::endl;
-
-        // Update the parameter in all materials
-        for (auto& mesh : meshes) {
-            mesh.material->setIntParam("visualizeNormals", visualizeNormals ? 1 : 0);
-        }
     }
     if (glfwGetKey(window, GLFW_KEY_N) == GLFW_RELEASE) {
         nKeyPressed = false;
@@ -152,15 +269,47 @@ void processInput(GLFWwindow* window) {
         visualizeshadowIntensity = !visualizeshadowIntensity;
         iKeyPressed = true;
         std::cout << "Visualize Shadow Intensity: " << (visualizeshadowIntensity ? "ON" : "OFF") << std::endl;
-
-        // Update the parameter in all materials
-        for (auto& mesh : meshes) {
-            mesh.material->setIntParam("visualizeShadowIntensity", visualizeshadowIntensity ? 1 : 0);
-        }
     }
     if (glfwGetKey(window, GLFW_KEY_I) == GLFW_RELEASE) {
         iKeyPressed = false;
     }
+
+    // Handle 'G' key to print the GL calls issued by the previous frame
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && !gKeyPressed) {
+        gKeyPressed = true;
+        lastFrameGLStats.print(std::cout);
+        lastFrameStateStats.print(std::cout);
+        lastFrameCullingStats.print(std::cout);
+        if (!streamedTextures.empty()) {
+            textureResidency.stats().print(std::cout);
+        }
+    }
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE) {
+        gKeyPressed = false;
+    }
+
+    // Handle 'K' key to add the camera position to the recorded benchmark path
+    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS && !kKeyPressed) {
+        kKeyPressed = true;
+        if (CameraPath::append(cameraPathFile, camera.getPosition())) {
+            std::cout << "Recorded camera path point to " << cameraPathFile << std::endl;
+        }
+    }
+    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_RELEASE) {
+        kKeyPressed = false;
+    }
+
+#if ENABLE_PROFILER
+    // Handle 'P' key to print the profile of the frames in the ring and save it as a Chrome trace
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && !pKeyPressed) {
+        pKeyPressed = true;
+        Profiler::instance().printSummary(std::cout);
+        Profiler::instance().writeChromeTrace("profile_trace.json");
+    }
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE) {
+        pKeyPressed = false;
+    }
+#endif
 }
 
 void mouseCallback(GLFWwindow* window, double xpos, double ypos) {
@@ -187,7 +336,7 @@ void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
 }
 
 // Utility function to load textures using stb_image or similar
-GLuint loadTextureFromFile(const char* path, const std::string& directory);
+GLuint loadTextureFromFile(const char* path, const std::string& directory, BlockFormat& format, const MipOptions& mips);
 
 std::string getFilenameFromPath(const std::string& path) {
     size_t pos = path.find_last_of("/\\");
@@ -197,21 +346,23 @@ std::string getFilenameFromPath(const std::string& path) {
         return path;
 }
 
-std::map<std::string, std::shared_ptr<Material>> loadMaterialsFromList(const std::string& modelPath) {
-    std::map<std::string, std::shared_ptr<Material>> materials;
-
+std::string getModelName(const std::string& modelPath) {
     // Extract the model name without the path and extension
-    size_t lastSlash = modelPath.find_last_of("/\\");
-    std::string modelNameWithExtension = (lastSlash != std::string::npos) ? modelPath.substr(lastSlash + 1) : modelPath;
-    std::string modelName = modelNameWithExtension.substr(0, modelNameWithExtension.find_last_of('.'));
+    std::string modelNameWithExtension = getFilenameFromPath(modelPath);
+    return modelNameWithExtension.substr(0, modelNameWithExtension.find_last_of('.'));
+}
+
+// Material names (the XML file names without extension) and XML paths from the model's materials list, in list order
+std::vector<std::pair<std::string, std::string>> readMaterialsList(const std::string& modelPath) {
+    std::vector<std::pair<std::string, std::string>> entries;
 
     // Construct the materials list file path in the 'materials' folder
-    std::string materialsListPath = FileSystemUtils::getAssetFilePath("materials/" + modelName + ".txt");
+    std::string materialsListPath = FileSystemUtils::getAssetFilePath("materials/" + getModelName(modelPath) + ".txt");
 
     std::ifstream materialsFile(materialsListPath);
     if (!materialsFile.is_open()) {
         std::cerr << "Materials list file not found: " << materialsListPath << std::endl;
-        return materials;
+        return entries;
     }
 
     std::string materialName;
@@ -224,9 +375,6 @@ std::map<std::string, std::shared_ptr<Material>> loadMaterialsFromList(const std
             // Construct the path to the material XML file without appending '.xml'
             std::string materialFilePath = FileSystemUtils::getAssetFilePath("materials/" + materialName);
 
-            // Load the material using a shared_ptr
-            std::shared_ptr<Material> material = std::make_shared<Material>(materialFilePath);
-
             // Remove the '.xml' extension from materialName for the map key
             std::string materialKey = materialName;
             size_t pos = materialKey.find_last_of('.');
@@ -234,239 +382,804 @@ std::map<std::string, std::shared_ptr<Material>> loadMaterialsFromList(const std
                 materialKey = materialKey.substr(0, pos);
             }
 
-            // Store in the map with the material name without extension
-            materials[materialKey] = material;
+            entries.emplace_back(materialKey, materialFilePath);
         }
     }
 
     materialsFile.close();
+    return entries;
+}
+
+std::map<std::string, std::shared_ptr<Material>> loadMaterialsFromList(const std::string& modelPath) {
+    std::map<std::string, std::shared_ptr<Material>> materials;
+    for (const auto& [materialKey, materialFilePath] : readMaterialsList(modelPath)) {
+        // Load the material using a shared_ptr
+        std::shared_ptr<Material> material = std::make_shared<Material>(materialFilePath);
+
+        // Store in the map with the material name without extension
+        materials[materialKey] = material;
+    }
     return materials;
 }
 
-std::vector<Mesh> loadModel(const std::string& path);
-std::vector<Mesh> loadModel(const std::string& path, std::shared_ptr<Material> singleMaterial);
+const unsigned int MODEL_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_FlipUVs |
+    aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices |
+    aiProcess_CalcTangentSpace;
 
-std::vector<Mesh> loadModel(const std::string& path) {
-    // Load materials from the materials list file
-    auto materials = loadMaterialsFromList(path);
+// Fixed transform from the level's FBX space into world space
+glm::mat4 getLevelImportTransform() {
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::scale(model, glm::vec3(0.01f));
+    model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    return model;
+}
+
+struct ModelImportOptions {
+    // Bake the transform into the vertices at load time and mark the meshes as world-space
+    bool preTransform = true;
+    glm::mat4 transform = getLevelImportTransform();
+    // Reorder triangles for the post-transform cache and overdraw, then vertices for fetch order
+    bool optimizeMeshes = true;
+    // Keep each mesh's vertices and indices in Mesh after upload; otherwise only the GPU has them
+    bool keepCpuCopy = false;
+    // Worker threads for the per-mesh conversion; 0 uses every hardware thread. Does not affect the output.
+    unsigned int importThreads = 0;
+};
+
+ModelImportOptions levelImportOptions;
+
+// Everything that changes the baked output, so the scene cache is rebuilt when it changes
+uint64_t getImportSettingsHash(const ModelImportOptions& options) {
+    uint64_t hash = hashBytes(&MODEL_IMPORT_FLAGS, sizeof(MODEL_IMPORT_FLAGS));
+    if (options.preTransform) {
+        hash = hashBytes(glm::value_ptr(options.transform), sizeof(float) * 16, hash);
+    }
+    hash = hashBytes(&options.optimizeMeshes, sizeof(options.optimizeMeshes), hash);
+    return hash;
+}
+
+// Maps an imported material name to the Material used to draw it
+using MaterialResolver = std::function<std::shared_ptr<Material>(const std::string& materialName)>;
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Adds a mesh either to the static batch or with its own VAO, VBO and EBO
+void addMesh(std::vector<Mesh>& target, const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexDataCount,
+    std::shared_ptr<Material> material, const ModelImportOptions& options) {
+    if (useStaticBatching) {
+        VertexPackingReport packingReport;
+        BatchRange range = staticBatch.add(vertexData, vertexCount, indexData, indexDataCount, &packingReport);
+        target.emplace_back(range, packingReport, material);
+    }
+    else {
+        target.emplace_back(vertexData, vertexCount, indexData, indexDataCount, material);
+    }
+
+    Mesh& mesh = target.back();
+    mesh.worldSpace = options.preTransform;
+    mesh.bounds = computeBounds(vertexData, vertexCount);
+    if (options.keepCpuCopy) {
+        mesh.vertices.assign(vertexData, vertexData + vertexCount);
+        mesh.indices.assign(indexData, indexData + indexDataCount);
+    }
+
+    if (usePackedVertices) {
+        mesh.packingReport.print(std::cout, std::to_string(target.size() - 1) + " (" + material->name + ")");
+        vertexPackingTotal.merge(mesh.packingReport);
+    }
+}
+
+// Number of indices convertMesh writes for the mesh
+size_t countMeshIndices(const aiMesh* mesh) {
+    size_t count = 0;
+    for (unsigned int j = 0; j < mesh->mNumFaces; j++) {
+        count += mesh->mFaces[j].mNumIndices;
+    }
+    return count;
+}
+
+// Converts an Assimp mesh into the Vertex/index layout uploaded by Mesh, writing into
+// storage sized for mNumVertices vertices and countMeshIndices(mesh) indices
+void convertMesh(const aiMesh* mesh, Vertex* vertices, unsigned int* indices) {
+    // Process vertices and indices
+    for (unsigned int j = 0; j < mesh->mNumVertices; j++) {
+        Vertex& vertex = vertices[j];
+        vertex.Position = glm::vec3(mesh->mVertices[j].x, mesh->mVertices[j].y, mesh->mVertices[j].z);
+        vertex.Normal = glm::vec3(mesh->mNormals[j].x, mesh->mNormals[j].y, mesh->mNormals[j].z);
+
+        // First UV set (for diffuse textures)
+        if (mesh->mTextureCoords[0]) {
+            vertex.TexCoords = glm::vec2(mesh->mTextureCoords[0][j].x, mesh->mTextureCoords[0][j].y);
+        }
+        else {
+            vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+        }
+
+        // Second UV set (for lightmap textures)
+        if (mesh->mTextureCoords[1]) {
+            vertex.LightmapTexCoords = glm::vec2(mesh->mTextureCoords[1][j].x, mesh->mTextureCoords[1][j].y);
+        }
+        else {
+            vertex.LightmapTexCoords = glm::vec2(0.0f, 0.0f); // Default to (0,0) if not available
+        }
+
+        // Tangent and Bitangent
+        if (mesh->HasTangentsAndBitangents()) {
+            vertex.Tangent = glm::vec3(mesh->mTangents[j].x, mesh->mTangents[j].y, mesh->mTangents[j].z);
+            vertex.Bitangent = glm::vec3(mesh->mBitangents[j].x, mesh->mBitangents[j].y, mesh->mBitangents[j].z);
+        }
+        else {
+            // Approximate tangent and bitangent based on the normal
+            glm::vec3 up = std::abs(vertex.Normal.y) < 0.999f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+            vertex.Tangent = normalize(cross(up, vertex.Normal));
+            vertex.Bitangent = cross(vertex.Normal, vertex.Tangent);
+        }
+    }
+
+    // Process indices
+    for (unsigned int j = 0; j < mesh->mNumFaces; j++) {
+        const aiFace& face = mesh->mFaces[j];
+        indices = std::copy(face.mIndices, face.mIndices + face.mNumIndices, indices);
+    }
+}
+
+std::string getMeshMaterialName(const aiScene* scene, const aiMesh* mesh) {
+    aiMaterial* aiMaterial = scene->mMaterials[mesh->mMaterialIndex];
+    aiString aiMatName;
+    aiMaterial->Get(AI_MATKEY_NAME, aiMatName);
+    return std::string(aiMatName.C_Str());
+}
+
+// Loads the model from its baked scene cache; fails if the cache is missing or stale
+bool loadModelFromCache(const std::string& path, const ModelImportOptions& options, const MaterialResolver& resolveMaterial,
+    std::vector<Mesh>& loaded) {
+    auto start = std::chrono::steady_clock::now();
 
+    SceneCache cache;
+    if (!cache.open(path, getImportSettingsHash(options))) {
+        return false;
+    }
+
+    // Geometry is uploaded straight from the mapped file
+    loaded.reserve(loaded.size() + cache.meshCount());
+    for (size_t i = 0; i < cache.meshCount(); i++) {
+        const BakedMeshRange& range = cache.mesh(i);
+        addMesh(loaded, cache.vertices(range), range.vertexCount,
+            cache.indices(range), range.indexCount,
+            resolveMaterial(cache.materialName(range)), options);
+    }
+
+    double cachedMs = millisecondsSince(start);
+    std::cout << "Scene cache: loaded " << cache.meshCount() << " meshes from " << SceneCache::cachePathFor(path)
+        << " in " << cachedMs << " ms (cold import: " << cache.coldImportMs() << " ms, "
+        << cache.coldImportMs() / std::max(cachedMs, 0.001) << "x faster)" << std::endl;
+    return true;
+}
+
+// Converts every mesh of an imported scene into one BakedScene. Storage for the whole scene is
+// sized up front, then each mesh is converted, transformed and optimized in place in its own
+// slot on a thread pool, so the result does not depend on the thread count or scheduling.
+void convertScene(const aiScene* scene, const ModelImportOptions& options, BakedScene& baked,
+    std::vector<MeshOptimizationReport>* reports = nullptr) {
+    std::vector<size_t> indexCounts(scene->mNumMeshes);
+    size_t totalVertices = 0;
+    size_t totalIndices = 0;
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+        indexCounts[i] = countMeshIndices(scene->mMeshes[i]);
+        totalVertices += scene->mMeshes[i]->mNumVertices;
+        totalIndices += indexCounts[i];
+    }
+    baked.reserve(totalVertices, totalIndices, scene->mNumMeshes);
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+        baked.appendMesh(scene->mMeshes[i]->mNumVertices, indexCounts[i], getMeshMaterialName(scene, scene->mMeshes[i]));
+    }
+
+    std::vector<MeshOptimizationReport> optimization(scene->mNumMeshes);
+    std::vector<uint32_t> vertexCounts(scene->mNumMeshes);
+    {
+        ThreadPool pool(options.importThreads);
+        for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+            pool.submit([&, i]() {
+                const BakedMeshRange& range = baked.meshes[i];
+                Vertex* vertices = baked.vertices.data() + range.firstVertex;
+                unsigned int* indices = baked.indices.data() + range.firstIndex;
+
+                convertMesh(scene->mMeshes[i], vertices, indices);
+                if (options.preTransform) {
+                    transformVertices(vertices, range.vertexCount, options.transform);
+                }
+                vertexCounts[i] = range.vertexCount;
+                if (options.optimizeMeshes) {
+                    optimization[i] = optimizeMesh(vertices, range.vertexCount, indices, range.indexCount);
+                    vertexCounts[i] = static_cast<uint32_t>(optimization[i].vertexCount);
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    // The fetch pass may drop unreferenced vertices
+    baked.shrinkMeshes(vertexCounts);
+    if (reports && options.optimizeMeshes) {
+        *reports = std::move(optimization);
+    }
+}
+
+// Imports the model through Assimp into one BakedScene
+bool importScene(const std::string& path, const ModelImportOptions& options, BakedScene& baked,
+    std::vector<MeshOptimizationReport>* reports = nullptr) {
     Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path,
-        aiProcess_Triangulate | aiProcess_FlipUVs |
-        aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices |
-        aiProcess_CalcTangentSpace);
+    const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         std::cerr << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
-        return {};
+        return false;
     }
 
-    // Load a default material in case some materials are missing
-    std::shared_ptr<Material> defaultMaterial = std::make_shared<Material>(FileSystemUtils::getAssetFilePath("materials/DefaultMaterial.xml"));
+    convertScene(scene, options, baked, reports);
+    return true;
+}
 
-    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
-        aiMesh* mesh = scene->mMeshes[i];
-        std::vector<Vertex> vertices;
-        std::vector<unsigned int> indices;
-
-        // Process vertices and indices
-        for (unsigned int j = 0; j < mesh->mNumVertices; j++) {
-            Vertex vertex;
-            vertex.Position = glm::vec3(mesh->mVertices[j].x, mesh->mVertices[j].y, mesh->mVertices[j].z);
-            vertex.Normal = glm::vec3(mesh->mNormals[j].x, mesh->mNormals[j].y, mesh->mNormals[j].z);
-
-            // First UV set (for diffuse textures)
-            if (mesh->mTextureCoords[0]) {
-                vertex.TexCoords = glm::vec2(mesh->mTextureCoords[0][j].x, mesh->mTextureCoords[0][j].y);
-            }
-            else {
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-            }
+// Imports the model, creates its meshes from the baked arrays and bakes the result for the next launch
+bool importModel(const std::string& path, const ModelImportOptions& options, const MaterialResolver& resolveMaterial,
+    std::vector<Mesh>& loaded) {
+    auto start = std::chrono::steady_clock::now();
 
-            // Second UV set (for lightmap textures)
-            if (mesh->mTextureCoords[1]) {
-                vertex.LightmapTexCoords = glm::vec2(mesh->mTextureCoords[1][j].x, mesh->mTextureCoords[1][j].y);
-            }
-            else {
-                vertex.LightmapTexCoords = glm::vec2(0.0f, 0.0f); // Default to (0,0) if not available
-            }
+    BakedScene baked;
+    std::vector<MeshOptimizationReport> reports;
+    if (!importScene(path, options, baked, &reports)) {
+        return false;
+    }
+
+    // Materials are resolved and meshes created on this thread, in scene order
+    loaded.reserve(loaded.size() + baked.meshes.size());
+    for (size_t i = 0; i < baked.meshes.size(); i++) {
+        const BakedMeshRange& range = baked.meshes[i];
+        std::string matName = baked.stringTable.substr(range.materialNameOffset, range.materialNameLength);
+        if (i < reports.size()) {
+            reports[i].print(std::cout, std::to_string(i) + " (" + matName + ")");
+        }
+        addMesh(loaded, baked.vertices.data() + range.firstVertex, range.vertexCount,
+            baked.indices.data() + range.firstIndex, range.indexCount, resolveMaterial(matName), options);
+    }
+
+    double coldMs = millisecondsSince(start);
+    std::cout << "Scene cache: cold import of " << path << " took " << coldMs << " ms" << std::endl;
+
+    if (SceneCache::write(path, getImportSettingsHash(options), baked, coldMs)) {
+        std::cout << "Scene cache: baked " << baked.meshes.size() << " meshes to " << SceneCache::cachePathFor(path) << std::endl;
+    }
+    return true;
+}
 
-            // Tangent and Bitangent
-            if (mesh->HasTangentsAndBitangents()) {
-                vertex.Tangent = glm::vec3(mesh->mTangents[j].x, mesh->mTangents[j].y, mesh->mTangents[j].z);
-                vertex.Bitangent = glm::vec3(mesh->mBitangents[j].x, mesh->mBitangents[j].y, mesh->mBitangents[j].z);
+// Writes a Wavefront OBJ of meshCount wavy grids with about triangleCount triangles in total
+bool writeSyntheticObj(const std::string& path, size_t triangleCount, size_t meshCount) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+
+    size_t side = std::max<size_t>(1, static_cast<size_t>(std::sqrt(triangleCount / (2.0 * meshCount))));
+    size_t vertexBase = 1;
+    for (size_t m = 0; m < meshCount; m++) {
+        out << "o mesh_" << m << "\nusemtl material_" << m % 8 << "\n";
+        float originX = static_cast<float>(m % 8) * side;
+        float originZ = static_cast<float>(m / 8) * side;
+        for (size_t z = 0; z <= side; z++) {
+            for (size_t x = 0; x <= side; x++) {
+                float height = std::sin(x * 0.3f) * std::cos(z * 0.2f);
+                out << "v " << originX + x << ' ' << height << ' ' << originZ + z << '\n';
+                out << "vt " << static_cast<float>(x) / side << ' ' << static_cast<float>(z) / side << '\n';
+                out << "vn 0 1 0\n";
             }
-            else {
-                // Approximate tangent and bitangent based on the normal
-                glm::vec3 up = std::abs(vertex.Normal.y) < 0.999f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
-                vertex.Tangent = normalize(cross(up, vertex.Normal));
-                vertex.Bitangent = cross(vertex.Normal, vertex.Tangent);
+        }
+        for (size_t z = 0; z < side; z++) {
+            for (size_t x = 0; x < side; x++) {
+                size_t a = vertexBase + z * (side + 1) + x;
+                size_t b = a + side + 1;
+                out << "f " << a << '/' << a << '/' << a << ' ' << b << '/' << b << '/' << b << ' ' << a + 1 << '/' << a + 1 << '/' << a + 1 << '\n';
+                out << "f " << a + 1 << '/' << a + 1 << '/' << a + 1 << ' ' << b << '/' << b << '/' << b << ' ' << b + 1 << '/' << b + 1 << '/' << b + 1 << '\n';
             }
+        }
+        vertexBase += (side + 1) * (side + 1);
+    }
+    return static_cast<bool>(out);
+}
+
+// Imports a large synthetic OBJ without a GL context and reports import time and peak RSS
+void runImportBenchmark(size_t triangleCount) {
+    std::string path = (std::filesystem::temp_directory_path() / "dlm_import_benchmark.obj").string();
+    if (!writeSyntheticObj(path, triangleCount, 64)) {
+        std::cerr << "Import benchmark: could not write " << path << std::endl;
+        return;
+    }
+
+    std::error_code ec;
+    double fileMB = std::filesystem::file_size(path, ec) / (1024.0 * 1024.0);
+    size_t residentBefore = getCurrentResidentBytes();
+    auto start = std::chrono::steady_clock::now();
+
+    ModelImportOptions options;
+    options.optimizeMeshes = false; // Measure the import itself; optimization is benchmarked by its own report
+    BakedScene baked;
+    bool imported = importScene(path, options, baked);
+    double importMs = millisecondsSince(start);
+    std::filesystem::remove(path, ec);
+    if (!imported) {
+        return;
+    }
+
+    double bakedMB = (baked.vertices.size() * sizeof(Vertex) + baked.indices.size() * sizeof(unsigned int)) / (1024.0 * 1024.0);
+    std::cout << "Import benchmark: " << baked.indices.size() / 3 << " triangles, " << baked.vertices.size() << " vertices in "
+        << baked.meshes.size() << " meshes (" << fileMB << " MB OBJ)" << std::endl;
+    std::cout << "  import time: " << importMs << " ms" << std::endl;
+    std::cout << "  resident before: " << residentBefore / (1024.0 * 1024.0) << " MB, peak: "
+        << getPeakResidentBytes() / (1024.0 * 1024.0) << " MB, baked arrays: " << bakedMB << " MB" << std::endl;
+}
 
-            vertices.push_back(vertex);
+// Times the parallel conversion stage for 1..N threads on one synthetic scene and checks that every
+// thread count produces identical output
+void runImportScalingBenchmark(size_t triangleCount) {
+    std::string path = (std::filesystem::temp_directory_path() / "dlm_import_scaling.obj").string();
+    if (!writeSyntheticObj(path, triangleCount, 64)) {
+        std::cerr << "Import scaling benchmark: could not write " << path << std::endl;
+        return;
+    }
+
+    auto readStart = std::chrono::steady_clock::now();
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
+    double readMs = millisecondsSince(readStart);
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        std::cerr << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+        return;
+    }
+
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::cout << "Import scaling benchmark: " << scene->mNumMeshes << " meshes, Assimp read (serial) "
+        << readMs << " ms" << std::endl;
+
+    double singleThreadMs = 0.0;
+    uint64_t referenceHash = 0;
+    for (unsigned int threads : threadCounts) {
+        ModelImportOptions options;
+        options.importThreads = threads;
+
+        auto start = std::chrono::steady_clock::now();
+        BakedScene baked;
+        convertScene(scene, options, baked);
+        double convertMs = millisecondsSince(start);
+
+        uint64_t hash = hashBytes(baked.vertices.data(), baked.vertices.size() * sizeof(Vertex));
+        hash = hashBytes(baked.indices.data(), baked.indices.size() * sizeof(unsigned int), hash);
+        if (threads == 1) {
+            singleThreadMs = convertMs;
+            referenceHash = hash;
         }
 
-        // Process indices
-        for (unsigned int j = 0; j < mesh->mNumFaces; j++) {
-            aiFace face = mesh->mFaces[j];
-            for (unsigned int k = 0; k < face.mNumIndices; k++) {
-                indices.push_back(face.mIndices[k]);
-            }
+        std::cout << "  " << threads << " thread(s): " << convertMs << " ms, "
+            << singleThreadMs / std::max(convertMs, 0.001) << "x"
+            << (hash == referenceHash ? "" : " (output differs from 1 thread!)") << std::endl;
+    }
+}
+
+// Packs every mesh of the model on the CPU and prints the packing error and memory saved, without a GL context
+void reportVertexPacking(const std::string& path, const ModelImportOptions& options) {
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        std::cerr << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+        return;
+    }
+
+    VertexPackingReport total;
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+        std::vector<Vertex> vertices(scene->mMeshes[i]->mNumVertices);
+        std::vector<unsigned int> indices(countMeshIndices(scene->mMeshes[i]));
+        convertMesh(scene->mMeshes[i], vertices.data(), indices.data());
+        if (options.preTransform) {
+            transformVertices(vertices.data(), vertices.size(), options.transform);
         }
 
-        // Get the material assigned to this mesh
-        aiMaterial* aiMaterial = scene->mMaterials[mesh->mMaterialIndex];
-        aiString aiMatName;
-        aiMaterial->Get(AI_MATKEY_NAME, aiMatName);
-        std::string matName(aiMatName.C_Str());
+        std::vector<PackedVertex> packed(vertices.size());
+        PositionDequantization dequantization = packVertices(vertices.data(), vertices.size(), packed.data());
+        VertexPackingReport report = measurePackingError(vertices.data(), packed.data(), vertices.size(), dequantization);
+        report.print(std::cout, std::to_string(i) + " (" + getMeshMaterialName(scene, scene->mMeshes[i]) + ")");
+        total.merge(report);
+    }
+    total.print(std::cout, "total");
+}
 
-        // Find the corresponding Material object
-        std::shared_ptr<Material> meshMaterial;
-        auto it = materials.find(matName);
-        if (it != materials.end()) {
-            meshMaterial = it->second;
+// World-space lights of an imported scene for the lightmap baker. A light is placed by its node,
+// then by the import transform like the meshes.
+std::vector<BakeLight> getSceneLights(const aiScene* scene, const ModelImportOptions& options) {
+    std::vector<BakeLight> lights;
+    for (unsigned int i = 0; i < scene->mNumLights; i++) {
+        const aiLight* light = scene->mLights[i];
+
+        glm::mat4 transform(1.0f);
+        for (const aiNode* node = scene->mRootNode->FindNode(light->mName); node != nullptr; node = node->mParent) {
+            // Assimp matrices are row-major
+            transform = glm::transpose(glm::make_mat4(&node->mTransformation.a1)) * transform;
         }
-        else {
-            std::cerr << "Material not found for mesh: " << matName << ". Using default material." << std::endl;
-            meshMaterial = defaultMaterial;
+        if (options.preTransform) {
+            transform = options.transform * transform;
         }
 
-        // Create the Mesh object with the material
-        meshes.push_back(Mesh(vertices, indices, meshMaterial));
+        BakeLight bakeLight;
+        switch (light->mType) {
+        case aiLightSource_DIRECTIONAL: bakeLight.type = BakeLightType::Directional; break;
+        case aiLightSource_POINT: bakeLight.type = BakeLightType::Point; break;
+        case aiLightSource_SPOT: bakeLight.type = BakeLightType::Spot; break;
+        default:
+            std::cerr << "Lightmap baker: skipping light " << light->mName.C_Str() << " of unsupported type" << std::endl;
+            continue;
+        }
+        bakeLight.position = glm::vec3(transform * glm::vec4(light->mPosition.x, light->mPosition.y, light->mPosition.z, 1.0f));
+        bakeLight.direction = glm::normalize(glm::mat3(transform) * glm::vec3(light->mDirection.x, light->mDirection.y, light->mDirection.z));
+        bakeLight.color = glm::vec3(light->mColorDiffuse.r, light->mColorDiffuse.g, light->mColorDiffuse.b);
+
+        // Attenuation is given over distances in model units; the baker measures them after the transform
+        float scale = std::cbrt(std::abs(glm::determinant(glm::mat3(transform))));
+        bakeLight.attenuationConstant = light->mAttenuationConstant;
+        bakeLight.attenuationLinear = light->mAttenuationLinear / scale;
+        bakeLight.attenuationQuadratic = light->mAttenuationQuadratic / (scale * scale);
+
+        // Assimp gives the full cone angles
+        bakeLight.innerConeAngle = light->mAngleInnerCone * 0.5f;
+        bakeLight.outerConeAngle = light->mAngleOuterCone * 0.5f;
+        lights.push_back(bakeLight);
     }
-
-    return meshes;
+    return lights;
 }
 
-std::vector<Mesh> loadModel(const std::string& path, std::shared_ptr<Material> singleMaterial) {
-    // Initialize Assimp importer
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path,
-        aiProcess_Triangulate | aiProcess_FlipUVs |
-        aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices |
-        aiProcess_CalcTangentSpace);
+// Baked lightmaps go below this asset directory, in one subdirectory per model
+const std::string bakedLightmapDirectory = "textures/lightmaps";
 
+// Imports the model like loadModel does, keeping the Assimp scene for its lights
+bool importSceneForBake(const std::string& path, const ModelImportOptions& options, BakedScene& baked, std::vector<BakeLight>& lights) {
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, MODEL_IMPORT_FLAGS);
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         std::cerr << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
-        return {};
+        return false;
     }
 
-    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
-        aiMesh* mesh = scene->mMeshes[i];
-        std::vector<Vertex> vertices;
-        std::vector<unsigned int> indices;
-
-        // Process vertices and indices
-        for (unsigned int j = 0; j < mesh->mNumVertices; j++) {
-            Vertex vertex;
-            vertex.Position = glm::vec3(mesh->mVertices[j].x, mesh->mVertices[j].y, mesh->mVertices[j].z);
-            vertex.Normal = glm::vec3(mesh->mNormals[j].x, mesh->mNormals[j].y, mesh->mNormals[j].z);
-
-            // First UV set (for diffuse textures)
-            if (mesh->mTextureCoords[0]) {
-                vertex.TexCoords = glm::vec2(mesh->mTextureCoords[0][j].x, mesh->mTextureCoords[0][j].y);
-            }
-            else {
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-            }
+    convertScene(scene, options, baked);
+    lights = getSceneLights(scene, options);
+    if (lights.empty()) {
+        std::cout << "Lightmap baker: " << path << " has no lights, baking the sky only" << std::endl;
+    }
+    return true;
+}
 
-            // Second UV set (for lightmap textures)
-            if (mesh->mTextureCoords[1]) {
-                vertex.LightmapTexCoords = glm::vec2(mesh->mTextureCoords[1][j].x, mesh->mTextureCoords[1][j].y);
-            }
-            else {
-                vertex.LightmapTexCoords = glm::vec2(0.0f, 0.0f); // Default to (0,0) if not available
-            }
+// Bakes lightmap0..2 of every material of the model on the CPU, writes them as TGA files and
+// points the material XMLs at them. Needs no GL context. An incremental bake starts from the record
+// of the previous one, re-traces only the texels the scene changes can affect and rewrites only the
+// lightmaps that changed.
+bool bakeModelLightmaps(const std::string& path, const ModelImportOptions& options, const LightmapBakeOptions& bakeOptions, bool incremental) {
+    BakedScene baked;
+    std::vector<BakeLight> lights;
+    if (!importSceneForBake(path, options, baked, lights)) {
+        return false;
+    }
 
-            // Tangent and Bitangent
-            if (mesh->HasTangentsAndBitangents()) {
-                vertex.Tangent = glm::vec3(mesh->mTangents[j].x, mesh->mTangents[j].y, mesh->mTangents[j].z);
-                vertex.Bitangent = glm::vec3(mesh->mBitangents[j].x, mesh->mBitangents[j].y, mesh->mBitangents[j].z);
-            }
-            else {
-                // Approximate tangent and bitangent based on the normal
-                glm::vec3 up = std::abs(vertex.Normal.y) < 0.999f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
-                vertex.Tangent = normalize(cross(up, vertex.Normal));
-                vertex.Bitangent = cross(vertex.Normal, vertex.Tangent);
-            }
+    std::string modelName = getModelName(path);
+    std::string outputDirectory = bakedLightmapDirectory + "/" + modelName;
+    std::string recordPath = FileSystemUtils::getAssetFilePath(outputDirectory + "/" + modelName + ".lightmapbake");
+    LightmapBake previous;
+    bool hasPrevious = incremental && previous.read(recordPath);
+    if (incremental && !hasPrevious) {
+        std::cout << "Lightmap baker: no usable bake record at " << recordPath << ", baking everything" << std::endl;
+    }
+
+    LightmapBakeStats stats;
+    LightmapBake bake = bakeLightmaps(baked, lights, bakeOptions, hasPrevious ? &previous : nullptr, &stats);
+    stats.print(std::cout);
+
+    std::error_code ec;
+    std::filesystem::create_directories(FileSystemUtils::getAssetFilePath(outputDirectory), ec);
 
-            vertices.push_back(vertex);
+    std::map<std::string, std::string> materialFiles;
+    for (const auto& [materialKey, materialFilePath] : readMaterialsList(path)) {
+        materialFiles[materialKey] = materialFilePath;
+    }
+
+    bool written = true;
+    size_t rewritten = 0;
+    for (const DirectionalLightmap& lightmap : bake.lightmaps) {
+        // Material names may contain characters that are not allowed in file names
+        std::string fileName = lightmap.material;
+        std::replace_if(fileName.begin(), fileName.end(), [](char c) { return !std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_'; }, '_');
+
+        std::array<std::string, 3> assetPaths;
+        std::array<std::string, 3> filePaths;
+        bool missing = false;
+        for (int i = 0; i < 3; i++) {
+            assetPaths[i] = outputDirectory + "/" + fileName + "_lightmap" + std::to_string(i) + ".tga";
+            filePaths[i] = FileSystemUtils::getAssetFilePath(assetPaths[i]);
+            missing = missing || !std::filesystem::exists(filePaths[i], ec);
+        }
+        if (!lightmap.modified && !missing) {
+            continue;
         }
+        if (!writeDirectionalLightmap(lightmap, filePaths)) {
+            written = false;
+            continue;
+        }
+        rewritten++;
 
-        // Process indices
-        for (unsigned int j = 0; j < mesh->mNumFaces; j++) {
-            aiFace face = mesh->mFaces[j];
-            for (unsigned int k = 0; k < face.mNumIndices; k++) {
-                indices.push_back(face.mIndices[k]);
-            }
+        auto it = materialFiles.find(lightmap.material);
+        if (it == materialFiles.end()) {
+            std::cerr << "Lightmap baker: " << lightmap.material << " is not in the materials list, so no material uses its lightmaps" << std::endl;
+            continue;
         }
+        written = updateMaterialLightmaps(it->second, assetPaths) && written;
+    }
 
-        // Create the Mesh object with the material
-        meshes.push_back(Mesh(vertices, indices, singleMaterial));
+    // Only a complete bake may serve as the base of the next one
+    if (written && !bake.write(recordPath)) {
+        written = false;
     }
 
-    return meshes;
+    std::cout << "Lightmap baker: wrote " << rewritten << " of " << bake.lightmaps.size() << " lightmap triplets to " << outputDirectory << std::endl;
+    return written;
 }
 
-GLuint loadTextureFromFile(const char* path, const std::string&) {
-    GLuint textureID;
-    glGenTextures(1, &textureID);
+// Bakes the model's lightmaps with 1..N threads and reports rays per second, the speedup and
+// parallel efficiency over one thread, and whether every thread count produced the same lightmaps
+void runLightmapScalingBenchmark(const std::string& path, const ModelImportOptions& options, LightmapBakeOptions bakeOptions) {
+    BakedScene baked;
+    std::vector<BakeLight> lights;
+    if (!importSceneForBake(path, options, baked, lights)) {
+        return;
+    }
+
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::cout << "Lightmap scaling benchmark: " << baked.indices.size() / 3 << " triangles, " << lights.size() << " lights, "
+        << bakeOptions.resolution << "x" << bakeOptions.resolution << " texels per material, " << bakeOptions.skySamples
+        << " sky samples" << std::endl;
+
+    double singleThreadMs = 0.0;
+    uint64_t referenceHash = 0;
+    for (unsigned int threads : threadCounts) {
+        bakeOptions.threads = threads;
+        LightmapBakeStats stats;
+        std::vector<DirectionalLightmap> lightmaps = bakeDirectionalLightmaps(baked, lights, bakeOptions, &stats);
+
+        uint64_t hash = FNV1A_OFFSET_BASIS;
+        for (const DirectionalLightmap& lightmap : lightmaps) {
+            for (const auto& layer : lightmap.layers) {
+                hash = hashBytes(layer.data(), layer.size() * sizeof(glm::vec3), hash);
+            }
+        }
+        if (threads == 1) {
+            singleThreadMs = stats.traceMs;
+            referenceHash = hash;
+        }
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data) {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
+        double speedup = singleThreadMs / std::max(stats.traceMs, 0.001);
+        std::cout << "  " << threads << " thread(s): " << stats.traceMs << " ms, " << stats.raysPerSecond() / 1e6 << " Mrays/s, "
+            << speedup << "x, " << 100.0 * speedup / threads << "% efficiency, " << stats.steals << " steals"
+            << (hash == referenceHash ? "" : " (output differs from 1 thread!)") << std::endl;
+    }
+}
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+std::vector<Mesh> loadModel(const std::string& path, const ModelImportOptions& options = ModelImportOptions());
+std::vector<Mesh> loadModel(const std::string& path, std::shared_ptr<Material> singleMaterial, const ModelImportOptions& options = ModelImportOptions());
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+std::vector<Mesh> loadModel(const std::string& path, const ModelImportOptions& options) {
+    // Load materials from the materials list file
+    auto materials = loadMaterialsFromList(path);
 
-        stbi_image_free(data);
+    // Load a default material in case some materials are missing
+    std::shared_ptr<Material> defaultMaterial = std::make_shared<Material>(FileSystemUtils::getAssetFilePath("materials/DefaultMaterial.xml"));
+
+    // Find the corresponding Material object
+    MaterialResolver resolveMaterial = [&](const std::string& matName) {
+        auto it = materials.find(matName);
+        if (it != materials.end()) {
+            return it->second;
+        }
+        std::cerr << "Material not found for mesh: " << matName << ". Using default material." << std::endl;
+        return defaultMaterial;
+    };
+
+    std::vector<Mesh> loaded;
+    if (!loadModelFromCache(path, options, resolveMaterial, loaded) && !importModel(path, options, resolveMaterial, loaded)) {
+        return {};
     }
-    else {
-        std::cerr << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+
+    return loaded;
+}
+
+std::vector<Mesh> loadModel(const std::string& path, std::shared_ptr<Material> singleMaterial, const ModelImportOptions& options) {
+    MaterialResolver resolveMaterial = [&](const std::string&) {
+        return singleMaterial;
+    };
+
+    std::vector<Mesh> loaded;
+    if (!loadModelFromCache(path, options, resolveMaterial, loaded) && !importModel(path, options, resolveMaterial, loaded)) {
+        return {};
     }
 
-    return textureID;
+    return loaded;
+}
+
+// Texture decoding runs on worker threads; the GL uploads happen when the loader is drained
+TextureLoader textureLoader;
+
+// Upload 2D textures block-compressed with precomputed mips, transcoded once into .texcache files.
+// Bump maps stay uncompressed unless they are normal maps whose shader handles BUMP_MAP_XY; those become BC5.
+const bool useCompressedTextures = true;
+
+GLuint loadTextureFromFile(const char* path, const std::string&, BlockFormat& format, const MipOptions& mips) {
+    if (!useCompressedTextures) {
+        format = BlockFormat::None;
+    }
+    return textureLoader.load2D(path, format, mips);
 }
 
 GLuint loadCubemap(const std::vector<std::string>& faces) {
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++) {
-        unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data) {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
+    return textureLoader.loadCubemap(faces);
+}
+
+// Bind lightmap0..2 as the layers of one GL_TEXTURE_2D_ARRAY; shaders select it with LIGHTMAP_ARRAY.
+// With the level atlas, every material's triplet is appended to one array shared by the whole level,
+// and lightmapLayer tells the shader where its triplet starts. All layers must have the same size.
+// Needs shaders that handle LIGHTMAP_ARRAY; materials whose shader does not keep three 2D textures.
+const bool useLightmapArrays = false;
+const bool useLevelLightmapAtlas = false;
+
+struct LevelLightmapAtlas {
+    GLuint texture = 0;
+    std::vector<std::string> layers;
+    BlockFormat format = BlockFormat::None;
+    MipOptions mips;
+} levelLightmapAtlas;
+
+GLuint loadLightmapArray(const std::vector<std::string>& layers, BlockFormat& format, const MipOptions& mips, int& firstLayer) {
+    if (!useLightmapArrays) {
+        return 0;
+    }
+    if (!useCompressedTextures) {
+        format = BlockFormat::None;
+    }
+    else if (format == BlockFormat::Auto) {
+        // Every layer of an array shares one internal format, so the per-image BC1/BC3 choice is pinned
+        format = BlockFormat::BC1;
+    }
+
+    if (!useLevelLightmapAtlas) {
+        firstLayer = 0;
+        return textureLoader.loadArray(layers, format, mips);
+    }
+
+    // The atlas is uploaded once the whole level is known, see uploadLevelLightmapAtlas
+    if (levelLightmapAtlas.texture == 0) {
+        glGenTextures(1, &levelLightmapAtlas.texture);
+        levelLightmapAtlas.format = format;
+        levelLightmapAtlas.mips = mips;
+    }
+    format = levelLightmapAtlas.format;
+    firstLayer = static_cast<int>(levelLightmapAtlas.layers.size());
+    levelLightmapAtlas.layers.insert(levelLightmapAtlas.layers.end(), layers.begin(), layers.end());
+    return levelLightmapAtlas.texture;
+}
+
+void uploadLevelLightmapAtlas() {
+    if (levelLightmapAtlas.layers.empty()) {
+        return;
+    }
+    std::cout << "Level lightmap atlas: " << levelLightmapAtlas.layers.size() << " layers" << std::endl;
+    textureLoader.loadArray(levelLightmapAtlas.layers, levelLightmapAtlas.format, levelLightmapAtlas.mips, levelLightmapAtlas.texture);
+}
+
+// Registers every uploaded 2D texture of the level with the residency manager; call after textureLoader.finish()
+void registerStreamedTextures(const std::vector<Mesh>& levelMeshes) {
+    for (const auto& mesh : levelMeshes) {
+        for (const auto& texture : mesh.material->textures) {
+            if (texture.isCubemap || texture.isArray || texture.id == 0 || streamedTextureIndices.count(texture.id)) {
+                continue;
+            }
+
+            // Level sizes as the driver stores them
+            GLint width = 0, height = 0, maxLevel = 0;
+            glBindTexture(GL_TEXTURE_2D, texture.id);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+            glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+            if (width <= 0 || height <= 0) {
+                continue;
+            }
+            int levelCount = std::min(maxLevel + 1, static_cast<int>(std::floor(std::log2(std::max(width, height)))) + 1);
+
+            std::vector<size_t> levelBytes;
+            for (int level = 0; level < levelCount; level++) {
+                GLint compressed = GL_FALSE;
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &compressed);
+                if (compressed) {
+                    GLint size = 0;
+                    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+                    levelBytes.push_back(static_cast<size_t>(size));
+                }
+                else {
+                    GLint bits[4] = {};
+                    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_RED_SIZE, &bits[0]);
+                    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_GREEN_SIZE, &bits[1]);
+                    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_BLUE_SIZE, &bits[2]);
+                    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_ALPHA_SIZE, &bits[3]);
+                    size_t texels = static_cast<size_t>(std::max(width >> level, 1)) * std::max(height >> level, 1);
+                    levelBytes.push_back(texels * (bits[0] + bits[1] + bits[2] + bits[3] + 7) / 8);
+                }
+            }
+
+            streamedTextureIndices[texture.id] = textureResidency.addTexture(levelBytes, width, height);
+            streamedTextures.push_back({ texture.id, texture.path, texture.compression, defaultMipOptions(texture.type, Material::ssBumpMaps),
+                width, height, levelCount });
         }
-        else {
-            std::cerr << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    std::cout << "Texture streaming: " << streamedTextures.size() << " textures, "
+        << textureResidency.residentBytes() / (1024.0 * 1024.0) << " MB loaded, "
+        << textureStreamingOptions.budgetBytes / (1024.0 * 1024.0) << " MB budget" << std::endl;
+}
+
+// Requests the mip level every visible mesh needs and reloads the textures whose resident levels change
+void updateTextureStreaming(const std::vector<Mesh>& levelMeshes, const std::vector<uint32_t>& visible,
+    const FrameConstantsData& frame, float viewportHeight) {
+    glm::vec3 eye = glm::vec3(frame.viewPos);
+    textureResidency.beginFrame();
+    for (uint32_t index : visible) {
+        const Mesh& mesh = levelMeshes[index];
+        float pixels = projectedSizePixels(mesh.bounds, eye, frame.projection[1][1], viewportHeight);
+        for (const auto& texture : mesh.material->textures) {
+            auto it = streamedTextureIndices.find(texture.id);
+            if (it == streamedTextureIndices.end()) {
+                continue;
+            }
+            const StreamedTexture& streamed = streamedTextures[it->second];
+            float tiling = std::max(texture.tiling.x, texture.tiling.y);
+            textureResidency.request(it->second, desiredMipLevel(streamed.width, streamed.height, tiling, pixels, streamed.levelCount));
         }
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-    return textureID;
+    for (const ResidencyChange& change : textureResidency.update()) {
+        const StreamedTexture& streamed = streamedTextures[change.texture];
+        textureLoader.reload2D(streamed.id, streamed.path, streamed.format, streamed.mips, change.baseLevel);
+    }
+    textureLoader.processUploads();
+}
+
+// Collects the image files below a directory for the texture decode benchmark
+std::vector<std::string> findImageFiles(const std::string& directory) {
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, ec)) {
+        std::string extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp") {
+            paths.push_back(entry.path().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
 }
 
 GLuint compileShader(const char* vertexSrc, const char* fragmentSrc, const std::string& shaderName) {
@@ -500,6 +1213,8 @@ GLuint compileShader(const char* vertexSrc, const char* fragmentSrc, const std::
     GLuint shaderProgram = glCreateProgram();
     glAttachShader(shaderProgram, vertexShader);
     glAttachShader(shaderProgram, fragmentShader);
+    // Lets the program binary cache read the linked binary back
+    glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(shaderProgram);
 
     // Check Linking
@@ -516,35 +1231,69 @@ GLuint compileShader(const char* vertexSrc, const char* fragmentSrc, const std::
     return shaderProgram;
 }
 
-int main() {
+// Opens the window and GL context, a hidden one without vsync for benchmarks. Null on failure.
+GLFWwindow* createWindow(bool benchmark, const std::string& contextApi) {
+#ifdef GLFW_PLATFORM_NULL
+    // OSMesa renders in software without a window system, so it works on machines without a display
+    if (benchmark && contextApi == "osmesa") {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+#endif
+
     // Initialize GLFW
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
-        return -1;
+        return nullptr;
     }
 
     // Create a GLFW window
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3); // Request OpenGL 4.3 or newer
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (benchmark) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        if (contextApi == "egl") {
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+        }
+        else if (contextApi == "osmesa") {
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+        }
+        else if (contextApi != "native") {
+            std::cerr << "Unknown context API: " << contextApi << " (native, egl or osmesa)" << std::endl;
+            glfwTerminate();
+            return nullptr;
+        }
+    }
 
     GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "OpenGL Directional LightMapping Example", nullptr, nullptr);
     if (!window) {
         std::cerr << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
-        return -1;
+        return nullptr;
     }
     glfwMakeContextCurrent(window);
-    glfwSwapInterval(1); // Enable VSync to cap frame rate to monitor's refresh rate
-    glfwSetCursorPosCallback(window, mouseCallback);
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    glfwSetScrollCallback(window, scrollCallback);
+    if (benchmark) {
+        glfwSwapInterval(0); // Frame times must not be capped by the refresh rate
+    }
+    else {
+        glfwSwapInterval(1); // Enable VSync to cap frame rate to monitor's refresh rate
+        glfwSetCursorPosCallback(window, mouseCallback);
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        glfwSetScrollCallback(window, scrollCallback);
+    }
 
     // Initialize GLEW
     glewExperimental = GL_TRUE;
-    if (glewInit() != GLEW_OK) {
+    GLenum glewStatus = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLX builds of GLEW report this for EGL and OSMesa contexts, but the GL entry points still load
+    if (glewStatus == GLEW_ERROR_NO_GLX_DISPLAY) {
+        glewStatus = GLEW_OK;
+    }
+#endif
+    if (glewStatus != GLEW_OK) {
         std::cerr << "Failed to initialize GLEW" << std::endl;
-        return -1;
+        return nullptr;
     }
 
     // Clear any GLEW errors
@@ -552,12 +1301,318 @@ int main() {
 
     // Enable OpenGL debugging if supported
     glEnable(GL_DEBUG_OUTPUT);
-    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    if (!benchmark) {
+        // Synchronous callbacks serialize the driver, which would skew benchmark timings
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }
     glDebugMessageCallback(MessageCallback, nullptr);
 
     // Optionally filter which types of messages you want to log
     glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
 
+    PROFILE_ENABLE_GPU();
+    return window;
+}
+
+// Distance of the bounds' centre in front of the camera, used to draw blended meshes back to front
+float viewDepth(const glm::mat4& view, const AABB& bounds) {
+    return -(view * glm::vec4(bounds.center(), 1.0f)).z;
+}
+
+// Culls, streams textures and draws the level from the current camera into sceneFramebuffer
+void renderFrame(const glm::mat4& levelTransform) {
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+
+    glClearColor(0.3f, 0.3f, 0.4f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    float aspectRatio = static_cast<float>(WIDTH) / HEIGHT;
+
+    // Camera matrices and visualization flags are computed and uploaded once for the frame
+    frameConstants.update(camera, aspectRatio, visualizeNormals, visualizeshadowIntensity);
+
+    // Only meshes inside the view frustum reach the draw loop
+    {
+        PROFILE_SCOPE("Culling");
+        visibleMeshes.clear();
+        lastFrameCullingStats = CullingStats();
+        if (useFrustumCulling) {
+            levelBVH.cull(Frustum::fromMatrix(frameConstants.data().viewProj), visibleMeshes, lastFrameCullingStats);
+        }
+        else {
+            for (uint32_t i = 0; i < meshes.size(); i++) {
+                visibleMeshes.push_back(i);
+            }
+            lastFrameCullingStats.meshesVisible = static_cast<unsigned int>(meshes.size());
+        }
+    }
+
+    if (!streamedTextures.empty()) {
+        PROFILE_SCOPE("Texture streaming");
+        updateTextureStreaming(meshes, visibleMeshes, frameConstants.data(), static_cast<float>(HEIGHT));
+    }
+
+    // The draw loop, timed on the CPU and as one GPU pass
+    {
+        PROFILE_SCOPE("Draw");
+        PROFILE_GPU_SCOPE("Draw");
+        if (useStaticBatching) {
+            // One multi-draw per material, or per draw group with the material table, over the shared level buffers
+            materialTable.bind(glState);
+            staticBatch.clearDraws();
+            for (uint32_t index : visibleMeshes) {
+                const Mesh& mesh = meshes[index];
+                staticBatch.submit(*mesh.material, mesh.batchRange, viewDepth(frameConstants.data().view, mesh.bounds));
+            }
+            staticBatch.execute(frameConstants, glState, levelImportOptions.preTransform ? nullptr : &levelTransform);
+        }
+        else {
+            // Queue all objects, then draw them sorted by blend state, program, textures and VAO
+            materialTable.bind(glState);
+            renderQueue.clear();
+            for (uint32_t index : visibleMeshes) {
+                const Mesh& mesh = meshes[index];
+                renderQueue.submit(*mesh.material, mesh.VAO, mesh.indexCount, mesh.worldSpace ? nullptr : &levelTransform,
+                    viewDepth(frameConstants.data().view, mesh.bounds), index);
+            }
+            renderQueue.sort();
+            renderQueue.execute(frameConstants, glState);
+        }
+    }
+}
+
+// Plays the camera path offscreen with a fixed time step, timing every frame to completion
+int runFlythroughBenchmark(const FlythroughOptions& options, const glm::mat4& levelTransform,
+    const std::vector<std::pair<std::string, double>>& loadMs) {
+    CameraPath path;
+    if (!options.cameraPath.empty()) {
+        if (!path.load(options.cameraPath)) {
+            return -1;
+        }
+    }
+    else {
+        AABB levelBounds;
+        for (const auto& mesh : meshes) {
+            levelBounds.min = glm::min(levelBounds.min, mesh.bounds.min);
+            levelBounds.max = glm::max(levelBounds.max, mesh.bounds.max);
+        }
+        path.generate(levelBounds);
+    }
+
+    // Fixed-size offscreen target, so the result does not depend on the (hidden) window
+    GLuint renderbuffers[2];
+    glGenRenderbuffers(2, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WIDTH, HEIGHT);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, WIDTH, HEIGHT);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glGenFramebuffers(1, &sceneFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Benchmark framebuffer is incomplete" << std::endl;
+        return -1;
+    }
+
+    BenchmarkReport report;
+    report.context = options.context;
+    report.renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    report.version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    report.width = WIDTH;
+    report.height = HEIGHT;
+    report.warmupFrames = options.warmupFrames;
+    report.textureStreaming = !streamedTextures.empty();
+    report.loadMs = loadMs;
+    report.frames.reserve(options.frames);
+
+    deltaTime = 1.0f / 60.0f;
+    for (size_t frame = 0; frame < options.warmupFrames + options.frames; frame++) {
+        PROFILE_FRAME();
+        size_t pathFrame = frame < options.warmupFrames ? 0 : frame - options.warmupFrames;
+        CameraPose pose = path.sample(static_cast<float>(pathFrame) / std::max<size_t>(options.frames, 1));
+        camera = makeCamera(pose.position, pose.yaw, pose.pitch);
+
+        glCallStats = GLCallStats();
+        glState.beginFrame();
+        auto start = std::chrono::steady_clock::now();
+        renderFrame(levelTransform);
+        double cpuMs = millisecondsSince(start);
+        glFinish();
+        double frameMs = millisecondsSince(start);
+
+        if (frame >= options.warmupFrames) {
+            report.frames.push_back({ frameMs, cpuMs, glCallStats, glState.stats() });
+        }
+        glfwPollEvents();
+    }
+
+    report.peakResidentBytes = getPeakResidentBytes();
+    report.print(std::cout);
+    bool written = report.writeJson(options.reportPath);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &sceneFramebuffer);
+    glDeleteRenderbuffers(2, renderbuffers);
+    sceneFramebuffer = 0;
+    return written ? 0 : -1;
+}
+
+// Flies the generated benchmark path with the recording backend installed and checks the GL calls of
+// every frame against limits derived from the visible meshes and materials. Returns 1 on violations.
+int runSubmissionCheck(GLRecorder& recorder, size_t frameCount, const glm::mat4& levelTransform) {
+    SubmissionCheck check(recorder);
+    std::cout << "Level load: " << recorder.totalCalls() << " GL calls, " << check.loadErrors() << " errors" << std::endl;
+
+    AABB levelBounds;
+    for (const auto& mesh : meshes) {
+        levelBounds.min = glm::min(levelBounds.min, mesh.bounds.min);
+        levelBounds.max = glm::max(levelBounds.max, mesh.bounds.max);
+    }
+    CameraPath path;
+    path.generate(levelBounds);
+
+    deltaTime = 1.0f / 60.0f;
+    std::vector<const Material*> visibleMaterials;
+    for (size_t frame = 0; frame < frameCount; frame++) {
+        CameraPose pose = path.sample(static_cast<float>(frame) / std::max<size_t>(frameCount, 1));
+        camera = makeCamera(pose.position, pose.yaw, pose.pitch);
+
+        glCallStats = GLCallStats();
+        glState.beginFrame();
+        recorder.resetCounters();
+        renderFrame(levelTransform);
+
+        visibleMaterials.clear();
+        for (uint32_t index : visibleMeshes) {
+            visibleMaterials.push_back(meshes[index].material.get());
+        }
+        check.checkFrame(visibleMaterials, materialTable.enabled() ? MAX_MATERIAL_ARRAYS : 0, std::cerr);
+    }
+
+    check.printReport(std::cout);
+    return check.passed() ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    // Decides how bump maps are compressed and filtered, before any material loads or textures are transcoded
+    Material::ssBumpMaps = useSSBump;
+
+    // Headless texture decode benchmark: --bench-texture-decode [directory]
+    if (argc > 1 && std::string(argv[1]) == "--bench-texture-decode") {
+        std::string directory = argc > 2 ? argv[2] : FileSystemUtils::getAssetFilePath("textures");
+        runTextureDecodeBenchmark(findImageFiles(directory));
+        return 0;
+    }
+
+    // Offline texture transcode into the texture cache: --transcode-textures [directory] [format] [sampler type]
+    // The sampler type (diffuseTexture, bumpMap, lightmap0, ...) selects the mip filtering, as materials do
+    if (argc > 1 && std::string(argv[1]) == "--transcode-textures") {
+        std::string directory = argc > 2 ? argv[2] : FileSystemUtils::getAssetFilePath("textures");
+        std::string samplerType = argc > 4 ? argv[4] : "diffuseTexture";
+        runTextureTranscode(findImageFiles(directory), parseBlockFormat(argc > 3 ? argv[3] : "auto"), defaultMipOptions(samplerType, Material::ssBumpMaps));
+        return 0;
+    }
+
+    // Per-texture CPU mip generation timings: --bench-mips [directory]
+    if (argc > 1 && std::string(argv[1]) == "--bench-mips") {
+        std::string directory = argc > 2 ? argv[2] : FileSystemUtils::getAssetFilePath("textures");
+        runMipBenchmark(findImageFiles(directory));
+        return 0;
+    }
+
+    // Headless culling benchmark: --bench-culling [mesh count] [frame count]
+    if (argc > 1 && std::string(argv[1]) == "--bench-culling") {
+        runCullingBenchmark(argc > 2 ? std::stoul(argv[2]) : 100000, argc > 3 ? std::stoul(argv[3]) : 1000);
+        return 0;
+    }
+
+    // Texture residency decisions along a camera path over a synthetic level: --simulate-residency [texture count] [frame count] [budget MB]
+    if (argc > 1 && std::string(argv[1]) == "--simulate-residency") {
+        runResidencySimulation(argc > 2 ? std::stoul(argv[2]) : 2000, argc > 3 ? std::stoul(argv[3]) : 2000, argc > 4 ? std::stoul(argv[4]) : 64);
+        return 0;
+    }
+
+    // Headless import benchmark on a synthetic OBJ: --bench-import [triangle count]
+    if (argc > 1 && std::string(argv[1]) == "--bench-import") {
+        runImportBenchmark(argc > 2 ? std::stoul(argv[2]) : 4000000);
+        return 0;
+    }
+
+    // Per-mesh import stage scaling across thread counts: --bench-import-scaling [triangle count]
+    if (argc > 1 && std::string(argv[1]) == "--bench-import-scaling") {
+        runImportScalingBenchmark(argc > 2 ? std::stoul(argv[2]) : 2000000);
+        return 0;
+    }
+
+    // CPU-only vertex packing error report: --report-vertex-packing [model]
+    if (argc > 1 && std::string(argv[1]) == "--report-vertex-packing") {
+        reportVertexPacking(argc > 2 ? argv[2] : FileSystemUtils::getAssetFilePath("models/tutorial_map.fbx"), levelImportOptions);
+        return 0;
+    }
+
+    // Vertex pre-transform micro-benchmark: --bench-transform [vertex count]
+    if (argc > 1 && std::string(argv[1]) == "--bench-transform") {
+        runTransformBenchmark(argc > 2 ? std::stoul(argv[2]) : 1000000);
+        return 0;
+    }
+
+    // CPU lightmap bake into lightmap0..2 of every material: --bake-lightmaps [model] [resolution] [sky samples] [threads] [full|incremental]
+    if (argc > 1 && std::string(argv[1]) == "--bake-lightmaps") {
+        LightmapBakeOptions bakeOptions;
+        if (argc > 3) bakeOptions.resolution = std::stoi(argv[3]);
+        if (argc > 4) bakeOptions.skySamples = std::stoi(argv[4]);
+        if (argc > 5) bakeOptions.threads = std::stoul(argv[5]);
+        bool incremental = argc > 6 ? std::string(argv[6]) != "full" : true;
+        bool baked = bakeModelLightmaps(argc > 2 ? argv[2] : FileSystemUtils::getAssetFilePath("models/tutorial_map.fbx"), levelImportOptions,
+            bakeOptions, incremental);
+        return baked ? 0 : 1;
+    }
+
+    // Lightmap bake throughput across thread counts: --bench-lightmap-scaling [model] [resolution] [sky samples]
+    if (argc > 1 && std::string(argv[1]) == "--bench-lightmap-scaling") {
+        LightmapBakeOptions bakeOptions;
+        bakeOptions.resolution = argc > 3 ? std::stoi(argv[3]) : 128;
+        bakeOptions.skySamples = argc > 4 ? std::stoi(argv[4]) : 32;
+        runLightmapScalingBenchmark(argc > 2 ? argv[2] : FileSystemUtils::getAssetFilePath("models/tutorial_map.fbx"), levelImportOptions, bakeOptions);
+        return 0;
+    }
+
+    // Deterministic offscreen flythrough: --benchmark [frames] [report.json] [native|egl|osmesa] [camera path file]
+    bool benchmark = argc > 1 && std::string(argv[1]) == "--benchmark";
+    FlythroughOptions benchmarkOptions;
+    if (benchmark) {
+        if (argc > 2) benchmarkOptions.frames = std::stoul(argv[2]);
+        if (argc > 3) benchmarkOptions.reportPath = argv[3];
+        if (argc > 4) benchmarkOptions.context = argv[4];
+        if (argc > 5) benchmarkOptions.cameraPath = argv[5];
+    }
+
+    // Load phases and their times, for the benchmark report
+    std::vector<std::pair<std::string, double>> loadMs;
+    auto phaseStart = std::chrono::steady_clock::now();
+    auto endLoadPhase = [&loadMs, &phaseStart](const char* phase) {
+        loadMs.push_back({ phase, millisecondsSince(phaseStart) });
+        phaseStart = std::chrono::steady_clock::now();
+    };
+
+    // GPU-free check of the GL calls issued per frame: --check-submission [frames]
+    bool checkSubmission = argc > 1 && std::string(argv[1]) == "--check-submission";
+    size_t checkFrames = checkSubmission && argc > 2 ? std::stoul(argv[2]) : 200;
+
+    GLRecorder glRecorder;
+    GLFWwindow* window = nullptr;
+    if (checkSubmission) {
+        glRecorder.install();
+    }
+    else {
+        window = createWindow(benchmark, benchmarkOptions.context);
+        if (!window) {
+            return -1;
+        }
+    }
+
     // Define the viewport dimensions
     glViewport(0, 0, WIDTH, HEIGHT);
 
@@ -565,37 +1620,123 @@ int main() {
 
     glCullFace(GL_BACK); // Cull back faces (default)
 
+    // Per-frame camera data shared by all material shaders
+    frameConstants.create();
+    endLoadPhase("context");
+
+    if (useProgramBinaryCache && !checkSubmission) {
+        shaderProgramCache.enableBinaryCache(PROGRAM_BINARY_CACHE_DIR);
+    }
+
+    if (useMaterialTable) {
+        materialTable.setMode(MaterialTable::detectMode(allowBindlessTextures));
+        Material::tableMode = materialTable.mode();
+    }
+
     // Load the model
-    meshes = loadModel(FileSystemUtils::getAssetFilePath("models/tutorial_map.fbx"));
+    auto loadStart = std::chrono::steady_clock::now();
+    meshes = loadModel(FileSystemUtils::getAssetFilePath("models/tutorial_map.fbx"), levelImportOptions);
+    uploadLevelLightmapAtlas();
+    shaderProgramCache.printStats(std::cout);
+    std::cout << "Level load: " << meshes.size() << " meshes in " << millisecondsSince(loadStart) << " ms, peak RSS "
+        << getPeakResidentBytes() / (1024.0 * 1024.0) << " MB" << std::endl;
+    endLoadPhase("level");
+    textureLoader.finish();
+    endLoadPhase("textures");
+    staticBatch.upload();
+    endLoadPhase("staticBatch");
+    if (usePackedVertices) {
+        vertexPackingTotal.print(std::cout, "total");
+    }
+
+    // Needs the finished textures: handles and array copies are taken from them
+    if (materialTable.enabled()) {
+        std::vector<Material*> levelMaterials;
+        for (const auto& mesh : meshes) {
+            if (std::find(levelMaterials.begin(), levelMaterials.end(), mesh.material.get()) == levelMaterials.end()) {
+                levelMaterials.push_back(mesh.material.get());
+            }
+        }
+        materialTable.build(levelMaterials);
+        materialTable.printStats(std::cout);
+
+        if (useStaticBatching) {
+            std::vector<uint32_t> meshMaterials(meshes.size(), 0);
+            for (const auto& mesh : meshes) {
+                if (mesh.batchRange.meshIndex < meshMaterials.size()) {
+                    meshMaterials[mesh.batchRange.meshIndex] = static_cast<uint32_t>(mesh.material->tableIndex);
+                }
+            }
+            staticBatch.setMaterialIndices(meshMaterials);
+        }
+        endLoadPhase("materialTable");
+    }
+
+    // Only used when the level is not pre-transformed at load time
+    const glm::mat4 levelTransform = getLevelImportTransform();
+
+    // World-space bounds for culling
+    std::vector<AABB> meshBounds;
+    meshBounds.reserve(meshes.size());
+    for (auto& mesh : meshes) {
+        if (!mesh.worldSpace) {
+            mesh.bounds = transformBounds(mesh.bounds, levelTransform);
+        }
+        meshBounds.push_back(mesh.bounds);
+    }
+    levelBVH.build(meshBounds);
+    endLoadPhase("cullingBVH");
+
+    // Streaming uploads are not submission cost, and would make the check and the benchmark depend on decode timing
+    if (useTextureStreaming && !materialTable.enabled() && !checkSubmission && !benchmark) {
+        registerStreamedTextures(meshes);
+        endLoadPhase("textureStreaming");
+    }
+
+    if (checkSubmission) {
+        int result = runSubmissionCheck(glRecorder, checkFrames, levelTransform);
+        glRecorder.uninstall();
+        return result;
+    }
+
+    if (benchmark) {
+        int result = runFlythroughBenchmark(benchmarkOptions, levelTransform, loadMs);
+        glfwTerminate();
+        return result;
+    }
 
     // Render loop
+    previousTime = glfwGetTime();
     while (!glfwWindowShouldClose(window)) {
+        PROFILE_FRAME();
         float currentFrame = static_cast<float>(glfwGetTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        // Frame rate and average frame time over the last second, in the window title
+        frameCount++;
+        if (currentFrame - previousTime >= 1.0) {
+            double elapsed = currentFrame - previousTime;
+            std::string title = "OpenGL Directional LightMapping Example - " + std::to_string(static_cast<int>(frameCount / elapsed + 0.5)) +
+                " FPS, " + std::to_string(1000.0 * elapsed / frameCount).substr(0, 5) + " ms";
+            glfwSetWindowTitle(window, title.c_str());
+            previousTime = currentFrame;
+            frameCount = 0;
+        }
+
+        // Keep the previous frame's GL call counts for reporting and start counting this one
+        lastFrameGLStats = glCallStats;
+        lastFrameStateStats = glState.stats();
+        glCallStats = GLCallStats();
+        glState.beginFrame();
+
         processInput(window);
 
         // Input handling
         if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
             glfwSetWindowShouldClose(window, true);
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        glClearColor(0.3f, 0.3f, 0.4f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        float aspectRatio = static_cast<float>(WIDTH) / HEIGHT;
-
-        // Render all objects
-        for (const auto& mesh : meshes) {
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::scale(model, glm::vec3(0.01f));
-            model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-
-            // Draw the mesh with the model matrix and camera
-            mesh.Draw(camera, model, aspectRatio);
-        }
+        renderFrame(levelTransform);
 
         // Swap buffers and poll IO events
         glfwSwapBuffers(window);
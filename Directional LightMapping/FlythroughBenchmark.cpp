@@ -0,0 +1,220 @@
+#include "FlythroughBenchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+struct Distribution {
+    double mean = 0.0;
+    double min = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+Distribution summarize(std::vector<double> values) {
+    Distribution result;
+    if (values.empty()) {
+        return result;
+    }
+    std::sort(values.begin(), values.end());
+    auto percentile = [&values](double fraction) {
+        return values[static_cast<size_t>(fraction * (values.size() - 1) + 0.5)];
+    };
+    for (double value : values) {
+        result.mean += value;
+    }
+    result.mean /= values.size();
+    result.min = values.front();
+    result.p50 = percentile(0.50);
+    result.p90 = percentile(0.90);
+    result.p95 = percentile(0.95);
+    result.p99 = percentile(0.99);
+    result.max = values.back();
+    return result;
+}
+
+void writeDistribution(std::ostream& out, const Distribution& d) {
+    out << "{\"mean\": " << d.mean << ", \"min\": " << d.min << ", \"p50\": " << d.p50 << ", \"p90\": " << d.p90
+        << ", \"p95\": " << d.p95 << ", \"p99\": " << d.p99 << ", \"max\": " << d.max << "}";
+}
+
+void writeJsonString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+// Per-frame counters reported as mean and max
+struct Counter {
+    const char* name;
+    std::function<double(const BenchmarkFrame&)> read;
+};
+
+const std::vector<Counter>& counters() {
+    static const std::vector<Counter> list = {
+        { "drawCalls", [](const BenchmarkFrame& f) { return f.calls.drawCalls; } },
+        { "programBinds", [](const BenchmarkFrame& f) { return f.calls.programBinds; } },
+        { "textureBinds", [](const BenchmarkFrame& f) { return f.calls.textureBinds; } },
+        { "vertexArrayBinds", [](const BenchmarkFrame& f) { return f.calls.vertexArrayBinds; } },
+        { "renderStateChanges", [](const BenchmarkFrame& f) { return f.calls.renderStateChanges; } },
+        { "uniformUploads", [](const BenchmarkFrame& f) { return f.calls.uniformUploads; } },
+        { "uniformLookups", [](const BenchmarkFrame& f) { return f.calls.uniformLookups; } },
+        { "glCalls", [](const BenchmarkFrame& f) { return f.calls.total(); } },
+        { "programChanges", [](const BenchmarkFrame& f) { return f.state.program.issued; } },
+        { "programChangesSkipped", [](const BenchmarkFrame& f) { return f.state.program.redundant; } },
+        { "textureChanges", [](const BenchmarkFrame& f) { return f.state.texture.issued; } },
+        { "textureChangesSkipped", [](const BenchmarkFrame& f) { return f.state.texture.redundant; } },
+        { "blendChanges", [](const BenchmarkFrame& f) { return f.state.blend.issued; } },
+        { "blendChangesSkipped", [](const BenchmarkFrame& f) { return f.state.blend.redundant; } },
+        { "vertexArrayChanges", [](const BenchmarkFrame& f) { return f.state.vertexArray.issued; } },
+        { "vertexArrayChangesSkipped", [](const BenchmarkFrame& f) { return f.state.vertexArray.redundant; } },
+    };
+    return list;
+}
+
+std::vector<double> collect(const std::vector<BenchmarkFrame>& frames, const std::function<double(const BenchmarkFrame&)>& read) {
+    std::vector<double> values;
+    values.reserve(frames.size());
+    for (const auto& frame : frames) {
+        values.push_back(read(frame));
+    }
+    return values;
+}
+
+} // namespace
+
+bool CameraPath::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open camera path: " << path << std::endl;
+        return false;
+    }
+
+    points_.clear();
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        glm::vec3 point;
+        if (fields >> point.x >> point.y >> point.z) {
+            points_.push_back(point);
+        }
+    }
+    if (points_.size() < 2) {
+        std::cerr << "Camera path needs at least 2 points: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void CameraPath::generate(const AABB& bounds, int controlPoints) {
+    glm::vec3 center = bounds.center();
+    glm::vec3 extent = bounds.extent();
+    float height = bounds.min.y + 0.3f * (bounds.max.y - bounds.min.y);
+
+    points_.clear();
+    for (int i = 0; i < controlPoints; i++) {
+        float angle = glm::radians(360.0f * i / controlPoints);
+        float radius = i % 2 == 0 ? 0.6f : 0.3f;
+        points_.push_back(glm::vec3(center.x + std::cos(angle) * extent.x * radius, height, center.z + std::sin(angle) * extent.z * radius));
+    }
+}
+
+bool CameraPath::append(const std::string& path, const glm::vec3& position) {
+    std::ofstream file(path, std::ios::app);
+    if (!file) {
+        std::cerr << "Failed to write camera path: " << path << std::endl;
+        return false;
+    }
+    file << position.x << " " << position.y << " " << position.z << "\n";
+    return true;
+}
+
+CameraPose CameraPath::sample(float t) const {
+    CameraPose pose;
+    pose.position = samplePath(points_, t);
+
+    // Look a little ahead along the path
+    glm::vec3 direction = samplePath(points_, t + 0.25f / points_.size()) - pose.position;
+    float length = glm::length(direction);
+    direction = length > 1e-5f ? direction / length : glm::vec3(1.0f, 0.0f, 0.0f);
+    pose.yaw = glm::degrees(std::atan2(direction.z, direction.x));
+    pose.pitch = glm::degrees(std::asin(std::clamp(direction.y, -1.0f, 1.0f)));
+    return pose;
+}
+
+void BenchmarkReport::print(std::ostream& out) const {
+    Distribution frameTimes = summarize(collect(frames, [](const BenchmarkFrame& f) { return f.frameMs; }));
+    Distribution cpuTimes = summarize(collect(frames, [](const BenchmarkFrame& f) { return f.cpuMs; }));
+
+    out << "Flythrough benchmark: " << frames.size() << " frames at " << width << "x" << height << " on "
+        << renderer << " (" << context << " context" << (textureStreaming ? ", texture streaming on" : "") << ")" << std::endl;
+    out << "  frame ms: mean " << frameTimes.mean << ", p50 " << frameTimes.p50 << ", p95 " << frameTimes.p95
+        << ", p99 " << frameTimes.p99 << ", max " << frameTimes.max << std::endl;
+    out << "  CPU submission ms: mean " << cpuTimes.mean << ", p50 " << cpuTimes.p50 << ", p99 " << cpuTimes.p99 << std::endl;
+    for (const auto& counter : counters()) {
+        Distribution values = summarize(collect(frames, counter.read));
+        out << "  " << counter.name << " per frame: mean " << values.mean << ", max " << values.max << std::endl;
+    }
+    out << "  load:";
+    for (const auto& [phase, ms] : loadMs) {
+        out << " " << phase << " " << ms << " ms,";
+    }
+    out << " peak RSS " << peakResidentBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+}
+
+bool BenchmarkReport::writeJson(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Failed to write benchmark report: " << path << std::endl;
+        return false;
+    }
+
+    out << std::setprecision(6);
+    out << "{\n  \"context\": ";
+    writeJsonString(out, context);
+    out << ",\n  \"renderer\": ";
+    writeJsonString(out, renderer);
+    out << ",\n  \"version\": ";
+    writeJsonString(out, version);
+    out << ",\n  \"width\": " << width << ",\n  \"height\": " << height
+        << ",\n  \"frames\": " << frames.size() << ",\n  \"warmupFrames\": " << warmupFrames
+        << ",\n  \"textureStreaming\": " << (textureStreaming ? "true" : "false");
+
+    out << ",\n  \"frameMs\": ";
+    writeDistribution(out, summarize(collect(frames, [](const BenchmarkFrame& f) { return f.frameMs; })));
+    out << ",\n  \"cpuMs\": ";
+    writeDistribution(out, summarize(collect(frames, [](const BenchmarkFrame& f) { return f.cpuMs; })));
+
+    out << ",\n  \"perFrame\": {";
+    for (size_t i = 0; i < counters().size(); i++) {
+        Distribution values = summarize(collect(frames, counters()[i].read));
+        out << (i > 0 ? "," : "") << "\n    \"" << counters()[i].name << "\": {\"mean\": " << values.mean
+            << ", \"max\": " << values.max << "}";
+    }
+    out << "\n  }";
+
+    out << ",\n  \"loadMs\": {";
+    for (size_t i = 0; i < loadMs.size(); i++) {
+        out << (i > 0 ? ", " : "");
+        writeJsonString(out, loadMs[i].first);
+        out << ": " << loadMs[i].second;
+    }
+    out << "},\n  \"peakResidentMB\": " << peakResidentBytes / (1024.0 * 1024.0) << "\n}\n";
+
+    std::cout << "Wrote benchmark report to " << path << std::endl;
+    return true;
+}
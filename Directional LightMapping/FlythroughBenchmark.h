@@ -0,0 +1,74 @@
+#ifndef FLYTHROUGH_BENCHMARK_H
+#define FLYTHROUGH_BENCHMARK_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Culling.h"
+#include "GLStateTracker.h"
+#include "GLStats.h"
+
+// Position and orientation in Camera's convention: yaw and pitch in degrees, with
+// front = (cos(yaw) cos(pitch), sin(pitch), sin(yaw) cos(pitch))
+struct CameraPose {
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+};
+
+// Closed loop through control points, played back at a fixed rate so every run sees the same views
+class CameraPath {
+public:
+    // Text file with one "x y z" control point per line; '#' starts a comment
+    bool load(const std::string& path);
+    // Loop through the inside of the bounds, alternating between an outer and inner ring
+    void generate(const AABB& bounds, int controlPoints = 8);
+    // Appends a control point to a path file, for recording paths by flying them
+    static bool append(const std::string& path, const glm::vec3& position);
+
+    // Catmull-Rom position at t in [0, 1), looking along the direction of travel
+    CameraPose sample(float t) const;
+
+    size_t size() const { return points_.size(); }
+
+private:
+    std::vector<glm::vec3> points_;
+};
+
+struct BenchmarkFrame {
+    double frameMs; // Submission until the GPU finished
+    double cpuMs;   // Submission only
+    GLCallStats calls;
+    StateTrackerStats state;
+};
+
+// --benchmark [frames] [report.json] [native|egl|osmesa] [camera path file]
+struct FlythroughOptions {
+    size_t frames = 1000;
+    size_t warmupFrames = 30;       // Played at the start of the path and not measured
+    std::string reportPath = "benchmark.json";
+    std::string context = "native"; // GLFW context creation API; osmesa needs no display or GPU
+    std::string cameraPath;         // Empty for a loop generated from the level bounds
+};
+
+// Everything a flythrough run measured, as console text or JSON for comparing runs
+struct BenchmarkReport {
+    std::string context;
+    std::string renderer;
+    std::string version;
+    int width = 0;
+    int height = 0;
+    size_t warmupFrames = 0;
+    bool textureStreaming = false; // Streamed reloads land on frames that vary from run to run
+    std::vector<std::pair<std::string, double>> loadMs; // Load phases in order
+    std::vector<BenchmarkFrame> frames;
+    size_t peakResidentBytes = 0;
+
+    void print(std::ostream& out) const;
+    bool writeJson(const std::string& path) const;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#include "FrameConstants.h"
+#include "GLStats.h"
+
+void FrameConstants::create() {
+    glGenBuffers(1, &buffer_);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstantsData), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, buffer_);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void FrameConstants::update(const Camera& camera, float aspectRatio, bool visualizeNormals, bool visualizeShadowIntensity) {
+    data_.view = camera.getViewMatrix();
+    data_.projection = camera.getProjectionMatrix(aspectRatio);
+    data_.viewProj = data_.projection * data_.view;
+    data_.viewPos = glm::vec4(camera.getPosition(), 1.0f);
+    data_.flags[0] = visualizeNormals ? 1 : 0;
+    data_.flags[1] = visualizeShadowIntensity ? 1 : 0;
+    data_.flags[2] = 0;
+    data_.flags[3] = 0;
+    frameIndex_++;
+
+    if (buffer_ != 0) {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstantsData), &data_);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glCallStats.uniformUploads++;
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef FRAME_CONSTANTS_H
+#define FRAME_CONSTANTS_H
+
+#include "GLDispatch.h"
+#include <glm/glm.hpp>
+#include "Camera.h"
+
+// Uniform buffer binding point shared by every material shader
+const GLuint FRAME_CONSTANTS_BINDING = 0;
+
+// CPU mirror of the std140 block shaders declare as:
+//
+//   layout(std140, binding = 0) uniform FrameConstants {
+//       mat4 view;
+//       mat4 projection;
+//       mat4 viewProj;
+//       vec4 viewPos;
+//       ivec4 flags; // x = visualizeNormals, y = visualizeShadowIntensity
+//   };
+struct FrameConstantsData {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProj;
+    glm::vec4 viewPos;
+    int flags[4];
+};
+
+static_assert(sizeof(FrameConstantsData) == 224, "FrameConstantsData must match the std140 layout");
+
+// Camera and global visualization state, computed and uploaded once per frame
+class FrameConstants {
+public:
+    void create();
+    void update(const Camera& camera, float aspectRatio, bool visualizeNormals, bool visualizeShadowIntensity);
+
+    const FrameConstantsData& data() const { return data_; }
+
+    // Increases with every update; lets shaders without the block upload their loose uniforms once per frame
+    unsigned int frameIndex() const { return frameIndex_; }
+
+private:
+    GLuint buffer_ = 0;
+    FrameConstantsData data_ = {};
+    unsigned int frameIndex_ = 0;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#define GL_DISPATCH_IMPLEMENTATION
+#include "GLDispatch.h"
+
+void (GLAPIENTRY* glDispatchBindTexture)(GLenum, GLuint) = glBindTexture;
+void (GLAPIENTRY* glDispatchBlendFunc)(GLenum, GLenum) = glBlendFunc;
+void (GLAPIENTRY* glDispatchClear)(GLbitfield) = glClear;
+void (GLAPIENTRY* glDispatchClearColor)(GLfloat, GLfloat, GLfloat, GLfloat) = glClearColor;
+void (GLAPIENTRY* glDispatchCullFace)(GLenum) = glCullFace;
+void (GLAPIENTRY* glDispatchDisable)(GLenum) = glDisable;
+void (GLAPIENTRY* glDispatchDrawElements)(GLenum, GLsizei, GLenum, const void*) = glDrawElements;
+void (GLAPIENTRY* glDispatchEnable)(GLenum) = glEnable;
+void (GLAPIENTRY* glDispatchFinish)() = glFinish;
+void (GLAPIENTRY* glDispatchGenTextures)(GLsizei, GLuint*) = glGenTextures;
+GLenum (GLAPIENTRY* glDispatchGetError)() = glGetError;
+void (GLAPIENTRY* glDispatchGetIntegerv)(GLenum, GLint*) = glGetIntegerv;
+const GLubyte* (GLAPIENTRY* glDispatchGetString)(GLenum) = glGetString;
+void (GLAPIENTRY* glDispatchGetTexLevelParameteriv)(GLenum, GLint, GLenum, GLint*) = glGetTexLevelParameteriv;
+void (GLAPIENTRY* glDispatchGetTexParameteriv)(GLenum, GLenum, GLint*) = glGetTexParameteriv;
+void (GLAPIENTRY* glDispatchPixelStorei)(GLenum, GLint) = glPixelStorei;
+void (GLAPIENTRY* glDispatchTexImage2D)(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*) = glTexImage2D;
+void (GLAPIENTRY* glDispatchTexParameteri)(GLenum, GLenum, GLint) = glTexParameteri;
+void (GLAPIENTRY* glDispatchViewport)(GLint, GLint, GLsizei, GLsizei) = glViewport;
@@ -0,0 +1,55 @@
+#ifndef GL_DISPATCH_H
+#define GL_DISPATCH_H
+
+#include <GL/glew.h>
+
+// Include this instead of <GL/glew.h>. Every GL call of the renderer then goes through a function
+// pointer, so the driver can be swapped for a recording backend (see GLRecorder.h). GLEW already
+// loads GL 1.2+ and extension entry points into pointers; the GL 1.0/1.1 functions are exported by
+// the system GL library instead, so the ones the renderer uses get pointers here, initialized to
+// the library functions.
+extern void (GLAPIENTRY* glDispatchBindTexture)(GLenum target, GLuint texture);
+extern void (GLAPIENTRY* glDispatchBlendFunc)(GLenum sfactor, GLenum dfactor);
+extern void (GLAPIENTRY* glDispatchClear)(GLbitfield mask);
+extern void (GLAPIENTRY* glDispatchClearColor)(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+extern void (GLAPIENTRY* glDispatchCullFace)(GLenum mode);
+extern void (GLAPIENTRY* glDispatchDisable)(GLenum cap);
+extern void (GLAPIENTRY* glDispatchDrawElements)(GLenum mode, GLsizei count, GLenum type, const void* indices);
+extern void (GLAPIENTRY* glDispatchEnable)(GLenum cap);
+extern void (GLAPIENTRY* glDispatchFinish)();
+extern void (GLAPIENTRY* glDispatchGenTextures)(GLsizei n, GLuint* textures);
+extern GLenum (GLAPIENTRY* glDispatchGetError)();
+extern void (GLAPIENTRY* glDispatchGetIntegerv)(GLenum pname, GLint* data);
+extern const GLubyte* (GLAPIENTRY* glDispatchGetString)(GLenum name);
+extern void (GLAPIENTRY* glDispatchGetTexLevelParameteriv)(GLenum target, GLint level, GLenum pname, GLint* params);
+extern void (GLAPIENTRY* glDispatchGetTexParameteriv)(GLenum target, GLenum pname, GLint* params);
+extern void (GLAPIENTRY* glDispatchPixelStorei)(GLenum pname, GLint param);
+extern void (GLAPIENTRY* glDispatchTexImage2D)(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+    GLint border, GLenum format, GLenum type, const void* pixels);
+extern void (GLAPIENTRY* glDispatchTexParameteri)(GLenum target, GLenum pname, GLint param);
+extern void (GLAPIENTRY* glDispatchViewport)(GLint x, GLint y, GLsizei width, GLsizei height);
+
+// GLDispatch.cpp needs the library functions themselves
+#ifndef GL_DISPATCH_IMPLEMENTATION
+#define glBindTexture glDispatchBindTexture
+#define glBlendFunc glDispatchBlendFunc
+#define glClear glDispatchClear
+#define glClearColor glDispatchClearColor
+#define glCullFace glDispatchCullFace
+#define glDisable glDispatchDisable
+#define glDrawElements glDispatchDrawElements
+#define glEnable glDispatchEnable
+#define glFinish glDispatchFinish
+#define glGenTextures glDispatchGenTextures
+#define glGetError glDispatchGetError
+#define glGetIntegerv glDispatchGetIntegerv
+#define glGetString glDispatchGetString
+#define glGetTexLevelParameteriv glDispatchGetTexLevelParameteriv
+#define glGetTexParameteriv glDispatchGetTexParameteriv
+#define glPixelStorei glDispatchPixelStorei
+#define glTexImage2D glDispatchTexImage2D
+#define glTexParameteri glDispatchTexParameteri
+#define glViewport glDispatchViewport
+#endif
+
+#endif
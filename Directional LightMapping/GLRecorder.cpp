@@ -0,0 +1,1124 @@
+#include "GLRecorder.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <utility>
+
+struct GLRecorder::State {
+    struct Uniform {
+        std::string name;
+        GLenum type;
+        GLint size;       // Array length, 1 otherwise
+        GLint location;   // -1 for block members
+        GLint blockOffset; // -1 outside blocks
+    };
+    struct UniformBlock {
+        std::string name;
+        std::vector<GLint> members; // Indices into uniforms
+        GLint dataSize;
+    };
+    struct Program {
+        std::vector<GLuint> shaders;
+        std::vector<Uniform> uniforms;
+        std::vector<UniformBlock> blocks;
+    };
+    struct Level {
+        GLint width = 0;
+        GLint height = 0;
+        GLint internalFormat = 0;
+        GLint compressedSize = 0;
+    };
+    struct Texture {
+        std::map<GLint, Level> levels;
+        std::map<GLenum, GLint> parameters;
+    };
+
+    // Objects
+    GLuint nextName = 1;
+    std::map<GLuint, std::string> shaderSources;
+    std::map<GLuint, Program> programs;
+    std::map<GLuint, Texture> textures;
+    std::set<GLuint> buffers;
+    std::set<GLuint> vertexArrays;
+    std::set<GLuint> queries;
+    std::set<GLuint> framebuffers;
+    std::set<GLuint> renderbuffers;
+
+    // Bindings
+    GLuint program = 0;
+    GLuint activeUnit = 0;
+    std::map<std::pair<GLuint, GLenum>, GLuint> textureBindings;
+    GLuint vertexArray = 0;
+    std::map<GLenum, GLuint> bufferBindings;
+    std::set<GLenum> enabledCaps;
+    GLenum blendSource = GL_ONE;
+    GLenum blendDestination = GL_ZERO;
+    GLenum blendEquation = GL_FUNC_ADD;
+
+    // Bindings set so far this frame, to tell redundant ones from the first of the frame
+    bool programSetThisFrame = false;
+    bool vertexArraySetThisFrame = false;
+    std::set<std::pair<GLuint, GLenum>> texturesSetThisFrame;
+    std::set<GLenum> blendSetThisFrame; // GL_BLEND for enable/disable, GL_BLEND_SRC_RGB for the factors, GL_BLEND_EQUATION
+
+    // Counters
+    std::map<std::string, unsigned long long> counts;
+    unsigned long long total = 0;
+    unsigned long long draws = 0;
+    unsigned long long errors = 0;
+    GLRedundantBinds redundant;
+    bool logging = false;
+    std::vector<GLRecordedCall> log;
+
+    std::string vendor = "GLRecorder";
+    std::string renderer = "GL recorder (no GPU)";
+    std::string version = "4.6 GLRecorder";
+    std::string shadingLanguageVersion = "4.60";
+};
+
+namespace {
+
+GLRecorder::State* active = nullptr;
+
+template <typename T>
+void appendArgument(std::ostringstream& out, const T& value) {
+    out << value;
+}
+
+void appendArgument(std::ostringstream& out, GLboolean value) {
+    out << static_cast<int>(value);
+}
+
+void appendArguments(std::ostringstream&) {}
+
+template <typename T, typename... Rest>
+void appendArguments(std::ostringstream& out, const T& first, const Rest&... rest) {
+    appendArgument(out, first);
+    if (sizeof...(rest) > 0) {
+        out << ", ";
+    }
+    appendArguments(out, rest...);
+}
+
+template <typename... Args>
+void record(const char* name, const Args&... args) {
+    active->counts[name]++;
+    active->total++;
+    if (active->logging) {
+        std::ostringstream out;
+        appendArguments(out, args...);
+        active->log.push_back({ name, out.str() });
+    }
+}
+
+GLuint generateName() {
+    return active->nextName++;
+}
+
+void writeString(const std::string& text, GLsizei bufSize, GLsizei* length, GLchar* out) {
+    GLsizei copied = bufSize > 0 ? std::min(static_cast<GLsizei>(text.size()), bufSize - 1) : 0;
+    if (out && bufSize > 0) {
+        std::memcpy(out, text.data(), copied);
+        out[copied] = '\0';
+    }
+    if (length) {
+        *length = copied;
+    }
+}
+
+// GL type and std140 size and alignment of a GLSL type; type 0 for types the recorder does not know
+struct GlslType {
+    GLenum type;
+    GLint size;
+    GLint alignment;
+};
+
+GlslType glslType(const std::string& name) {
+    static const std::map<std::string, GlslType> types = {
+        { "float", { GL_FLOAT, 4, 4 } },
+        { "vec2", { GL_FLOAT_VEC2, 8, 8 } },
+        { "vec3", { GL_FLOAT_VEC3, 12, 16 } },
+        { "vec4", { GL_FLOAT_VEC4, 16, 16 } },
+        { "int", { GL_INT, 4, 4 } },
+        { "ivec2", { GL_INT_VEC2, 8, 8 } },
+        { "ivec3", { GL_INT_VEC3, 12, 16 } },
+        { "ivec4", { GL_INT_VEC4, 16, 16 } },
+        { "uint", { GL_UNSIGNED_INT, 4, 4 } },
+        { "uvec2", { GL_UNSIGNED_INT_VEC2, 8, 8 } },
+        { "uvec4", { GL_UNSIGNED_INT_VEC4, 16, 16 } },
+        { "bool", { GL_BOOL, 4, 4 } },
+        { "mat3", { GL_FLOAT_MAT3, 48, 16 } },
+        { "mat4", { GL_FLOAT_MAT4, 64, 16 } },
+        { "sampler2D", { GL_SAMPLER_2D, 4, 4 } },
+        { "sampler2DArray", { GL_SAMPLER_2D_ARRAY, 4, 4 } },
+        { "sampler2DShadow", { GL_SAMPLER_2D_SHADOW, 4, 4 } },
+        { "samplerCube", { GL_SAMPLER_CUBE, 4, 4 } },
+        { "sampler3D", { GL_SAMPLER_3D, 4, 4 } },
+    };
+    auto it = types.find(name);
+    if (it != types.end()) {
+        return it->second;
+    }
+    return { 0, 0, 0 };
+}
+
+std::string stripCommentsAndDirectives(const std::string& source) {
+    std::string withoutComments = std::regex_replace(source, std::regex(R"(/\*[\s\S]*?\*/|//[^\n]*)"), " ");
+    return std::regex_replace(withoutComments, std::regex(R"((^|\n)[ \t]*#[^\n]*)"), "\n");
+}
+
+// Collects the uniforms and uniform blocks of the program's shaders, locations in declaration order
+void linkUniforms(GLRecorder::State::Program& program) {
+    static const std::regex plainUniform(R"(\buniform\s+(\w+)\s+(\w+)\s*(?:\[\s*(\d+)\s*\])?\s*(?:=[^;]*)?;)");
+    static const std::regex uniformBlock(R"(\buniform\s+(\w+)\s*\{([^}]*)\}\s*(\w*)[^;]*;)");
+    static const std::regex blockMember(R"((\w+)\s+(\w+)\s*(?:\[\s*(\d+)\s*\])?\s*;)");
+
+    program.uniforms.clear();
+    program.blocks.clear();
+    auto known = [&program](const std::string& name) {
+        return std::any_of(program.uniforms.begin(), program.uniforms.end(), [&name](const auto& u) { return u.name == name; });
+    };
+
+    GLint nextLocation = 0;
+    for (GLuint shader : program.shaders) {
+        std::string source = stripCommentsAndDirectives(active->shaderSources[shader]);
+
+        for (std::sregex_iterator it(source.begin(), source.end(), plainUniform), end; it != end; ++it) {
+            GlslType type = glslType((*it)[1]);
+            std::string name = (*it)[2];
+            if (type.type == 0 || known(name)) {
+                continue;
+            }
+            GLint size = (*it)[3].matched ? std::stoi((*it)[3]) : 1;
+            program.uniforms.push_back({ name, type.type, size, nextLocation, -1 });
+            nextLocation += size;
+        }
+
+        for (std::sregex_iterator it(source.begin(), source.end(), uniformBlock), end; it != end; ++it) {
+            std::string blockName = (*it)[1];
+            if (std::any_of(program.blocks.begin(), program.blocks.end(), [&blockName](const auto& b) { return b.name == blockName; })) {
+                continue;
+            }
+            // Members of a block with an instance name are qualified with the block name
+            std::string prefix = (*it)[3].length() > 0 ? blockName + "." : "";
+
+            GLRecorder::State::UniformBlock block;
+            block.name = blockName;
+            GLint offset = 0;
+            std::string body = (*it)[2];
+            for (std::sregex_iterator member(body.begin(), body.end(), blockMember), memberEnd; member != memberEnd; ++member) {
+                GlslType type = glslType((*member)[1]);
+                if (type.type == 0) {
+                    continue;
+                }
+                GLint size = (*member)[3].matched ? std::stoi((*member)[3]) : 1;
+                // std140: array elements are padded to vec4
+                GLint alignment = size > 1 ? 16 : type.alignment;
+                GLint stride = size > 1 ? (type.size + 15) / 16 * 16 : type.size;
+                offset = (offset + alignment - 1) / alignment * alignment;
+                block.members.push_back(static_cast<GLint>(program.uniforms.size()));
+                program.uniforms.push_back({ prefix + std::string((*member)[2]), type.type, size, -1, offset });
+                offset += stride * size;
+            }
+            block.dataSize = (offset + 15) / 16 * 16;
+            program.blocks.push_back(block);
+        }
+    }
+}
+
+GLRecorder::State::Texture* boundTexture(GLenum target) {
+    if (target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z) {
+        target = GL_TEXTURE_CUBE_MAP;
+    }
+    auto binding = active->textureBindings.find({ active->activeUnit, target });
+    if (binding == active->textureBindings.end() || binding->second == 0) {
+        active->errors++;
+        return nullptr;
+    }
+    return &active->textures[binding->second];
+}
+
+GLRecorder::State::Program* findProgram(GLuint program) {
+    auto it = active->programs.find(program);
+    if (it == active->programs.end()) {
+        active->errors++;
+        return nullptr;
+    }
+    return &it->second;
+}
+
+void checkUniformTarget() {
+    if (active->program == 0) {
+        active->errors++;
+    }
+}
+
+void checkName(const std::set<GLuint>& names, GLuint name) {
+    if (name != 0 && names.count(name) == 0) {
+        active->errors++;
+    }
+}
+
+void generate(std::set<GLuint>& names, GLsizei n, GLuint* out) {
+    for (GLsizei i = 0; i < n; i++) {
+        out[i] = generateName();
+        names.insert(out[i]);
+    }
+}
+
+// Objects and state
+
+void GLAPIENTRY recordGenTextures(GLsizei n, GLuint* textures) {
+    record("glGenTextures", n);
+    for (GLsizei i = 0; i < n; i++) {
+        textures[i] = generateName();
+        active->textures[textures[i]];
+    }
+}
+
+void GLAPIENTRY recordGenBuffers(GLsizei n, GLuint* buffers) {
+    record("glGenBuffers", n);
+    generate(active->buffers, n, buffers);
+}
+
+void GLAPIENTRY recordGenVertexArrays(GLsizei n, GLuint* arrays) {
+    record("glGenVertexArrays", n);
+    generate(active->vertexArrays, n, arrays);
+}
+
+void GLAPIENTRY recordGenQueries(GLsizei n, GLuint* ids) {
+    record("glGenQueries", n);
+    generate(active->queries, n, ids);
+}
+
+void GLAPIENTRY recordGenFramebuffers(GLsizei n, GLuint* framebuffers) {
+    record("glGenFramebuffers", n);
+    generate(active->framebuffers, n, framebuffers);
+}
+
+void GLAPIENTRY recordGenRenderbuffers(GLsizei n, GLuint* renderbuffers) {
+    record("glGenRenderbuffers", n);
+    generate(active->renderbuffers, n, renderbuffers);
+}
+
+void GLAPIENTRY recordDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+    record("glDeleteFramebuffers", n);
+    for (GLsizei i = 0; i < n; i++) {
+        active->framebuffers.erase(framebuffers[i]);
+    }
+}
+
+void GLAPIENTRY recordDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers) {
+    record("glDeleteRenderbuffers", n);
+    for (GLsizei i = 0; i < n; i++) {
+        active->renderbuffers.erase(renderbuffers[i]);
+    }
+}
+
+void GLAPIENTRY recordUseProgram(GLuint program) {
+    record("glUseProgram", program);
+    if (program != 0 && active->programs.count(program) == 0) {
+        active->errors++;
+    }
+    if (active->programSetThisFrame && active->program == program) {
+        active->redundant.program++;
+    }
+    active->program = program;
+    active->programSetThisFrame = true;
+}
+
+void GLAPIENTRY recordActiveTexture(GLenum texture) {
+    record("glActiveTexture", texture);
+    active->activeUnit = texture - GL_TEXTURE0;
+}
+
+void GLAPIENTRY recordBindTexture(GLenum target, GLuint texture) {
+    record("glBindTexture", target, texture);
+    if (texture != 0 && active->textures.count(texture) == 0) {
+        active->errors++;
+    }
+    std::pair<GLuint, GLenum> slot(active->activeUnit, target);
+    if (active->texturesSetThisFrame.count(slot) && active->textureBindings[slot] == texture) {
+        active->redundant.texture++;
+    }
+    active->textureBindings[slot] = texture;
+    active->texturesSetThisFrame.insert(slot);
+}
+
+void GLAPIENTRY recordBindVertexArray(GLuint array) {
+    record("glBindVertexArray", array);
+    checkName(active->vertexArrays, array);
+    if (active->vertexArraySetThisFrame && active->vertexArray == array) {
+        active->redundant.vertexArray++;
+    }
+    active->vertexArray = array;
+    active->vertexArraySetThisFrame = true;
+}
+
+void GLAPIENTRY recordBindBuffer(GLenum target, GLuint buffer) {
+    record("glBindBuffer", target, buffer);
+    checkName(active->buffers, buffer);
+    active->bufferBindings[target] = buffer;
+}
+
+void GLAPIENTRY recordBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    record("glBindBufferBase", target, index, buffer);
+    checkName(active->buffers, buffer);
+    active->bufferBindings[target] = buffer;
+}
+
+void GLAPIENTRY recordBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    record("glBindBufferRange", target, index, buffer, offset, size);
+    checkName(active->buffers, buffer);
+    active->bufferBindings[target] = buffer;
+}
+
+void GLAPIENTRY recordBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+    record("glBufferData", target, size, data, usage);
+    if (active->bufferBindings[target] == 0) {
+        active->errors++;
+    }
+}
+
+void GLAPIENTRY recordBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+    record("glBufferSubData", target, offset, size, data);
+    if (active->bufferBindings[target] == 0) {
+        active->errors++;
+    }
+}
+
+void GLAPIENTRY recordBindFramebuffer(GLenum target, GLuint framebuffer) {
+    record("glBindFramebuffer", target, framebuffer);
+    checkName(active->framebuffers, framebuffer);
+}
+
+void GLAPIENTRY recordBindRenderbuffer(GLenum target, GLuint renderbuffer) {
+    record("glBindRenderbuffer", target, renderbuffer);
+    checkName(active->renderbuffers, renderbuffer);
+}
+
+void GLAPIENTRY recordRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+    record("glRenderbufferStorage", target, internalformat, width, height);
+}
+
+void GLAPIENTRY recordFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) {
+    record("glFramebufferRenderbuffer", target, attachment, renderbuffertarget, renderbuffer);
+    checkName(active->renderbuffers, renderbuffer);
+}
+
+GLenum GLAPIENTRY recordCheckFramebufferStatus(GLenum target) {
+    record("glCheckFramebufferStatus", target);
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+void GLAPIENTRY recordEnable(GLenum cap) {
+    record("glEnable", cap);
+    if (cap == GL_BLEND) {
+        if (active->blendSetThisFrame.count(GL_BLEND) && active->enabledCaps.count(GL_BLEND)) {
+            active->redundant.blend++;
+        }
+        active->blendSetThisFrame.insert(GL_BLEND);
+    }
+    active->enabledCaps.insert(cap);
+}
+
+void GLAPIENTRY recordDisable(GLenum cap) {
+    record("glDisable", cap);
+    if (cap == GL_BLEND) {
+        if (active->blendSetThisFrame.count(GL_BLEND) && !active->enabledCaps.count(GL_BLEND)) {
+            active->redundant.blend++;
+        }
+        active->blendSetThisFrame.insert(GL_BLEND);
+    }
+    active->enabledCaps.erase(cap);
+}
+
+void GLAPIENTRY recordBlendFunc(GLenum sfactor, GLenum dfactor) {
+    record("glBlendFunc", sfactor, dfactor);
+    if (active->blendSetThisFrame.count(GL_BLEND_SRC_RGB) && active->blendSource == sfactor && active->blendDestination == dfactor) {
+        active->redundant.blend++;
+    }
+    active->blendSource = sfactor;
+    active->blendDestination = dfactor;
+    active->blendSetThisFrame.insert(GL_BLEND_SRC_RGB);
+}
+
+void GLAPIENTRY recordBlendEquation(GLenum mode) {
+    record("glBlendEquation", mode);
+    if (active->blendSetThisFrame.count(GL_BLEND_EQUATION) && active->blendEquation == mode) {
+        active->redundant.blend++;
+    }
+    active->blendEquation = mode;
+    active->blendSetThisFrame.insert(GL_BLEND_EQUATION);
+}
+
+void GLAPIENTRY recordCullFace(GLenum mode) {
+    record("glCullFace", mode);
+}
+
+void GLAPIENTRY recordViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    record("glViewport", x, y, width, height);
+}
+
+void GLAPIENTRY recordClear(GLbitfield mask) {
+    record("glClear", mask);
+}
+
+void GLAPIENTRY recordClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+    record("glClearColor", red, green, blue, alpha);
+}
+
+void GLAPIENTRY recordFinish() {
+    record("glFinish");
+}
+
+GLenum GLAPIENTRY recordGetError() {
+    record("glGetError");
+    return GL_NO_ERROR;
+}
+
+void GLAPIENTRY recordGetIntegerv(GLenum pname, GLint* data) {
+    record("glGetIntegerv", pname);
+    switch (pname) {
+    case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT: *data = 256; break;
+    case GL_MAX_ARRAY_TEXTURE_LAYERS: *data = 2048; break;
+    case GL_MAX_TEXTURE_SIZE: *data = 16384; break;
+    case GL_MAX_TEXTURE_IMAGE_UNITS: *data = 32; break;
+    case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS: *data = 192; break;
+    case GL_CURRENT_PROGRAM: *data = static_cast<GLint>(active->program); break;
+    case GL_NUM_PROGRAM_BINARY_FORMATS: *data = 0; break;
+    default: *data = 0; break;
+    }
+}
+
+const GLubyte* GLAPIENTRY recordGetString(GLenum name) {
+    record("glGetString", name);
+    const std::string* value = nullptr;
+    switch (name) {
+    case GL_VENDOR: value = &active->vendor; break;
+    case GL_RENDERER: value = &active->renderer; break;
+    case GL_VERSION: value = &active->version; break;
+    case GL_SHADING_LANGUAGE_VERSION: value = &active->shadingLanguageVersion; break;
+    default: return nullptr;
+    }
+    return reinterpret_cast<const GLubyte*>(value->c_str());
+}
+
+void GLAPIENTRY recordDebugMessageCallback(GLDEBUGPROC callback, const void* userParam) {
+    record("glDebugMessageCallback", reinterpret_cast<const void*>(callback), userParam);
+}
+
+void GLAPIENTRY recordDebugMessageControl(GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint* ids, GLboolean enabled) {
+    record("glDebugMessageControl", source, type, severity, count, ids, enabled);
+}
+
+// Textures
+
+void GLAPIENTRY recordTexParameteri(GLenum target, GLenum pname, GLint param) {
+    record("glTexParameteri", target, pname, param);
+    if (auto* texture = boundTexture(target)) {
+        texture->parameters[pname] = param;
+    }
+}
+
+void GLAPIENTRY recordGetTexParameteriv(GLenum target, GLenum pname, GLint* params) {
+    record("glGetTexParameteriv", target, pname);
+    *params = pname == GL_TEXTURE_MAX_LEVEL ? 1000 : 0;
+    if (auto* texture = boundTexture(target)) {
+        auto it = texture->parameters.find(pname);
+        if (it != texture->parameters.end()) {
+            *params = it->second;
+        }
+    }
+}
+
+void GLAPIENTRY recordGetTexLevelParameteriv(GLenum target, GLint level, GLenum pname, GLint* params) {
+    record("glGetTexLevelParameteriv", target, level, pname);
+    *params = 0;
+    auto* texture = boundTexture(target);
+    if (!texture || texture->levels.count(level) == 0) {
+        return;
+    }
+    const auto& info = texture->levels[level];
+    switch (pname) {
+    case GL_TEXTURE_WIDTH: *params = info.width; break;
+    case GL_TEXTURE_HEIGHT: *params = info.height; break;
+    case GL_TEXTURE_INTERNAL_FORMAT: *params = info.internalFormat; break;
+    case GL_TEXTURE_COMPRESSED: *params = info.compressedSize > 0 ? GL_TRUE : GL_FALSE; break;
+    case GL_TEXTURE_COMPRESSED_IMAGE_SIZE: *params = info.compressedSize; break;
+    case GL_TEXTURE_RED_SIZE:
+    case GL_TEXTURE_GREEN_SIZE:
+    case GL_TEXTURE_BLUE_SIZE:
+    case GL_TEXTURE_ALPHA_SIZE: *params = info.compressedSize > 0 ? 0 : 8; break;
+    default: break;
+    }
+}
+
+void GLAPIENTRY recordPixelStorei(GLenum pname, GLint param) {
+    record("glPixelStorei", pname, param);
+}
+
+void GLAPIENTRY recordTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+    GLint border, GLenum format, GLenum type, const void* pixels) {
+    record("glTexImage2D", target, level, internalformat, width, height, border, format, type, pixels);
+    if (auto* texture = boundTexture(target)) {
+        texture->levels[level] = { width, height, internalformat, 0 };
+    }
+}
+
+void GLAPIENTRY recordCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height,
+    GLint border, GLsizei imageSize, const void* data) {
+    record("glCompressedTexImage2D", target, level, internalformat, width, height, border, imageSize, data);
+    if (auto* texture = boundTexture(target)) {
+        texture->levels[level] = { width, height, static_cast<GLint>(internalformat), imageSize };
+    }
+}
+
+void GLAPIENTRY recordTexStorage3D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth) {
+    record("glTexStorage3D", target, levels, internalformat, width, height, depth);
+    if (auto* texture = boundTexture(target)) {
+        for (GLint level = 0; level < levels; level++) {
+            texture->levels[level] = { std::max(width >> level, 1), std::max(height >> level, 1), static_cast<GLint>(internalformat), 0 };
+        }
+    }
+}
+
+void GLAPIENTRY recordTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
+    GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) {
+    record("glTexSubImage3D", target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+    boundTexture(target);
+}
+
+void GLAPIENTRY recordCompressedTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
+    GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize, const void* data) {
+    record("glCompressedTexSubImage3D", target, level, xoffset, yoffset, zoffset, width, height, depth, format, imageSize, data);
+    boundTexture(target);
+}
+
+void GLAPIENTRY recordCopyImageSubData(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ,
+    GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ,
+    GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth) {
+    record("glCopyImageSubData", srcName, srcTarget, srcLevel, srcX, srcY, srcZ, dstName, dstTarget, dstLevel, dstX, dstY, dstZ,
+        srcWidth, srcHeight, srcDepth);
+    if (active->textures.count(srcName) == 0 || active->textures.count(dstName) == 0) {
+        active->errors++;
+    }
+}
+
+GLuint64 GLAPIENTRY recordGetTextureHandleARB(GLuint texture) {
+    record("glGetTextureHandleARB", texture);
+    return (GLuint64(1) << 32) | texture;
+}
+
+void GLAPIENTRY recordMakeTextureHandleResidentARB(GLuint64 handle) {
+    record("glMakeTextureHandleResidentARB", handle);
+}
+
+// Shaders and programs
+
+GLuint GLAPIENTRY recordCreateShader(GLenum type) {
+    record("glCreateShader", type);
+    GLuint shader = generateName();
+    active->shaderSources[shader];
+    return shader;
+}
+
+void GLAPIENTRY recordShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) {
+    record("glShaderSource", shader, count);
+    std::string source;
+    for (GLsizei i = 0; i < count; i++) {
+        source += length && length[i] >= 0 ? std::string(string[i], length[i]) : std::string(string[i]);
+    }
+    active->shaderSources[shader] = source;
+}
+
+void GLAPIENTRY recordCompileShader(GLuint shader) {
+    record("glCompileShader", shader);
+}
+
+void GLAPIENTRY recordGetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+    record("glGetShaderiv", shader, pname);
+    *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+void GLAPIENTRY recordGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+    record("glGetShaderInfoLog", shader, bufSize);
+    writeString("", bufSize, length, infoLog);
+}
+
+void GLAPIENTRY recordDeleteShader(GLuint shader) {
+    record("glDeleteShader", shader);
+}
+
+GLuint GLAPIENTRY recordCreateProgram() {
+    record("glCreateProgram");
+    GLuint program = generateName();
+    active->programs[program];
+    return program;
+}
+
+void GLAPIENTRY recordAttachShader(GLuint program, GLuint shader) {
+    record("glAttachShader", program, shader);
+    if (auto* target = findProgram(program)) {
+        target->shaders.push_back(shader);
+    }
+}
+
+void GLAPIENTRY recordLinkProgram(GLuint program) {
+    record("glLinkProgram", program);
+    if (auto* target = findProgram(program)) {
+        linkUniforms(*target);
+    }
+}
+
+void GLAPIENTRY recordDeleteProgram(GLuint program) {
+    record("glDeleteProgram", program);
+    active->programs.erase(program);
+}
+
+void GLAPIENTRY recordGetProgramiv(GLuint program, GLenum pname, GLint* params) {
+    record("glGetProgramiv", program, pname);
+    *params = 0;
+    auto* target = findProgram(program);
+    if (pname == GL_LINK_STATUS) {
+        *params = target ? GL_TRUE : GL_FALSE;
+    }
+    else if (pname == GL_ACTIVE_UNIFORMS && target) {
+        *params = static_cast<GLint>(target->uniforms.size());
+    }
+    else if (pname == GL_ACTIVE_UNIFORM_BLOCKS && target) {
+        *params = static_cast<GLint>(target->blocks.size());
+    }
+}
+
+void GLAPIENTRY recordGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+    record("glGetProgramInfoLog", program, bufSize);
+    writeString("", bufSize, length, infoLog);
+}
+
+void GLAPIENTRY recordProgramParameteri(GLuint program, GLenum pname, GLint value) {
+    record("glProgramParameteri", program, pname, value);
+}
+
+// No binary formats are reported, so binaries never load
+void GLAPIENTRY recordProgramBinary(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length) {
+    record("glProgramBinary", program, binaryFormat, binary, length);
+    active->errors++;
+}
+
+void GLAPIENTRY recordGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary) {
+    record("glGetProgramBinary", program, bufSize, length, binaryFormat, binary);
+    if (length) {
+        *length = 0;
+    }
+}
+
+void GLAPIENTRY recordGetActiveUniform(GLuint program, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name) {
+    record("glGetActiveUniform", program, index);
+    auto* target = findProgram(program);
+    if (!target || index >= target->uniforms.size()) {
+        active->errors++;
+        writeString("", bufSize, length, name);
+        return;
+    }
+    const auto& uniform = target->uniforms[index];
+    *size = uniform.size;
+    *type = uniform.type;
+    writeString(uniform.size > 1 ? uniform.name + "[0]" : uniform.name, bufSize, length, name);
+}
+
+void GLAPIENTRY recordGetActiveUniformName(GLuint program, GLuint uniformIndex, GLsizei bufSize, GLsizei* length, GLchar* uniformName) {
+    record("glGetActiveUniformName", program, uniformIndex);
+    auto* target = findProgram(program);
+    if (!target || uniformIndex >= target->uniforms.size()) {
+        active->errors++;
+        writeString("", bufSize, length, uniformName);
+        return;
+    }
+    const auto& uniform = target->uniforms[uniformIndex];
+    writeString(uniform.size > 1 ? uniform.name + "[0]" : uniform.name, bufSize, length, uniformName);
+}
+
+void GLAPIENTRY recordGetActiveUniformsiv(GLuint program, GLsizei uniformCount, const GLuint* uniformIndices, GLenum pname, GLint* params) {
+    record("glGetActiveUniformsiv", program, uniformCount, pname);
+    auto* target = findProgram(program);
+    for (GLsizei i = 0; i < uniformCount; i++) {
+        params[i] = 0;
+        if (!target || uniformIndices[i] >= target->uniforms.size()) {
+            active->errors++;
+            continue;
+        }
+        const auto& uniform = target->uniforms[uniformIndices[i]];
+        switch (pname) {
+        case GL_UNIFORM_OFFSET: params[i] = uniform.blockOffset; break;
+        case GL_UNIFORM_TYPE: params[i] = static_cast<GLint>(uniform.type); break;
+        case GL_UNIFORM_SIZE: params[i] = uniform.size; break;
+        default: break;
+        }
+    }
+}
+
+GLint GLAPIENTRY recordGetUniformLocation(GLuint program, const GLchar* name) {
+    record("glGetUniformLocation", program, name);
+    auto* target = findProgram(program);
+    if (!target) {
+        return -1;
+    }
+
+    // "name", "name[0]" and "name[i]" of arrays
+    std::string base = name;
+    GLint element = 0;
+    size_t bracket = base.find('[');
+    if (bracket != std::string::npos) {
+        element = std::atoi(base.c_str() + bracket + 1);
+        base = base.substr(0, bracket);
+    }
+    for (const auto& uniform : target->uniforms) {
+        if (uniform.name == base && uniform.location >= 0 && element < uniform.size) {
+            return uniform.location + element;
+        }
+    }
+    return -1;
+}
+
+void GLAPIENTRY recordGetUniformiv(GLuint program, GLint location, GLint* params) {
+    record("glGetUniformiv", program, location);
+    *params = 0;
+}
+
+void GLAPIENTRY recordGetUniformfv(GLuint program, GLint location, GLfloat* params) {
+    record("glGetUniformfv", program, location);
+    std::fill(params, params + 4, 0.0f);
+}
+
+GLuint GLAPIENTRY recordGetUniformBlockIndex(GLuint program, const GLchar* uniformBlockName) {
+    record("glGetUniformBlockIndex", program, uniformBlockName);
+    if (auto* target = findProgram(program)) {
+        for (size_t i = 0; i < target->blocks.size(); i++) {
+            if (target->blocks[i].name == uniformBlockName) {
+                return static_cast<GLuint>(i);
+            }
+        }
+    }
+    return GL_INVALID_INDEX;
+}
+
+void GLAPIENTRY recordGetActiveUniformBlockiv(GLuint program, GLuint uniformBlockIndex, GLenum pname, GLint* params) {
+    record("glGetActiveUniformBlockiv", program, uniformBlockIndex, pname);
+    auto* target = findProgram(program);
+    if (!target || uniformBlockIndex >= target->blocks.size()) {
+        active->errors++;
+        *params = 0;
+        return;
+    }
+    const auto& block = target->blocks[uniformBlockIndex];
+    switch (pname) {
+    case GL_UNIFORM_BLOCK_DATA_SIZE: *params = block.dataSize; break;
+    case GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS: *params = static_cast<GLint>(block.members.size()); break;
+    case GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES: std::copy(block.members.begin(), block.members.end(), params); break;
+    default: *params = 0; break;
+    }
+}
+
+void GLAPIENTRY recordUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {
+    record("glUniformBlockBinding", program, uniformBlockIndex, uniformBlockBinding);
+}
+
+// Uniforms
+
+void GLAPIENTRY recordUniform1i(GLint location, GLint v0) {
+    record("glUniform1i", location, v0);
+    checkUniformTarget();
+}
+
+void GLAPIENTRY recordUniform1f(GLint location, GLfloat v0) {
+    record("glUniform1f", location, v0);
+    checkUniformTarget();
+}
+
+void GLAPIENTRY recordUniform1iv(GLint location, GLsizei count, const GLint* value) {
+    record("glUniform1iv", location, count, value);
+    checkUniformTarget();
+}
+
+void GLAPIENTRY recordUniform1fv(GLint location, GLsizei count, const GLfloat* value) {
+    record("glUniform1fv", location, count, value);
+    checkUniformTarget();
+}
+
+void GLAPIENTRY recordUniform2fv(GLint location, GLsizei count, const GLfloat* value) {
+    record("glUniform2fv", location, count, value);
+    checkUniformTarget();
+}
+
+void GLAPIENTRY recordUniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+    record("glUniform3fv", location, count, value);
+    checkUniformTarget();
+}
+
+void GLAPIENTRY recordUniform4fv(GLint location, GLsizei count, const GLfloat* value) {
+    record("glUniform4fv", location, count, value);
+    checkUniformTarget();
+}
+
+void GLAPIENTRY recordUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+    record("glUniformMatrix4fv", location, count, transpose, value);
+    checkUniformTarget();
+}
+
+// Vertex input and draws
+
+void GLAPIENTRY recordVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) {
+    record("glVertexAttribPointer", index, size, type, normalized, stride, pointer);
+}
+
+void GLAPIENTRY recordVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer) {
+    record("glVertexAttribIPointer", index, size, type, stride, pointer);
+}
+
+void GLAPIENTRY recordEnableVertexAttribArray(GLuint index) {
+    record("glEnableVertexAttribArray", index);
+}
+
+void GLAPIENTRY recordDisableVertexAttribArray(GLuint index) {
+    record("glDisableVertexAttribArray", index);
+}
+
+void GLAPIENTRY recordVertexAttribDivisor(GLuint index, GLuint divisor) {
+    record("glVertexAttribDivisor", index, divisor);
+}
+
+void GLAPIENTRY recordVertexAttribI1ui(GLuint index, GLuint x) {
+    record("glVertexAttribI1ui", index, x);
+}
+
+void checkDrawState() {
+    if (active->program == 0 || active->vertexArray == 0) {
+        active->errors++;
+    }
+}
+
+void GLAPIENTRY recordDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+    record("glDrawElements", mode, count, type, indices);
+    checkDrawState();
+    active->draws++;
+}
+
+void GLAPIENTRY recordMultiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride) {
+    record("glMultiDrawElementsIndirect", mode, type, indirect, drawcount, stride);
+    checkDrawState();
+    active->draws += drawcount;
+}
+
+// Timer queries complete immediately with zero time
+
+void GLAPIENTRY recordBeginQuery(GLenum target, GLuint id) {
+    record("glBeginQuery", target, id);
+    checkName(active->queries, id);
+}
+
+void GLAPIENTRY recordEndQuery(GLenum target) {
+    record("glEndQuery", target);
+}
+
+void GLAPIENTRY recordGetQueryObjectiv(GLuint id, GLenum pname, GLint* params) {
+    record("glGetQueryObjectiv", id, pname);
+    *params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+void GLAPIENTRY recordGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params) {
+    record("glGetQueryObjectui64v", id, pname);
+    *params = 0;
+}
+
+template <typename T>
+void hook(std::vector<std::function<void()>>& restores, T& pointer, T replacement) {
+    T original = pointer;
+    restores.push_back([&pointer, original] { pointer = original; });
+    pointer = replacement;
+}
+
+} // namespace
+
+GLRecorder::GLRecorder() : state_(new State()) {}
+
+GLRecorder::~GLRecorder() {
+    uninstall();
+}
+
+void GLRecorder::install() {
+    if (installed() || active) {
+        return;
+    }
+    active = state_.get();
+
+    // GL 1.0/1.1 through GLDispatch.h
+    hook(restores_, glDispatchBindTexture, &recordBindTexture);
+    hook(restores_, glDispatchBlendFunc, &recordBlendFunc);
+    hook(restores_, glDispatchClear, &recordClear);
+    hook(restores_, glDispatchClearColor, &recordClearColor);
+    hook(restores_, glDispatchCullFace, &recordCullFace);
+    hook(restores_, glDispatchDisable, &recordDisable);
+    hook(restores_, glDispatchDrawElements, &recordDrawElements);
+    hook(restores_, glDispatchEnable, &recordEnable);
+    hook(restores_, glDispatchFinish, &recordFinish);
+    hook(restores_, glDispatchGenTextures, &recordGenTextures);
+    hook(restores_, glDispatchGetError, &recordGetError);
+    hook(restores_, glDispatchGetIntegerv, &recordGetIntegerv);
+    hook(restores_, glDispatchGetString, &recordGetString);
+    hook(restores_, glDispatchGetTexLevelParameteriv, &recordGetTexLevelParameteriv);
+    hook(restores_, glDispatchGetTexParameteriv, &recordGetTexParameteriv);
+    hook(restores_, glDispatchPixelStorei, &recordPixelStorei);
+    hook(restores_, glDispatchTexImage2D, &recordTexImage2D);
+    hook(restores_, glDispatchTexParameteri, &recordTexParameteri);
+    hook(restores_, glDispatchViewport, &recordViewport);
+
+    // Everything newer through GLEW's function pointers
+    hook(restores_, __glewActiveTexture, &recordActiveTexture);
+    hook(restores_, __glewAttachShader, &recordAttachShader);
+    hook(restores_, __glewBeginQuery, &recordBeginQuery);
+    hook(restores_, __glewBindBuffer, &recordBindBuffer);
+    hook(restores_, __glewBindBufferBase, &recordBindBufferBase);
+    hook(restores_, __glewBindBufferRange, &recordBindBufferRange);
+    hook(restores_, __glewBindFramebuffer, &recordBindFramebuffer);
+    hook(restores_, __glewBindRenderbuffer, &recordBindRenderbuffer);
+    hook(restores_, __glewBindVertexArray, &recordBindVertexArray);
+    hook(restores_, __glewBlendEquation, &recordBlendEquation);
+    hook(restores_, __glewBufferData, &recordBufferData);
+    hook(restores_, __glewBufferSubData, &recordBufferSubData);
+    hook(restores_, __glewCheckFramebufferStatus, &recordCheckFramebufferStatus);
+    hook(restores_, __glewCompileShader, &recordCompileShader);
+    hook(restores_, __glewCompressedTexImage2D, &recordCompressedTexImage2D);
+    hook(restores_, __glewCompressedTexSubImage3D, &recordCompressedTexSubImage3D);
+    hook(restores_, __glewCopyImageSubData, &recordCopyImageSubData);
+    hook(restores_, __glewCreateProgram, &recordCreateProgram);
+    hook(restores_, __glewCreateShader, &recordCreateShader);
+    hook(restores_, __glewDebugMessageCallback, &recordDebugMessageCallback);
+    hook(restores_, __glewDebugMessageControl, &recordDebugMessageControl);
+    hook(restores_, __glewDeleteFramebuffers, &recordDeleteFramebuffers);
+    hook(restores_, __glewDeleteProgram, &recordDeleteProgram);
+    hook(restores_, __glewDeleteRenderbuffers, &recordDeleteRenderbuffers);
+    hook(restores_, __glewDeleteShader, &recordDeleteShader);
+    hook(restores_, __glewDisableVertexAttribArray, &recordDisableVertexAttribArray);
+    hook(restores_, __glewEnableVertexAttribArray, &recordEnableVertexAttribArray);
+    hook(restores_, __glewEndQuery, &recordEndQuery);
+    hook(restores_, __glewFramebufferRenderbuffer, &recordFramebufferRenderbuffer);
+    hook(restores_, __glewGenBuffers, &recordGenBuffers);
+    hook(restores_, __glewGenFramebuffers, &recordGenFramebuffers);
+    hook(restores_, __glewGenQueries, &recordGenQueries);
+    hook(restores_, __glewGenRenderbuffers, &recordGenRenderbuffers);
+    hook(restores_, __glewGenVertexArrays, &recordGenVertexArrays);
+    hook(restores_, __glewGetActiveUniform, &recordGetActiveUniform);
+    hook(restores_, __glewGetActiveUniformBlockiv, &recordGetActiveUniformBlockiv);
+    hook(restores_, __glewGetActiveUniformName, &recordGetActiveUniformName);
+    hook(restores_, __glewGetActiveUniformsiv, &recordGetActiveUniformsiv);
+    hook(restores_, __glewGetProgramBinary, &recordGetProgramBinary);
+    hook(restores_, __glewGetProgramInfoLog, &recordGetProgramInfoLog);
+    hook(restores_, __glewGetProgramiv, &recordGetProgramiv);
+    hook(restores_, __glewGetQueryObjectiv, &recordGetQueryObjectiv);
+    hook(restores_, __glewGetQueryObjectui64v, &recordGetQueryObjectui64v);
+    hook(restores_, __glewGetShaderInfoLog, &recordGetShaderInfoLog);
+    hook(restores_, __glewGetShaderiv, &recordGetShaderiv);
+    hook(restores_, __glewGetTextureHandleARB, &recordGetTextureHandleARB);
+    hook(restores_, __glewGetUniformBlockIndex, &recordGetUniformBlockIndex);
+    hook(restores_, __glewGetUniformLocation, &recordGetUniformLocation);
+    hook(restores_, __glewGetUniformfv, &recordGetUniformfv);
+    hook(restores_, __glewGetUniformiv, &recordGetUniformiv);
+    hook(restores_, __glewLinkProgram, &recordLinkProgram);
+    hook(restores_, __glewMakeTextureHandleResidentARB, &recordMakeTextureHandleResidentARB);
+    hook(restores_, __glewMultiDrawElementsIndirect, &recordMultiDrawElementsIndirect);
+    hook(restores_, __glewProgramBinary, &recordProgramBinary);
+    hook(restores_, __glewProgramParameteri, &recordProgramParameteri);
+    hook(restores_, __glewRenderbufferStorage, &recordRenderbufferStorage);
+    hook(restores_, __glewShaderSource, &recordShaderSource);
+    hook(restores_, __glewTexStorage3D, &recordTexStorage3D);
+    hook(restores_, __glewTexSubImage3D, &recordTexSubImage3D);
+    hook(restores_, __glewUniform1f, &recordUniform1f);
+    hook(restores_, __glewUniform1fv, &recordUniform1fv);
+    hook(restores_, __glewUniform1i, &recordUniform1i);
+    hook(restores_, __glewUniform1iv, &recordUniform1iv);
+    hook(restores_, __glewUniform2fv, &recordUniform2fv);
+    hook(restores_, __glewUniform3fv, &recordUniform3fv);
+    hook(restores_, __glewUniform4fv, &recordUniform4fv);
+    hook(restores_, __glewUniformBlockBinding, &recordUniformBlockBinding);
+    hook(restores_, __glewUniformMatrix4fv, &recordUniformMatrix4fv);
+    hook(restores_, __glewUseProgram, &recordUseProgram);
+    hook(restores_, __glewVertexAttribDivisor, &recordVertexAttribDivisor);
+    hook(restores_, __glewVertexAttribI1ui, &recordVertexAttribI1ui);
+    hook(restores_, __glewVertexAttribIPointer, &recordVertexAttribIPointer);
+    hook(restores_, __glewVertexAttribPointer, &recordVertexAttribPointer);
+}
+
+void GLRecorder::uninstall() {
+    if (!installed()) {
+        return;
+    }
+    for (auto& restore : restores_) {
+        restore();
+    }
+    restores_.clear();
+    active = nullptr;
+}
+
+void GLRecorder::setLogging(bool enabled) {
+    state_->logging = enabled;
+}
+
+const std::vector<GLRecordedCall>& GLRecorder::log() const {
+    return state_->log;
+}
+
+void GLRecorder::resetCounters() {
+    state_->counts.clear();
+    state_->total = 0;
+    state_->draws = 0;
+    state_->errors = 0;
+    state_->redundant = GLRedundantBinds();
+    state_->log.clear();
+    state_->programSetThisFrame = false;
+    state_->vertexArraySetThisFrame = false;
+    state_->texturesSetThisFrame.clear();
+    state_->blendSetThisFrame.clear();
+}
+
+unsigned long long GLRecorder::count(const std::string& function) const {
+    auto it = state_->counts.find(function);
+    return it != state_->counts.end() ? it->second : 0;
+}
+
+unsigned long long GLRecorder::totalCalls() const {
+    return state_->total;
+}
+
+const std::map<std::string, unsigned long long>& GLRecorder::counts() const {
+    return state_->counts;
+}
+
+unsigned long long GLRecorder::draws() const {
+    return state_->draws;
+}
+
+const GLRedundantBinds& GLRecorder::redundantBinds() const {
+    return state_->redundant;
+}
+
+unsigned long long GLRecorder::errors() const {
+    return state_->errors;
+}
+
+void GLRecorder::printCounts(std::ostream& out) const {
+    std::vector<std::pair<unsigned long long, std::string>> sorted;
+    for (const auto& [name, count] : state_->counts) {
+        sorted.push_back({ count, name });
+    }
+    std::sort(sorted.rbegin(), sorted.rend());
+
+    out << "Recorded GL calls: " << state_->total << " (" << state_->draws << " draws, " << state_->errors << " errors, "
+        << state_->redundant.total() << " redundant binds)" << std::endl;
+    for (const auto& [count, name] : sorted) {
+        out << "  " << std::left << std::setw(32) << name << std::right << count << std::endl;
+    }
+}
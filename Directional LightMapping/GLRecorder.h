@@ -0,0 +1,73 @@
+#ifndef GL_RECORDER_H
+#define GL_RECORDER_H
+
+#include "GLDispatch.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct GLRecordedCall {
+    const char* name;
+    std::string arguments;
+};
+
+// Bindings of the value that was already bound earlier in the same frame. The state tracker
+// exists to keep these at zero.
+struct GLRedundantBinds {
+    unsigned int program = 0;
+    unsigned int texture = 0;
+    unsigned int vertexArray = 0;
+    unsigned int blend = 0;
+
+    unsigned int total() const { return program + texture + vertexArray + blend; }
+};
+
+// GPU-free GL backend. install() points every entry point the renderer uses at functions that
+// count and optionally log the call, and simulate enough of GL to keep the renderer running:
+// object names, the program, texture, VAO, buffer and blend bindings, texture level sizes, and
+// the uniforms and uniform blocks declared in the shader sources. Every declaration counts as
+// active, whichever #ifdef branch it is in. Queries return the values of a generic GL 4.6 driver,
+// draws draw nothing. Needs no context; do not install it over a live one.
+class GLRecorder {
+public:
+    GLRecorder();
+    ~GLRecorder();
+
+    GLRecorder(const GLRecorder&) = delete;
+    GLRecorder& operator=(const GLRecorder&) = delete;
+
+    // Only one recorder can be installed at a time
+    void install();
+    void uninstall();
+    bool installed() const { return !restores_.empty(); }
+
+    // Keeps every call with its arguments, not just the counts
+    void setLogging(bool enabled);
+    const std::vector<GLRecordedCall>& log() const;
+
+    // Starts a new frame of counters; the simulated GL objects and bindings are kept
+    void resetCounters();
+
+    unsigned long long count(const std::string& function) const;
+    unsigned long long totalCalls() const;
+    const std::map<std::string, unsigned long long>& counts() const;
+    // Individual draws, counting every command of a multi-draw
+    unsigned long long draws() const;
+    const GLRedundantBinds& redundantBinds() const;
+    // Calls a driver would reject: uniforms without a program, draws without a program or vertex
+    // array, bindings of names that were never generated
+    unsigned long long errors() const;
+
+    void printCounts(std::ostream& out) const;
+
+    struct State;
+
+private:
+    std::unique_ptr<State> state_;
+    std::vector<std::function<void()>> restores_;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "GLStateTracker.h"
+#include "GLStats.h"
+
+void StateTrackerStats::print(std::ostream& out) const {
+    unsigned int issued = program.issued + texture.issued + blend.issued + vertexArray.issued;
+    unsigned int redundant = program.redundant + texture.redundant + blend.redundant + vertexArray.redundant;
+    out << "State changes: " << issued << " issued, " << redundant << " redundant skipped"
+        << " (program " << program.issued << "/" << program.redundant
+        << ", texture " << texture.issued << "/" << texture.redundant
+        << ", blend " << blend.issued << "/" << blend.redundant
+        << ", VAO " << vertexArray.issued << "/" << vertexArray.redundant << ")" << std::endl;
+}
+
+void GLStateTracker::beginFrame() {
+    programKnown_ = false;
+    activeUnitKnown_ = false;
+    for (auto& binding : textures_) {
+        binding.known = false;
+    }
+    blendKnown_ = false;
+    vertexArrayKnown_ = false;
+    lastMaterial_ = nullptr;
+    stats_ = StateTrackerStats();
+}
+
+void GLStateTracker::useProgram(GLuint program) {
+    if (programKnown_ && program_ == program) {
+        stats_.program.redundant++;
+        return;
+    }
+
+    glUseProgram(program);
+    programKnown_ = true;
+    program_ = program;
+    stats_.program.issued++;
+    glCallStats.programBinds++;
+}
+
+void GLStateTracker::bindTexture(GLint unit, GLenum target, GLuint texture) {
+    TextureBinding* binding = (unit >= 0 && unit < MAX_TEXTURE_UNITS) ? &textures_[unit] : nullptr;
+    if (binding && binding->known && binding->target == target && binding->texture == texture) {
+        stats_.texture.redundant++;
+        return;
+    }
+
+    if (!activeUnitKnown_ || activeUnit_ != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnitKnown_ = true;
+        activeUnit_ = unit;
+        glCallStats.textureBinds++;
+    }
+    glBindTexture(target, texture);
+    stats_.texture.issued++;
+    glCallStats.textureBinds++;
+
+    if (binding) {
+        binding->target = target;
+        binding->texture = texture;
+        binding->known = true;
+    }
+}
+
+void GLStateTracker::setBlend(bool enabled, GLenum srcFactor, GLenum dstFactor, GLenum equation) {
+    if (blendKnown_ && blendEnabled_ == enabled &&
+        (!enabled || (srcFactor_ == srcFactor && dstFactor_ == dstFactor && equation_ == equation))) {
+        stats_.blend.redundant++;
+        return;
+    }
+
+    if (enabled) {
+        if (!blendKnown_ || !blendEnabled_) {
+            glEnable(GL_BLEND);
+            glCallStats.renderStateChanges++;
+        }
+        glBlendFunc(srcFactor, dstFactor);
+        glBlendEquation(equation);
+        glCallStats.renderStateChanges += 2;
+        srcFactor_ = srcFactor;
+        dstFactor_ = dstFactor;
+        equation_ = equation;
+    }
+    else {
+        glDisable(GL_BLEND);
+        glCallStats.renderStateChanges++;
+    }
+
+    blendKnown_ = true;
+    blendEnabled_ = enabled;
+    stats_.blend.issued++;
+}
+
+void GLStateTracker::bindVertexArray(GLuint vao) {
+    if (vertexArrayKnown_ && vertexArray_ == vao) {
+        stats_.vertexArray.redundant++;
+        return;
+    }
+
+    glBindVertexArray(vao);
+    vertexArrayKnown_ = true;
+    vertexArray_ = vao;
+    stats_.vertexArray.issued++;
+    glCallStats.vertexArrayBinds++;
+}
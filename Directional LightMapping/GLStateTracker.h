@@ -0,0 +1,68 @@
+#ifndef GL_STATE_TRACKER_H
+#define GL_STATE_TRACKER_H
+
+#include "GLDispatch.h"
+#include <ostream>
+
+class Material;
+
+// Issued vs skipped state changes, counted per frame
+struct StateChangeStats {
+    unsigned int issued = 0;
+    unsigned int redundant = 0;
+};
+
+struct StateTrackerStats {
+    StateChangeStats program;
+    StateChangeStats texture;
+    StateChangeStats blend;
+    StateChangeStats vertexArray;
+
+    void print(std::ostream& out) const;
+};
+
+// Shadows the GL bindings the renderer touches and drops calls that would not change anything.
+// Anything outside the render queue may change GL state behind its back (texture uploads, mesh
+// setup), so the shadow copy is invalidated at the start of every frame.
+class GLStateTracker {
+public:
+    static const int MAX_TEXTURE_UNITS = 16;
+
+    void beginFrame();
+
+    void useProgram(GLuint program);
+    void bindTexture(GLint unit, GLenum target, GLuint texture);
+    void setBlend(bool enabled, GLenum srcFactor, GLenum dstFactor, GLenum equation);
+    void bindVertexArray(GLuint vao);
+
+    // The material whose parameters were uploaded last; lets back-to-back draws skip re-uploading them
+    const Material* lastMaterial() const { return lastMaterial_; }
+    void setLastMaterial(const Material* material) { lastMaterial_ = material; }
+
+    const StateTrackerStats& stats() const { return stats_; }
+
+private:
+    struct TextureBinding {
+        GLenum target = GL_NONE;
+        GLuint texture = 0;
+        bool known = false;
+    };
+
+    bool programKnown_ = false;
+    GLuint program_ = 0;
+    bool activeUnitKnown_ = false;
+    GLint activeUnit_ = 0;
+    TextureBinding textures_[MAX_TEXTURE_UNITS];
+    bool blendKnown_ = false;
+    bool blendEnabled_ = false;
+    GLenum srcFactor_ = GL_ONE;
+    GLenum dstFactor_ = GL_ZERO;
+    GLenum equation_ = GL_FUNC_ADD;
+    bool vertexArrayKnown_ = false;
+    GLuint vertexArray_ = 0;
+    const Material* lastMaterial_ = nullptr;
+
+    StateTrackerStats stats_;
+};
+
+#endif
@@ -0,0 +1,14 @@
+#include "GLStats.h"
+
+GLCallStats glCallStats;
+
+void GLCallStats::print(std::ostream& out) const {
+    out << "GL calls: " << total()
+        << " (uniform lookups " << uniformLookups
+        << ", uniform uploads " << uniformUploads
+        << ", program binds " << programBinds
+        << ", texture binds " << textureBinds
+        << ", render state " << renderStateChanges
+        << ", VAO binds " << vertexArrayBinds
+        << ", draws " << drawCalls << ")" << std::endl;
+}
@@ -0,0 +1,27 @@
+#ifndef GL_STATS_H
+#define GL_STATS_H
+
+#include <ostream>
+
+// Number of GL calls issued by the renderer, grouped by kind. The render loop
+// snapshots and resets the counters once per frame.
+struct GLCallStats {
+    unsigned int uniformLookups = 0;
+    unsigned int uniformUploads = 0;
+    unsigned int programBinds = 0;
+    unsigned int textureBinds = 0;
+    unsigned int renderStateChanges = 0;
+    unsigned int vertexArrayBinds = 0;
+    unsigned int drawCalls = 0;
+
+    unsigned int total() const {
+        return uniformLookups + uniformUploads + programBinds + textureBinds +
+            renderStateChanges + vertexArrayBinds + drawCalls;
+    }
+
+    void print(std::ostream& out) const;
+};
+
+extern GLCallStats glCallStats;
+
+#endif
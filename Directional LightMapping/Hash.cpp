@@ -0,0 +1,51 @@
+#include "Hash.h"
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+bool hashFile(const std::string& path, uint64_t& hash) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::vector<char> buffer(1 << 20);
+    hash = FNV1A_OFFSET_BASIS;
+    while (file) {
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        hash = hashBytes(buffer.data(), static_cast<size_t>(file.gcount()), hash);
+    }
+    return true;
+}
+
+namespace {
+
+bool statSource(const std::string& path, SourceFingerprint& fingerprint) {
+    std::error_code ec;
+    auto modified = std::filesystem::last_write_time(path, ec);
+    if (ec) return false;
+    auto size = std::filesystem::file_size(path, ec);
+    if (ec) return false;
+
+    fingerprint.modifiedTime = static_cast<int64_t>(modified.time_since_epoch().count());
+    fingerprint.size = static_cast<uint64_t>(size);
+    return true;
+}
+
+} // namespace
+
+bool fingerprintSource(const std::string& path, SourceFingerprint& fingerprint) {
+    return statSource(path, fingerprint) && hashFile(path, fingerprint.hash);
+}
+
+bool sourceMatches(const std::string& path, const SourceFingerprint& stored) {
+    SourceFingerprint current;
+    if (!statSource(path, current) || current.size != stored.size) {
+        return false;
+    }
+    if (current.modifiedTime == stored.modifiedTime) {
+        return true;
+    }
+    // Touched but possibly unchanged, e.g. after a checkout
+    return hashFile(path, current.hash) && current.hash == stored.hash;
+}
@@ -0,0 +1,43 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64-bit FNV-1a, used to fingerprint source assets for the on-disk caches
+const uint64_t FNV1A_OFFSET_BASIS = 14695981039346656037ull;
+const uint64_t FNV1A_PRIME = 1099511628211ull;
+
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t hash = FNV1A_OFFSET_BASIS) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+inline uint64_t hashString(const std::string& str, uint64_t hash = FNV1A_OFFSET_BASIS) {
+    return hashBytes(str.data(), str.size(), hash);
+}
+
+// Hashes the full contents of a file; returns false if it cannot be read
+bool hashFile(const std::string& path, uint64_t& hash);
+
+// Identity of a cached asset's source file; any field changing invalidates the cache.
+// A zero hash marks a fingerprint that has not been taken yet.
+struct SourceFingerprint {
+    uint64_t hash = 0;
+    int64_t modifiedTime = 0;
+    uint64_t size = 0;
+
+    bool operator==(const SourceFingerprint&) const = default;
+};
+
+bool fingerprintSource(const std::string& path, SourceFingerprint& fingerprint);
+
+// Checks a stored fingerprint against the file, only reading the contents when the size matches but the time differs
+bool sourceMatches(const std::string& path, const SourceFingerprint& stored);
+
+#endif
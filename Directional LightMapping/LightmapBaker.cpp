@@ -0,0 +1,1086 @@
+#include "LightmapBaker.h"
+#include "Hash.h"
+#include "Profiler.h"
+#include "RayTracer.h"
+#include "ThreadPool.h"
+#include "tinyxml2.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+const uint32_t NO_TRIANGLE = 0xFFFFFFFFu;
+const float PI = 3.14159265358979f;
+// Texel centers this far outside a triangle, in barycentric weight, still count as inside it,
+// so shared edges leave no uncovered texels
+const float COVERAGE_EPSILON = 1e-5f;
+const float MIN_UV_AREA = 1e-12f;
+// Sampler units of lightmap0..2, as in Material::samplerUnitMap
+const int LIGHTMAP_UNITS[3] = { 2, 3, 4 };
+const char LIGHTMAP_BAKE_MAGIC[4] = { 'D', 'L', 'M', 'B' };
+// Bounds of changed meshes grow by this fraction of their size plus this many world units, so rays
+// grazing one of their faces still count as passing through
+const float BOUNDS_PADDING = 1e-3f;
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The scene's triangles, with the corners as indices into scene.vertices
+struct BakeGeometry {
+    const BakedScene* scene = nullptr;
+    std::vector<uint32_t> corners;
+    std::vector<uint32_t> meshes;    // Mesh of each triangle
+    std::vector<uint32_t> lightmaps; // Lightmap of each triangle
+    RayTracer tracer;
+};
+
+// Which triangle covers each texel center of a lightmap, and where
+struct TexelMap {
+    std::vector<uint32_t> triangles;     // NO_TRIANGLE where nothing covers the texel
+    std::vector<glm::vec2> barycentrics; // Weights of the second and third corner
+};
+
+// Where and which way a texel's rays start
+struct TexelSurface {
+    glm::vec3 origin; // On the surface, offset along the face normal
+    glm::vec3 tangent;
+    glm::vec3 bitangent;
+    glm::vec3 normal;
+};
+
+float cross2(const glm::vec2& a, const glm::vec2& b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+uint32_t mixBits(uint32_t h) {
+    // MurmurHash3 finalizer
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// Seeded by the material rather than the lightmap index, so a texel draws the same samples whichever
+// meshes come before it, and an incremental bake matches a full one
+uint32_t hashTexel(uint32_t seed, uint32_t materialHash, uint32_t x, uint32_t y) {
+    return mixBits(mixBits(mixBits(mixBits(seed) ^ materialHash) ^ x) ^ y);
+}
+
+float toUnitFloat(uint32_t bits) {
+    return (bits >> 8) * (1.0f / 16777216.0f);
+}
+
+float radicalInverse(uint32_t bits) {
+    bits = (bits << 16) | (bits >> 16);
+    bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+    bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+    bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+    bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+    return toUnitFloat(bits);
+}
+
+void rasterizeTriangle(const BakeGeometry& geometry, uint32_t triangle, int width, int height, TexelMap& map) {
+    const Vertex* vertices = geometry.scene->vertices.data();
+    glm::vec2 size(static_cast<float>(width), static_cast<float>(height));
+    glm::vec2 a = vertices[geometry.corners[triangle * 3]].LightmapTexCoords * size;
+    glm::vec2 b = vertices[geometry.corners[triangle * 3 + 1]].LightmapTexCoords * size;
+    glm::vec2 c = vertices[geometry.corners[triangle * 3 + 2]].LightmapTexCoords * size;
+
+    // Meshes without a second UV set have all their lightmap UVs at zero
+    float area = cross2(b - a, c - a);
+    if (std::abs(area) < MIN_UV_AREA) {
+        return;
+    }
+
+    // Texel (x, y) has its center at (x + 0.5, y + 0.5)
+    int x0 = std::max(0, static_cast<int>(std::floor(std::min({ a.x, b.x, c.x }) - 0.5f)));
+    int y0 = std::max(0, static_cast<int>(std::floor(std::min({ a.y, b.y, c.y }) - 0.5f)));
+    int x1 = std::min(width - 1, static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x }) - 0.5f)));
+    int y1 = std::min(height - 1, static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y }) - 0.5f)));
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            glm::vec2 p(x + 0.5f, y + 0.5f);
+            float u = cross2(p - a, c - a) / area;
+            float v = cross2(b - a, p - a) / area;
+            if (u >= -COVERAGE_EPSILON && v >= -COVERAGE_EPSILON && u + v <= 1.0f + COVERAGE_EPSILON) {
+                size_t texel = static_cast<size_t>(y) * width + x;
+                map.triangles[texel] = triangle;
+                map.barycentrics[texel] = glm::vec2(u, v);
+            }
+        }
+    }
+}
+
+TexelSurface texelSurface(const BakeGeometry& geometry, uint32_t triangle, const glm::vec2& barycentrics, float rayOffset) {
+    const Vertex& a = geometry.scene->vertices[geometry.corners[triangle * 3]];
+    const Vertex& b = geometry.scene->vertices[geometry.corners[triangle * 3 + 1]];
+    const Vertex& c = geometry.scene->vertices[geometry.corners[triangle * 3 + 2]];
+    float wa = 1.0f - barycentrics.x - barycentrics.y;
+    float wb = barycentrics.x;
+    float wc = barycentrics.y;
+
+    glm::vec3 position = a.Position * wa + b.Position * wb + c.Position * wc;
+    glm::vec3 faceNormal = glm::cross(b.Position - a.Position, c.Position - a.Position);
+    faceNormal /= std::max(glm::length(faceNormal), 1e-20f);
+
+    TexelSurface surface;
+    surface.normal = a.Normal * wa + b.Normal * wb + c.Normal * wc;
+    float normalLength = glm::length(surface.normal);
+    surface.normal = normalLength > 1e-6f ? surface.normal / normalLength : faceNormal;
+    if (glm::dot(faceNormal, surface.normal) < 0.0f) {
+        faceNormal = -faceNormal;
+    }
+    surface.origin = position + faceNormal * rayOffset;
+
+    // Orthonormal frame that keeps the handedness of the interpolated tangent and bitangent
+    glm::vec3 tangent = a.Tangent * wa + b.Tangent * wb + c.Tangent * wc;
+    glm::vec3 bitangent = a.Bitangent * wa + b.Bitangent * wb + c.Bitangent * wc;
+    tangent -= surface.normal * glm::dot(surface.normal, tangent);
+    if (glm::dot(tangent, tangent) < 1e-12f) {
+        glm::vec3 up = std::abs(surface.normal.y) < 0.999f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        tangent = glm::cross(up, surface.normal);
+    }
+    surface.tangent = glm::normalize(tangent);
+    surface.bitangent = glm::cross(surface.normal, surface.tangent);
+    if (glm::dot(surface.bitangent, bitangent) < 0.0f) {
+        surface.bitangent = -surface.bitangent;
+    }
+    return surface;
+}
+
+// A light as it arrives at a texel
+struct LightArrival {
+    glm::vec3 toLight;
+    float distance;
+    glm::vec3 radiance; // Attenuated, before the shadow ray
+};
+
+// False for lights that do not reach the surface: below it, whichever way the basis directions
+// lean, or outside their cone
+bool lightArrival(const BakeLight& light, const TexelSurface& surface, LightArrival& arrival) {
+    arrival.radiance = light.color;
+    if (light.type == BakeLightType::Directional) {
+        arrival.toLight = -glm::normalize(light.direction);
+        arrival.distance = 1e30f;
+    }
+    else {
+        arrival.toLight = light.position - surface.origin;
+        arrival.distance = glm::length(arrival.toLight);
+        if (arrival.distance <= 0.0f) {
+            return false;
+        }
+        arrival.toLight /= arrival.distance;
+
+        float distance = arrival.distance;
+        float attenuation = light.attenuationConstant + distance * (light.attenuationLinear + distance * light.attenuationQuadratic);
+        arrival.radiance *= attenuation > 0.0f ? 1.0f / attenuation : 1.0f;
+        if (light.type == BakeLightType::Spot) {
+            float cosAngle = glm::dot(-arrival.toLight, glm::normalize(light.direction));
+            float cosOuter = std::cos(light.outerConeAngle);
+            float cosInner = std::cos(light.innerConeAngle);
+            float t = cosInner > cosOuter ? glm::clamp((cosAngle - cosOuter) / (cosInner - cosOuter), 0.0f, 1.0f) : (cosAngle >= cosOuter ? 1.0f : 0.0f);
+            arrival.radiance *= t * t * (3.0f - 2.0f * t);
+        }
+    }
+    return glm::dot(surface.normal, arrival.toLight) > 0.0f && arrival.radiance != glm::vec3(0.0f);
+}
+
+// Sample i of count uniformly distributed hemisphere directions. The sample points are a Hammersley
+// set rotated by the texel's hash, so neighbouring texels do not share a pattern.
+glm::vec3 skyDirection(const TexelSurface& surface, uint32_t hash, int sample, int count) {
+    float u = (sample + 0.5f) / count + toUnitFloat(hash);
+    float v = radicalInverse(static_cast<uint32_t>(sample)) + toUnitFloat(mixBits(hash));
+    u -= std::floor(u);
+    v -= std::floor(v);
+
+    float cosTheta = u;
+    float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+    float phi = 2.0f * PI * v;
+    return surface.tangent * (sinTheta * std::cos(phi)) + surface.bitangent * (sinTheta * std::sin(phi)) + surface.normal * cosTheta;
+}
+
+// Irradiance from one light along each basis direction, zero where the light is shadowed. Records
+// the light if it reaches the surface and the mesh that shadows it, if any.
+void addLight(const BakeGeometry& geometry, const BakeLight& light, uint32_t lightIndex, const TexelSurface& surface,
+    const glm::vec3 basis[3], glm::vec3 irradiance[3], uint64_t& rays, std::vector<uint32_t>& dependencies) {
+    LightArrival arrival;
+    if (!lightArrival(light, surface, arrival)) {
+        return;
+    }
+    dependencies.push_back(LIGHT_DEPENDENCY | lightIndex);
+
+    rays++;
+    RayHit hit;
+    if (geometry.tracer.occluded(surface.origin, arrival.toLight, arrival.distance, &hit)) {
+        dependencies.push_back(geometry.meshes[hit.triangle]);
+        return;
+    }
+    for (int i = 0; i < 3; i++) {
+        irradiance[i] += arrival.radiance * std::max(0.0f, glm::dot(basis[i], arrival.toLight));
+    }
+}
+
+// Sky irradiance along each basis direction from uniformly distributed hemisphere rays, recording the
+// meshes that block them
+void addSky(const BakeGeometry& geometry, const LightmapBakeOptions& options, const TexelSurface& surface, const glm::vec3 basis[3],
+    uint32_t hash, glm::vec3 irradiance[3], uint64_t& rays, std::vector<uint32_t>& dependencies) {
+    float weight = 2.0f * PI / options.skySamples;
+    for (int sample = 0; sample < options.skySamples; sample++) {
+        glm::vec3 direction = skyDirection(surface, hash, sample, options.skySamples);
+
+        rays++;
+        RayHit hit;
+        if (geometry.tracer.occluded(surface.origin, direction, options.skyDistance, &hit)) {
+            dependencies.push_back(geometry.meshes[hit.triangle]);
+            continue;
+        }
+        for (int i = 0; i < 3; i++) {
+            irradiance[i] += options.skyColor * (std::max(0.0f, glm::dot(basis[i], direction)) * weight);
+        }
+    }
+}
+
+// Appends the texel's dependencies, sorted and without duplicates, to dependencies
+void bakeTexel(const BakeGeometry& geometry, const std::vector<BakeLight>& lights, const LightmapBakeOptions& options,
+    const TexelSurface& surface, uint32_t hash, glm::vec3 out[3], uint64_t& rays, std::vector<uint32_t>& dependencies) {
+    glm::vec3 basis[3];
+    for (int i = 0; i < 3; i++) {
+        basis[i] = surface.tangent * LIGHTMAP_BASIS[i].x + surface.bitangent * LIGHTMAP_BASIS[i].y + surface.normal * LIGHTMAP_BASIS[i].z;
+    }
+
+    size_t firstDependency = dependencies.size();
+    glm::vec3 irradiance[3] = { glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f) };
+    for (uint32_t light = 0; light < lights.size(); light++) {
+        addLight(geometry, lights[light], light, surface, basis, irradiance, rays, dependencies);
+    }
+    if (options.skySamples > 0) {
+        addSky(geometry, options, surface, basis, hash, irradiance, rays, dependencies);
+    }
+    std::sort(dependencies.begin() + firstDependency, dependencies.end());
+    dependencies.erase(std::unique(dependencies.begin() + firstDependency, dependencies.end()), dependencies.end());
+
+    for (int i = 0; i < 3; i++) {
+        out[i] = irradiance[i] / PI;
+    }
+}
+
+// Grows the charts by one texel per pass: each empty texel next to filled ones takes their average
+void dilate(DirectionalLightmap& lightmap, int passes) {
+    std::vector<uint8_t> filled = lightmap.coverage;
+    for (int pass = 0; pass < passes; pass++) {
+        std::vector<uint8_t> next = filled;
+        for (int y = 0; y < lightmap.height; y++) {
+            for (int x = 0; x < lightmap.width; x++) {
+                size_t texel = static_cast<size_t>(y) * lightmap.width + x;
+                if (filled[texel]) {
+                    continue;
+                }
+
+                glm::vec3 sum[3] = { glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f) };
+                int count = 0;
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        int nx = x + dx;
+                        int ny = y + dy;
+                        if (nx < 0 || ny < 0 || nx >= lightmap.width || ny >= lightmap.height) {
+                            continue;
+                        }
+                        size_t neighbour = static_cast<size_t>(ny) * lightmap.width + nx;
+                        if (!filled[neighbour]) {
+                            continue;
+                        }
+                        for (int i = 0; i < 3; i++) {
+                            sum[i] += lightmap.layers[i][neighbour];
+                        }
+                        count++;
+                    }
+                }
+                if (count > 0) {
+                    for (int i = 0; i < 3; i++) {
+                        lightmap.layers[i][texel] = sum[i] / static_cast<float>(count);
+                    }
+                    next[texel] = 1;
+                }
+            }
+        }
+        filled.swap(next);
+    }
+}
+
+// Hands out task indices to a fixed set of workers. Each worker starts with a contiguous share and
+// works through it from the front; one that runs out steals the back half of the next worker's
+// remaining share, so neighbouring tiles tend to stay on one worker.
+class WorkStealingQueues {
+public:
+    WorkStealingQueues(size_t taskCount, unsigned int workerCount) {
+        for (unsigned int worker = 0; worker < workerCount; worker++) {
+            queues_.push_back(std::make_unique<Queue>());
+            // Reversed, so the worker's next task is at the back
+            size_t begin = taskCount * worker / workerCount;
+            size_t end = taskCount * (worker + 1) / workerCount;
+            for (size_t task = end; task > begin; task--) {
+                queues_.back()->tasks.push_back(task - 1);
+            }
+        }
+    }
+
+    bool next(unsigned int worker, size_t& task) {
+        Queue& own = *queues_[worker];
+        {
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = own.tasks.back();
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+
+        for (size_t offset = 1; offset < queues_.size(); offset++) {
+            Queue& victim = *queues_[(worker + offset) % queues_.size()];
+            std::vector<size_t> stolen;
+            {
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                size_t count = (victim.tasks.size() + 1) / 2;
+                stolen.assign(victim.tasks.begin(), victim.tasks.begin() + count);
+                victim.tasks.erase(victim.tasks.begin(), victim.tasks.begin() + count);
+            }
+            if (stolen.empty()) {
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(own.mutex);
+            task = stolen.back();
+            stolen.pop_back();
+            own.tasks.insert(own.tasks.end(), stolen.begin(), stolen.end());
+            steals_++;
+            return true;
+        }
+
+        // Tasks are never added, so once every queue is empty there is nothing left to run
+        return false;
+    }
+
+    size_t steals() const { return steals_; }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::atomic<size_t> steals_{ 0 };
+};
+
+struct BakeTile {
+    uint32_t lightmap;
+    int x;
+    int y;
+};
+
+bool writeTga(const std::string& path, int width, int height, const std::vector<glm::vec3>& texels) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Lightmap baker: cannot write " << path << std::endl;
+        return false;
+    }
+
+    uint8_t header[18] = {};
+    header[2] = 2; // Uncompressed true color
+    header[12] = static_cast<uint8_t>(width & 0xFF);
+    header[13] = static_cast<uint8_t>(width >> 8);
+    header[14] = static_cast<uint8_t>(height & 0xFF);
+    header[15] = static_cast<uint8_t>(height >> 8);
+    header[16] = 24;
+    header[17] = 0x20; // First row at the top
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    std::vector<uint8_t> pixels(texels.size() * 3);
+    for (size_t i = 0; i < texels.size(); i++) {
+        // BGR order
+        for (int c = 0; c < 3; c++) {
+            pixels[i * 3 + 2 - c] = static_cast<uint8_t>(glm::clamp(texels[i][c], 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+    }
+    out.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+    return static_cast<bool>(out);
+}
+
+// A bake up to the tracing: the triangles grouped into one lightmap per material and rasterized
+struct BakePlan {
+    BakeGeometry geometry;
+    std::vector<glm::vec3> positions;           // Three per triangle, for the ray tracer
+    std::vector<DirectionalLightmap> lightmaps; // Zeroed layers, coverage set
+    std::vector<TexelMap> texelMaps;
+    std::vector<uint32_t> materialHashes;       // Of each lightmap, for hashTexel
+};
+
+void prepareBake(const BakedScene& scene, const LightmapBakeOptions& options, BakePlan& plan) {
+    // One lightmap per material, in the order the materials first appear
+    BakeGeometry& geometry = plan.geometry;
+    geometry.scene = &scene;
+    std::unordered_map<std::string, uint32_t> lightmapIndices;
+    for (uint32_t mesh = 0; mesh < scene.meshes.size(); mesh++) {
+        const BakedMeshRange& range = scene.meshes[mesh];
+        std::string material = scene.stringTable.substr(range.materialNameOffset, range.materialNameLength);
+        auto it = lightmapIndices.emplace(material, static_cast<uint32_t>(plan.lightmaps.size())).first;
+        if (it->second == plan.lightmaps.size()) {
+            DirectionalLightmap lightmap;
+            lightmap.material = material;
+            lightmap.width = options.resolution;
+            lightmap.height = options.resolution;
+            plan.lightmaps.push_back(std::move(lightmap));
+            plan.materialHashes.push_back(static_cast<uint32_t>(hashString(material)));
+        }
+
+        for (uint32_t i = 0; i + 2 < range.indexCount; i += 3) {
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t vertex = range.firstVertex + scene.indices[range.firstIndex + i + corner];
+                geometry.corners.push_back(vertex);
+                plan.positions.push_back(scene.vertices[vertex].Position);
+            }
+            geometry.meshes.push_back(mesh);
+            geometry.lightmaps.push_back(it->second);
+        }
+    }
+
+    plan.texelMaps.resize(plan.lightmaps.size());
+    for (size_t i = 0; i < plan.lightmaps.size(); i++) {
+        size_t texelCount = static_cast<size_t>(plan.lightmaps[i].width) * plan.lightmaps[i].height;
+        plan.texelMaps[i].triangles.assign(texelCount, NO_TRIANGLE);
+        plan.texelMaps[i].barycentrics.resize(texelCount);
+        for (int layer = 0; layer < 3; layer++) {
+            plan.lightmaps[i].layers[layer].assign(texelCount, glm::vec3(0.0f));
+        }
+    }
+    for (uint32_t triangle = 0; triangle < geometry.lightmaps.size(); triangle++) {
+        const DirectionalLightmap& lightmap = plan.lightmaps[geometry.lightmaps[triangle]];
+        rasterizeTriangle(geometry, triangle, lightmap.width, lightmap.height, plan.texelMaps[geometry.lightmaps[triangle]]);
+    }
+    for (size_t i = 0; i < plan.lightmaps.size(); i++) {
+        DirectionalLightmap& lightmap = plan.lightmaps[i];
+        lightmap.coverage.resize(plan.texelMaps[i].triangles.size());
+        for (size_t texel = 0; texel < lightmap.coverage.size(); texel++) {
+            lightmap.coverage[texel] = plan.texelMaps[i].triangles[texel] != NO_TRIANGLE;
+        }
+    }
+}
+
+uint64_t hashMesh(const BakedScene& scene, const BakedMeshRange& range) {
+    uint64_t hash = hashBytes(scene.vertices.data() + range.firstVertex, range.vertexCount * sizeof(Vertex));
+    hash = hashBytes(scene.indices.data() + range.firstIndex, range.indexCount * sizeof(unsigned int), hash);
+    return hashString(scene.stringTable.substr(range.materialNameOffset, range.materialNameLength), hash);
+}
+
+uint64_t hashLight(const BakeLight& light) {
+    // Every member is four bytes wide, so there is no padding to hash
+    return hashBytes(&light, sizeof(BakeLight));
+}
+
+// Everything but the thread count and tile size, which do not change the result
+uint64_t hashBakeOptions(const LightmapBakeOptions& options) {
+    uint64_t hash = hashBytes(&options.resolution, sizeof(options.resolution));
+    hash = hashBytes(&options.skySamples, sizeof(options.skySamples), hash);
+    hash = hashBytes(&options.skyColor, sizeof(options.skyColor), hash);
+    hash = hashBytes(&options.skyDistance, sizeof(options.skyDistance), hash);
+    hash = hashBytes(&options.rayOffset, sizeof(options.rayOffset), hash);
+    hash = hashBytes(&options.dilation, sizeof(options.dilation), hash);
+    return hashBytes(&options.seed, sizeof(options.seed), hash);
+}
+
+// Whether the ray passes through the box before maxDistance
+bool rayHitsBox(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, const AABB& box) {
+    float enter = 0.0f;
+    float exit = maxDistance;
+    for (int axis = 0; axis < 3; axis++) {
+        if (std::abs(direction[axis]) < 1e-12f) {
+            if (origin[axis] < box.min[axis] || origin[axis] > box.max[axis]) {
+                return false;
+            }
+            continue;
+        }
+        float inverse = 1.0f / direction[axis];
+        float t0 = (box.min[axis] - origin[axis]) * inverse;
+        float t1 = (box.max[axis] - origin[axis]) * inverse;
+        enter = std::max(enter, std::min(t0, t1));
+        exit = std::min(exit, std::max(t0, t1));
+        if (enter > exit) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool rayHitsAny(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, const std::vector<AABB>& boxes) {
+    for (const AABB& box : boxes) {
+        if (rayHitsBox(origin, direction, maxDistance, box)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Without a previous bake, or after an options change, every covered texel is dirty
+LightmapDirtyRegion markDirtyTexels(const LightmapBake* previous, const LightmapSceneDiff& diff, const BakePlan& plan,
+    const std::vector<BakeLight>& lights, const LightmapBakeOptions& options) {
+    std::unordered_map<std::string, uint32_t> previousIndices;
+    if (previous && !diff.full) {
+        for (uint32_t i = 0; i < previous->lightmaps.size() && i < previous->dependencies.size(); i++) {
+            previousIndices.emplace(previous->lightmaps[i].material, i);
+        }
+    }
+
+    std::vector<AABB> appeared;
+    for (const AABB& box : diff.appearedBounds) {
+        glm::vec3 padding = (box.max - box.min) * BOUNDS_PADDING + BOUNDS_PADDING;
+        AABB padded;
+        padded.min = box.min - padding;
+        padded.max = box.max + padding;
+        appeared.push_back(padded);
+    }
+    bool lightsChanged = std::find(diff.changedLights.begin(), diff.changedLights.end(), 1) != diff.changedLights.end();
+
+    auto texelDirty = [&](const LightmapDependencies& recorded, const TexelMap& texelMap, size_t texel, uint32_t hash) {
+        uint32_t triangle = texelMap.triangles[texel];
+        uint32_t mesh = triangle != NO_TRIANGLE ? plan.geometry.meshes[triangle] : NO_MESH;
+        // Covered by another mesh than before, newly covered or no longer covered
+        if (mesh != recorded.meshes[texel]) {
+            return true;
+        }
+        if (mesh == NO_MESH) {
+            return false;
+        }
+        if (diff.changedMeshes[mesh]) {
+            return true;
+        }
+        for (uint32_t i = recorded.offsets[texel]; i < recorded.offsets[texel + 1]; i++) {
+            uint32_t entry = recorded.entries[i];
+            if (entry & LIGHT_DEPENDENCY ? diff.changedLights[entry & ~LIGHT_DEPENDENCY] : diff.changedMeshes[entry]) {
+                return true;
+            }
+        }
+        if (!lightsChanged && appeared.empty()) {
+            return false;
+        }
+
+        // Changed lights that reach the texel now, and rays that changed meshes may block now
+        TexelSurface surface = texelSurface(plan.geometry, triangle, texelMap.barycentrics[texel], options.rayOffset);
+        for (uint32_t light = 0; light < lights.size(); light++) {
+            LightArrival arrival;
+            if (!lightArrival(lights[light], surface, arrival)) {
+                continue;
+            }
+            if (diff.changedLights[light] || rayHitsAny(surface.origin, arrival.toLight, arrival.distance, appeared)) {
+                return true;
+            }
+        }
+        for (int sample = 0; sample < options.skySamples && !appeared.empty(); sample++) {
+            if (rayHitsAny(surface.origin, skyDirection(surface, hash, sample, options.skySamples), options.skyDistance, appeared)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    LightmapDirtyRegion region;
+    for (uint32_t i = 0; i < plan.lightmaps.size(); i++) {
+        const DirectionalLightmap& lightmap = plan.lightmaps[i];
+        const TexelMap& texelMap = plan.texelMaps[i];
+        size_t texelCount = texelMap.triangles.size();
+
+        int previousIndex = -1;
+        auto it = previousIndices.find(lightmap.material);
+        if (it != previousIndices.end() && previous->lightmaps[it->second].width == lightmap.width &&
+            previous->lightmaps[it->second].height == lightmap.height) {
+            previousIndex = static_cast<int>(it->second);
+        }
+        region.previousLightmaps.push_back(previousIndex);
+
+        std::vector<uint8_t>& dirty = region.texels.emplace_back(texelCount, 0);
+        for (int y = 0; y < lightmap.height; y++) {
+            for (int x = 0; x < lightmap.width; x++) {
+                size_t texel = static_cast<size_t>(y) * lightmap.width + x;
+                bool covered = texelMap.triangles[texel] != NO_TRIANGLE;
+                if (previousIndex < 0) {
+                    dirty[texel] = covered;
+                }
+                else {
+                    dirty[texel] = texelDirty(previous->dependencies[previousIndex], texelMap, texel,
+                        hashTexel(options.seed, plan.materialHashes[i], x, y));
+                }
+                region.coveredTexels += covered;
+                region.dirtyTexels += covered && dirty[texel];
+            }
+        }
+    }
+    return region;
+}
+
+struct LightmapBakeHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t optionsHash;
+    uint32_t meshCount;
+    uint32_t lightCount;
+    uint32_t lightmapCount;
+    uint32_t reserved;
+};
+
+// Followed by the material name, the three layers, the coverage and the dependencies
+struct LightmapRecordHeader {
+    uint32_t width;
+    uint32_t height;
+    uint32_t materialLength;
+    uint32_t entryCount;
+};
+
+template <typename T>
+void writeArray(std::ostream& out, const std::vector<T>& values) {
+    out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+template <typename T>
+bool readArray(std::istream& in, std::vector<T>& values, size_t count) {
+    values.resize(count);
+    in.read(reinterpret_cast<char*>(values.data()), count * sizeof(T));
+    return static_cast<bool>(in);
+}
+
+} // namespace
+
+void LightmapBakeStats::print(std::ostream& out) const {
+    out << "Lightmap bake: " << lightmaps << " lightmaps, " << texels << " texels traced, " << reusedTexels << " reused, "
+        << triangles << " triangles, " << lights << " lights" << std::endl;
+    out << "  " << rays << " rays in " << traceMs << " ms on " << threads << " threads: " << raysPerSecond() / 1e6
+        << " Mrays/s (" << tiles << " tiles, " << steals << " steals)" << std::endl;
+    out << "  BVH build " << buildMs << " ms, rasterize " << rasterizeMs << " ms, dirty region " << dirtyRegionMs
+        << " ms, dilate " << dilateMs << " ms, total " << totalMs << " ms" << std::endl;
+}
+
+LightmapSceneDiff diffLightmapScene(const LightmapBake& previous, const BakedScene& scene, const std::vector<BakeLight>& lights,
+    const LightmapBakeOptions& options) {
+    LightmapSceneDiff diff;
+    if (previous.optionsHash != hashBakeOptions(options)) {
+        diff.full = true;
+        return diff;
+    }
+
+    // Meshes and lights past the end of either scene were added or removed
+    diff.changedMeshes.assign(std::max(previous.meshHashes.size(), scene.meshes.size()), 1);
+    for (size_t mesh = 0; mesh < scene.meshes.size(); mesh++) {
+        const BakedMeshRange& range = scene.meshes[mesh];
+        if (mesh < previous.meshHashes.size() && previous.meshHashes[mesh] == hashMesh(scene, range)) {
+            diff.changedMeshes[mesh] = 0;
+            continue;
+        }
+        AABB bounds = computeBounds(scene.vertices.data() + range.firstVertex, range.vertexCount);
+        if (!bounds.isEmpty()) {
+            diff.appearedBounds.push_back(bounds);
+        }
+    }
+
+    diff.changedLights.assign(std::max(previous.lightHashes.size(), lights.size()), 1);
+    for (size_t light = 0; light < lights.size() && light < previous.lightHashes.size(); light++) {
+        diff.changedLights[light] = previous.lightHashes[light] != hashLight(lights[light]);
+    }
+    return diff;
+}
+
+LightmapDirtyRegion findLightmapDirtyRegion(const LightmapBake& previous, const BakedScene& scene, const std::vector<BakeLight>& lights,
+    const LightmapBakeOptions& options) {
+    BakePlan plan;
+    prepareBake(scene, options, plan);
+    return markDirtyTexels(&previous, diffLightmapScene(previous, scene, lights, options), plan, lights, options);
+}
+
+LightmapBake bakeLightmaps(const BakedScene& scene, const std::vector<BakeLight>& lights, const LightmapBakeOptions& options,
+    const LightmapBake* previous, LightmapBakeStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    LightmapBakeStats result;
+    result.lights = lights.size();
+
+    LightmapBake bake;
+    bake.optionsHash = hashBakeOptions(options);
+    for (const BakedMeshRange& range : scene.meshes) {
+        bake.meshHashes.push_back(hashMesh(scene, range));
+    }
+    for (const BakeLight& light : lights) {
+        bake.lightHashes.push_back(hashLight(light));
+    }
+
+    auto rasterizeStart = std::chrono::steady_clock::now();
+    BakePlan plan;
+    prepareBake(scene, options, plan);
+    std::vector<DirectionalLightmap>& lightmaps = plan.lightmaps;
+    const BakeGeometry& geometry = plan.geometry;
+    result.triangles = geometry.meshes.size();
+    result.lightmaps = lightmaps.size();
+    result.rasterizeMs = millisecondsSince(rasterizeStart);
+
+    auto dirtyStart = std::chrono::steady_clock::now();
+    LightmapSceneDiff diff;
+    if (previous) {
+        diff = diffLightmapScene(*previous, scene, lights, options);
+    }
+    LightmapDirtyRegion region = markDirtyTexels(previous, diff, plan, lights, options);
+    result.texels = region.dirtyTexels;
+    result.reusedTexels = region.coveredTexels - region.dirtyTexels;
+
+    // Clean texels keep their previous values; only tiles with dirty texels are traced
+    std::vector<BakeTile> tiles;
+    int tileSize = std::max(1, options.tileSize);
+    for (uint32_t i = 0; i < lightmaps.size(); i++) {
+        DirectionalLightmap& lightmap = lightmaps[i];
+        const std::vector<uint8_t>& dirty = region.texels[i];
+        if (region.previousLightmaps[i] >= 0) {
+            const DirectionalLightmap& old = previous->lightmaps[region.previousLightmaps[i]];
+            for (size_t texel = 0; texel < dirty.size(); texel++) {
+                if (lightmap.coverage[texel] && !dirty[texel]) {
+                    for (int layer = 0; layer < 3; layer++) {
+                        lightmap.layers[layer][texel] = old.layers[layer][texel];
+                    }
+                }
+            }
+        }
+        lightmap.modified = region.previousLightmaps[i] < 0 || std::find(dirty.begin(), dirty.end(), 1) != dirty.end();
+
+        for (int y = 0; y < lightmap.height; y += tileSize) {
+            for (int x = 0; x < lightmap.width; x += tileSize) {
+                bool traced = false;
+                for (int ty = y; ty < std::min(y + tileSize, lightmap.height) && !traced; ty++) {
+                    for (int tx = x; tx < std::min(x + tileSize, lightmap.width) && !traced; tx++) {
+                        size_t texel = static_cast<size_t>(ty) * lightmap.width + tx;
+                        traced = lightmap.coverage[texel] && dirty[texel];
+                    }
+                }
+                if (traced) {
+                    tiles.push_back({ i, x, y });
+                }
+            }
+        }
+    }
+    result.tiles = tiles.size();
+    result.dirtyRegionMs = millisecondsSince(dirtyStart);
+
+    // Nothing to trace when the scene did not change
+    auto buildStart = std::chrono::steady_clock::now();
+    if (!tiles.empty()) {
+        plan.geometry.tracer.build(plan.positions);
+    }
+    result.buildMs = millisecondsSince(buildStart);
+
+    // Each tile appends the dependencies of its texels, in row order, to its own list
+    std::vector<std::vector<uint32_t>> tileDependencies(tiles.size());
+    std::vector<std::vector<uint32_t>> dependencyCounts(lightmaps.size());
+    for (size_t i = 0; i < lightmaps.size(); i++) {
+        dependencyCounts[i].assign(lightmaps[i].coverage.size(), 0);
+    }
+
+    auto traceStart = std::chrono::steady_clock::now();
+    if (!tiles.empty()) {
+        ThreadPool pool(options.threads);
+        WorkStealingQueues queues(tiles.size(), pool.size());
+        std::vector<uint64_t> workerRays(pool.size(), 0);
+        for (unsigned int worker = 0; worker < pool.size(); worker++) {
+            pool.submit([&, worker]() {
+                uint64_t rays = 0;
+                size_t index;
+                while (queues.next(worker, index)) {
+                    PROFILE_SCOPE("Lightmap tile");
+                    const BakeTile& tile = tiles[index];
+                    DirectionalLightmap& lightmap = lightmaps[tile.lightmap];
+                    const TexelMap& texelMap = plan.texelMaps[tile.lightmap];
+                    const std::vector<uint8_t>& dirty = region.texels[tile.lightmap];
+                    std::vector<uint32_t>& dependencies = tileDependencies[index];
+                    for (int y = tile.y; y < std::min(tile.y + tileSize, lightmap.height); y++) {
+                        for (int x = tile.x; x < std::min(tile.x + tileSize, lightmap.width); x++) {
+                            size_t texel = static_cast<size_t>(y) * lightmap.width + x;
+                            uint32_t triangle = texelMap.triangles[texel];
+                            if (triangle == NO_TRIANGLE || !dirty[texel]) {
+                                continue;
+                            }
+
+                            TexelSurface surface = texelSurface(geometry, triangle, texelMap.barycentrics[texel], options.rayOffset);
+                            glm::vec3 value[3];
+                            size_t firstDependency = dependencies.size();
+                            bakeTexel(geometry, lights, options, surface, hashTexel(options.seed, plan.materialHashes[tile.lightmap], x, y),
+                                value, rays, dependencies);
+                            dependencyCounts[tile.lightmap][texel] = static_cast<uint32_t>(dependencies.size() - firstDependency);
+                            for (int i = 0; i < 3; i++) {
+                                lightmap.layers[i][texel] = value[i];
+                            }
+                        }
+                    }
+                }
+                workerRays[worker] = rays;
+            });
+        }
+        pool.wait();
+
+        result.threads = pool.size();
+        result.steals = queues.steals();
+        for (uint64_t rays : workerRays) {
+            result.rays += rays;
+        }
+    }
+    result.traceMs = millisecondsSince(traceStart);
+
+    // Compressed rows: counts of traced texels from the tiles, the rest from the previous bake
+    bake.dependencies.resize(lightmaps.size());
+    for (size_t i = 0; i < lightmaps.size(); i++) {
+        LightmapDependencies& recorded = bake.dependencies[i];
+        const TexelMap& texelMap = plan.texelMaps[i];
+        const std::vector<uint8_t>& dirty = region.texels[i];
+        const LightmapDependencies* old = region.previousLightmaps[i] >= 0 ? &previous->dependencies[region.previousLightmaps[i]] : nullptr;
+        size_t texelCount = texelMap.triangles.size();
+
+        recorded.meshes.resize(texelCount);
+        recorded.offsets.assign(texelCount + 1, 0);
+        for (size_t texel = 0; texel < texelCount; texel++) {
+            uint32_t triangle = texelMap.triangles[texel];
+            recorded.meshes[texel] = triangle != NO_TRIANGLE ? geometry.meshes[triangle] : NO_MESH;
+            uint32_t count = dependencyCounts[i][texel];
+            if (triangle != NO_TRIANGLE && !dirty[texel]) {
+                count = old->offsets[texel + 1] - old->offsets[texel];
+            }
+            recorded.offsets[texel + 1] = recorded.offsets[texel] + count;
+        }
+
+        recorded.entries.resize(recorded.offsets.back());
+        for (size_t texel = 0; texel < texelCount; texel++) {
+            if (texelMap.triangles[texel] != NO_TRIANGLE && !dirty[texel]) {
+                std::copy(old->entries.begin() + old->offsets[texel], old->entries.begin() + old->offsets[texel + 1],
+                    recorded.entries.begin() + recorded.offsets[texel]);
+            }
+        }
+    }
+    for (size_t index = 0; index < tiles.size(); index++) {
+        const BakeTile& tile = tiles[index];
+        const DirectionalLightmap& lightmap = lightmaps[tile.lightmap];
+        LightmapDependencies& recorded = bake.dependencies[tile.lightmap];
+        const std::vector<uint8_t>& dirty = region.texels[tile.lightmap];
+        auto source = tileDependencies[index].begin();
+        for (int y = tile.y; y < std::min(tile.y + tileSize, lightmap.height); y++) {
+            for (int x = tile.x; x < std::min(tile.x + tileSize, lightmap.width); x++) {
+                size_t texel = static_cast<size_t>(y) * lightmap.width + x;
+                if (lightmap.coverage[texel] && dirty[texel]) {
+                    uint32_t count = recorded.offsets[texel + 1] - recorded.offsets[texel];
+                    std::copy(source, source + count, recorded.entries.begin() + recorded.offsets[texel]);
+                    source += count;
+                }
+            }
+        }
+    }
+
+    // Dilation reads the charts' edges, which may have changed, so it runs on whole lightmaps
+    auto dilateStart = std::chrono::steady_clock::now();
+    for (DirectionalLightmap& lightmap : lightmaps) {
+        dilate(lightmap, options.dilation);
+    }
+    result.dilateMs = millisecondsSince(dilateStart);
+    result.totalMs = millisecondsSince(start);
+
+    if (stats) {
+        *stats = result;
+    }
+    bake.lightmaps = std::move(lightmaps);
+    return bake;
+}
+
+std::vector<DirectionalLightmap> bakeDirectionalLightmaps(const BakedScene& scene, const std::vector<BakeLight>& lights,
+    const LightmapBakeOptions& options, LightmapBakeStats* stats) {
+    return bakeLightmaps(scene, lights, options, nullptr, stats).lightmaps;
+}
+
+bool LightmapBake::write(const std::string& path) const {
+    LightmapBakeHeader header = {};
+    std::memcpy(header.magic, LIGHTMAP_BAKE_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.optionsHash = optionsHash;
+    header.meshCount = static_cast<uint32_t>(meshHashes.size());
+    header.lightCount = static_cast<uint32_t>(lightHashes.size());
+    header.lightmapCount = static_cast<uint32_t>(lightmaps.size());
+
+    // Temporary file first, so an interrupted write never leaves a truncated record behind
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Lightmap baker: cannot write " << tempPath << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeArray(out, meshHashes);
+        writeArray(out, lightHashes);
+        for (size_t i = 0; i < lightmaps.size(); i++) {
+            const DirectionalLightmap& lightmap = lightmaps[i];
+            LightmapRecordHeader record = {};
+            record.width = lightmap.width;
+            record.height = lightmap.height;
+            record.materialLength = static_cast<uint32_t>(lightmap.material.size());
+            record.entryCount = static_cast<uint32_t>(dependencies[i].entries.size());
+            out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+            out.write(lightmap.material.data(), lightmap.material.size());
+            for (const auto& layer : lightmap.layers) {
+                writeArray(out, layer);
+            }
+            writeArray(out, lightmap.coverage);
+            writeArray(out, dependencies[i].meshes);
+            writeArray(out, dependencies[i].offsets);
+            writeArray(out, dependencies[i].entries);
+        }
+        if (!out) {
+            std::cerr << "Lightmap baker: write failed for " << tempPath << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        std::cerr << "Lightmap baker: cannot replace " << path << ": " << ec.message() << std::endl;
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool LightmapBake::read(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    LightmapBakeHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, LIGHTMAP_BAKE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != VERSION) {
+        return false;
+    }
+
+    LightmapBake bake;
+    bake.optionsHash = header.optionsHash;
+    if (!readArray(in, bake.meshHashes, header.meshCount) || !readArray(in, bake.lightHashes, header.lightCount)) {
+        std::cerr << "Lightmap baker: truncated bake record " << path << std::endl;
+        return false;
+    }
+
+    // Sizes are checked as the file is read, so a corrupt record fails instead of allocating wildly
+    const uint32_t maxSize = 16384;
+    for (uint32_t i = 0; i < header.lightmapCount; i++) {
+        LightmapRecordHeader record;
+        if (!in.read(reinterpret_cast<char*>(&record), sizeof(record)) || record.width > maxSize || record.height > maxSize ||
+            record.materialLength > maxSize) {
+            std::cerr << "Lightmap baker: corrupt bake record " << path << std::endl;
+            return false;
+        }
+
+        DirectionalLightmap& lightmap = bake.lightmaps.emplace_back();
+        LightmapDependencies& recorded = bake.dependencies.emplace_back();
+        size_t texelCount = static_cast<size_t>(record.width) * record.height;
+        lightmap.width = record.width;
+        lightmap.height = record.height;
+        lightmap.material.resize(record.materialLength);
+        lightmap.modified = false;
+        bool complete = static_cast<bool>(in.read(lightmap.material.data(), record.materialLength));
+        for (auto& layer : lightmap.layers) {
+            complete = complete && readArray(in, layer, texelCount);
+        }
+        complete = complete && readArray(in, lightmap.coverage, texelCount) && readArray(in, recorded.meshes, texelCount) &&
+            readArray(in, recorded.offsets, texelCount + 1);
+        if (!complete || recorded.offsets.front() != 0 || recorded.offsets.back() != record.entryCount ||
+            !std::is_sorted(recorded.offsets.begin(), recorded.offsets.end())) {
+            std::cerr << "Lightmap baker: corrupt bake record " << path << std::endl;
+            return false;
+        }
+        if (!readArray(in, recorded.entries, record.entryCount)) {
+            std::cerr << "Lightmap baker: truncated bake record " << path << std::endl;
+            return false;
+        }
+
+        // Indices past the recorded scene would be out of range for the next diff
+        for (uint32_t mesh : recorded.meshes) {
+            if (mesh != NO_MESH && mesh >= header.meshCount) {
+                complete = false;
+            }
+        }
+        for (uint32_t entry : recorded.entries) {
+            if (entry & LIGHT_DEPENDENCY ? (entry & ~LIGHT_DEPENDENCY) >= header.lightCount : entry >= header.meshCount) {
+                complete = false;
+            }
+        }
+        if (!complete) {
+            std::cerr << "Lightmap baker: corrupt bake record " << path << std::endl;
+            return false;
+        }
+    }
+
+    *this = std::move(bake);
+    return true;
+}
+
+bool writeDirectionalLightmap(const DirectionalLightmap& lightmap, const std::array<std::string, 3>& paths) {
+    for (int i = 0; i < 3; i++) {
+        if (!writeTga(paths[i], lightmap.width, lightmap.height, lightmap.layers[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool updateMaterialLightmaps(const std::string& xmlPath, const std::array<std::string, 3>& assetPaths) {
+    tinyxml2::XMLDocument doc;
+    if (doc.LoadFile(xmlPath.c_str()) != tinyxml2::XML_SUCCESS) {
+        std::cerr << "Failed to load material XML: " << xmlPath << std::endl;
+        return false;
+    }
+
+    tinyxml2::XMLElement* root = doc.FirstChildElement("material");
+    if (!root) {
+        std::cerr << "No <material> root element found in " << xmlPath << std::endl;
+        return false;
+    }
+
+    tinyxml2::XMLElement* texturesElement = root->FirstChildElement("textures");
+    if (!texturesElement) {
+        texturesElement = doc.NewElement("textures");
+        root->InsertFirstChild(texturesElement);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        std::string type = "lightmap" + std::to_string(i);
+        tinyxml2::XMLElement* texElement = texturesElement->FirstChildElement("texture");
+        for (; texElement != nullptr; texElement = texElement->NextSiblingElement("texture")) {
+            const char* texType = texElement->Attribute("type");
+            if (texType && type == texType) {
+                break;
+            }
+        }
+        if (!texElement) {
+            texElement = doc.NewElement("texture");
+            texElement->SetAttribute("unit", LIGHTMAP_UNITS[i]);
+            texElement->SetAttribute("type", type.c_str());
+            texturesElement->InsertEndChild(texElement);
+        }
+        texElement->SetAttribute("path", assetPaths[i].c_str());
+    }
+
+    if (doc.SaveFile(xmlPath.c_str()) != tinyxml2::XML_SUCCESS) {
+        std::cerr << "Failed to save material XML: " << xmlPath << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,159 @@
+#ifndef LIGHTMAP_BAKER_H
+#define LIGHTMAP_BAKER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Culling.h"
+#include "SceneCache.h"
+
+// Tangent-space directions (x = tangent, y = bitangent, z = normal) that lightmap0..2 hold the light
+// arriving from: the Half-Life 2 radiosity normal mapping basis, which the shaders weight by the
+// per-pixel normal
+const glm::vec3 LIGHTMAP_BASIS[3] = {
+    glm::vec3(0.81649658f, 0.0f, 0.57735027f),         // ( sqrt(2/3),  0,          1/sqrt(3))
+    glm::vec3(-0.40824829f, 0.70710678f, 0.57735027f), // (-1/sqrt(6),  1/sqrt(2),  1/sqrt(3))
+    glm::vec3(-0.40824829f, -0.70710678f, 0.57735027f) // (-1/sqrt(6), -1/sqrt(2),  1/sqrt(3))
+};
+
+enum class BakeLightType { Directional, Point, Spot };
+
+// A light of the model's Assimp scene, in the same space as the baked vertices
+struct BakeLight {
+    BakeLightType type = BakeLightType::Directional;
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f); // Where the light travels
+    glm::vec3 color = glm::vec3(1.0f);                  // Intensity included
+    // Point and spot lights are scaled by 1 / (constant + linear d + quadratic d^2)
+    float attenuationConstant = 1.0f;
+    float attenuationLinear = 0.0f;
+    float attenuationQuadratic = 0.0f;
+    // Half angles in radians: full intensity inside the inner cone, none outside the outer one
+    float innerConeAngle = 3.14159265f;
+    float outerConeAngle = 3.14159265f;
+};
+
+struct LightmapBakeOptions {
+    int resolution = 512;                               // Width and height of every material's lightmaps
+    int skySamples = 64;                                // Hemisphere rays per texel; 0 bakes the lights only
+    glm::vec3 skyColor = glm::vec3(0.25f, 0.3f, 0.35f); // Radiance of the unoccluded sky
+    float skyDistance = 1e30f;                          // Occluders farther away than this do not block the sky
+    float rayOffset = 0.005f;  // Rays start this far off the surface, in world units, so it does not shadow itself
+    int dilation = 4;          // Passes that grow the charts into the empty texels around them, against seams
+    int tileSize = 16;         // Texels per side of one unit of work
+    unsigned int threads = 0;  // 0 uses one worker per hardware thread; does not change the result
+    uint32_t seed = 1;
+};
+
+// lightmap0..2 of one material. Every mesh drawn with the material shares the one lightmap UV layout.
+struct DirectionalLightmap {
+    std::string material;
+    int width = 0;
+    int height = 0;
+    // Irradiance along each basis direction divided by pi, i.e. the radiance a white diffuse surface
+    // facing that way reflects, in linear RGB. Rows from the top, like the images.
+    std::array<std::vector<glm::vec3>, 3> layers;
+    std::vector<uint8_t> coverage; // 1 where a triangle covers the texel center; dilated texels are 0
+    bool modified = true;          // False when an incremental bake reused every texel of the previous one
+};
+
+struct LightmapBakeStats {
+    unsigned int threads = 0;
+    size_t triangles = 0;
+    size_t lights = 0;
+    size_t lightmaps = 0;
+    size_t texels = 0;         // Covered texels that were traced
+    size_t reusedTexels = 0;   // Covered texels an incremental bake copied from the previous one
+    size_t tiles = 0;
+    size_t steals = 0;         // Times a worker ran out of tiles and took some from another
+    uint64_t rays = 0;
+    double buildMs = 0.0;      // Ray tracer BVH
+    double rasterizeMs = 0.0;  // Lightmap UVs into texels
+    double traceMs = 0.0;
+    double dirtyRegionMs = 0.0;
+    double dilateMs = 0.0;
+    double totalMs = 0.0;
+
+    double raysPerSecond() const { return traceMs > 0.0 ? rays / (traceMs / 1000.0) : 0.0; }
+    void print(std::ostream& out) const;
+};
+
+// Bakes direct light and sky occlusion (no bounces) into directional lightmaps, one per material of
+// the scene, in the order the materials first appear. The lightmap UVs (the second UV set) are
+// rasterized at texel centers; tiles of texels are traced on worker threads that each start with
+// their own share and steal from the others once it runs out. Each texel's samples are seeded by its
+// material and position, so the result does not depend on the thread count or scheduling.
+std::vector<DirectionalLightmap> bakeDirectionalLightmaps(const BakedScene& scene, const std::vector<BakeLight>& lights,
+    const LightmapBakeOptions& options, LightmapBakeStats* stats = nullptr);
+
+const uint32_t NO_MESH = 0xFFFFFFFFu;
+// Set on the light entries of LightmapDependencies::entries
+const uint32_t LIGHT_DEPENDENCY = 0x80000000u;
+
+// What each texel of a lightmap depended on when it was traced, in compressed rows
+struct LightmapDependencies {
+    std::vector<uint32_t> meshes;  // Mesh covering the texel, NO_MESH for empty texels
+    std::vector<uint32_t> offsets; // Texel t depends on entries[offsets[t], offsets[t + 1])
+    // Meshes that blocked one of its rays, and LIGHT_DEPENDENCY | index of each light on its side of the
+    // surface, shadowed or not
+    std::vector<uint32_t> entries;
+};
+
+// A bake and what it depended on, stored next to the lightmaps so the next bake of the model only
+// re-traces what a change can affect. Meshes and lights are identified by their index in the scene.
+struct LightmapBake {
+    static const uint32_t VERSION = 1;
+
+    uint64_t optionsHash = 0;          // Options that change the result; thread count and tile size do not
+    std::vector<uint64_t> meshHashes;  // Vertices, indices and material of each mesh
+    std::vector<uint64_t> lightHashes;
+    std::vector<DirectionalLightmap> lightmaps;
+    std::vector<LightmapDependencies> dependencies; // One per lightmap
+
+    bool write(const std::string& path) const;
+    bool read(const std::string& path);
+};
+
+// What changed between the scene of a previous bake and the current one
+struct LightmapSceneDiff {
+    bool full = false;                  // The options changed, so nothing of the previous bake is reused; the rest is left empty
+    std::vector<uint8_t> changedMeshes; // Per mesh index of either scene: added, removed or edited
+    std::vector<uint8_t> changedLights; // Per light index of either scene
+    std::vector<AABB> appearedBounds;   // Current bounds of the changed meshes, where rays may now be blocked
+};
+
+LightmapSceneDiff diffLightmapScene(const LightmapBake& previous, const BakedScene& scene, const std::vector<BakeLight>& lights,
+    const LightmapBakeOptions& options);
+
+struct LightmapDirtyRegion {
+    std::vector<std::vector<uint8_t>> texels; // Per lightmap of the current scene, 1 for texels to re-trace or clear
+    std::vector<int> previousLightmaps;       // The same material's lightmap in the previous bake, -1 if there is none
+    size_t dirtyTexels = 0;                   // Covered texels to re-trace
+    size_t coveredTexels = 0;
+};
+
+// The texels an incremental bake re-traces: texels on a changed mesh or on another mesh than before,
+// texels whose recorded occluders or lights changed, texels a changed light reaches now, and texels
+// with a light or sky ray through the bounds of a changed mesh. Re-tracing only these gives the same
+// lightmaps as a full bake. Rays are only tested against the changed bounds, not traced.
+LightmapDirtyRegion findLightmapDirtyRegion(const LightmapBake& previous, const BakedScene& scene, const std::vector<BakeLight>& lights,
+    const LightmapBakeOptions& options);
+
+// bakeDirectionalLightmaps, also recording what every texel depended on. Given the previous bake of
+// the same model, only its dirty region is traced and every other texel is copied from it.
+LightmapBake bakeLightmaps(const BakedScene& scene, const std::vector<BakeLight>& lights, const LightmapBakeOptions& options,
+    const LightmapBake* previous = nullptr, LightmapBakeStats* stats = nullptr);
+
+// Writes the three layers as uncompressed 24-bit TGA files, clamped to [0, 1] and not gamma encoded,
+// since lightmaps are sampled as linear data
+bool writeDirectionalLightmap(const DirectionalLightmap& lightmap, const std::array<std::string, 3>& paths);
+
+// Points the lightmap0..2 <texture> entries of a material XML at the given asset paths, adding the
+// entries that are missing
+bool updateMaterialLightmaps(const std::string& xmlPath, const std::array<std::string, 3>& assetPaths);
+
+#endif
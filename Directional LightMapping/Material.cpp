@@ -1,16 +1,41 @@
 #include "Material.h"
 #include "FileSystemUtils.h"
+#include "GLStats.h"
+#include "Profiler.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <unordered_set>
 #include <glm/gtc/type_ptr.hpp>
 
-// Include your shader compilation function or adjust accordingly
-extern GLuint compileShader(const char* vertexSrc, const char* fragmentSrc, const std::string& shaderName);
-extern GLuint loadTextureFromFile(const char* path, const std::string& directory);
+extern GLuint loadTextureFromFile(const char* path, const std::string& directory, BlockFormat& format, const MipOptions& mips);
 extern GLuint loadCubemap(const std::vector<std::string>& faces);
+extern GLuint loadLightmapArray(const std::vector<std::string>& layers, BlockFormat& format, const MipOptions& mips, int& firstLayer);
+
+std::map<std::string, std::pair<GLuint, BlockFormat>> Material::textureCache;
+std::map<std::vector<std::pair<GLint, GLuint>>, uint32_t> Material::textureSetIds;
+std::map<std::string, int> Material::lightmapArrayLayers;
+MaterialTableMode Material::tableMode = MaterialTableMode::Disabled;
+bool Material::ssBumpMaps = false;
+
+namespace {
+
+// Whether the shader has a code path for an optional define, e.g. BUMP_MAP_XY or LIGHTMAP_ARRAY.
+// Looked up before the program is built, since the define changes how the textures are loaded.
+bool shaderHandles(const std::string& shaderPath, const std::string& define) {
+    static std::map<std::string, std::string> sources;
+    if (shaderPath.empty()) {
+        return false;
+    }
+    auto it = sources.find(shaderPath);
+    if (it == sources.end()) {
+        it = sources.emplace(shaderPath, preprocessShaderSource(shaderPath, {})).first;
+    }
+    return it->second.find(define) != std::string::npos;
+}
 
-std::map<std::string, GLuint> Material::textureCache;
+} // namespace
 
 // Initialize the static sampler unit mapping
 const std::unordered_map<std::string, GLint> Material::samplerUnitMap = {
@@ -19,6 +44,7 @@ const std::unordered_map<std::string, GLint> Material::samplerUnitMap = {
     {"lightmap0", 2},
     {"lightmap1", 3},
     {"lightmap2", 4},
+    {"lightmapArray", 2}, // Replaces lightmap0..2 when they are packed into one array
     {"environmentMap", 5},
     {"detailMap", 6},
     {"detailMap2", 7},
@@ -58,7 +84,15 @@ Material::Material(const std::string& xmlFilePath) {
     if (matName)
         name = matName;
 
+    // Shader paths are read first, since the bump map format depends on the fragment shader
+    tinyxml2::XMLElement* shaderElement = root->FirstChildElement("shader");
+    if (shaderElement) {
+        vertexShaderPath = FileSystemUtils::getAssetFilePath(shaderElement->Attribute("vertex"));
+        fragmentShaderPath = FileSystemUtils::getAssetFilePath(shaderElement->Attribute("fragment"));
+    }
+
     // Load textures
+    std::vector<Texture> lightmaps;
     tinyxml2::XMLElement* texturesElement = root->FirstChildElement("textures");
     if (texturesElement) {
         for (tinyxml2::XMLElement* texElement = texturesElement->FirstChildElement();
@@ -84,16 +118,30 @@ Material::Material(const std::string& xmlFilePath) {
                     texture.tiling = glm::vec2(1.0f);
                 }
 
-                // Check if the texture is already loaded
-                auto it = textureCache.find(texture.path);
-                if (it != textureCache.end()) {
-                    texture.id = it->second;
+                // Block format: compression="bc1|bc3|bc5|auto|none", or the default for the sampler type
+                const char* compression = texElement->Attribute("compression");
+                texture.compression = compression ? parseBlockFormat(compression) : defaultBlockFormat(texture.type);
+
+                // BC5 drops the third channel: fine for normal maps when the shader rebuilds Z, wrong for SSBump maps
+                if (texture.type == "bumpMap") {
+                    bool allowBC5 = !ssBumpMaps && shaderHandles(fragmentShaderPath, "BUMP_MAP_XY");
+                    if (!compression && allowBC5) {
+                        texture.compression = BlockFormat::BC5;
+                    }
+                    else if (texture.compression == BlockFormat::BC5 && !allowBC5) {
+                        std::cerr << "Material " << name << ": " << texture.path << " cannot be BC5 "
+                            << (ssBumpMaps ? "as an SSBump map" : "without a BUMP_MAP_XY shader path") << ", keeping it uncompressed" << std::endl;
+                        texture.compression = BlockFormat::None;
+                    }
                 }
-                else {
-                    texture.id = loadTextureFromFile(texture.path.c_str(), "");
-                    textureCache[texture.path] = texture.id;
+
+                // The directional lightmaps are loaded together once all of them are known
+                if (texture.type == "lightmap0" || texture.type == "lightmap1" || texture.type == "lightmap2") {
+                    lightmaps.push_back(texture);
+                    continue;
                 }
 
+                loadTexture2D(texture);
                 textures.push_back(texture);
             }
             else if (strcmp(texElement->Name(), "cubemap") == 0) {
@@ -120,17 +168,27 @@ Material::Material(const std::string& xmlFilePath) {
                 // Check if the cubemap is already loaded
                 auto it = textureCache.find(cubemapKey);
                 if (it != textureCache.end()) {
-                    texture.id = it->second;
+                    texture.id = it->second.first;
                 }
                 else {
                     texture.id = loadCubemap(faces);
-                    textureCache[cubemapKey] = texture.id;
+                    textureCache[cubemapKey] = { texture.id, BlockFormat::None };
                 }
 
                 textures.push_back(texture);
             }
         }
     }
+    loadLightmaps(lightmaps);
+
+    // Materials binding the same textures to the same units share a texture set id for draw sorting
+    std::vector<std::pair<GLint, GLuint>> textureSet;
+    for (const auto& texture : textures) {
+        textureSet.emplace_back(texture.unit, texture.id);
+    }
+    std::sort(textureSet.begin(), textureSet.end());
+    auto setIt = textureSetIds.emplace(textureSet, static_cast<uint32_t>(textureSetIds.size())).first;
+    textureSetId = setIt->second;
 
     // Load parameters
     tinyxml2::XMLElement* paramsElement = root->FirstChildElement("parameters");
@@ -143,16 +201,16 @@ Material::Material(const std::string& xmlFilePath) {
             std::string value = paramElement->Attribute("value");
 
             if (type == "float") {
-                floatParams[paramName] = std::stof(value);
+                params.setFloat(params.declare(paramName, MaterialParamType::Float), std::stof(value));
             }
             else if (type == "int") {
-                intParams[paramName] = std::stoi(value);
+                params.setInt(params.declare(paramName, MaterialParamType::Int), std::stoi(value));
             }
             else if (type == "vec3") {
                 glm::vec3 vecValue;
                 std::istringstream ss(value);
                 ss >> vecValue.x >> vecValue.y >> vecValue.z;
-                vec3Params[paramName] = vecValue;
+                params.setVec3(params.declare(paramName, MaterialParamType::Vec3), vecValue);
             }
         }
     }
@@ -173,129 +231,369 @@ Material::Material(const std::string& xmlFilePath) {
     }
 
     // Load shaders
-    tinyxml2::XMLElement* shaderElement = root->FirstChildElement("shader");
     if (shaderElement) {
-        vertexShaderPath = FileSystemUtils::getAssetFilePath(shaderElement->Attribute("vertex"));
-        fragmentShaderPath = FileSystemUtils::getAssetFilePath(shaderElement->Attribute("fragment"));
-        loadShaders();
+        // Optional <define name="..." value="..."/> entries, inserted after #version
+        ShaderDefines defines;
+        for (tinyxml2::XMLElement* defineElement = shaderElement->FirstChildElement("define");
+            defineElement != nullptr;
+            defineElement = defineElement->NextSiblingElement("define")) {
+            const char* defineName = defineElement->Attribute("name");
+            const char* defineValue = defineElement->Attribute("value");
+            if (defineName) {
+                defines.emplace_back(defineName, defineValue ? defineValue : "");
+            }
+        }
+
+        if (usesLightmapArray) {
+            defines.emplace_back("LIGHTMAP_ARRAY", "1");
+        }
+        // Shaders without a MATERIAL_TABLE path keep reading the material's own samplers
+        usesMaterialTable = tableMode != MaterialTableMode::Disabled && shaderHandles(fragmentShaderPath, "MATERIAL_TABLE");
+        if (usesMaterialTable) {
+            defines.emplace_back("MATERIAL_TABLE", "1");
+            if (tableMode == MaterialTableMode::Bindless) {
+                defines.emplace_back("MATERIAL_TABLE_BINDLESS", "1");
+            }
+        }
+
+        // BC5 keeps only the XY of a normal map; the shader has to rebuild Z
+        for (const auto& texture : textures) {
+            if (texture.type == "bumpMap" && texture.compression == BlockFormat::BC5) {
+                defines.emplace_back("BUMP_MAP_XY", "1");
+                break;
+            }
+        }
+        loadShaders(defines);
     }
 }
 
-void Material::load() {
-    // Additional loading steps if necessary
+void Material::loadTexture2D(Texture& texture) {
+    // Check if the texture is already loaded
+    auto it = textureCache.find(texture.path);
+    if (it != textureCache.end()) {
+        texture.id = it->second.first;
+        texture.compression = it->second.second;
+    }
+    else {
+        texture.id = loadTextureFromFile(texture.path.c_str(), "", texture.compression, defaultMipOptions(texture.type, ssBumpMaps));
+        textureCache[texture.path] = { texture.id, texture.compression };
+    }
 }
 
-void Material::loadShaders() {
-    // Read shader code from files
-    std::ifstream vShaderFile(vertexShaderPath);
-    std::stringstream vShaderStream;
-    vShaderStream << vShaderFile.rdbuf();
-    std::string vertexCode = vShaderStream.str();
+void Material::loadLightmaps(std::vector<Texture>& lightmaps) {
+    // lightmap0..2 share one UV layout, so a complete triplet becomes the layers of one array texture
+    std::sort(lightmaps.begin(), lightmaps.end(), [](const Texture& a, const Texture& b) { return a.type < b.type; });
+    bool complete = lightmaps.size() == 3 && lightmaps[0].type == "lightmap0" &&
+        lightmaps[1].type == "lightmap1" && lightmaps[2].type == "lightmap2";
+
+    // Shaders without a LIGHTMAP_ARRAY path keep sampling lightmap0..2
+    if (complete && shaderHandles(fragmentShaderPath, "LIGHTMAP_ARRAY")) {
+        Texture array = lightmaps[0];
+        array.type = "lightmapArray";
+        array.unit = samplerUnitMap.at("lightmapArray");
+        array.isArray = true;
+
+        std::string key = "lightmapArray:" + lightmaps[0].path + "|" + lightmaps[1].path + "|" + lightmaps[2].path;
+        int firstLayer = 0;
+        auto it = textureCache.find(key);
+        if (it != textureCache.end()) {
+            array.id = it->second.first;
+            array.compression = it->second.second;
+            firstLayer = lightmapArrayLayers[key];
+        }
+        else {
+            std::vector<std::string> layers = { lightmaps[0].path, lightmaps[1].path, lightmaps[2].path };
+            array.id = loadLightmapArray(layers, array.compression, defaultMipOptions(array.type, ssBumpMaps), firstLayer);
+            if (array.id != 0) {
+                textureCache[key] = { array.id, array.compression };
+                lightmapArrayLayers[key] = firstLayer;
+            }
+        }
 
-    std::ifstream fShaderFile(fragmentShaderPath);
-    std::stringstream fShaderStream;
-    fShaderStream << fShaderFile.rdbuf();
-    std::string fragmentCode = fShaderStream.str();
+        if (array.id != 0) {
+            textures.push_back(array);
+            usesLightmapArray = true;
+            // Base layer when the level shares one lightmap array
+            params.setInt(params.declare("lightmapLayer", MaterialParamType::Int), firstLayer);
+            return;
+        }
+    }
 
-    shaderProgram = compileShader(vertexCode.c_str(), fragmentCode.c_str(), name);
+    // Incomplete triplet, arrays disabled or not handled by the shader: bind them as separate textures
+    for (Texture& texture : lightmaps) {
+        loadTexture2D(texture);
+        textures.push_back(texture);
+    }
 }
 
-void Material::apply(const glm::mat4& modelMatrix, const Camera& camera, float aspectRatio) const {
-    glUseProgram(shaderProgram);
-
-    // Set model, view, and projection matrices
-    GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-    GLint viewLoc = glGetUniformLocation(shaderProgram, "view");
-    GLint projLoc = glGetUniformLocation(shaderProgram, "projection");
+void Material::load() {
+    // Additional loading steps if necessary
+}
 
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(camera.getViewMatrix()));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE,  glm::value_ptr(camera.getProjectionMatrix(aspectRatio)));
+void Material::loadShaders(const ShaderDefines& defines) {
+    // Identical preprocessed sources are compiled once and shared
+    program = shaderProgramCache.acquire(vertexShaderPath, fragmentShaderPath, defines, name);
+    shaderProgram = program->id;
+    resolveUniformBindings();
+}
 
-    // Set camera position
-    GLint viewPosLoc = glGetUniformLocation(shaderProgram, "viewPos");
-    glUniform3fv(viewPosLoc, 1, glm::value_ptr(camera.getPosition()));
+void Material::resolveUniformBindings() {
+    uniforms = UniformBindings();
 
-    // Set custom uniforms
-    setUniforms(shaderProgram);
+    uniforms.model = glGetUniformLocation(shaderProgram, "model");
+    glCallStats.uniformLookups++;
 
-    // Bind textures specified in the material
-    for (const auto& texture : textures) {
-        glActiveTexture(GL_TEXTURE0 + texture.unit);
-        if (texture.isCubemap) {
-            glBindTexture(GL_TEXTURE_CUBE_MAP, texture.id);
-        }
-        else {
-            glBindTexture(GL_TEXTURE_2D, texture.id);
-        }
+    GLuint frameBlockIndex = glGetUniformBlockIndex(shaderProgram, "FrameConstants");
+    glCallStats.uniformLookups++;
+    if (frameBlockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shaderProgram, frameBlockIndex, FRAME_CONSTANTS_BINDING);
+        uniforms.usesFrameBlock = true;
+    }
+    else {
+        uniforms.view = glGetUniformLocation(shaderProgram, "view");
+        uniforms.projection = glGetUniformLocation(shaderProgram, "projection");
+        uniforms.viewPos = glGetUniformLocation(shaderProgram, "viewPos");
+        uniforms.visualizeNormals = glGetUniformLocation(shaderProgram, "visualizeNormals");
+        uniforms.visualizeShadowIntensity = glGetUniformLocation(shaderProgram, "visualizeShadowIntensity");
+        glCallStats.uniformLookups += 5;
     }
 
-    // Automatically assign texture units to sampler uniforms
+    // Sampler units never change, so they are assigned once here instead of on every draw
+    glUseProgram(shaderProgram);
+    glCallStats.programBinds++;
     for (const auto& [samplerName, unit] : samplerUnitMap) {
         GLint loc = glGetUniformLocation(shaderProgram, samplerName.c_str());
+        glCallStats.uniformLookups++;
         if (loc != -1) {
             glUniform1i(loc, unit);
+            glCallStats.uniformUploads++;
+        }
+    }
+    if (usesMaterialTable && tableMode == MaterialTableMode::TextureArrays) {
+        for (int i = 0; i < MAX_MATERIAL_ARRAYS; i++) {
+            std::string samplerName = "materialArrays[" + std::to_string(i) + "]";
+            GLint loc = glGetUniformLocation(shaderProgram, samplerName.c_str());
+            glCallStats.uniformLookups++;
+            if (loc != -1) {
+                glUniform1i(loc, MATERIAL_ARRAY_FIRST_UNIT + i);
+                glCallStats.uniformUploads++;
+            }
         }
     }
 
-    // Pass tiling parameters
+    // Tiling parameters (e.g. "diffuseTextureTiling")
     for (const auto& texture : textures) {
-        // Construct the uniform name (e.g., "diffuseTextureTiling")
         std::string uniformName = texture.type + "Tiling";
         GLint loc = glGetUniformLocation(shaderProgram, uniformName.c_str());
+        glCallStats.uniformLookups++;
         if (loc != -1) {
-            glUniform2fv(loc, 1, glm::value_ptr(texture.tiling));
+            uniforms.tilings.push_back({ loc, &texture.tiling });
         }
     }
 
-    // Pass detailBlendFactor if it exists
-    GLint blendFactorLoc = glGetUniformLocation(shaderProgram, "detailBlendFactor");
-    if (blendFactorLoc != -1) {
-        auto it = floatParams.find("detailBlendFactor");
-        if (it != floatParams.end()) {
-            glUniform1f(blendFactorLoc, it->second);
+    // detailBlendFactor defaults to 0 when the material does not specify it
+    if (!params.find("detailBlendFactor").valid()) {
+        GLint blendFactorLoc = glGetUniformLocation(shaderProgram, "detailBlendFactor");
+        glCallStats.uniformLookups++;
+        if (blendFactorLoc != -1) {
+            glUniform1f(blendFactorLoc, 0.0f);
+            glCallStats.uniformUploads++;
         }
-        else {
-            glUniform1f(blendFactorLoc, 0.0f); // Default to 0 if not specified
+    }
+
+    compileParams();
+
+    // Everything else another material may have changed on the shared program
+    std::unordered_set<GLint> ownLocations = { uniforms.model, uniforms.view, uniforms.projection,
+        uniforms.viewPos, uniforms.visualizeNormals, uniforms.visualizeShadowIntensity };
+    for (const auto& tiling : uniforms.tilings) ownLocations.insert(tiling.location);
+    for (const auto& param : uniforms.params) ownLocations.insert(param.location);
+    for (const auto& value : program->defaults) {
+        bool frameFlag = value.name == "visualizeNormals" || value.name == "visualizeShadowIntensity";
+        if (!frameFlag && ownLocations.count(value.location) == 0) {
+            uniforms.defaults.push_back(&value);
         }
     }
+}
 
-    // Set blending mode
-    if (blendingEnabled) {
-        glEnable(GL_BLEND);
-        glBlendFunc(srcBlendFactor, dstBlendFactor);
-        glBlendEquation(blendEquation);
+void Material::compileParams() {
+    uniforms.params.clear();
+    uniforms.usesParamBlock = false;
+
+    GLuint blockIndex = glGetUniformBlockIndex(shaderProgram, "MaterialParams");
+    glCallStats.uniformLookups++;
+    if (blockIndex != GL_INVALID_INDEX) {
+        // Lay the block out the way the program reads it
+        GLint blockSize = 0, memberCount = 0;
+        glGetActiveUniformBlockiv(shaderProgram, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+        glGetActiveUniformBlockiv(shaderProgram, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &memberCount);
+        std::vector<GLint> memberIndices(memberCount);
+        if (memberCount > 0) {
+            glGetActiveUniformBlockiv(shaderProgram, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, memberIndices.data());
+        }
+
+        std::vector<std::pair<std::string, uint32_t>> memberOffsets;
+        for (GLint index : memberIndices) {
+            char memberName[256];
+            GLsizei length = 0;
+            GLint offset = 0;
+            GLuint uniformIndex = static_cast<GLuint>(index);
+            glGetActiveUniformName(shaderProgram, uniformIndex, sizeof(memberName), &length, memberName);
+            glGetActiveUniformsiv(shaderProgram, 1, &uniformIndex, GL_UNIFORM_OFFSET, &offset);
+            std::string name(memberName, length);
+            memberOffsets.emplace_back(name.substr(name.find('.') + 1), static_cast<uint32_t>(offset));
+        }
+        params.compile(memberOffsets, static_cast<size_t>(blockSize));
+
+        glUniformBlockBinding(shaderProgram, blockIndex, MATERIAL_PARAMS_BINDING);
+        if (uniforms.paramRange.buffer == 0 || static_cast<size_t>(uniforms.paramRange.size) < params.size()) {
+            uniforms.paramRange = uniformBlockPool.allocate(params.size());
+        }
+        uniforms.usesParamBlock = true;
+        paramsUploaded_ = 0xFFFFFFFFu;
+        return;
     }
-    else {
-        glDisable(GL_BLEND);
+
+    for (size_t i = 0; i < params.slots().size(); i++) {
+        const MaterialParamSlot& slot = params.slots()[i];
+        // The visualization flags are global and come from the frame constants
+        if (slot.name.empty() || slot.name == "visualizeNormals" || slot.name == "visualizeShadowIntensity") {
+            continue;
+        }
+
+        GLint loc = glGetUniformLocation(shaderProgram, slot.name.c_str());
+        glCallStats.uniformLookups++;
+        if (loc != -1) {
+            MaterialParamHandle handle;
+            handle.index = static_cast<uint32_t>(i);
+            uniforms.params.push_back({ loc, slot.type, handle });
+        }
     }
 }
 
-void Material::setUniforms(GLuint program) const {
-    for (const auto& [name, value] : floatParams) {
-        GLint loc = glGetUniformLocation(program, name.c_str());
-        if (loc != -1) {
-            glUniform1f(loc, value);
+void Material::uploadParams() const {
+    if (paramsUploaded_ == params.version()) {
+        return;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, uniforms.paramRange.buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, uniforms.paramRange.offset, static_cast<GLsizeiptr>(params.size()), params.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glCallStats.uniformUploads++;
+    paramsUploaded_ = params.version();
+}
+
+void Material::apply(const glm::mat4* modelMatrix, const FrameConstants& frame, GLStateTracker& state) const {
+    PROFILE_SCOPE("Material::apply");
+    state.useProgram(shaderProgram);
+
+    // Set model matrix; view and projection are per-frame state.
+    // World-space geometry needs the identity, which only has to be set once.
+    if (modelMatrix) {
+        glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, glm::value_ptr(*modelMatrix));
+        glCallStats.uniformUploads++;
+        program->modelIsIdentity = false;
+    }
+    else if (!program->modelIsIdentity) {
+        glm::mat4 identity = glm::mat4(1.0f);
+        glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, glm::value_ptr(identity));
+        glCallStats.uniformUploads++;
+        program->modelIsIdentity = true;
+    }
+
+    // Shaders without the FrameConstants block keep their loose camera uniforms, set once per frame
+    if (!uniforms.usesFrameBlock && program->frameConstantsUploaded != frame.frameIndex()) {
+        const FrameConstantsData& data = frame.data();
+        glUniformMatrix4fv(uniforms.view, 1, GL_FALSE, glm::value_ptr(data.view));
+        glUniformMatrix4fv(uniforms.projection, 1, GL_FALSE, glm::value_ptr(data.projection));
+        glUniform3fv(uniforms.viewPos, 1, glm::value_ptr(data.viewPos));
+        glUniform1i(uniforms.visualizeNormals, data.flags[0]);
+        glUniform1i(uniforms.visualizeShadowIntensity, data.flags[1]);
+        glCallStats.uniformUploads += 5;
+        program->frameConstantsUploaded = frame.frameIndex();
+    }
+
+    // Runtime parameter writes reach the GPU even between consecutive draws of this material
+    if (uniforms.usesParamBlock) {
+        uploadParams();
+    }
+
+    // Consecutive draws with the same material only need their own model matrix
+    if (state.lastMaterial() == this) {
+        return;
+    }
+    state.setLastMaterial(this);
+
+    // Set custom uniforms
+    setUniforms();
+
+    // Draws outside the static batch have no per-instance index, they read the generic attribute
+    if (tableIndex >= 0) {
+        glVertexAttribI1ui(MATERIAL_INDEX_LOCATION, static_cast<GLuint>(tableIndex));
+    }
+
+    // Fully table-resident materials read their textures and tilings through the table
+    if (drawGroupId == 0) {
+        // Bind textures specified in the material
+        for (const auto& texture : textures) {
+            GLenum target = texture.isCubemap ? GL_TEXTURE_CUBE_MAP : (texture.isArray ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D);
+            state.bindTexture(texture.unit, target, texture.id);
         }
+
+        // Pass tiling parameters
+        for (const auto& tiling : uniforms.tilings) {
+            glUniform2fv(tiling.location, 1, glm::value_ptr(*tiling.value));
+        }
+        glCallStats.uniformUploads += static_cast<unsigned int>(uniforms.tilings.size());
     }
-    for (const auto& [name, value] : intParams) {
-        GLint loc = glGetUniformLocation(program, name.c_str());
-        if (loc != -1) {
-            glUniform1i(loc, value);
+
+    // Set blending mode
+    state.setBlend(blendingEnabled, srcBlendFactor, dstBlendFactor, blendEquation);
+}
+
+void Material::setUniforms() const {
+    // Only a shared program can hold another material's values
+    if (program->users > 1) {
+        for (const UniformDefault* value : uniforms.defaults) {
+            switch (value->type) {
+            case GL_FLOAT: glUniform1fv(value->location, 1, value->floats); break;
+            case GL_FLOAT_VEC2: glUniform2fv(value->location, 1, value->floats); break;
+            case GL_FLOAT_VEC3: glUniform3fv(value->location, 1, value->floats); break;
+            case GL_FLOAT_VEC4: glUniform4fv(value->location, 1, value->floats); break;
+            default: glUniform1iv(value->location, 1, value->ints); break;
+            }
         }
+        glCallStats.uniformUploads += static_cast<unsigned int>(uniforms.defaults.size());
     }
-    for (const auto& [name, value] : vec3Params) {
-        GLint loc = glGetUniformLocation(program, name.c_str());
-        if (loc != -1) {
-            glUniform3fv(loc, 1, &value[0]);
+
+    if (uniforms.usesParamBlock) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, MATERIAL_PARAMS_BINDING, uniforms.paramRange.buffer,
+            uniforms.paramRange.offset, uniforms.paramRange.size);
+        return;
+    }
+
+    for (const auto& param : uniforms.params) {
+        const void* value = params.valuePtr(param.handle);
+        switch (param.type) {
+        case MaterialParamType::Float: glUniform1fv(param.location, 1, static_cast<const float*>(value)); break;
+        case MaterialParamType::Int: glUniform1iv(param.location, 1, static_cast<const GLint*>(value)); break;
+        case MaterialParamType::Vec3: glUniform3fv(param.location, 1, static_cast<const float*>(value)); break;
         }
     }
+    glCallStats.uniformUploads += static_cast<unsigned int>(uniforms.params.size());
 }
 
 void Material::setIntParam(const std::string& name, int value) {
-    intParams[name] = value;
+    bool declared = params.find(name).valid();
+    params.setInt(params.declare(name, MaterialParamType::Int), value);
+    if (!declared && shaderProgram != 0) {
+        compileParams();
+    }
 }
 
 void Material::setFloatParam(const std::string& name, float value) {
-    floatParams[name] = value;
-}
\ No newline at end of file
+    bool declared = params.find(name).valid();
+    params.setFloat(params.declare(name, MaterialParamType::Float), value);
+    if (!declared && shaderProgram != 0) {
+        compileParams();
+    }
+}
@@ -5,10 +5,17 @@
 #include <map>
 #include <vector>
 #include <glm/glm.hpp>
-#include <GL/glew.h>
+#include "GLDispatch.h"
 #include <unordered_map>
+#include <cstdint>
+#include <memory>
 #include "tinyxml2.h"
-#include "Camera.h"
+#include "FrameConstants.h"
+#include "GLStateTracker.h"
+#include "ShaderProgramCache.h"
+#include "TextureCompression.h"
+#include "MaterialTable.h"
+#include "MaterialParams.h"
 
 struct Texture {
     GLuint id;
@@ -16,13 +23,46 @@ struct Texture {
     std::string type;
     std::string path;
     bool isCubemap;
+    bool isArray = false; // GL_TEXTURE_2D_ARRAY, e.g. the packed directional lightmaps
     glm::vec2 tiling = glm::vec2(1.0f); // Default tiling factors (U and V)
+    BlockFormat compression = BlockFormat::None; // What the texture was actually uploaded as
+};
+
+// Uniform locations resolved once after the program links. Parameter entries hold handles into
+// the material's parameter block, which stay valid when new parameters are declared.
+struct UniformBindings {
+    GLint model = -1;
+
+    // Shaders that declare the FrameConstants block read camera state from the frame UBO;
+    // older shaders get it through these loose uniforms, uploaded once per frame
+    bool usesFrameBlock = false;
+    GLint view = -1;
+    GLint projection = -1;
+    GLint viewPos = -1;
+    GLint visualizeNormals = -1;
+    GLint visualizeShadowIntensity = -1;
+
+    struct Tiling { GLint location; const glm::vec2* value; };
+    struct Param { GLint location; MaterialParamType type; MaterialParamHandle handle; };
+
+    std::vector<Tiling> tilings;
+
+    // Shaders that declare the MaterialParams block get the whole parameter block as one
+    // uniform buffer range; the others get a loose uniform per parameter
+    bool usesParamBlock = false;
+    UniformBlockPool::Range paramRange;
+    std::vector<Param> params;
+
+    // Uniforms of a shared program this material does not set; restored when switching to it
+    std::vector<const UniformDefault*> defaults;
 };
 
 class Material {
 public:
     std::string name;
-    GLuint shaderProgram;
+    GLuint shaderProgram = 0;
+    // Shared by every material with the same preprocessed shaders
+    std::shared_ptr<ShaderProgram> program = std::make_shared<ShaderProgram>();
     std::string vertexShaderPath;
     std::string fragmentShaderPath;
 
@@ -32,26 +72,57 @@ public:
     GLenum dstBlendFactor = GL_ZERO;
     GLenum blendEquation = GL_FUNC_ADD;
 
-    std::map<std::string, float> floatParams;
-    std::map<std::string, int> intParams;
-    std::map<std::string, glm::vec3> vec3Params;
+    // Compiled at load time; set values at runtime through handles from params.find()
+    MaterialParams params;
 
     std::vector<Texture> textures;
+    uint32_t textureSetId = 0; // Shared by materials that bind identical textures
+    bool usesLightmapArray = false; // lightmap0..2 packed into the lightmapArray sampler
+
+    // Built with MATERIAL_TABLE; only these materials get a table entry
+    bool usesMaterialTable = false;
+    // Set by MaterialTable::build. Materials with the same non-zero draw group differ only in
+    // their table entry, so one multi-draw covers all of them.
+    int tableIndex = -1;
+    uint32_t drawGroupId = 0;
+
+    // Chosen before the materials load, since it selects the MATERIAL_TABLE shader variants
+    static MaterialTableMode tableMode;
+    // Bump maps are SSBump maps rather than normal maps. Chosen before the materials load: SSBump
+    // maps keep all three channels, so they are never stored as BC5.
+    static bool ssBumpMaps;
 
     // Static mapping from sampler names to texture units
     static const std::unordered_map<std::string, GLint> samplerUnitMap;
 
     Material(const std::string& xmlFilePath);
+    Material(const Material&) = delete; // Uniform bindings point into this material's own members
+    Material& operator=(const Material&) = delete;
     void load();
-    void apply(const glm::mat4& modelMatrix, const Camera& camera, float aspectRatio) const;
+    // A null model matrix means the geometry is already in world space
+    void apply(const glm::mat4* modelMatrix, const FrameConstants& frame, GLStateTracker& state) const;
+    // Name-based, for load-time code; declares the parameter if the material does not have it yet
     void setIntParam(const std::string& name, int value);
     void setFloatParam(const std::string& name, float value);
 
+    bool sharesDrawState(const Material& other) const {
+        return this == &other || (drawGroupId != 0 && drawGroupId == other.drawGroupId);
+    }
+
 private:
-    void loadShaders();
+    void loadShaders(const ShaderDefines& defines);
     void loadTextures();
-    void setUniforms(GLuint program) const;
-    static std::map<std::string, GLuint> textureCache;
+    void loadTexture2D(Texture& texture);
+    void loadLightmaps(std::vector<Texture>& lightmaps);
+    void resolveUniformBindings();
+    void setUniforms() const;
+    void compileParams();
+    void uploadParams() const;
+    UniformBindings uniforms;
+    mutable uint32_t paramsUploaded_ = 0xFFFFFFFFu; // Version of params last written to paramRange
+    static std::map<std::string, std::pair<GLuint, BlockFormat>> textureCache;
+    static std::map<std::string, int> lightmapArrayLayers; // First layer of each packed triplet
+    static std::map<std::vector<std::pair<GLint, GLuint>>, uint32_t> textureSetIds;
     GLenum parseBlendFactor(const std::string& factor);
     GLenum parseBlendEquation(const std::string& equation);
 };
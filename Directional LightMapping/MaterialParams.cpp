@@ -0,0 +1,128 @@
+#include "MaterialParams.h"
+#include <algorithm>
+#include <cstring>
+
+UniformBlockPool uniformBlockPool;
+
+uint32_t std140Size(MaterialParamType type) {
+    return type == MaterialParamType::Vec3 ? 12 : 4;
+}
+
+uint32_t std140Offset(uint32_t end, MaterialParamType type) {
+    // Scalars align to 4 bytes, vec3 to 16
+    uint32_t alignment = type == MaterialParamType::Vec3 ? 16 : 4;
+    return (end + alignment - 1) / alignment * alignment;
+}
+
+MaterialParamHandle MaterialParams::declare(const std::string& name, MaterialParamType type) {
+    MaterialParamHandle existing = find(name);
+    if (existing.valid() && slots_[existing.index].type == type) {
+        return existing;
+    }
+    if (existing.valid()) {
+        // Redeclared with another type: keep the name, give it fresh storage
+        slots_[existing.index].name.clear();
+    }
+
+    MaterialParamSlot slot;
+    slot.name = name;
+    slot.type = type;
+    slot.offset = std140Offset(static_cast<uint32_t>(size()), type);
+    words_.resize((slot.offset + std140Size(type)) / 4, 0);
+    slots_.push_back(slot);
+    version_++;
+
+    MaterialParamHandle handle;
+    handle.index = static_cast<uint32_t>(slots_.size() - 1);
+    return handle;
+}
+
+MaterialParamHandle MaterialParams::find(const std::string& name) const {
+    MaterialParamHandle handle;
+    for (size_t i = 0; i < slots_.size(); i++) {
+        if (slots_[i].name == name) {
+            handle.index = static_cast<uint32_t>(i);
+            break;
+        }
+    }
+    return handle;
+}
+
+void MaterialParams::store(MaterialParamHandle handle, const void* value, size_t bytes) {
+    std::memcpy(words_.data() + slots_[handle.index].offset / 4, value, bytes);
+    version_++;
+}
+
+float MaterialParams::getFloat(MaterialParamHandle handle) const {
+    float value;
+    std::memcpy(&value, valuePtr(handle), sizeof(value));
+    return value;
+}
+
+int MaterialParams::getInt(MaterialParamHandle handle) const {
+    int value;
+    std::memcpy(&value, valuePtr(handle), sizeof(value));
+    return value;
+}
+
+glm::vec3 MaterialParams::getVec3(MaterialParamHandle handle) const {
+    glm::vec3 value;
+    std::memcpy(&value, valuePtr(handle), sizeof(value));
+    return value;
+}
+
+void MaterialParams::compile(const std::vector<std::pair<std::string, uint32_t>>& memberOffsets, size_t blockSize) {
+    std::vector<uint32_t> oldWords = std::move(words_);
+    words_.assign((blockSize + 3) / 4, 0);
+
+    // Members of the program's block first, then the rest after it in declaration order
+    std::vector<uint32_t> oldOffsets;
+    uint32_t end = static_cast<uint32_t>(words_.size() * 4);
+    for (auto& slot : slots_) {
+        oldOffsets.push_back(slot.offset);
+        auto member = std::find_if(memberOffsets.begin(), memberOffsets.end(),
+            [&slot](const auto& entry) { return entry.first == slot.name; });
+        if (member != memberOffsets.end() && !slot.name.empty()) {
+            slot.offset = member->second;
+        }
+        else {
+            slot.offset = std140Offset(end, slot.type);
+            end = slot.offset + std140Size(slot.type);
+        }
+    }
+    for (const auto& slot : slots_) {
+        words_.resize(std::max<size_t>(words_.size(), (slot.offset + std140Size(slot.type)) / 4), 0);
+    }
+
+    for (size_t i = 0; i < slots_.size(); i++) {
+        std::memcpy(words_.data() + slots_[i].offset / 4, oldWords.data() + oldOffsets[i] / 4, std140Size(slots_[i].type));
+    }
+    version_++;
+}
+
+UniformBlockPool::Range UniformBlockPool::allocate(size_t size) {
+    if (alignment_ == 0) {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment_);
+        alignment_ = std::max(alignment_, 16);
+    }
+
+    size_t alignment = static_cast<size_t>(alignment_);
+    size_t aligned = (size + alignment - 1) / alignment * alignment;
+    if (pages_.empty() || pages_.back().used + aligned > std::max(PAGE_SIZE, aligned)) {
+        Page page;
+        glGenBuffers(1, &page.buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, page.buffer);
+        glBufferData(GL_UNIFORM_BUFFER, std::max(PAGE_SIZE, aligned), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        page.used = 0;
+        pages_.push_back(page);
+    }
+
+    Page& page = pages_.back();
+    Range range;
+    range.buffer = page.buffer;
+    range.offset = static_cast<GLintptr>(page.used);
+    range.size = static_cast<GLsizeiptr>(size);
+    page.used += aligned;
+    return range;
+}
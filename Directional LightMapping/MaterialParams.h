@@ -0,0 +1,108 @@
+#ifndef MATERIAL_PARAMS_H
+#define MATERIAL_PARAMS_H
+
+#include "GLDispatch.h"
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Uniform buffer binding point of the per-material parameter block
+const GLuint MATERIAL_PARAMS_BINDING = 2;
+
+enum class MaterialParamType : uint8_t {
+    Float,
+    Int,
+    Vec3,
+};
+
+// A parameter resolved once by name; setting through it is a single store
+struct MaterialParamHandle {
+    uint32_t index = 0xFFFFFFFFu;
+
+    bool valid() const { return index != 0xFFFFFFFFu; }
+};
+
+struct MaterialParamSlot {
+    std::string name;
+    MaterialParamType type;
+    uint32_t offset; // Bytes from the start of the block
+};
+
+// A material's parameters as one std140 byte block with a precomputed offset table. Parameters
+// are declared at load time; afterwards values are read and written through handles, without
+// lookups or allocations. Shaders that declare
+//
+//   layout(std140, binding = 2) uniform MaterialParams { float shininess; vec3 specularColor; ... };
+//
+// get the block as a uniform buffer range; compile() moves every parameter to the offset the
+// linked program reports for it. Members the material does not declare read as zero.
+class MaterialParams {
+public:
+    // Adds a parameter at the next std140 offset, or returns the existing one of that name
+    MaterialParamHandle declare(const std::string& name, MaterialParamType type);
+    // Name lookup for load-time code; invalid handle if the parameter is not declared
+    MaterialParamHandle find(const std::string& name) const;
+
+    void setFloat(MaterialParamHandle handle, float value) { store(handle, &value, sizeof(value)); }
+    void setInt(MaterialParamHandle handle, int value) { store(handle, &value, sizeof(value)); }
+    void setVec3(MaterialParamHandle handle, const glm::vec3& value) { store(handle, &value, sizeof(value)); }
+
+    float getFloat(MaterialParamHandle handle) const;
+    int getInt(MaterialParamHandle handle) const;
+    glm::vec3 getVec3(MaterialParamHandle handle) const;
+
+    // Lays the block out to match a program's block members (name, offset) and size; parameters the
+    // program does not have follow at std140 offsets. Values are kept. No GL calls.
+    void compile(const std::vector<std::pair<std::string, uint32_t>>& memberOffsets, size_t blockSize);
+
+    const std::vector<MaterialParamSlot>& slots() const { return slots_; }
+    const MaterialParamSlot& slot(MaterialParamHandle handle) const { return slots_[handle.index]; }
+    const void* data() const { return words_.data(); }
+    const void* valuePtr(MaterialParamHandle handle) const { return words_.data() + slots_[handle.index].offset / 4; }
+    size_t size() const { return words_.size() * sizeof(uint32_t); }
+
+    // Bumped by every write, so the uploaded copy can tell it is stale
+    uint32_t version() const { return version_; }
+
+private:
+    void store(MaterialParamHandle handle, const void* value, size_t bytes);
+
+    std::vector<MaterialParamSlot> slots_;
+    std::vector<uint32_t> words_; // Every std140 member is a multiple of 4 bytes
+    uint32_t version_ = 0;
+};
+
+// std140 offset of the next member of the given type after end bytes
+uint32_t std140Offset(uint32_t end, MaterialParamType type);
+uint32_t std140Size(MaterialParamType type);
+
+// Sub-allocates the uniform buffer ranges of all material blocks from a few large buffers
+class UniformBlockPool {
+public:
+    struct Range {
+        GLuint buffer = 0;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+    };
+
+    Range allocate(size_t size);
+
+    size_t bufferCount() const { return pages_.size(); }
+
+private:
+    static const size_t PAGE_SIZE = 64 * 1024;
+
+    struct Page {
+        GLuint buffer;
+        size_t used;
+    };
+    std::vector<Page> pages_;
+    GLint alignment_ = 0;
+};
+
+extern UniformBlockPool uniformBlockPool;
+
+#endif
@@ -0,0 +1,308 @@
+#include "MaterialTable.h"
+#include "GLStateTracker.h"
+#include "Hash.h"
+#include "Material.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <set>
+#include <tuple>
+
+const char* materialTableModeName(MaterialTableMode mode) {
+    switch (mode) {
+    case MaterialTableMode::Bindless: return "bindless";
+    case MaterialTableMode::TextureArrays: return "texture arrays";
+    default: return "disabled";
+    }
+}
+
+TextureSlot TextureSlot::fromHandle(uint64_t handle) {
+    TextureSlot slot;
+    slot.x = static_cast<uint32_t>(handle);
+    slot.y = static_cast<uint32_t>(handle >> 32);
+    return slot;
+}
+
+uint64_t TextureSlot::handle() const {
+    return (uint64_t(y) << 32) | x;
+}
+
+bool packMaterialEntry(const std::vector<MaterialTextureRef>& textures,
+    const std::unordered_map<GLuint, TextureSlot>& slots, MaterialTableEntry& entry) {
+    for (int slot = 0; slot < MATERIAL_TABLE_SLOTS; slot++) {
+        entry.textures[slot][0] = MATERIAL_SLOT_EMPTY;
+        entry.textures[slot][1] = MATERIAL_SLOT_EMPTY;
+        entry.tiling[slot] = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+    }
+
+    bool complete = true;
+    for (const auto& texture : textures) {
+        if (texture.unit < 0 || texture.unit >= MATERIAL_TABLE_SLOTS) {
+            complete = false;
+            continue;
+        }
+
+        // The tiling is kept even for slots read from the classic sampler, the shader has no other copy
+        entry.tiling[texture.unit] = glm::vec4(texture.tiling.x, texture.tiling.y, 0.0f, 0.0f);
+        auto it = slots.find(texture.texture);
+        if (it == slots.end() || it->second.empty()) {
+            complete = false;
+            continue;
+        }
+        entry.textures[texture.unit][0] = it->second.x;
+        entry.textures[texture.unit][1] = it->second.y;
+    }
+    return complete;
+}
+
+bool TextureShape::operator<(const TextureShape& other) const {
+    return std::tie(internalFormat, width, height, levels) < std::tie(other.internalFormat, other.width, other.height, other.levels);
+}
+
+bool TextureShape::operator==(const TextureShape& other) const {
+    return internalFormat == other.internalFormat && width == other.width && height == other.height && levels == other.levels;
+}
+
+TextureArrayLayout assignArrayLayers(const std::vector<std::pair<GLuint, TextureShape>>& textures,
+    int maxLayers, int maxArrays) {
+    // Textures per shape, in first-seen order so the layout does not depend on GL names
+    std::vector<std::pair<TextureShape, std::vector<GLuint>>> shapes;
+    std::map<TextureShape, size_t> shapeIndices;
+    std::set<GLuint> seen;
+    for (const auto& [texture, shape] : textures) {
+        if (!seen.insert(texture).second) {
+            continue;
+        }
+        auto [it, inserted] = shapeIndices.emplace(shape, shapes.size());
+        if (inserted) {
+            shapes.push_back({ shape, {} });
+        }
+        shapes[it->second].second.push_back(texture);
+    }
+
+    // The shapes with the most textures get the arrays, so the fewest materials fall back
+    std::stable_sort(shapes.begin(), shapes.end(), [](const auto& a, const auto& b) {
+        return a.second.size() > b.second.size();
+    });
+
+    TextureArrayLayout layout;
+    for (const auto& [shape, members] : shapes) {
+        size_t placed = 0;
+        while (placed < members.size() && static_cast<int>(layout.arrays.size()) < maxArrays) {
+            size_t count = std::min(members.size() - placed, static_cast<size_t>(std::max(maxLayers, 1)));
+            uint32_t arrayIndex = static_cast<uint32_t>(layout.arrays.size());
+            layout.arrays.push_back(shape);
+            layout.layers.emplace_back(members.begin() + placed, members.begin() + placed + count);
+            for (size_t i = 0; i < count; i++) {
+                layout.slots[members[placed + i]] = { arrayIndex, static_cast<uint32_t>(i) };
+            }
+            placed += count;
+        }
+        layout.unplaced.insert(layout.unplaced.end(), members.begin() + placed, members.end());
+    }
+    return layout;
+}
+
+MaterialTableMode MaterialTable::detectMode(bool allowBindless) {
+    if (allowBindless && GLEW_ARB_bindless_texture) {
+        return MaterialTableMode::Bindless;
+    }
+    return MaterialTableMode::TextureArrays;
+}
+
+void MaterialTable::build(const std::vector<Material*>& levelMaterials) {
+    if (!enabled()) {
+        return;
+    }
+
+    // Materials whose shader has no table path keep binding their own textures
+    std::vector<Material*> materials;
+    for (Material* material : levelMaterials) {
+        if (material->usesMaterialTable) {
+            materials.push_back(material);
+        }
+        else {
+            material->tableIndex = -1;
+            material->drawGroupId = 0;
+        }
+    }
+
+    // Every texture referenced by a material, once
+    std::vector<GLuint> textures;
+    std::set<GLuint> seen;
+    for (const Material* material : materials) {
+        for (const auto& texture : material->textures) {
+            if (texture.id != 0 && seen.insert(texture.id).second) {
+                textures.push_back(texture.id);
+            }
+        }
+    }
+
+    if (mode_ == MaterialTableMode::Bindless) {
+        resolveBindless(textures);
+    }
+    else {
+        // Only plain 2D textures can become array layers; cubemaps and arrays stay on their units
+        std::vector<GLuint> planar;
+        std::set<GLuint> planarSeen;
+        for (const Material* material : materials) {
+            for (const auto& texture : material->textures) {
+                if (!texture.isCubemap && !texture.isArray && texture.id != 0 && planarSeen.insert(texture.id).second) {
+                    planar.push_back(texture.id);
+                }
+            }
+        }
+        resolveArrays(planar);
+    }
+
+    entries_.clear();
+    drawGroups_.clear();
+    tableMaterials_ = 0;
+    partialMaterials_ = 0;
+    for (Material* material : materials) {
+        std::vector<MaterialTextureRef> refs;
+        for (const auto& texture : material->textures) {
+            refs.push_back({ texture.unit, texture.id, texture.tiling });
+        }
+
+        MaterialTableEntry entry;
+        bool complete = packMaterialEntry(refs, slots_, entry);
+        material->tableIndex = static_cast<int>(entries_.size());
+        entries_.push_back(entry);
+
+        // Blended draws keep their submission order, so they are never merged
+        material->drawGroupId = complete && !material->blendingEnabled ? drawGroupFor(*material) : 0;
+        if (complete) {
+            tableMaterials_++;
+        }
+        else {
+            partialMaterials_++;
+        }
+    }
+
+    if (buffer_ == 0) {
+        glGenBuffers(1, &buffer_);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, entries_.size() * sizeof(MaterialTableEntry), entries_.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void MaterialTable::resolveBindless(const std::vector<GLuint>& textures) {
+    for (GLuint texture : textures) {
+        if (slots_.count(texture)) {
+            continue;
+        }
+        // A handle freezes the texture's sampling state; it stays valid for the texture's lifetime
+        GLuint64 handle = glGetTextureHandleARB(texture);
+        if (handle == 0) {
+            std::cerr << "Material table: no bindless handle for texture " << texture << std::endl;
+            continue;
+        }
+        glMakeTextureHandleResidentARB(handle);
+        residentHandles_.push_back(handle);
+        slots_[texture] = TextureSlot::fromHandle(handle);
+    }
+}
+
+void MaterialTable::resolveArrays(const std::vector<GLuint>& textures) {
+    std::vector<std::pair<GLuint, TextureShape>> shapes;
+    for (GLuint texture : textures) {
+        GLint width = 0, height = 0, internalFormat = 0, maxLevel = 0;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+        if (width <= 0 || height <= 0) {
+            continue; // Failed to load; the material keeps its own binding
+        }
+
+        TextureShape shape;
+        shape.internalFormat = static_cast<GLenum>(internalFormat);
+        shape.width = width;
+        shape.height = height;
+        int fullChain = static_cast<int>(std::floor(std::log2(std::max(width, height)))) + 1;
+        shape.levels = std::min(maxLevel + 1, fullChain);
+        shapes.emplace_back(texture, shape);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    TextureArrayLayout layout = assignArrayLayers(shapes, maxLayers, MAX_MATERIAL_ARRAYS);
+    if (!layout.unplaced.empty()) {
+        std::cerr << "Material table: " << layout.unplaced.size() << " textures did not fit into "
+            << MAX_MATERIAL_ARRAYS << " arrays and stay bound per material" << std::endl;
+    }
+
+    // Copy every level of every source texture into its layer; the sources stay for the classic path
+    for (size_t a = 0; a < layout.arrays.size(); a++) {
+        const TextureShape& shape = layout.arrays[a];
+        GLuint array = 0;
+        glGenTextures(1, &array);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, shape.levels, shape.internalFormat, shape.width, shape.height,
+            static_cast<GLsizei>(layout.layers[a].size()));
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        for (size_t layer = 0; layer < layout.layers[a].size(); layer++) {
+            for (int level = 0; level < shape.levels; level++) {
+                glCopyImageSubData(layout.layers[a][layer], GL_TEXTURE_2D, level, 0, 0, 0,
+                    array, GL_TEXTURE_2D_ARRAY, level, 0, 0, static_cast<GLint>(layer),
+                    std::max(shape.width >> level, 1), std::max(shape.height >> level, 1), 1);
+            }
+        }
+        arrays_.push_back(array);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    slots_.insert(layout.slots.begin(), layout.slots.end());
+}
+
+uint32_t MaterialTable::drawGroupFor(const Material& material) {
+    // Everything apply() uploads besides the textures; equal keys give identical GL state
+    std::vector<uint64_t> key = { material.shaderProgram };
+    for (const auto& slot : material.params.slots()) {
+        MaterialParamHandle handle = material.params.find(slot.name);
+        if (slot.name.empty() || !handle.valid()) {
+            continue;
+        }
+        key.push_back(hashString(slot.name));
+        key.push_back(hashBytes(material.params.valuePtr(handle), std140Size(slot.type)));
+    }
+
+    // Ids start at 1; 0 means the material draws on its own
+    auto it = drawGroups_.emplace(key, static_cast<uint32_t>(drawGroups_.size() + 1)).first;
+    return it->second;
+}
+
+void MaterialTable::bind(GLStateTracker& state) const {
+    if (buffer_ == 0) {
+        return;
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_TABLE_BINDING, buffer_);
+    for (size_t i = 0; i < arrays_.size(); i++) {
+        state.bindTexture(MATERIAL_ARRAY_FIRST_UNIT + static_cast<GLint>(i), GL_TEXTURE_2D_ARRAY, arrays_[i]);
+    }
+}
+
+void MaterialTable::printStats(std::ostream& out) const {
+    size_t layers = 0;
+    for (const auto& [texture, slot] : slots_) {
+        layers += slot.empty() ? 0 : 1;
+    }
+    out << "Material table (" << materialTableModeName(mode_) << "): " << entries_.size() << " materials, "
+        << tableMaterials_ << " fully in the table, " << partialMaterials_ << " partly bound per material, "
+        << drawGroups_.size() << " draw groups, " << layers << " textures";
+    if (mode_ == MaterialTableMode::TextureArrays) {
+        out << " in " << arrays_.size() << " arrays";
+    }
+    else {
+        out << " resident";
+    }
+    out << std::endl;
+}
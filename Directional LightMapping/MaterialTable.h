@@ -0,0 +1,143 @@
+#ifndef MATERIAL_TABLE_H
+#define MATERIAL_TABLE_H
+
+#include "GLDispatch.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class Material;
+class GLStateTracker;
+
+// Shader storage binding of the table and attribute location of the per-draw material index
+const GLuint MATERIAL_TABLE_BINDING = 1;
+const GLuint MATERIAL_INDEX_LOCATION = 8;
+
+// One slot per sampler unit in Material::samplerUnitMap
+const int MATERIAL_TABLE_SLOTS = 10;
+
+// Texture-array fallback: the arrays are bound to the units after the material samplers
+const GLint MATERIAL_ARRAY_FIRST_UNIT = MATERIAL_TABLE_SLOTS;
+const int MAX_MATERIAL_ARRAYS = 6;
+
+// Marks a slot the table cannot serve; the shader samples the classic sampler of that unit instead
+const uint32_t MATERIAL_SLOT_EMPTY = 0xFFFFFFFFu;
+
+enum class MaterialTableMode {
+    Disabled,
+    Bindless,      // GL_ARB_bindless_texture resident handles
+    TextureArrays, // 2D textures copied into arrays grouped by size, format and level count
+};
+
+const char* materialTableModeName(MaterialTableMode mode);
+
+// CPU mirror of one std430 entry. Shaders built with MATERIAL_TABLE declare:
+//
+//   layout(location = 8) in uint aMaterialIndex; // per instance, or the generic attribute value
+//   struct MaterialEntry {
+//       uvec2 textures[10]; // bindless: the 64-bit handle; arrays: x = array, y = layer
+//       vec4 tiling[10];    // xy = tiling of the slot's texture
+//   };
+//   layout(std430, binding = 1) readonly buffer MaterialTable { MaterialEntry materials[]; };
+//   uniform sampler2DArray materialArrays[6]; // without MATERIAL_TABLE_BINDLESS
+//
+// and sample slot s through sampler2D(textures[s]) with MATERIAL_TABLE_BINDLESS, or through
+// materialArrays[textures[s].x] at layer textures[s].y otherwise. A slot whose x is 0xFFFFFFFF is
+// not in the table and is read from the material's own sampler, which is then still bound.
+struct MaterialTableEntry {
+    uint32_t textures[MATERIAL_TABLE_SLOTS][2];
+    glm::vec4 tiling[MATERIAL_TABLE_SLOTS];
+};
+
+static_assert(sizeof(MaterialTableEntry) == 240, "MaterialTableEntry must match the std430 layout");
+
+// Where the table finds one texture
+struct TextureSlot {
+    uint32_t x = MATERIAL_SLOT_EMPTY;
+    uint32_t y = MATERIAL_SLOT_EMPTY;
+
+    bool empty() const { return x == MATERIAL_SLOT_EMPTY; }
+    static TextureSlot fromHandle(uint64_t handle);
+    uint64_t handle() const;
+};
+
+// A texture of a material as the table sees it
+struct MaterialTextureRef {
+    GLint unit;
+    GLuint texture;
+    glm::vec2 tiling;
+};
+
+// Packs one entry; textures the resolver has no slot for, or on units past the table, stay empty.
+// Returns false if any texture was left out. No GL calls.
+bool packMaterialEntry(const std::vector<MaterialTextureRef>& textures,
+    const std::unordered_map<GLuint, TextureSlot>& slots, MaterialTableEntry& entry);
+
+// Storage of a 2D texture; only textures with the same shape can share an array
+struct TextureShape {
+    GLenum internalFormat = GL_NONE;
+    int width = 0;
+    int height = 0;
+    int levels = 0;
+
+    bool operator<(const TextureShape& other) const;
+    bool operator==(const TextureShape& other) const;
+};
+
+struct TextureArrayLayout {
+    std::vector<TextureShape> arrays;
+    std::vector<std::vector<GLuint>> layers;          // Source texture of every layer, per array
+    std::unordered_map<GLuint, TextureSlot> slots;    // x = array, y = layer
+    std::vector<GLuint> unplaced;                     // Left out: too many shapes or layers
+};
+
+// Groups textures by shape, most textures first, into at most maxArrays arrays of up to maxLayers
+// layers each. Textures of a shape with no array left are reported as unplaced. No GL calls.
+TextureArrayLayout assignArrayLayers(const std::vector<std::pair<GLuint, TextureShape>>& textures,
+    int maxLayers, int maxArrays);
+
+// GPU-side table of every material's textures and tilings, indexed per draw. Materials whose
+// textures are all in the table and that share a program and parameters get the same draw group,
+// so the static batch draws them with one multi-draw instead of one per material.
+class MaterialTable {
+public:
+    // Bindless where supported and allowed, texture arrays otherwise. Needs a current context.
+    static MaterialTableMode detectMode(bool allowBindless);
+
+    explicit MaterialTable(MaterialTableMode mode = MaterialTableMode::Disabled) : mode_(mode) {}
+
+    void setMode(MaterialTableMode mode) { mode_ = mode; }
+    MaterialTableMode mode() const { return mode_; }
+    bool enabled() const { return mode_ != MaterialTableMode::Disabled; }
+
+    // Call once all textures have finished uploading. Sets tableIndex and drawGroupId on the materials
+    // built with MATERIAL_TABLE; the others keep -1 and 0.
+    void build(const std::vector<Material*>& levelMaterials);
+
+    // The texture arrays are per-unit state that the tracker forgets every frame
+    void bind(GLStateTracker& state) const;
+
+    const std::vector<MaterialTableEntry>& entries() const { return entries_; }
+    void printStats(std::ostream& out) const;
+
+private:
+    void resolveBindless(const std::vector<GLuint>& textures);
+    void resolveArrays(const std::vector<GLuint>& textures);
+    uint32_t drawGroupFor(const Material& material);
+
+    MaterialTableMode mode_;
+    std::vector<MaterialTableEntry> entries_;
+    std::unordered_map<GLuint, TextureSlot> slots_;
+    std::vector<GLuint> arrays_;
+    std::vector<uint64_t> residentHandles_;
+    std::map<std::vector<uint64_t>, uint32_t> drawGroups_; // Program, blend and parameter values
+    GLuint buffer_ = 0;
+    size_t tableMaterials_ = 0;  // Every texture in the table
+    size_t partialMaterials_ = 0; // Some textures still bound per material
+};
+
+#endif
@@ -0,0 +1,313 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+// Forsyth's scoring constants
+const int FORSYTH_CACHE_SIZE = 32;
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+// Overdraw reordering may cost at most this much ACMR against the cache-optimized order
+const float OVERDRAW_ACMR_THRESHOLD = 1.05f;
+
+float vertexScore(int cachePosition, unsigned int remainingTriangles) {
+    if (remainingTriangles == 0) {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // The last triangle's vertices get a fixed score so its neighbours are not favoured over each other
+            score = LAST_TRIANGLE_SCORE;
+        }
+        else {
+            float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+        }
+    }
+
+    score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+    return score;
+}
+
+} // namespace
+
+VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, size_t cacheSize) {
+    VertexCacheStats stats;
+    if (indexCount < 3) {
+        return stats;
+    }
+
+    // Each vertex remembers when it entered the FIFO; it is resident while fewer than cacheSize misses followed
+    std::vector<size_t> insertedAt(vertexCount, SIZE_MAX);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t misses = 0;
+    size_t referencedCount = 0;
+
+    for (size_t i = 0; i < indexCount; i++) {
+        unsigned int index = indices[i];
+        if (!referenced[index]) {
+            referenced[index] = true;
+            referencedCount++;
+        }
+        if (insertedAt[index] == SIZE_MAX || misses - insertedAt[index] >= cacheSize) {
+            insertedAt[index] = misses;
+            misses++;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / (indexCount / 3);
+    stats.atvr = referencedCount > 0 ? static_cast<float>(misses) / referencedCount : 0.0f;
+    return stats;
+}
+
+void optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Triangles using each vertex, as ranges into one flat array; the active part shrinks as triangles are emitted
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        remaining[indices[i]]++;
+    }
+    std::vector<unsigned int> triangleOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        triangleOffsets[v + 1] = triangleOffsets[v] + remaining[v];
+    }
+    std::vector<unsigned int> vertexTriangles(triangleOffsets[vertexCount]);
+    std::vector<unsigned int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = indices[t * 3 + k];
+            vertexTriangles[fill[v]++] = static_cast<unsigned int>(t);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        vertexScores[v] = vertexScore(-1, remaining[v]);
+    }
+
+    // Start with the highest scoring triangle, i.e. one of low-valence vertices
+    std::vector<bool> emitted(triangleCount, false);
+    long long bestTriangle = -1;
+    float bestScore = -1.0f;
+    for (size_t t = 0; t < triangleCount; t++) {
+        float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+        if (score > bestScore) {
+            bestScore = score;
+            bestTriangle = static_cast<long long>(t);
+        }
+    }
+
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+    std::vector<unsigned int> cache;
+    std::vector<unsigned int> newCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    size_t scanCursor = 0;
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        if (bestTriangle < 0) {
+            // Nothing adjacent to the cache is left: continue with the next unemitted triangle
+            while (emitted[scanCursor]) {
+                scanCursor++;
+            }
+            bestTriangle = static_cast<long long>(scanCursor);
+        }
+
+        size_t t = static_cast<size_t>(bestTriangle);
+        emitted[t] = true;
+        const unsigned int* triangle = indices + t * 3;
+        output.insert(output.end(), triangle, triangle + 3);
+
+        // Drop the triangle from its vertices' active lists
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = triangle[k];
+            unsigned int* begin = vertexTriangles.data() + triangleOffsets[v];
+            unsigned int* end = begin + remaining[v];
+            std::iter_swap(std::find(begin, end, static_cast<unsigned int>(t)), end - 1);
+            remaining[v]--;
+        }
+
+        // Emitted vertices move to the front of the LRU cache
+        newCache.assign(triangle, triangle + 3);
+        for (unsigned int v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                newCache.push_back(v);
+            }
+        }
+
+        for (size_t i = 0; i < newCache.size(); i++) {
+            unsigned int v = newCache[i];
+            cachePosition[v] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+            vertexScores[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+
+        // Rescore the remaining triangles of everything that was or is in the cache
+        bestTriangle = -1;
+        bestScore = -1.0f;
+        for (unsigned int v : newCache) {
+            for (unsigned int i = 0; i < remaining[v]; i++) {
+                unsigned int other = vertexTriangles[triangleOffsets[v] + i];
+                const unsigned int* o = indices + other * 3;
+                float score = vertexScores[o[0]] + vertexScores[o[1]] + vertexScores[o[2]];
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestTriangle = other;
+                }
+            }
+        }
+
+        if (newCache.size() > FORSYTH_CACHE_SIZE) {
+            newCache.resize(FORSYTH_CACHE_SIZE);
+        }
+        cache.swap(newCache);
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount) {
+    const size_t cacheSize = 16;
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Split into clusters where the simulated cache misses all three vertices
+    std::vector<size_t> clusterStarts;
+    std::vector<size_t> insertedAt(vertexCount, SIZE_MAX);
+    size_t misses = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        int triangleMisses = 0;
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = indices[t * 3 + k];
+            if (insertedAt[v] == SIZE_MAX || misses - insertedAt[v] >= cacheSize) {
+                insertedAt[v] = misses;
+                misses++;
+                triangleMisses++;
+            }
+        }
+        if (t == 0 || triangleMisses == 3) {
+            clusterStarts.push_back(t);
+        }
+    }
+    if (clusterStarts.size() < 2) {
+        return;
+    }
+    clusterStarts.push_back(triangleCount);
+
+    struct Cluster {
+        size_t firstTriangle;
+        size_t triangleCount;
+        float sortKey;
+    };
+    std::vector<Cluster> clusters;
+    clusters.reserve(clusterStarts.size() - 1);
+
+    // Area-weighted centroid of the whole mesh
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t t = 0; t < triangleCount; t++) {
+        const glm::vec3& a = vertices[indices[t * 3]].Position;
+        const glm::vec3& b = vertices[indices[t * 3 + 1]].Position;
+        const glm::vec3& c = vertices[indices[t * 3 + 2]].Position;
+        float area = glm::length(glm::cross(b - a, c - a));
+        meshCentroid += (a + b + c) * (area / 3.0f);
+        meshArea += area;
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+
+    for (size_t i = 0; i + 1 < clusterStarts.size(); i++) {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = clusterStarts[i]; t < clusterStarts[i + 1]; t++) {
+            const glm::vec3& a = vertices[indices[t * 3]].Position;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3& c = vertices[indices[t * 3 + 2]].Position;
+            glm::vec3 faceNormal = glm::cross(b - a, c - a);
+            float faceArea = glm::length(faceNormal);
+            centroid += (a + b + c) * (faceArea / 3.0f);
+            normal += faceNormal;
+            area += faceArea;
+        }
+
+        Cluster cluster;
+        cluster.firstTriangle = clusterStarts[i];
+        cluster.triangleCount = clusterStarts[i + 1] - clusterStarts[i];
+        cluster.sortKey = 0.0f;
+        float normalLength = glm::length(normal);
+        if (area > 0.0f && normalLength > 0.0f) {
+            cluster.sortKey = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+        }
+        clusters.push_back(cluster);
+    }
+
+    // Clusters facing away from the mesh centre are the most likely occluders, so they go first
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<unsigned int> reordered;
+    reordered.reserve(triangleCount * 3);
+    for (const auto& cluster : clusters) {
+        reordered.insert(reordered.end(), indices + cluster.firstTriangle * 3,
+            indices + (cluster.firstTriangle + cluster.triangleCount) * 3);
+    }
+
+    float cacheOnlyAcmr = analyzeVertexCache(indices, triangleCount * 3, vertexCount, cacheSize).acmr;
+    float reorderedAcmr = analyzeVertexCache(reordered.data(), reordered.size(), vertexCount, cacheSize).acmr;
+    if (reorderedAcmr <= cacheOnlyAcmr * OVERDRAW_ACMR_THRESHOLD) {
+        std::copy(reordered.begin(), reordered.end(), indices);
+    }
+}
+
+size_t optimizeVertexFetch(Vertex* vertices, size_t vertexCount, unsigned int* indices, size_t indexCount) {
+    const unsigned int unused = UINT32_MAX;
+    std::vector<unsigned int> remap(vertexCount, unused);
+    std::vector<Vertex> source(vertices, vertices + vertexCount);
+    unsigned int nextVertex = 0;
+
+    for (size_t i = 0; i < indexCount; i++) {
+        unsigned int& index = indices[i];
+        if (remap[index] == unused) {
+            remap[index] = nextVertex;
+            vertices[nextVertex++] = source[index];
+        }
+        index = remap[index];
+    }
+    return nextVertex;
+}
+
+void MeshOptimizationReport::print(std::ostream& out, const std::string& name) const {
+    out << "Mesh optimization " << name << ": " << triangleCount << " triangles, ACMR "
+        << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
+
+MeshOptimizationReport optimizeMesh(Vertex* vertices, size_t vertexCount, unsigned int* indices, size_t indexCount) {
+    MeshOptimizationReport report;
+    report.triangleCount = indexCount / 3;
+    report.before = analyzeVertexCache(indices, indexCount, vertexCount);
+
+    optimizeVertexCache(indices, indexCount, vertexCount);
+    optimizeOverdraw(indices, indexCount, vertices, vertexCount);
+    report.vertexCount = optimizeVertexFetch(vertices, vertexCount, indices, indexCount);
+
+    report.after = analyzeVertexCache(indices, indexCount, report.vertexCount);
+    return report;
+}
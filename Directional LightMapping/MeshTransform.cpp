@@ -0,0 +1,153 @@
+#include "MeshTransform.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESH_TRANSFORM_SSE 1
+#include <emmintrin.h>
+#else
+#define MESH_TRANSFORM_SSE 0
+#endif
+
+namespace {
+
+const float MIN_LENGTH_SQUARED = 1e-20f;
+
+glm::mat3 computeNormalMatrix(const glm::mat4& transform) {
+    return glm::transpose(glm::inverse(glm::mat3(transform)));
+}
+
+glm::vec3 safeNormalize(const glm::vec3& v) {
+    return v / std::sqrt(std::max(glm::dot(v, v), MIN_LENGTH_SQUARED));
+}
+
+#if MESH_TRANSFORM_SSE
+
+inline __m128 transformVec3(const __m128 columns[3], const glm::vec3& v) {
+    __m128 r = _mm_mul_ps(columns[0], _mm_set1_ps(v.x));
+    r = _mm_add_ps(r, _mm_mul_ps(columns[1], _mm_set1_ps(v.y)));
+    return _mm_add_ps(r, _mm_mul_ps(columns[2], _mm_set1_ps(v.z)));
+}
+
+// Expects a zero w lane
+inline __m128 normalize3(__m128 v) {
+    __m128 sq = _mm_mul_ps(v, v);
+    __m128 sum = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+    sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_div_ps(v, _mm_sqrt_ps(_mm_max_ps(sum, _mm_set1_ps(MIN_LENGTH_SQUARED))));
+}
+
+inline void storeVec3(glm::vec3& out, __m128 v) {
+    _mm_storel_pi(reinterpret_cast<__m64*>(&out.x), v);
+    _mm_store_ss(&out.z, _mm_movehl_ps(v, v));
+}
+
+inline void loadColumns(__m128 columns[3], const glm::mat3& m) {
+    for (int i = 0; i < 3; i++) {
+        columns[i] = _mm_setr_ps(m[i].x, m[i].y, m[i].z, 0.0f);
+    }
+}
+
+#endif
+
+void fillRandomVertices(std::vector<Vertex>& vertices) {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+    for (auto& v : vertices) {
+        v.Position = glm::vec3(dist(rng), dist(rng), dist(rng));
+        v.Normal = safeNormalize(glm::vec3(dist(rng), dist(rng), dist(rng)));
+        v.TexCoords = glm::vec2(dist(rng), dist(rng));
+        v.LightmapTexCoords = glm::vec2(dist(rng), dist(rng));
+        v.Tangent = safeNormalize(glm::vec3(dist(rng), dist(rng), dist(rng)));
+        v.Bitangent = safeNormalize(glm::cross(v.Normal, v.Tangent));
+    }
+}
+
+float maxDifference(const glm::vec3& a, const glm::vec3& b) {
+    glm::vec3 d = glm::abs(a - b);
+    return std::max(d.x, std::max(d.y, d.z));
+}
+
+} // namespace
+
+void transformVerticesScalar(Vertex* vertices, size_t count, const glm::mat4& transform) {
+    const glm::mat3 directionMatrix = glm::mat3(transform);
+    const glm::mat3 normalMatrix = computeNormalMatrix(transform);
+
+    for (size_t i = 0; i < count; i++) {
+        Vertex& v = vertices[i];
+        v.Position = glm::vec3(transform * glm::vec4(v.Position, 1.0f));
+        v.Normal = safeNormalize(normalMatrix * v.Normal);
+        v.Tangent = safeNormalize(directionMatrix * v.Tangent);
+        v.Bitangent = safeNormalize(directionMatrix * v.Bitangent);
+    }
+}
+
+void transformVertices(Vertex* vertices, size_t count, const glm::mat4& transform) {
+#if MESH_TRANSFORM_SSE
+    __m128 direction[3];
+    __m128 normal[3];
+    loadColumns(direction, glm::mat3(transform));
+    loadColumns(normal, computeNormalMatrix(transform));
+    const __m128 translation = _mm_setr_ps(transform[3].x, transform[3].y, transform[3].z, 0.0f);
+
+    for (size_t i = 0; i < count; i++) {
+        Vertex& v = vertices[i];
+        storeVec3(v.Position, _mm_add_ps(transformVec3(direction, v.Position), translation));
+        storeVec3(v.Normal, normalize3(transformVec3(normal, v.Normal)));
+        storeVec3(v.Tangent, normalize3(transformVec3(direction, v.Tangent)));
+        storeVec3(v.Bitangent, normalize3(transformVec3(direction, v.Bitangent)));
+    }
+#else
+    transformVerticesScalar(vertices, count, transform);
+#endif
+}
+
+void runTransformBenchmark(size_t vertexCount) {
+    const int iterations = 10;
+
+    glm::mat4 transform = glm::mat4(1.0f);
+    transform = glm::scale(transform, glm::vec3(0.01f));
+    transform = glm::rotate(transform, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+
+    std::vector<Vertex> source(vertexCount);
+    fillRandomVertices(source);
+    std::vector<Vertex> scalar;
+    std::vector<Vertex> simd;
+
+    double scalarMs = 0.0;
+    double simdMs = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        scalar = source;
+        auto start = std::chrono::steady_clock::now();
+        transformVerticesScalar(scalar.data(), scalar.size(), transform);
+        scalarMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        simd = source;
+        start = std::chrono::steady_clock::now();
+        transformVertices(simd.data(), simd.size(), transform);
+        simdMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    scalarMs /= iterations;
+    simdMs /= iterations;
+
+    float maxError = 0.0f;
+    for (size_t i = 0; i < vertexCount; i++) {
+        maxError = std::max(maxError, maxDifference(scalar[i].Position, simd[i].Position));
+        maxError = std::max(maxError, maxDifference(scalar[i].Normal, simd[i].Normal));
+        maxError = std::max(maxError, maxDifference(scalar[i].Tangent, simd[i].Tangent));
+        maxError = std::max(maxError, maxDifference(scalar[i].Bitangent, simd[i].Bitangent));
+    }
+
+    std::cout << "Vertex transform benchmark: " << vertexCount << " vertices, " << iterations << " runs"
+        << (MESH_TRANSFORM_SSE ? " (SSE)" : " (no SIMD on this target)") << std::endl;
+    std::cout << "  scalar glm: " << scalarMs << " ms (" << vertexCount / (scalarMs * 1000.0) << " Mverts/s)" << std::endl;
+    std::cout << "  simd:       " << simdMs << " ms (" << vertexCount / (simdMs * 1000.0) << " Mverts/s, "
+        << scalarMs / std::max(simdMs, 0.0001) << "x)" << std::endl;
+    std::cout << "  max abs difference: " << maxError << std::endl;
+}
@@ -0,0 +1,19 @@
+#ifndef MESH_TRANSFORM_H
+#define MESH_TRANSFORM_H
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "Vertex.h"
+
+// Bakes an affine transform into vertices in place: positions by the matrix, normals by its
+// inverse transpose, tangents and bitangents by its upper 3x3. Directions are renormalized.
+// Uses SSE when the target supports it.
+void transformVertices(Vertex* vertices, size_t count, const glm::mat4& transform);
+
+// Reference implementation with plain glm math
+void transformVerticesScalar(Vertex* vertices, size_t count, const glm::mat4& transform);
+
+// Times the SIMD kernel against the scalar glm path on synthetic vertices and prints the result
+void runTransformBenchmark(size_t vertexCount);
+
+#endif
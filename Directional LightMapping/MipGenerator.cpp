@@ -0,0 +1,390 @@
+#include "MipGenerator.h"
+#include "Hash.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_GENERATOR_SSE 1
+#include <emmintrin.h>
+#else
+#define MIP_GENERATOR_SSE 0
+#endif
+
+namespace {
+
+const float KAISER_RADIUS = 2.0f; // In destination texels, so 8 source taps when halving
+const float KAISER_ALPHA = 4.0f;
+const float PI = 3.14159265358979f;
+const int SRGB_ENCODE_TABLE_SIZE = 4096;
+const size_t PARALLEL_MIN_TEXELS = 64 * 1024; // Smaller levels are not worth splitting
+
+// Source taps of every destination texel along one axis, padded to tapCount with zero weights
+struct AxisTaps {
+    int tapCount = 0;
+    std::vector<int> indices;
+    std::vector<float> weights;
+};
+
+float besselI0(float x) {
+    // Power series; converges quickly for the small arguments a Kaiser window uses
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 20; k++) {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        sum += term;
+    }
+    return sum;
+}
+
+float kaiserWeight(float distance) {
+    float t = distance / KAISER_RADIUS;
+    if (std::fabs(t) >= 1.0f) {
+        return 0.0f;
+    }
+    float sinc = distance == 0.0f ? 1.0f : std::sin(PI * distance) / (PI * distance);
+    return sinc * besselI0(KAISER_ALPHA * std::sqrt(1.0f - t * t)) / besselI0(KAISER_ALPHA);
+}
+
+int addressTexel(int index, int size, bool wrap) {
+    if (wrap) {
+        index %= size;
+        return index < 0 ? index + size : index;
+    }
+    return std::min(std::max(index, 0), size - 1);
+}
+
+AxisTaps buildTaps(int sourceSize, int destinationSize, const MipOptions& options) {
+    AxisTaps taps;
+    float scale = static_cast<float>(sourceSize) / destinationSize;
+
+    if (options.filter == MipFilter::Box || sourceSize == destinationSize) {
+        taps.tapCount = sourceSize == destinationSize ? 1 : 2;
+        for (int i = 0; i < destinationSize; i++) {
+            for (int k = 0; k < taps.tapCount; k++) {
+                taps.indices.push_back(std::min(i * taps.tapCount + k, sourceSize - 1));
+                taps.weights.push_back(1.0f / taps.tapCount);
+            }
+        }
+        return taps;
+    }
+
+    float support = KAISER_RADIUS * scale;
+    taps.tapCount = static_cast<int>(std::ceil(support * 2.0f)) + 1;
+    for (int i = 0; i < destinationSize; i++) {
+        float center = (i + 0.5f) * scale;
+        int first = static_cast<int>(std::floor(center - support));
+        size_t start = taps.weights.size();
+        float total = 0.0f;
+        for (int k = 0; k < taps.tapCount; k++) {
+            int source = first + k;
+            float weight = kaiserWeight((source + 0.5f - center) / scale);
+            taps.indices.push_back(addressTexel(source, sourceSize, options.wrap));
+            taps.weights.push_back(weight);
+            total += weight;
+        }
+        for (size_t k = start; k < taps.weights.size(); k++) {
+            taps.weights[k] /= total;
+        }
+    }
+    return taps;
+}
+
+struct ConversionTables {
+    float srgbToLinear[256];
+    uint8_t linearToSrgb[SRGB_ENCODE_TABLE_SIZE];
+
+    ConversionTables() {
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < SRGB_ENCODE_TABLE_SIZE; i++) {
+            float c = i / static_cast<float>(SRGB_ENCODE_TABLE_SIZE - 1);
+            float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+            linearToSrgb[i] = static_cast<uint8_t>(std::lround(s * 255.0f));
+        }
+    }
+};
+
+const ConversionTables& conversionTables() {
+    static const ConversionTables tables;
+    return tables;
+}
+
+bool decodesAsNormal(const MipOptions& options, int components) {
+    return options.content == MipContent::Normal && components >= 3;
+}
+
+// RGBA8 to the float working space of the content type
+void decodeLevel(const std::vector<uint8_t>& rgba, const MipOptions& options, int components, std::vector<float>& out) {
+    const ConversionTables& tables = conversionTables();
+    bool normal = decodesAsNormal(options, components);
+    float color[256];
+    float alpha[256];
+    for (int value = 0; value < 256; value++) {
+        alpha[value] = value / 255.0f;
+        if (normal) {
+            color[value] = value * (2.0f / 255.0f) - 1.0f;
+        }
+        else {
+            color[value] = options.content == MipContent::Color ? tables.srgbToLinear[value] : alpha[value];
+        }
+    }
+
+    out.resize(rgba.size());
+    for (size_t i = 0; i < rgba.size(); i += 4) {
+        out[i + 0] = color[rgba[i + 0]];
+        out[i + 1] = color[rgba[i + 1]];
+        out[i + 2] = color[rgba[i + 2]];
+        out[i + 3] = alpha[rgba[i + 3]];
+    }
+}
+
+uint8_t quantizeUnit(float value) {
+    return static_cast<uint8_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// Renormalizes or clamps a filtered row in place and writes it out with the source channel layout
+void finishRow(float* row, int width, const MipOptions& options, int components, uint8_t* out) {
+    const ConversionTables& tables = conversionTables();
+    bool normal = decodesAsNormal(options, components);
+
+    for (int x = 0; x < width; x++) {
+        float* texel = row + x * 4;
+        uint8_t rgba[4];
+        if (normal) {
+            float length = std::sqrt(texel[0] * texel[0] + texel[1] * texel[1] + texel[2] * texel[2]);
+            float inverse = length > 1e-8f ? 1.0f / length : 0.0f;
+            for (int c = 0; c < 3; c++) {
+                texel[c] *= inverse;
+                rgba[c] = quantizeUnit(texel[c] * 0.5f + 0.5f);
+            }
+        }
+        else {
+            // Kaiser lobes can ring past the valid range; clamp so it does not build up down the chain
+            for (int c = 0; c < 3; c++) {
+                texel[c] = std::min(std::max(texel[c], 0.0f), 1.0f);
+                if (options.content == MipContent::Color) {
+                    rgba[c] = tables.linearToSrgb[static_cast<int>(texel[c] * (SRGB_ENCODE_TABLE_SIZE - 1) + 0.5f)];
+                }
+                else {
+                    rgba[c] = quantizeUnit(texel[c]);
+                }
+            }
+        }
+        texel[3] = std::min(std::max(texel[3], 0.0f), 1.0f);
+        rgba[3] = quantizeUnit(texel[3]);
+
+        uint8_t* pixel = out + static_cast<size_t>(x) * components;
+        switch (components) {
+        case 1: pixel[0] = rgba[0]; break;
+        case 2: pixel[0] = rgba[0]; pixel[1] = rgba[3]; break;
+        case 3: std::memcpy(pixel, rgba, 3); break;
+        default: std::memcpy(pixel, rgba, 4); break;
+        }
+    }
+}
+
+// Horizontal pass: one weighted sum of RGBA texels per destination texel
+void filterRow(const float* source, const AxisTaps& taps, int destinationWidth, float* out) {
+    for (int x = 0; x < destinationWidth; x++) {
+        const int* indices = taps.indices.data() + static_cast<size_t>(x) * taps.tapCount;
+        const float* weights = taps.weights.data() + static_cast<size_t>(x) * taps.tapCount;
+#if MIP_GENERATOR_SSE
+        __m128 sum = _mm_setzero_ps();
+        for (int k = 0; k < taps.tapCount; k++) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(source + indices[k] * 4), _mm_set1_ps(weights[k])));
+        }
+        _mm_storeu_ps(out + x * 4, sum);
+#else
+        float sum[4] = {};
+        for (int k = 0; k < taps.tapCount; k++) {
+            for (int c = 0; c < 4; c++) {
+                sum[c] += source[indices[k] * 4 + c] * weights[k];
+            }
+        }
+        std::memcpy(out + x * 4, sum, sizeof(sum));
+#endif
+    }
+}
+
+// Vertical pass: a destination row is the weighted sum of whole source rows
+void accumulateRow(const float* source, float weight, size_t floatCount, float* out) {
+    size_t i = 0;
+#if MIP_GENERATOR_SSE
+    __m128 w = _mm_set1_ps(weight);
+    for (; i + 4 <= floatCount; i += 4) {
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(source + i), w)));
+    }
+#endif
+    for (; i < floatCount; i++) {
+        out[i] += source[i] * weight;
+    }
+}
+
+// Runs body over [0, rows) in chunks on the pool, or inline when there is no pool or little work
+void forEachRowRange(ThreadPool* pool, int rows, size_t texelsPerRow, const std::function<void(int, int)>& body) {
+    if (!pool || pool->size() < 2 || static_cast<size_t>(rows) * texelsPerRow < PARALLEL_MIN_TEXELS) {
+        body(0, rows);
+        return;
+    }
+    int chunkCount = std::min(rows, static_cast<int>(pool->size()) * 4);
+    for (int chunk = 0; chunk < chunkCount; chunk++) {
+        int begin = rows * chunk / chunkCount;
+        int end = rows * (chunk + 1) / chunkCount;
+        pool->submit([&body, begin, end] { body(begin, end); });
+    }
+    pool->wait();
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+uint64_t MipOptions::hash() const {
+    uint32_t values[3] = { static_cast<uint32_t>(filter), static_cast<uint32_t>(content), wrap ? 1u : 0u };
+    return hashBytes(values, sizeof(values));
+}
+
+MipOptions defaultMipOptions(const std::string& samplerType, bool ssBumpMaps) {
+    MipOptions options;
+    if (samplerType == "bumpMap") {
+        options.content = ssBumpMaps ? MipContent::Linear : MipContent::Normal;
+    }
+    else if (samplerType == "diffuseTexture" || samplerType.compare(0, 9, "detailMap") == 0) {
+        options.content = MipContent::Color;
+    }
+    return options;
+}
+
+std::vector<uint8_t> expandToRgba(const uint8_t* pixels, int width, int height, int components) {
+    size_t texelCount = static_cast<size_t>(width) * height;
+    std::vector<uint8_t> rgba(texelCount * 4);
+    for (size_t i = 0; i < texelCount; i++) {
+        const uint8_t* in = pixels + i * components;
+        uint8_t* out = rgba.data() + i * 4;
+        switch (components) {
+        case 1: out[0] = out[1] = out[2] = in[0]; out[3] = 255; break;
+        case 2: out[0] = out[1] = out[2] = in[0]; out[3] = in[1]; break;
+        case 3: out[0] = in[0]; out[1] = in[1]; out[2] = in[2]; out[3] = 255; break;
+        default: std::memcpy(out, in, 4); break;
+        }
+    }
+    return rgba;
+}
+
+std::vector<MipLevelImage> generateMipChain(const uint8_t* pixels, int width, int height, int components,
+    const MipOptions& options, ThreadPool* pool) {
+    std::vector<MipLevelImage> levels;
+    MipLevelImage base;
+    base.width = width;
+    base.height = height;
+    base.components = components;
+    base.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * components);
+    levels.push_back(std::move(base));
+
+    // Each level is filtered from the float copy of the previous one, so rounding does not accumulate
+    std::vector<float> current;
+    decodeLevel(expandToRgba(pixels, width, height, components), options, components, current);
+    std::vector<float> horizontal;
+    std::vector<float> next;
+
+    while (width > 1 || height > 1) {
+        int nextWidth = std::max(width / 2, 1);
+        int nextHeight = std::max(height / 2, 1);
+        AxisTaps tapsX = buildTaps(width, nextWidth, options);
+        AxisTaps tapsY = buildTaps(height, nextHeight, options);
+
+        horizontal.assign(static_cast<size_t>(nextWidth) * height * 4, 0.0f);
+        forEachRowRange(pool, height, nextWidth, [&](int begin, int end) {
+            for (int y = begin; y < end; y++) {
+                filterRow(current.data() + static_cast<size_t>(y) * width * 4, tapsX, nextWidth,
+                    horizontal.data() + static_cast<size_t>(y) * nextWidth * 4);
+            }
+        });
+
+        MipLevelImage level;
+        level.width = nextWidth;
+        level.height = nextHeight;
+        level.components = components;
+        level.pixels.resize(static_cast<size_t>(nextWidth) * nextHeight * components);
+
+        size_t rowFloats = static_cast<size_t>(nextWidth) * 4;
+        next.assign(rowFloats * nextHeight, 0.0f);
+        forEachRowRange(pool, nextHeight, nextWidth, [&](int begin, int end) {
+            for (int y = begin; y < end; y++) {
+                float* row = next.data() + y * rowFloats;
+                for (int k = 0; k < tapsY.tapCount; k++) {
+                    size_t tap = static_cast<size_t>(y) * tapsY.tapCount + k;
+                    accumulateRow(horizontal.data() + tapsY.indices[tap] * rowFloats, tapsY.weights[tap], rowFloats, row);
+                }
+                finishRow(row, nextWidth, options, components,
+                    level.pixels.data() + static_cast<size_t>(y) * nextWidth * components);
+            }
+        });
+
+        levels.push_back(std::move(level));
+        current.swap(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    return levels;
+}
+
+void runMipBenchmark(const std::vector<std::string>& paths) {
+    if (paths.empty()) {
+        std::cerr << "Mip benchmark: no images to filter" << std::endl;
+        return;
+    }
+
+    ThreadPool pool;
+    std::cout << "Mip generation benchmark: " << paths.size() << " images"
+        << (MIP_GENERATOR_SSE ? " (SSE)" : " (no SIMD on this target)") << std::endl;
+    std::cout << "  image: box 1 thread / Kaiser 1 thread / Kaiser " << pool.size() << " threads" << std::endl;
+
+    double totalBoxMs = 0.0;
+    double totalKaiserMs = 0.0;
+    double totalParallelMs = 0.0;
+    for (const auto& path : paths) {
+        int width, height, components;
+        unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &components, 0);
+        if (!pixels) {
+            std::cerr << "  cannot decode " << path << std::endl;
+            continue;
+        }
+
+        std::string name = std::filesystem::path(path).filename().string();
+        MipOptions options = defaultMipOptions(name.find("normal") != std::string::npos ? "bumpMap" : "diffuseTexture");
+        options.filter = MipFilter::Box;
+        auto start = std::chrono::steady_clock::now();
+        generateMipChain(pixels, width, height, components, options);
+        double boxMs = millisecondsSince(start);
+
+        options.filter = MipFilter::Kaiser;
+        start = std::chrono::steady_clock::now();
+        generateMipChain(pixels, width, height, components, options);
+        double kaiserMs = millisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        generateMipChain(pixels, width, height, components, options, &pool);
+        double parallelMs = millisecondsSince(start);
+        stbi_image_free(pixels);
+
+        std::cout << "  " << name << " (" << width << "x" << height << "x" << components << "): "
+            << boxMs << " / " << kaiserMs << " / " << parallelMs << " ms" << std::endl;
+        totalBoxMs += boxMs;
+        totalKaiserMs += kaiserMs;
+        totalParallelMs += parallelMs;
+    }
+
+    std::cout << "  total: " << totalBoxMs << " / " << totalKaiserMs << " / " << totalParallelMs << " ms ("
+        << totalKaiserMs / std::max(totalParallelMs, 0.001) << "x from threads)" << std::endl;
+}
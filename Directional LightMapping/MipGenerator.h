@@ -0,0 +1,54 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ThreadPool.h"
+
+enum class MipFilter : uint32_t {
+    Box,    // 2x2 average; fast, slightly blurry and aliased
+    Kaiser, // Kaiser-windowed sinc over 8 source texels per axis; sharper, no visible aliasing
+};
+
+// How texel values are interpreted while filtering
+enum class MipContent : uint32_t {
+    Linear, // Data maps and lightmaps: filtered as stored
+    Color,  // sRGB-encoded color: filtered in linear light, so dark/bright edges keep their brightness
+    Normal, // Tangent-space normal map: XYZ decoded to [-1, 1] and renormalized at every level
+};
+
+struct MipOptions {
+    MipFilter filter = MipFilter::Kaiser;
+    MipContent content = MipContent::Linear;
+    bool wrap = true; // Filter taps wrap around the edges, matching GL_REPEAT sampling
+
+    // Part of the texture cache key, since the options change the baked levels
+    uint64_t hash() const;
+};
+
+// Options for a material sampler type: color for diffuse and detail maps, normal for bump maps.
+// SSBump maps hold three basis weights rather than a direction, so they are filtered as linear data.
+MipOptions defaultMipOptions(const std::string& samplerType, bool ssBumpMaps = false);
+
+// One level with the same channel count as the source image
+struct MipLevelImage {
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// Full chain down to 1x1; level 0 is a copy of the source. Filtering runs in float with SSE where
+// available. With a pool, the rows of each level are split across its workers; the pool must
+// not be busy with other work, since this waits for it to drain.
+std::vector<MipLevelImage> generateMipChain(const uint8_t* pixels, int width, int height, int components,
+    const MipOptions& options, ThreadPool* pool = nullptr);
+
+// Expands 1 to 4 component pixels to RGBA8; grey stays grey and missing alpha is opaque
+std::vector<uint8_t> expandToRgba(const uint8_t* pixels, int width, int height, int components);
+
+// Per-texture mip generation timings: box and Kaiser on one thread, Kaiser on the whole pool
+void runMipBenchmark(const std::vector<std::string>& paths);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef PROCESS_MEMORY_H
+#define PROCESS_MEMORY_H
+
+#include <cstddef>
+
+// Resident set size of this process, in bytes; zero where the platform does not report it
+size_t getCurrentResidentBytes();
+
+// Highest resident set size since the process started, in bytes
+size_t getPeakResidentBytes();
+
+#endif
@@ -0,0 +1,272 @@
+#include "Profiler.h"
+
+#if ENABLE_PROFILER
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <utility>
+
+namespace {
+    // Track of the GPU passes in the trace, after every CPU thread
+    const int GPU_TRACE_THREAD = 1000;
+
+    std::chrono::steady_clock::time_point profilerEpoch() {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return epoch;
+    }
+
+    void writeJsonString(std::ostream& out, const char* text) {
+        out << '"';
+        for (const char* c = text; *c; c++) {
+            if (*c == '"' || *c == '\\') {
+                out << '\\';
+            }
+            out << *c;
+        }
+        out << '"';
+    }
+
+    double percentile(const std::vector<double>& sorted, double fraction) {
+        size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+}
+
+ProfileRing::ProfileRing() : slots_(new Slot[CAPACITY]) {}
+
+void ProfileRing::push(const ProfileEvent& event) {
+    uint64_t index = next_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots_[index & (CAPACITY - 1)];
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event = event;
+    slot.sequence.store(2 * (index + 1), std::memory_order_release);
+}
+
+void ProfileRing::snapshot(std::vector<ProfileEvent>& out) const {
+    uint64_t end = next_.load(std::memory_order_acquire);
+    uint64_t begin = end > CAPACITY ? end - CAPACITY : 0;
+    for (uint64_t index = begin; index < end; index++) {
+        const Slot& slot = slots_[index & (CAPACITY - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != 2 * (index + 1)) {
+            continue;
+        }
+        ProfileEvent event = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Overwritten by a newer event while copying
+        if (slot.sequence.load(std::memory_order_relaxed) != 2 * (index + 1)) {
+            continue;
+        }
+        out.push_back(event);
+    }
+}
+
+void ProfileRing::clear() {
+    for (size_t i = 0; i < CAPACITY; i++) {
+        slots_[i].sequence.store(0, std::memory_order_relaxed);
+    }
+    next_.store(0, std::memory_order_release);
+}
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler() {
+    frameStartNs_ = nowNs();
+}
+
+uint16_t Profiler::threadId() {
+    static std::atomic<uint16_t> nextId{ 0 };
+    thread_local uint16_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+uint8_t& Profiler::threadDepth() {
+    thread_local uint8_t depth = 0;
+    return depth;
+}
+
+uint64_t Profiler::nowNs() const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - profilerEpoch()).count());
+}
+
+void Profiler::recordCpu(const char* name, uint64_t startNs, uint64_t endNs, uint8_t depth) {
+    ProfileEvent event;
+    event.name = name;
+    event.startNs = startNs;
+    event.durationNs = endNs - startNs;
+    event.frame = frame();
+    event.thread = threadId();
+    event.depth = depth;
+    event.gpu = false;
+    ring_.push(event);
+}
+
+void Profiler::beginFrame() {
+    uint64_t now = nowNs();
+    recordCpu("Frame", frameStartNs_, now, 0);
+    frameStartNs_ = now;
+    uint32_t frame = frame_.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    // The queries this frame is about to reuse were issued two frames ago
+    if (gpuEnabled_) {
+        for (auto& pass : gpuPasses_) {
+            collect(pass, frame & 1);
+        }
+    }
+}
+
+void Profiler::collect(GpuPass& pass, int buffer) {
+    if (!pass.pending[buffer]) {
+        return;
+    }
+    pass.pending[buffer] = false;
+
+    GLint available = 0;
+    glGetQueryObjectiv(pass.queries[buffer], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        // Waiting here would stall the pipeline the profiler is meant to observe
+        droppedGpuResults_++;
+        return;
+    }
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(pass.queries[buffer], GL_QUERY_RESULT, &elapsed);
+
+    ProfileEvent event;
+    event.name = pass.name;
+    event.startNs = pass.issuedNs[buffer];
+    event.durationNs = elapsed;
+    event.frame = pass.frame[buffer];
+    event.thread = 0;
+    event.depth = 0;
+    event.gpu = true;
+    ring_.push(event);
+}
+
+void Profiler::enableGpu() {
+    gpuEnabled_ = true;
+}
+
+int Profiler::beginGpuPass(const char* name) {
+    if (!gpuEnabled_ || activeGpuPass_ >= 0) {
+        return -1;
+    }
+
+    int index = 0;
+    while (index < static_cast<int>(gpuPasses_.size()) && gpuPasses_[index].name != name) {
+        index++;
+    }
+    if (index == static_cast<int>(gpuPasses_.size())) {
+        GpuPass pass;
+        pass.name = name;
+        glGenQueries(2, pass.queries);
+        gpuPasses_.push_back(pass);
+    }
+
+    GpuPass& pass = gpuPasses_[index];
+    int buffer = frame() & 1;
+    // Issued twice in one frame: keep the first
+    if (pass.pending[buffer]) {
+        return -1;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, pass.queries[buffer]);
+    pass.pending[buffer] = true;
+    pass.issuedNs[buffer] = nowNs();
+    pass.frame[buffer] = frame();
+    activeGpuPass_ = index;
+    return index;
+}
+
+void Profiler::endGpuPass(int pass) {
+    if (pass < 0) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    activeGpuPass_ = -1;
+}
+
+void Profiler::writeChromeTrace(const std::string& path) const {
+    std::vector<ProfileEvent> events;
+    ring_.snapshot(events);
+
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Failed to write profile trace: " << path << std::endl;
+        return;
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_TRACE_THREAD << ",\"args\":{\"name\":\"GPU\"}}";
+    std::set<uint16_t> threads;
+    out << std::fixed << std::setprecision(3);
+    for (const auto& event : events) {
+        int thread = event.gpu ? GPU_TRACE_THREAD : event.thread;
+        if (!event.gpu && threads.insert(event.thread).second) {
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+                << ",\"args\":{\"name\":\"" << (event.thread == 0 ? "Main" : "Worker " + std::to_string(event.thread)) << "\"}}";
+        }
+        out << ",\n{\"name\":";
+        writeJsonString(out, event.name);
+        out << ",\"cat\":\"" << (event.gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+            << ",\"ts\":" << event.startNs / 1000.0 << ",\"dur\":" << event.durationNs / 1000.0
+            << ",\"args\":{\"frame\":" << event.frame << "}}";
+    }
+    out << "\n]}\n";
+    std::cout << "Wrote " << events.size() << " profile events to " << path << std::endl;
+}
+
+void Profiler::printSummary(std::ostream& out) const {
+    std::vector<ProfileEvent> events;
+    ring_.snapshot(events);
+
+    // Time and calls per scope per frame; nested calls of the same scope count once each
+    struct FrameTotal {
+        double ms = 0.0;
+        unsigned int calls = 0;
+    };
+    std::map<std::pair<bool, std::string>, std::map<uint32_t, FrameTotal>> scopes;
+    for (const auto& event : events) {
+        FrameTotal& total = scopes[{ event.gpu, event.name }][event.frame];
+        total.ms += event.durationNs / 1e6;
+        total.calls++;
+    }
+
+    out << "Profile over " << events.size() << " events";
+    if (droppedGpuResults_ > 0) {
+        out << " (" << droppedGpuResults_ << " GPU results not ready in time)";
+    }
+    out << ", ms per frame:" << std::endl;
+    out << std::fixed << std::setprecision(3);
+    for (const auto& [key, frames] : scopes) {
+        std::vector<double> times;
+        unsigned long long calls = 0;
+        for (const auto& [frame, total] : frames) {
+            times.push_back(total.ms);
+            calls += total.calls;
+        }
+        std::sort(times.begin(), times.end());
+        out << "  " << (key.first ? "GPU " : "CPU ") << std::left << std::setw(28) << key.second << std::right
+            << " frames " << std::setw(6) << times.size()
+            << "  calls/frame " << std::setw(8) << static_cast<double>(calls) / times.size()
+            << "  p50 " << std::setw(8) << percentile(times, 0.50)
+            << "  p95 " << std::setw(8) << percentile(times, 0.95)
+            << "  p99 " << std::setw(8) << percentile(times, 0.99)
+            << "  max " << std::setw(8) << times.back() << std::endl;
+    }
+    out << std::defaultfloat;
+}
+
+void Profiler::clear() {
+    ring_.clear();
+    droppedGpuResults_ = 0;
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Frame profiler: nestable CPU scopes and GL_TIME_ELAPSED GPU passes, recorded into a lock-free
+// ring and exported as Chrome trace JSON (chrome://tracing, Perfetto) or per-scope percentiles.
+// Build with ENABLE_PROFILER=0 to compile every PROFILE_* macro out.
+#ifndef ENABLE_PROFILER
+#define ENABLE_PROFILER 1
+#endif
+
+#if ENABLE_PROFILER
+
+#include "GLDispatch.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct ProfileEvent {
+    const char* name;    // Must outlive the profiler; the macros pass string literals
+    uint64_t startNs;    // Since the profiler started; GPU passes use the CPU time they were issued
+    uint64_t durationNs;
+    uint32_t frame;
+    uint16_t thread;     // Small per-thread id in first-record order, so 0 is normally the main thread
+    uint8_t depth;       // Nesting level of CPU scopes on their thread
+    bool gpu;
+};
+
+// Fixed-capacity multi-producer ring: push() never blocks and overwrites the oldest events.
+// Each slot carries a sequence number, so a snapshot taken while other threads push skips
+// the slots being written instead of reading torn events.
+class ProfileRing {
+public:
+    static const size_t CAPACITY = size_t(1) << 16;
+
+    ProfileRing();
+
+    void push(const ProfileEvent& event);
+    // Appends the events still in the ring, oldest first
+    void snapshot(std::vector<ProfileEvent>& out) const;
+    void clear();
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence{ 0 }; // Odd while being written, 2 * (index + 1) once complete
+        ProfileEvent event;
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> next_{ 0 };
+};
+
+class Profiler {
+public:
+    static Profiler& instance();
+
+    // Closes the previous frame, recording it as a "Frame" event, and collects the GPU passes
+    // whose queries from two frames ago have completed
+    void beginFrame();
+    uint32_t frame() const { return frame_.load(std::memory_order_relaxed); }
+
+    uint64_t nowNs() const;
+    void recordCpu(const char* name, uint64_t startNs, uint64_t endNs, uint8_t depth);
+
+    // GPU passes need a GL context; without one (or before this call) they are ignored, so
+    // headless runs still get every CPU scope
+    void enableGpu();
+    // GL_TIME_ELAPSED queries cannot nest, so a pass begun inside another one is ignored.
+    // Returns the pass index to hand to endGpuPass, or -1.
+    int beginGpuPass(const char* name);
+    void endGpuPass(int pass);
+
+    void writeChromeTrace(const std::string& path) const;
+    // Per scope over the frames in the ring: calls per frame and p50/p95/p99/max of the time
+    // spent in it per frame
+    void printSummary(std::ostream& out) const;
+    void clear();
+
+    static uint16_t threadId();
+    static uint8_t& threadDepth();
+
+private:
+    Profiler();
+
+    struct GpuPass {
+        const char* name;
+        // Double-buffered by frame parity: a frame's query is read back when the pass is issued
+        // again two frames later, by which time the GPU has finished it
+        GLuint queries[2] = { 0, 0 };
+        bool pending[2] = { false, false };
+        uint64_t issuedNs[2] = { 0, 0 };
+        uint32_t frame[2] = { 0, 0 };
+    };
+
+    void collect(GpuPass& pass, int buffer);
+
+    ProfileRing ring_;
+    std::atomic<uint32_t> frame_{ 0 };
+    uint64_t frameStartNs_ = 0;
+    bool gpuEnabled_ = false;
+    int activeGpuPass_ = -1;
+    std::vector<GpuPass> gpuPasses_;
+    unsigned long long droppedGpuResults_ = 0;
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name)
+        : name_(name), depth_(Profiler::threadDepth()++), startNs_(Profiler::instance().nowNs()) {}
+    ~ProfileScope() {
+        Profiler::threadDepth()--;
+        Profiler::instance().recordCpu(name_, startNs_, Profiler::instance().nowNs(), depth_);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name_;
+    uint8_t depth_;
+    uint64_t startNs_;
+};
+
+class GpuProfileScope {
+public:
+    explicit GpuProfileScope(const char* name) : pass_(Profiler::instance().beginGpuPass(name)) {}
+    ~GpuProfileScope() { Profiler::instance().endGpuPass(pass_); }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    int pass_;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope PROFILE_CONCAT(gpuProfileScope_, __LINE__)(name)
+#define PROFILE_FRAME() Profiler::instance().beginFrame()
+#define PROFILE_ENABLE_GPU() Profiler::instance().enableGpu()
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_GPU_SCOPE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_ENABLE_GPU() ((void)0)
+
+#endif
+
+#endif
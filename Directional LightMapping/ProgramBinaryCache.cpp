@@ -0,0 +1,287 @@
+#include "ProgramBinaryCache.h"
+#include "Hash.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+const char* INDEX_HEADER = "program-binary-index";
+
+std::string glString(GLenum name) {
+    const GLubyte* value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+uint64_t DriverInfo::hash() const {
+    // Separators keep "ab" + "c" from hashing like "a" + "bc"
+    uint64_t hash = hashString(vendor);
+    hash = hashString("\n", hash);
+    hash = hashString(renderer, hash);
+    hash = hashString("\n", hash);
+    return hashString(version, hash);
+}
+
+DriverInfo DriverInfo::query() {
+    DriverInfo info;
+    info.vendor = glString(GL_VENDOR);
+    info.renderer = glString(GL_RENDERER);
+    info.version = glString(GL_VERSION);
+    return info;
+}
+
+uint64_t programBinaryKey(uint64_t sourceHash, const DriverInfo& driver) {
+    uint64_t driverHash = driver.hash();
+    return hashBytes(&driverHash, sizeof(driverHash), hashBytes(&sourceHash, sizeof(sourceHash)));
+}
+
+bool ProgramBinaryIndex::load(const std::string& path) {
+    entries_.clear();
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        return true;
+    }
+
+    std::string header;
+    uint32_t version = 0;
+    in >> header >> version;
+    if (header != INDEX_HEADER || version != VERSION) {
+        return false;
+    }
+
+    ProgramBinaryEntry entry;
+    in >> std::hex;
+    while (in >> entry.key >> entry.sourceHash >> entry.driverHash >> entry.binaryFormat >> entry.binarySize >> entry.binaryHash) {
+        entries_[entry.key] = entry;
+    }
+    if (!in.eof()) {
+        entries_.clear();
+        return false;
+    }
+    return true;
+}
+
+bool ProgramBinaryIndex::save(const std::string& path) const {
+    // Same temp-and-rename as the scene cache so a crash never leaves a half-written index
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        out << INDEX_HEADER << ' ' << VERSION << '\n' << std::hex;
+        for (const auto& [key, entry] : entries_) {
+            out << entry.key << ' ' << entry.sourceHash << ' ' << entry.driverHash << ' '
+                << entry.binaryFormat << ' ' << entry.binarySize << ' ' << entry.binaryHash << '\n';
+        }
+        if (!out) {
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    return !ec;
+}
+
+const ProgramBinaryEntry* ProgramBinaryIndex::find(uint64_t key) const {
+    auto it = entries_.find(key);
+    return it != entries_.end() ? &it->second : nullptr;
+}
+
+void ProgramBinaryIndex::insert(const ProgramBinaryEntry& entry) {
+    entries_[entry.key] = entry;
+}
+
+bool ProgramBinaryIndex::erase(uint64_t key) {
+    return entries_.erase(key) > 0;
+}
+
+std::vector<uint64_t> ProgramBinaryIndex::eraseOtherDrivers(uint64_t driverHash) {
+    std::vector<uint64_t> removed;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.driverHash != driverHash) {
+            removed.push_back(it->first);
+            it = entries_.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    return removed;
+}
+
+std::string programBinaryPath(const std::string& directory, uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(directory) / name).string();
+}
+
+bool writeProgramBinaryFile(const std::string& path, const std::vector<uint8_t>& binary) {
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+        if (!out) {
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    return !ec;
+}
+
+bool readProgramBinaryFile(const std::string& path, const ProgramBinaryEntry& entry, std::vector<uint8_t>& binary) {
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(path, ec);
+    if (ec || size != entry.binarySize) {
+        return false;
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    binary.resize(static_cast<size_t>(size));
+    if (!in.read(reinterpret_cast<char*>(binary.data()), binary.size())) {
+        return false;
+    }
+    return hashBytes(binary.data(), binary.size()) == entry.binaryHash;
+}
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string& directory)
+    : directory_(directory), indexPath_((std::filesystem::path(directory) / "index.txt").string()) {
+}
+
+void ProgramBinaryCache::open() {
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount <= 0) {
+        std::cout << "Program binary cache: driver supports no binary formats, disabled" << std::endl;
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+    if (ec) {
+        std::cerr << "Program binary cache: cannot create " << directory_ << ": " << ec.message() << std::endl;
+        return;
+    }
+
+    driver_ = DriverInfo::query();
+    driverHash_ = driver_.hash();
+    if (!index_.load(indexPath_)) {
+        std::cerr << "Program binary cache: discarding unreadable index " << indexPath_ << std::endl;
+    }
+
+    std::vector<uint64_t> stale = index_.eraseOtherDrivers(driverHash_);
+    for (uint64_t key : stale) {
+        std::filesystem::remove(programBinaryPath(directory_, key), ec);
+    }
+    if (!stale.empty()) {
+        std::cout << "Program binary cache: dropped " << stale.size() << " binaries from another driver" << std::endl;
+        index_.save(indexPath_);
+    }
+    enabled_ = true;
+}
+
+GLuint ProgramBinaryCache::load(uint64_t sourceHash) {
+    if (!enabled_) {
+        return 0;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t key = programBinaryKey(sourceHash, driver_);
+    const ProgramBinaryEntry* entry = index_.find(key);
+    std::vector<uint8_t> binary;
+    if (!entry) {
+        misses_++;
+        return 0;
+    }
+    if (!readProgramBinaryFile(programBinaryPath(directory_, key), *entry, binary)) {
+        forget(key);
+        misses_++;
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, entry->binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+
+    // Drivers may reject a binary at any time, e.g. after an update that kept the version string
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(program);
+        forget(key);
+        rejects_++;
+        return 0;
+    }
+
+    loads_++;
+    loadMs_ += millisecondsSince(start);
+    return program;
+}
+
+void ProgramBinaryCache::store(uint64_t sourceHash, GLuint program) {
+    if (!enabled_) {
+        return;
+    }
+
+    GLint linked = 0;
+    GLint length = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!linked || length <= 0) {
+        return;
+    }
+
+    std::vector<uint8_t> binary(static_cast<size_t>(length));
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    binary.resize(static_cast<size_t>(written));
+
+    ProgramBinaryEntry entry;
+    entry.key = programBinaryKey(sourceHash, driver_);
+    entry.sourceHash = sourceHash;
+    entry.driverHash = driverHash_;
+    entry.binaryFormat = format;
+    entry.binarySize = binary.size();
+    entry.binaryHash = hashBytes(binary.data(), binary.size());
+
+    if (!writeProgramBinaryFile(programBinaryPath(directory_, entry.key), binary)) {
+        std::cerr << "Program binary cache: cannot write binary to " << directory_ << std::endl;
+        return;
+    }
+    index_.insert(entry);
+    if (!index_.save(indexPath_)) {
+        std::cerr << "Program binary cache: cannot write " << indexPath_ << std::endl;
+    }
+    stores_++;
+}
+
+void ProgramBinaryCache::forget(uint64_t key) {
+    std::error_code ec;
+    std::filesystem::remove(programBinaryPath(directory_, key), ec);
+    index_.erase(key);
+    index_.save(indexPath_);
+}
+
+void ProgramBinaryCache::printStats(std::ostream& out) const {
+    if (!enabled_) {
+        return;
+    }
+    out << "Program binaries: " << loads_ << " loaded in " << loadMs_ << " ms, "
+        << misses_ << " missed, " << rejects_ << " rejected by the driver, "
+        << stores_ << " stored (" << index_.size() << " cached for " << driver_.renderer << ")" << std::endl;
+}
@@ -0,0 +1,104 @@
+#ifndef PROGRAM_BINARY_CACHE_H
+#define PROGRAM_BINARY_CACHE_H
+
+#include "GLDispatch.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Driver identity a program binary is only valid for. A driver update changes the version string,
+// which changes every key, so stale binaries are never offered to the new driver.
+struct DriverInfo {
+    std::string vendor;
+    std::string renderer;
+    std::string version;
+
+    uint64_t hash() const;
+
+    // GL_VENDOR, GL_RENDERER and GL_VERSION of the current context
+    static DriverInfo query();
+};
+
+// Cache key of a program: the preprocessed source hash combined with the driver hash
+uint64_t programBinaryKey(uint64_t sourceHash, const DriverInfo& driver);
+
+// One cached binary as recorded in the index file
+struct ProgramBinaryEntry {
+    uint64_t key = 0;
+    uint64_t sourceHash = 0;
+    uint64_t driverHash = 0;
+    uint32_t binaryFormat = 0;
+    uint64_t binarySize = 0;
+    uint64_t binaryHash = 0; // Catches truncated or corrupted blob files
+};
+
+// Text index of the binaries in a cache directory, one entry per line. Needs no GL context.
+class ProgramBinaryIndex {
+public:
+    static const uint32_t VERSION = 1;
+
+    // A missing file is an empty index; a file with another version or a bad line is discarded whole
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    const ProgramBinaryEntry* find(uint64_t key) const;
+    void insert(const ProgramBinaryEntry& entry);
+    bool erase(uint64_t key);
+
+    // Drops entries written by any other driver and returns their keys so the blobs can be deleted
+    std::vector<uint64_t> eraseOtherDrivers(uint64_t driverHash);
+
+    size_t size() const { return entries_.size(); }
+
+private:
+    std::unordered_map<uint64_t, ProgramBinaryEntry> entries_;
+};
+
+// "<directory>/<key as 16 hex digits>.bin"
+std::string programBinaryPath(const std::string& directory, uint64_t key);
+
+// Raw blob IO; reading fails when the size or hash does not match the index entry
+bool writeProgramBinaryFile(const std::string& path, const std::vector<uint8_t>& binary);
+bool readProgramBinaryFile(const std::string& path, const ProgramBinaryEntry& entry, std::vector<uint8_t>& binary);
+
+// Linked program binaries from glGetProgramBinary, kept on disk between runs. A hit skips
+// compiling and linking; a miss or a binary the driver rejects falls back to a full compile.
+class ProgramBinaryCache {
+public:
+    explicit ProgramBinaryCache(const std::string& directory);
+
+    // Reads the index and drops binaries of other drivers. Requires a GL context; the cache
+    // stays disabled if the driver supports no binary formats.
+    void open();
+    bool enabled() const { return enabled_; }
+
+    // Linked program, or 0 on a miss or when the driver rejects the binary
+    GLuint load(uint64_t sourceHash);
+
+    // Saves the binary of a freshly linked program
+    void store(uint64_t sourceHash, GLuint program);
+
+    unsigned int loads() const { return loads_; }
+    unsigned int misses() const { return misses_; }
+    unsigned int rejects() const { return rejects_; }
+    void printStats(std::ostream& out) const;
+
+private:
+    void forget(uint64_t key);
+
+    std::string directory_;
+    std::string indexPath_;
+    DriverInfo driver_;
+    uint64_t driverHash_ = 0;
+    ProgramBinaryIndex index_;
+    bool enabled_ = false;
+    unsigned int loads_ = 0;
+    unsigned int misses_ = 0;
+    unsigned int rejects_ = 0;
+    unsigned int stores_ = 0;
+    double loadMs_ = 0.0;
+};
+
+#endif
@@ -0,0 +1,438 @@
+#include "RayTracer.h"
+#include "Culling.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RAY_TRACER_SSE 1
+#include <emmintrin.h>
+#else
+#define RAY_TRACER_SSE 0
+#endif
+
+struct RayTracer::BinaryNode {
+    AABB bounds;
+    uint32_t left = 0;  // Children of inner nodes
+    uint32_t right = 0;
+    uint32_t begin = 0; // Triangles of leaves are order[begin, begin + count)
+    uint32_t count = 0;
+
+    bool isLeaf() const { return count > 0; }
+};
+
+struct RayTracer::Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+    glm::vec3 inverseDirection;
+    int nearBound[3]; // Rows of Node::bounds the ray enters and leaves each slab through
+    int farBound[3];
+    float maxDistance;
+};
+
+namespace {
+
+const int SAH_BINS = 16;
+// Deeper ranges are split at the median, which keeps the tree depth and the traversal stack bounded
+const int MAX_SAH_DEPTH = 40;
+const int STACK_SIZE = 256;
+const float MIN_DIRECTION = 1e-12f;
+const float MIN_DETERMINANT = 1e-12f;
+
+float surfaceArea(const AABB& box) {
+    if (box.isEmpty()) {
+        return 0.0f;
+    }
+    glm::vec3 size = box.max - box.min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+} // namespace
+
+uint32_t RayTracer::buildBinary(std::vector<BinaryNode>& nodes, std::vector<uint32_t>& order, const std::vector<AABB>& bounds,
+    const std::vector<glm::vec3>& centroids, uint32_t begin, uint32_t end, int depth) {
+    uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+
+    AABB box;
+    AABB centroidBox;
+    for (uint32_t i = begin; i < end; i++) {
+        box.expand(bounds[order[i]]);
+        centroidBox.expand(centroids[order[i]]);
+    }
+    nodes[index].bounds = box;
+
+    uint32_t count = end - begin;
+    if (count <= LEAF_SIZE) {
+        nodes[index].begin = begin;
+        nodes[index].count = count;
+        return index;
+    }
+
+    glm::vec3 extent = centroidBox.max - centroidBox.min;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    uint32_t mid = begin + count / 2;
+
+    if (extent[axis] <= 0.0f) {
+        // Coincident centroids: every split is as good as another
+    }
+    else if (depth >= MAX_SAH_DEPTH) {
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+            [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+    }
+    else {
+        // Binned SAH: equal-width bins over the centroid range, split at the cheapest bin boundary
+        float scale = SAH_BINS / extent[axis];
+        auto binOf = [&](uint32_t triangle) {
+            return std::min(SAH_BINS - 1, static_cast<int>((centroids[triangle][axis] - centroidBox.min[axis]) * scale));
+        };
+
+        AABB binBounds[SAH_BINS];
+        uint32_t binCounts[SAH_BINS] = {};
+        for (uint32_t i = begin; i < end; i++) {
+            int bin = binOf(order[i]);
+            binCounts[bin]++;
+            binBounds[bin].expand(bounds[order[i]]);
+        }
+
+        float rightCost[SAH_BINS] = {};
+        AABB right;
+        uint32_t rightCount = 0;
+        for (int bin = SAH_BINS - 1; bin > 0; bin--) {
+            right.expand(binBounds[bin]);
+            rightCount += binCounts[bin];
+            rightCost[bin] = surfaceArea(right) * rightCount;
+        }
+
+        float bestCost = std::numeric_limits<float>::max();
+        int bestSplit = 0;
+        AABB left;
+        uint32_t leftCount = 0;
+        for (int bin = 1; bin < SAH_BINS; bin++) {
+            left.expand(binBounds[bin - 1]);
+            leftCount += binCounts[bin - 1];
+            if (leftCount == 0 || leftCount == count) {
+                continue;
+            }
+            float cost = surfaceArea(left) * leftCount + rightCost[bin];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestSplit = bin;
+            }
+        }
+
+        if (bestSplit > 0) {
+            auto split = std::partition(order.begin() + begin, order.begin() + end,
+                [&](uint32_t triangle) { return binOf(triangle) < bestSplit; });
+            mid = static_cast<uint32_t>(split - order.begin());
+        }
+    }
+
+    uint32_t leftChild = buildBinary(nodes, order, bounds, centroids, begin, mid, depth + 1);
+    uint32_t rightChild = buildBinary(nodes, order, bounds, centroids, mid, end, depth + 1);
+    nodes[index].left = leftChild;
+    nodes[index].right = rightChild;
+    return index;
+}
+
+uint32_t RayTracer::collapse(const std::vector<BinaryNode>& binary, uint32_t index, const std::vector<uint32_t>& order,
+    const std::vector<glm::vec3>& corners) {
+    const BinaryNode& node = binary[index];
+    if (node.isLeaf()) {
+        TrianglePack pack = {};
+        for (uint32_t lane = 0; lane < 4; lane++) {
+            pack.triangles[lane] = EMPTY_CHILD;
+        }
+        for (uint32_t lane = 0; lane < node.count; lane++) {
+            uint32_t triangle = order[node.begin + lane];
+            glm::vec3 v0 = corners[triangle * 3];
+            glm::vec3 edge1 = corners[triangle * 3 + 1] - v0;
+            glm::vec3 edge2 = corners[triangle * 3 + 2] - v0;
+            for (int axis = 0; axis < 3; axis++) {
+                pack.v0[axis][lane] = v0[axis];
+                pack.edge1[axis][lane] = edge1[axis];
+                pack.edge2[axis][lane] = edge2[axis];
+            }
+            pack.triangles[lane] = triangle;
+        }
+        packs_.push_back(pack);
+        return LEAF_FLAG | static_cast<uint32_t>(packs_.size() - 1);
+    }
+
+    // Open the inner child with the largest surface area until there are four children
+    uint32_t children[4] = { node.left, node.right };
+    uint32_t childCount = 2;
+    while (childCount < 4) {
+        int largest = -1;
+        float largestArea = -1.0f;
+        for (uint32_t i = 0; i < childCount; i++) {
+            const BinaryNode& child = binary[children[i]];
+            float area = surfaceArea(child.bounds);
+            if (!child.isLeaf() && area > largestArea) {
+                largest = i;
+                largestArea = area;
+            }
+        }
+        if (largest < 0) {
+            break;
+        }
+        const BinaryNode& opened = binary[children[largest]];
+        children[largest] = opened.left;
+        children[childCount++] = opened.right;
+    }
+
+    uint32_t nodeIndex = static_cast<uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+    for (uint32_t lane = 0; lane < 4; lane++) {
+        AABB box; // Empty: inverted, so no ray enters it
+        uint32_t child = EMPTY_CHILD;
+        if (lane < childCount) {
+            box = binary[children[lane]].bounds;
+            child = collapse(binary, children[lane], order, corners);
+        }
+
+        // The recursion may have reallocated nodes_
+        Node& out = nodes_[nodeIndex];
+        for (int axis = 0; axis < 3; axis++) {
+            out.bounds[axis][lane] = box.min[axis];
+            out.bounds[axis + 3][lane] = box.max[axis];
+        }
+        out.children[lane] = child;
+    }
+    return nodeIndex;
+}
+
+void RayTracer::build(const std::vector<glm::vec3>& corners) {
+    nodes_.clear();
+    packs_.clear();
+    root_ = EMPTY_CHILD;
+    triangleCount_ = corners.size() / 3;
+    if (triangleCount_ == 0) {
+        return;
+    }
+
+    std::vector<AABB> bounds(triangleCount_);
+    std::vector<glm::vec3> centroids(triangleCount_);
+    std::vector<uint32_t> order(triangleCount_);
+    for (size_t triangle = 0; triangle < triangleCount_; triangle++) {
+        for (int corner = 0; corner < 3; corner++) {
+            bounds[triangle].expand(corners[triangle * 3 + corner]);
+        }
+        centroids[triangle] = bounds[triangle].center();
+        order[triangle] = static_cast<uint32_t>(triangle);
+    }
+
+    std::vector<BinaryNode> binary;
+    binary.reserve(triangleCount_ * 2 / LEAF_SIZE + 1);
+    buildBinary(binary, order, bounds, centroids, 0, static_cast<uint32_t>(triangleCount_), 0);
+
+    nodes_.reserve(binary.size() / 3 + 1);
+    packs_.reserve(binary.size() / 2 + 1);
+    root_ = collapse(binary, 0, order, corners);
+}
+
+int RayTracer::intersectNode(const Ray& ray, const Node& node, float maxDistance, float distances[4]) {
+#if RAY_TRACER_SSE
+    __m128 enter = _mm_setzero_ps();
+    __m128 exit = _mm_set1_ps(maxDistance);
+    for (int axis = 0; axis < 3; axis++) {
+        __m128 origin = _mm_set1_ps(ray.origin[axis]);
+        __m128 inverse = _mm_set1_ps(ray.inverseDirection[axis]);
+        enter = _mm_max_ps(enter, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[ray.nearBound[axis]]), origin), inverse));
+        exit = _mm_min_ps(exit, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[ray.farBound[axis]]), origin), inverse));
+    }
+    _mm_storeu_ps(distances, enter);
+    return _mm_movemask_ps(_mm_cmple_ps(enter, exit));
+#else
+    int mask = 0;
+    for (int lane = 0; lane < 4; lane++) {
+        float enter = 0.0f;
+        float exit = maxDistance;
+        for (int axis = 0; axis < 3; axis++) {
+            enter = std::max(enter, (node.bounds[ray.nearBound[axis]][lane] - ray.origin[axis]) * ray.inverseDirection[axis]);
+            exit = std::min(exit, (node.bounds[ray.farBound[axis]][lane] - ray.origin[axis]) * ray.inverseDirection[axis]);
+        }
+        distances[lane] = enter;
+        mask |= enter <= exit ? 1 << lane : 0;
+    }
+    return mask;
+#endif
+}
+
+int RayTracer::intersectPack(const Ray& ray, const TrianglePack& pack, float maxDistance, float distances[4], float u[4], float v[4]) {
+    // Moller-Trumbore on four triangles at once
+#if RAY_TRACER_SSE
+    __m128 dx = _mm_set1_ps(ray.direction.x);
+    __m128 dy = _mm_set1_ps(ray.direction.y);
+    __m128 dz = _mm_set1_ps(ray.direction.z);
+    __m128 e1x = _mm_load_ps(pack.edge1[0]);
+    __m128 e1y = _mm_load_ps(pack.edge1[1]);
+    __m128 e1z = _mm_load_ps(pack.edge1[2]);
+    __m128 e2x = _mm_load_ps(pack.edge2[0]);
+    __m128 e2y = _mm_load_ps(pack.edge2[1]);
+    __m128 e2z = _mm_load_ps(pack.edge2[2]);
+
+    // p = direction x edge2
+    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+    __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    __m128 inverse = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+
+    // s = origin - v0, q = s x edge1
+    __m128 sx = _mm_sub_ps(_mm_set1_ps(ray.origin.x), _mm_load_ps(pack.v0[0]));
+    __m128 sy = _mm_sub_ps(_mm_set1_ps(ray.origin.y), _mm_load_ps(pack.v0[1]));
+    __m128 sz = _mm_sub_ps(_mm_set1_ps(ray.origin.z), _mm_load_ps(pack.v0[2]));
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+
+    __m128 bu = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverse);
+    __m128 bv = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverse);
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverse);
+
+    __m128 absDeterminant = _mm_andnot_ps(_mm_set1_ps(-0.0f), determinant);
+    __m128 hit = _mm_cmpgt_ps(absDeterminant, _mm_set1_ps(MIN_DETERMINANT));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(bu, _mm_setzero_ps()));
+    hit = _mm_and_ps(hit, _mm_cmpge_ps(bv, _mm_setzero_ps()));
+    hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(bu, bv), _mm_set1_ps(1.0f)));
+    hit = _mm_and_ps(hit, _mm_cmpgt_ps(t, _mm_setzero_ps()));
+    hit = _mm_and_ps(hit, _mm_cmplt_ps(t, _mm_set1_ps(maxDistance)));
+
+    _mm_storeu_ps(distances, t);
+    _mm_storeu_ps(u, bu);
+    _mm_storeu_ps(v, bv);
+    return _mm_movemask_ps(hit);
+#else
+    int mask = 0;
+    for (int lane = 0; lane < 4; lane++) {
+        glm::vec3 edge1(pack.edge1[0][lane], pack.edge1[1][lane], pack.edge1[2][lane]);
+        glm::vec3 edge2(pack.edge2[0][lane], pack.edge2[1][lane], pack.edge2[2][lane]);
+        glm::vec3 p = glm::cross(ray.direction, edge2);
+        float determinant = glm::dot(edge1, p);
+        if (std::abs(determinant) <= MIN_DETERMINANT) {
+            continue;
+        }
+        float inverse = 1.0f / determinant;
+        glm::vec3 s = ray.origin - glm::vec3(pack.v0[0][lane], pack.v0[1][lane], pack.v0[2][lane]);
+        glm::vec3 q = glm::cross(s, edge1);
+        u[lane] = glm::dot(s, p) * inverse;
+        v[lane] = glm::dot(ray.direction, q) * inverse;
+        distances[lane] = glm::dot(edge2, q) * inverse;
+        if (u[lane] >= 0.0f && v[lane] >= 0.0f && u[lane] + v[lane] <= 1.0f && distances[lane] > 0.0f && distances[lane] < maxDistance) {
+            mask |= 1 << lane;
+        }
+    }
+    return mask;
+#endif
+}
+
+template <bool AnyHit>
+bool RayTracer::traverse(const Ray& ray, RayHit* hit) const {
+    if (root_ == EMPTY_CHILD) {
+        return false;
+    }
+
+    struct Entry {
+        uint32_t child;
+        float distance; // Where the ray enters it, to skip it once something closer was hit
+    };
+    Entry stack[STACK_SIZE];
+    int top = 0;
+    stack[top++] = { root_, 0.0f };
+
+    float maxDistance = ray.maxDistance;
+    bool found = false;
+    while (top > 0) {
+        Entry entry = stack[--top];
+        if (entry.distance >= maxDistance) {
+            continue;
+        }
+
+        float distances[4];
+        if (entry.child & LEAF_FLAG) {
+            const TrianglePack& pack = packs_[entry.child & ~LEAF_FLAG];
+            float u[4], v[4];
+            int mask = intersectPack(ray, pack, maxDistance, distances, u, v);
+            if (mask == 0) {
+                continue;
+            }
+            if (AnyHit) {
+                if (hit) {
+                    int lane = 0;
+                    while (!(mask & (1 << lane))) {
+                        lane++;
+                    }
+                    hit->distance = distances[lane];
+                    hit->triangle = pack.triangles[lane];
+                    hit->u = u[lane];
+                    hit->v = v[lane];
+                }
+                return true;
+            }
+            for (int lane = 0; lane < 4; lane++) {
+                if ((mask & (1 << lane)) && distances[lane] < maxDistance) {
+                    maxDistance = distances[lane];
+                    hit->distance = distances[lane];
+                    hit->triangle = pack.triangles[lane];
+                    hit->u = u[lane];
+                    hit->v = v[lane];
+                    found = true;
+                }
+            }
+            continue;
+        }
+
+        const Node& node = nodes_[entry.child];
+        int mask = intersectNode(ray, node, maxDistance, distances);
+
+        // Push the farthest child first so the nearest one is visited next
+        int lanes[4];
+        int count = 0;
+        for (int lane = 0; lane < 4; lane++) {
+            if (!(mask & (1 << lane))) {
+                continue;
+            }
+            int i = count++;
+            while (i > 0 && distances[lanes[i - 1]] < distances[lane]) {
+                lanes[i] = lanes[i - 1];
+                i--;
+            }
+            lanes[i] = lane;
+        }
+        for (int i = 0; i < count; i++) {
+            stack[top++] = { node.children[lanes[i]], distances[lanes[i]] };
+        }
+    }
+    return found;
+}
+
+namespace {
+
+template <typename Ray>
+void setupRay(Ray& ray, const glm::vec3& origin, const glm::vec3& direction, float maxDistance) {
+    ray.origin = origin;
+    ray.direction = direction;
+    for (int axis = 0; axis < 3; axis++) {
+        // Keeps the slab distances finite for axis-parallel rays
+        float d = std::abs(direction[axis]) < MIN_DIRECTION ? std::copysign(MIN_DIRECTION, direction[axis]) : direction[axis];
+        ray.inverseDirection[axis] = 1.0f / d;
+        ray.nearBound[axis] = d < 0.0f ? axis + 3 : axis;
+        ray.farBound[axis] = d < 0.0f ? axis : axis + 3;
+    }
+    ray.maxDistance = maxDistance;
+}
+
+} // namespace
+
+bool RayTracer::intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit) const {
+    Ray ray;
+    setupRay(ray, origin, direction, maxDistance);
+    return traverse<false>(ray, &hit);
+}
+
+bool RayTracer::occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit* hit) const {
+    Ray ray;
+    setupRay(ray, origin, direction, maxDistance);
+    return traverse<true>(ray, hit);
+}
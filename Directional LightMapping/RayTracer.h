@@ -0,0 +1,80 @@
+#ifndef RAY_TRACER_H
+#define RAY_TRACER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct AABB;
+
+struct RayHit {
+    float distance = 0.0f;
+    uint32_t triangle = 0; // Index of the triangle in the order it was passed to build()
+    float u = 0.0f;        // Barycentric weights of the second and third corner
+    float v = 0.0f;
+};
+
+// Four-wide BVH over triangles for CPU ray queries. Each node holds the bounds of up to four
+// children and each leaf up to four triangles, both as structures of arrays, so one SSE
+// instruction tests a ray against all four (plain loops where SSE is unavailable). Built
+// top-down with a binned SAH into a binary tree, which is then collapsed into four-wide nodes.
+// Queries are read-only and safe from any number of threads.
+class RayTracer {
+public:
+    static const uint32_t LEAF_SIZE = 4;
+
+    // Three corners per triangle; triangles facing either way are hit
+    void build(const std::vector<glm::vec3>& corners);
+
+    // Closest hit with a distance in (0, maxDistance)
+    bool intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit) const;
+
+    // Whether anything is hit in (0, maxDistance); stops at the first hit, for shadow and sky rays.
+    // The hit, if given, receives that first hit, which need not be the closest.
+    bool occluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit* hit = nullptr) const;
+
+    size_t triangleCount() const { return triangleCount_; }
+    size_t nodeCount() const { return nodes_.size(); }
+
+private:
+    // Children are node indices, LEAF_FLAG | pack index, or EMPTY_CHILD for unused lanes,
+    // which get inverted bounds so no ray hits them
+    static const uint32_t LEAF_FLAG = 0x80000000u;
+    static const uint32_t EMPTY_CHILD = 0xFFFFFFFFu;
+
+    struct alignas(16) Node {
+        float bounds[6][4]; // minX, minY, minZ, maxX, maxY, maxZ of each child
+        uint32_t children[4];
+    };
+
+    // Unused lanes have zero edges, which never pass the determinant test
+    struct alignas(16) TrianglePack {
+        float v0[3][4];
+        float edge1[3][4];
+        float edge2[3][4];
+        uint32_t triangles[4];
+    };
+
+    struct BinaryNode;
+    struct Ray;
+
+    static uint32_t buildBinary(std::vector<BinaryNode>& nodes, std::vector<uint32_t>& order, const std::vector<AABB>& bounds,
+        const std::vector<glm::vec3>& centroids, uint32_t begin, uint32_t end, int depth);
+    uint32_t collapse(const std::vector<BinaryNode>& binary, uint32_t index, const std::vector<uint32_t>& order,
+        const std::vector<glm::vec3>& corners);
+
+    // Bit i of the result is set when the ray hits child or triangle i within maxDistance
+    static int intersectNode(const Ray& ray, const Node& node, float maxDistance, float distances[4]);
+    static int intersectPack(const Ray& ray, const TrianglePack& pack, float maxDistance, float distances[4], float u[4], float v[4]);
+
+    template <bool AnyHit>
+    bool traverse(const Ray& ray, RayHit* hit) const;
+
+    std::vector<Node> nodes_;
+    std::vector<TrianglePack> packs_;
+    uint32_t root_ = EMPTY_CHILD;
+    size_t triangleCount_ = 0;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include "RenderQueue.h"
+#include "GLStats.h"
+#include "Material.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+
+uint64_t RenderQueue::makeSortKey(const Material& material, GLuint vao, float viewDepth, uint32_t meshIndex) {
+    if (material.blendingEnabled) {
+        // Non-negative floats order like their bit patterns, which fit in 31 bits; inverted so the farthest draw comes first
+        float depth = viewDepth > 0.0f ? viewDepth : 0.0f;
+        uint32_t depthBits;
+        std::memcpy(&depthBits, &depth, sizeof(depthBits));
+        return (uint64_t(1) << 63) | (uint64_t(0x7FFFFFFFu - depthBits) << 32) | meshIndex;
+    }
+
+    // Materials in one material-table draw group sort together, apart from the texture sets
+    uint64_t textureKey = material.drawGroupId != 0 ? (0x8000 | (material.drawGroupId & 0x7FFF)) : (material.textureSetId & 0x7FFF);
+    return (uint64_t(material.shaderProgram & 0x7FFF) << 48) |
+        (textureKey << 32) |
+        uint64_t(vao);
+}
+
+void RenderQueue::clear() {
+    items_.clear();
+}
+
+void RenderQueue::submit(const Material& material, GLuint vao, GLsizei indexCount, const glm::mat4* model,
+    float viewDepth, uint32_t meshIndex) {
+    DrawItem item;
+    item.sortKey = makeSortKey(material, vao, viewDepth, meshIndex);
+    item.material = &material;
+    item.vao = vao;
+    item.indexCount = indexCount;
+    item.hasModel = model != nullptr;
+    item.model = model ? *model : glm::mat4(1.0f);
+    items_.push_back(item);
+}
+
+void RenderQueue::sort() {
+    std::sort(items_.begin(), items_.end(), [](const DrawItem& a, const DrawItem& b) {
+        return a.sortKey < b.sortKey;
+    });
+}
+
+void RenderQueue::execute(const FrameConstants& frame, GLStateTracker& state) const {
+    PROFILE_SCOPE("RenderQueue::execute");
+    for (const auto& item : items_) {
+        item.material->apply(item.hasModel ? &item.model : nullptr, frame, state);
+
+        state.bindVertexArray(item.vao);
+        glDrawElements(GL_TRIANGLES, item.indexCount, GL_UNSIGNED_INT, 0);
+        glCallStats.drawCalls++;
+    }
+}
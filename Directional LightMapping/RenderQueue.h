@@ -0,0 +1,48 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "GLDispatch.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "FrameConstants.h"
+#include "GLStateTracker.h"
+
+class Material;
+
+struct DrawItem {
+    uint64_t sortKey;
+    const Material* material;
+    GLuint vao;
+    GLsizei indexCount;
+    bool hasModel; // False for world-space geometry
+    glm::mat4 model;
+};
+
+// Collects the frame's draws and submits them sorted to minimise state changes.
+// Opaque draws are ordered by program, texture set and VAO; blended draws go last,
+// back to front by view depth, with the mesh index keeping equal depths in scene order
+// however culling visited them.
+//
+// Sort key layout:
+//   opaque:  [63] 0 | [62..48] program | [47..32] texture set, or 0x8000 | material-table draw group | [31..0] VAO
+//   blended: [63] 1 | [62..32] inverted view depth | [31..0] mesh index
+class RenderQueue {
+public:
+    void clear();
+    // A null model matrix marks the geometry as already in world space.
+    // viewDepth and meshIndex only order blended draws.
+    void submit(const Material& material, GLuint vao, GLsizei indexCount, const glm::mat4* model,
+        float viewDepth, uint32_t meshIndex);
+    void sort();
+    void execute(const FrameConstants& frame, GLStateTracker& state) const;
+
+    size_t size() const { return items_.size(); }
+
+    static uint64_t makeSortKey(const Material& material, GLuint vao, float viewDepth, uint32_t meshIndex);
+
+private:
+    std::vector<DrawItem> items_;
+};
+
+#endif
@@ -0,0 +1,209 @@
+#include "SceneCache.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char SCENE_CACHE_MAGIC[4] = { 'D', 'L', 'M', 'C' };
+const uint64_t SECTION_ALIGNMENT = 16;
+
+uint64_t alignOffset(uint64_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+void writePadding(std::ofstream& out, uint64_t from, uint64_t to) {
+    static const char zeros[SECTION_ALIGNMENT] = {};
+    out.write(zeros, static_cast<std::streamsize>(to - from));
+}
+
+// Divides instead of multiplying so a corrupt count cannot wrap the end offset back inside the file
+bool sectionFits(uint64_t offset, uint64_t count, uint64_t stride, uint64_t fileSize) {
+    return offset <= fileSize && count <= (fileSize - offset) / stride;
+}
+
+} // namespace
+
+void BakedScene::reserve(size_t vertexCount, size_t indexCount, size_t meshCount) {
+    vertices.reserve(vertexCount);
+    indices.reserve(indexCount);
+    meshes.reserve(meshCount);
+}
+
+BakedMeshRange BakedScene::appendMesh(size_t vertexCount, size_t indexCount, const std::string& materialName) {
+    BakedMeshRange range;
+    range.firstVertex = static_cast<uint32_t>(vertices.size());
+    range.vertexCount = static_cast<uint32_t>(vertexCount);
+    range.firstIndex = static_cast<uint32_t>(indices.size());
+    range.indexCount = static_cast<uint32_t>(indexCount);
+    range.materialNameOffset = static_cast<uint32_t>(stringTable.size());
+    range.materialNameLength = static_cast<uint32_t>(materialName.size());
+
+    vertices.resize(vertices.size() + vertexCount);
+    indices.resize(indices.size() + indexCount);
+    stringTable += materialName;
+    meshes.push_back(range);
+    return range;
+}
+
+void BakedScene::shrinkMeshes(const std::vector<uint32_t>& vertexCounts) {
+    uint32_t nextVertex = 0;
+    for (size_t i = 0; i < meshes.size(); i++) {
+        BakedMeshRange& range = meshes[i];
+        uint32_t count = std::min(vertexCounts[i], range.vertexCount);
+        if (range.firstVertex != nextVertex) {
+            // Indices are relative to firstVertex, so only the vertices move
+            std::copy(vertices.begin() + range.firstVertex, vertices.begin() + range.firstVertex + count,
+                vertices.begin() + nextVertex);
+        }
+        range.firstVertex = nextVertex;
+        range.vertexCount = count;
+        nextVertex += count;
+    }
+    vertices.resize(nextVertex);
+}
+
+std::string SceneCache::cachePathFor(const std::string& sourcePath) {
+    return sourcePath + ".meshcache";
+}
+
+bool SceneCache::write(const std::string& sourcePath, uint64_t importSettingsHash, const BakedScene& scene, double coldImportMs) {
+    SourceFingerprint fingerprint;
+    if (!fingerprintSource(sourcePath, fingerprint)) {
+        std::cerr << "Scene cache: cannot fingerprint source " << sourcePath << std::endl;
+        return false;
+    }
+
+    SceneCacheHeader header = {};
+    std::memcpy(header.magic, SCENE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.vertexStride = sizeof(Vertex);
+    header.importSettingsHash = importSettingsHash;
+    header.sourceHash = fingerprint.hash;
+    header.sourceModifiedTime = fingerprint.modifiedTime;
+    header.sourceSize = fingerprint.size;
+    header.coldImportMs = coldImportMs;
+    header.meshCount = scene.meshes.size();
+    header.vertexCount = scene.vertices.size();
+    header.indexCount = scene.indices.size();
+    header.stringTableSize = scene.stringTable.size();
+    header.meshesOffset = alignOffset(sizeof(SceneCacheHeader));
+    header.verticesOffset = alignOffset(header.meshesOffset + header.meshCount * sizeof(BakedMeshRange));
+    header.indicesOffset = alignOffset(header.verticesOffset + header.vertexCount * sizeof(Vertex));
+    header.stringTableOffset = alignOffset(header.indicesOffset + header.indexCount * sizeof(unsigned int));
+
+    // Write to a temporary file first so an interrupted bake never leaves a truncated cache behind
+    std::string cachePath = cachePathFor(sourcePath);
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Scene cache: cannot write " << tempPath << std::endl;
+            return false;
+        }
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writePadding(out, sizeof(header), header.meshesOffset);
+        out.write(reinterpret_cast<const char*>(scene.meshes.data()), header.meshCount * sizeof(BakedMeshRange));
+        writePadding(out, header.meshesOffset + header.meshCount * sizeof(BakedMeshRange), header.verticesOffset);
+        out.write(reinterpret_cast<const char*>(scene.vertices.data()), header.vertexCount * sizeof(Vertex));
+        writePadding(out, header.verticesOffset + header.vertexCount * sizeof(Vertex), header.indicesOffset);
+        out.write(reinterpret_cast<const char*>(scene.indices.data()), header.indexCount * sizeof(unsigned int));
+        writePadding(out, header.indicesOffset + header.indexCount * sizeof(unsigned int), header.stringTableOffset);
+        out.write(scene.stringTable.data(), header.stringTableSize);
+
+        if (!out) {
+            std::cerr << "Scene cache: write failed for " << tempPath << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, cachePath, ec);
+    if (ec) {
+        std::cerr << "Scene cache: cannot replace " << cachePath << ": " << ec.message() << std::endl;
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool SceneCache::open(const std::string& sourcePath, uint64_t importSettingsHash) {
+    close();
+
+    if (!file_.open(cachePathFor(sourcePath))) {
+        return false;
+    }
+
+    const unsigned char* base = file_.data();
+    const size_t fileSize = file_.size();
+    if (fileSize < sizeof(SceneCacheHeader)) {
+        close();
+        return false;
+    }
+
+    const SceneCacheHeader* header = reinterpret_cast<const SceneCacheHeader*>(base);
+    if (std::memcmp(header->magic, SCENE_CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != VERSION ||
+        header->vertexStride != sizeof(Vertex) ||
+        header->importSettingsHash != importSettingsHash) {
+        std::cout << "Scene cache: format or import settings changed, rebaking " << sourcePath << std::endl;
+        close();
+        return false;
+    }
+
+    SourceFingerprint stored;
+    stored.hash = header->sourceHash;
+    stored.modifiedTime = header->sourceModifiedTime;
+    stored.size = header->sourceSize;
+    if (!sourceMatches(sourcePath, stored)) {
+        std::cout << "Scene cache: source changed, rebaking " << sourcePath << std::endl;
+        close();
+        return false;
+    }
+
+    // Reject caches whose sections run past the end of the file
+    if (!sectionFits(header->meshesOffset, header->meshCount, sizeof(BakedMeshRange), fileSize) ||
+        !sectionFits(header->verticesOffset, header->vertexCount, sizeof(Vertex), fileSize) ||
+        !sectionFits(header->indicesOffset, header->indexCount, sizeof(unsigned int), fileSize) ||
+        !sectionFits(header->stringTableOffset, header->stringTableSize, 1, fileSize)) {
+        std::cerr << "Scene cache: truncated cache file for " << sourcePath << std::endl;
+        close();
+        return false;
+    }
+
+    const BakedMeshRange* meshes = reinterpret_cast<const BakedMeshRange*>(base + header->meshesOffset);
+    for (uint64_t i = 0; i < header->meshCount; i++) {
+        const BakedMeshRange& range = meshes[i];
+        if (uint64_t(range.firstVertex) + range.vertexCount > header->vertexCount ||
+            uint64_t(range.firstIndex) + range.indexCount > header->indexCount ||
+            uint64_t(range.materialNameOffset) + range.materialNameLength > header->stringTableSize) {
+            std::cerr << "Scene cache: corrupt mesh table for " << sourcePath << std::endl;
+            close();
+            return false;
+        }
+    }
+
+    header_ = header;
+    meshes_ = meshes;
+    vertices_ = reinterpret_cast<const Vertex*>(base + header->verticesOffset);
+    indices_ = reinterpret_cast<const unsigned int*>(base + header->indicesOffset);
+    stringTable_ = reinterpret_cast<const char*>(base + header->stringTableOffset);
+    return true;
+}
+
+void SceneCache::close() {
+    file_.close();
+    header_ = nullptr;
+    meshes_ = nullptr;
+    vertices_ = nullptr;
+    indices_ = nullptr;
+    stringTable_ = nullptr;
+}
+
+std::string SceneCache::materialName(const BakedMeshRange& range) const {
+    return std::string(stringTable_ + range.materialNameOffset, range.materialNameLength);
+}
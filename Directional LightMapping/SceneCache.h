@@ -0,0 +1,87 @@
+#ifndef SCENE_CACHE_H
+#define SCENE_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Vertex.h"
+#include "MappedFile.h"
+
+// Range of the baked vertex/index arrays that belongs to one imported mesh
+struct BakedMeshRange {
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    uint32_t firstIndex;
+    uint32_t indexCount;         // Indices are relative to firstVertex
+    uint32_t materialNameOffset; // Offset into the string table
+    uint32_t materialNameLength;
+};
+
+// On-disk header of a baked scene; all section offsets are from the start of the file
+struct SceneCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexStride;
+    uint32_t reserved;
+    uint64_t importSettingsHash; // Import flags plus any baking option that changes the output
+    uint64_t sourceHash;
+    int64_t sourceModifiedTime;
+    uint64_t sourceSize;
+    double coldImportMs;
+    uint64_t meshCount;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t stringTableSize;
+    uint64_t meshesOffset;
+    uint64_t verticesOffset;
+    uint64_t indicesOffset;
+    uint64_t stringTableOffset;
+};
+
+// Geometry produced by one cold import, in the exact layout that is uploaded to the GPU
+struct BakedScene {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<BakedMeshRange> meshes;
+    std::string stringTable;
+
+    // Sizes the arrays once for the whole scene so appending meshes never reallocates
+    void reserve(size_t vertexCount, size_t indexCount, size_t meshCount);
+
+    // Appends room for a mesh and returns its range; the caller fills the vertices and indices in place
+    BakedMeshRange appendMesh(size_t vertexCount, size_t indexCount, const std::string& materialName);
+
+    // Shrinks each mesh to its first vertexCounts[i] vertices and closes the gaps
+    void shrinkMeshes(const std::vector<uint32_t>& vertexCounts);
+};
+
+// Versioned binary cache of imported model geometry, stored next to the source model.
+// The cache is rejected when the format version, vertex layout, import settings or the
+// source file's size, modification time or content hash differ from what was baked.
+class SceneCache {
+public:
+    static const uint32_t VERSION = 2;
+
+    static std::string cachePathFor(const std::string& sourcePath);
+    static bool write(const std::string& sourcePath, uint64_t importSettingsHash, const BakedScene& scene, double coldImportMs);
+
+    bool open(const std::string& sourcePath, uint64_t importSettingsHash);
+    void close();
+
+    size_t meshCount() const { return header_ ? static_cast<size_t>(header_->meshCount) : 0; }
+    const BakedMeshRange& mesh(size_t index) const { return meshes_[index]; }
+    const Vertex* vertices(const BakedMeshRange& range) const { return vertices_ + range.firstVertex; }
+    const unsigned int* indices(const BakedMeshRange& range) const { return indices_ + range.firstIndex; }
+    std::string materialName(const BakedMeshRange& range) const;
+    double coldImportMs() const { return header_ ? header_->coldImportMs : 0.0; }
+
+private:
+    MappedFile file_;
+    const SceneCacheHeader* header_ = nullptr;
+    const BakedMeshRange* meshes_ = nullptr;
+    const Vertex* vertices_ = nullptr;
+    const unsigned int* indices_ = nullptr;
+    const char* stringTable_ = nullptr;
+};
+
+#endif
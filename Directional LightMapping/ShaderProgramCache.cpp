@@ -0,0 +1,165 @@
+#include "ShaderProgramCache.h"
+#include "Hash.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+extern GLuint compileShader(const char* vertexSrc, const char* fragmentSrc, const std::string& shaderName);
+
+ShaderProgramCache shaderProgramCache;
+
+namespace {
+
+const int MAX_INCLUDE_DEPTH = 16;
+
+void appendSource(const std::filesystem::path& path, std::string& out, int depth) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "ERROR::SHADER::FILE_NOT_FOUND " << path.string() << std::endl;
+        return;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        // Normalize line endings and trailing whitespace
+        size_t end = line.find_last_not_of(" \t\r");
+        line.erase(end == std::string::npos ? 0 : end + 1);
+
+        size_t start = line.find_first_not_of(" \t");
+        if (start != std::string::npos && line.compare(start, 8, "#include") == 0) {
+            size_t open = line.find('"', start);
+            size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+            if (close != std::string::npos && depth < MAX_INCLUDE_DEPTH) {
+                appendSource(path.parent_path() / line.substr(open + 1, close - open - 1), out, depth + 1);
+                continue;
+            }
+            std::cerr << "ERROR::SHADER::BAD_INCLUDE in " << path.string() << ": " << line << std::endl;
+            continue;
+        }
+
+        out += line;
+        out += '\n';
+    }
+}
+
+void readUniformDefaults(ShaderProgram& program) {
+    GLint uniformCount = 0;
+    glGetProgramiv(program.id, GL_ACTIVE_UNIFORMS, &uniformCount);
+
+    for (GLint i = 0; i < uniformCount; i++) {
+        char name[256];
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program.id, static_cast<GLuint>(i), sizeof(name), &length, &size, &type, name);
+
+        bool plainValue = type == GL_FLOAT || type == GL_FLOAT_VEC2 || type == GL_FLOAT_VEC3 ||
+            type == GL_FLOAT_VEC4 || type == GL_INT || type == GL_BOOL;
+        if (!plainValue || size != 1) {
+            continue;
+        }
+
+        // Block members have no location
+        GLint location = glGetUniformLocation(program.id, name);
+        if (location == -1) {
+            continue;
+        }
+
+        UniformDefault value = {};
+        value.name = std::string(name, length);
+        value.location = location;
+        value.type = type;
+        if (type == GL_INT || type == GL_BOOL) {
+            glGetUniformiv(program.id, location, value.ints);
+        }
+        else {
+            glGetUniformfv(program.id, location, value.floats);
+        }
+        program.defaults.push_back(value);
+    }
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+std::string preprocessShaderSource(const std::string& path, const ShaderDefines& defines) {
+    std::string source;
+    appendSource(path, source, 0);
+    if (defines.empty()) {
+        return source;
+    }
+
+    std::string defineBlock;
+    for (const auto& [name, value] : defines) {
+        defineBlock += "#define " + name + (value.empty() ? "" : " " + value) + "\n";
+    }
+
+    // #version must stay the first directive
+    size_t insertAt = 0;
+    size_t version = source.find("#version");
+    if (version != std::string::npos) {
+        size_t lineEnd = source.find('\n', version);
+        insertAt = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+    }
+    source.insert(insertAt, defineBlock);
+    return source;
+}
+
+void ShaderProgramCache::enableBinaryCache(const std::string& directory) {
+    binaries_ = std::make_unique<ProgramBinaryCache>(directory);
+    binaries_->open();
+}
+
+std::shared_ptr<ShaderProgram> ShaderProgramCache::acquire(const std::string& vertexPath, const std::string& fragmentPath,
+    const ShaderDefines& defines, const std::string& name) {
+    auto preprocessStart = std::chrono::steady_clock::now();
+    std::string vertexSource = preprocessShaderSource(vertexPath, defines);
+    std::string fragmentSource = preprocessShaderSource(fragmentPath, defines);
+
+    // Lengths are hashed too so the split between the two stages is part of the key
+    uint64_t vertexLength = vertexSource.size();
+    uint64_t hash = hashBytes(&vertexLength, sizeof(vertexLength));
+    hash = hashString(vertexSource, hash);
+    hash = hashString(fragmentSource, hash);
+    preprocessMs_ += millisecondsSince(preprocessStart);
+
+    auto it = programs_.find(hash);
+    if (it != programs_.end()) {
+        hits_++;
+        it->second->users++;
+        return it->second;
+    }
+
+    auto program = std::make_shared<ShaderProgram>();
+    program->sourceHash = hash;
+    program->users = 1;
+    program->id = binaries_ ? binaries_->load(hash) : 0;
+    if (program->id == 0) {
+        auto compileStart = std::chrono::steady_clock::now();
+        program->id = compileShader(vertexSource.c_str(), fragmentSource.c_str(), name);
+        compileMs_ += millisecondsSince(compileStart);
+        compiles_++;
+        if (binaries_) {
+            binaries_->store(hash, program->id);
+        }
+    }
+    readUniformDefaults(*program);
+
+    programs_[hash] = program;
+    return program;
+}
+
+void ShaderProgramCache::printStats(std::ostream& out) const {
+    double averageMs = compiles_ > 0 ? compileMs_ / compiles_ : 0.0;
+    out << "Shader programs: " << compiles_ << " compiled in " << compileMs_ << " ms, "
+        << hits_ << " compiles avoided (~" << hits_ * averageMs << " ms saved, "
+        << preprocessMs_ << " ms spent hashing sources)" << std::endl;
+    if (binaries_) {
+        binaries_->printStats(out);
+    }
+}
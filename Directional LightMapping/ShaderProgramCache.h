@@ -0,0 +1,71 @@
+#ifndef SHADER_PROGRAM_CACHE_H
+#define SHADER_PROGRAM_CACHE_H
+
+#include "GLDispatch.h"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ProgramBinaryCache.h"
+
+// Value a plain uniform has right after linking. Materials sharing a program restore the
+// defaults of the uniforms they do not set themselves, so no value leaks between them.
+struct UniformDefault {
+    std::string name;
+    GLint location;
+    GLenum type;
+    float floats[4];
+    GLint ints[4];
+};
+
+// A linked program plus the uniform state shared by every material that uses it
+struct ShaderProgram {
+    GLuint id = 0;
+    uint64_t sourceHash = 0;
+    unsigned int users = 0;
+    std::vector<UniformDefault> defaults;
+
+    // Per-program uniform state, tracked here because materials share the program
+    bool modelIsIdentity = false;              // The model uniform currently holds the identity
+    unsigned int frameConstantsUploaded = 0;  // Frame index of the last loose camera upload
+};
+
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+// Expands #include "file" directives relative to the including file, inserts the defines after
+// the #version line and normalizes line endings, so equivalent sources hash the same
+std::string preprocessShaderSource(const std::string& path, const ShaderDefines& defines);
+
+// Programs keyed on a hash of the preprocessed vertex and fragment sources. Each distinct
+// program is compiled and linked once; materials with the same shaders share it.
+class ShaderProgramCache {
+public:
+    // Loads programs from linked binaries in directory when possible and saves new ones there.
+    // Call with a current GL context, before the first acquire.
+    void enableBinaryCache(const std::string& directory);
+
+    std::shared_ptr<ShaderProgram> acquire(const std::string& vertexPath, const std::string& fragmentPath,
+        const ShaderDefines& defines, const std::string& name);
+
+    unsigned int compiles() const { return compiles_; }
+    unsigned int hits() const { return hits_; }
+    double compileMs() const { return compileMs_; }
+
+    // Compiles avoided and the time they would have taken at the average compile cost
+    void printStats(std::ostream& out) const;
+
+private:
+    std::unordered_map<uint64_t, std::shared_ptr<ShaderProgram>> programs_;
+    std::unique_ptr<ProgramBinaryCache> binaries_;
+    unsigned int compiles_ = 0;
+    unsigned int hits_ = 0;
+    double compileMs_ = 0.0;
+    double preprocessMs_ = 0.0;
+};
+
+extern ShaderProgramCache shaderProgramCache;
+
+#endif
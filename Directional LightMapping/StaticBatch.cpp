@@ -0,0 +1,181 @@
+#include "StaticBatch.h"
+#include "GLStats.h"
+#include "Material.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cstddef>
+
+BatchRange packMesh(std::vector<Vertex>& packedVertices, std::vector<unsigned int>& packedIndices,
+    const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount) {
+    BatchRange range;
+    range.firstVertex = static_cast<uint32_t>(packedVertices.size());
+    range.vertexCount = static_cast<uint32_t>(vertexCount);
+    range.firstIndex = static_cast<uint32_t>(packedIndices.size());
+    range.indexCount = static_cast<uint32_t>(indexCount);
+
+    packedVertices.insert(packedVertices.end(), vertices, vertices + vertexCount);
+    packedIndices.insert(packedIndices.end(), indices, indices + indexCount);
+    return range;
+}
+
+void buildIndirectCommands(std::vector<BatchDraw>& draws,
+    std::vector<DrawElementsIndirectCommand>& commands, std::vector<IndirectDrawGroup>& groups) {
+    commands.clear();
+    groups.clear();
+
+    std::sort(draws.begin(), draws.end(), [](const BatchDraw& a, const BatchDraw& b) {
+        return a.sortKey < b.sortKey;
+    });
+
+    for (const auto& draw : draws) {
+        if (groups.empty() || !groups.back().material->sharesDrawState(*draw.material)) {
+            groups.push_back({ draw.material, static_cast<uint32_t>(commands.size()), 0 });
+        }
+
+        DrawElementsIndirectCommand command;
+        command.count = draw.range.indexCount;
+        command.instanceCount = 1;
+        command.firstIndex = draw.range.firstIndex;
+        command.baseVertex = static_cast<GLint>(draw.range.firstVertex);
+        command.baseInstance = draw.range.meshIndex;
+        commands.push_back(command);
+        groups.back().commandCount++;
+    }
+}
+
+BatchRange StaticBatch::add(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+    VertexPackingReport* report) {
+    BatchRange range;
+    if (packVertices_) {
+        // Quantize against this mesh's bounds right away; the float copy is never kept
+        range.firstVertex = static_cast<uint32_t>(packedVertices_.size());
+        range.vertexCount = static_cast<uint32_t>(vertexCount);
+        range.firstIndex = static_cast<uint32_t>(indices_.size());
+        range.indexCount = static_cast<uint32_t>(indexCount);
+        indices_.insert(indices_.end(), indices, indices + indexCount);
+
+        packedVertices_.resize(packedVertices_.size() + vertexCount);
+        PackedVertex* packed = packedVertices_.data() + range.firstVertex;
+        dequantization_.push_back(packVertices(vertices, vertexCount, packed));
+        if (report) {
+            *report = measurePackingError(vertices, packed, vertexCount, dequantization_.back());
+        }
+    }
+    else {
+        range = packMesh(vertices_, indices_, vertices, vertexCount, indices, indexCount);
+    }
+    range.meshIndex = meshCount_++;
+    return range;
+}
+
+void StaticBatch::upload() {
+    if ((vertices_.empty() && packedVertices_.empty()) || indices_.empty()) {
+        return;
+    }
+
+    glGenVertexArrays(1, &vao_);
+    glBindVertexArray(vao_);
+
+    glGenBuffers(1, &ebo_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_.size() * sizeof(unsigned int), indices_.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &vbo_);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    if (packVertices_) {
+        glBufferData(GL_ARRAY_BUFFER, packedVertices_.size() * sizeof(PackedVertex), packedVertices_.data(), GL_STATIC_DRAW);
+        setupPackedVertexAttributes();
+
+        // One dequantization entry per mesh, selected by each command's base instance
+        glGenBuffers(1, &dequantizationBuffer_);
+        glBindBuffer(GL_ARRAY_BUFFER, dequantizationBuffer_);
+        glBufferData(GL_ARRAY_BUFFER, dequantization_.size() * sizeof(PositionDequantization), dequantization_.data(), GL_STATIC_DRAW);
+        setupDequantizationAttributes();
+    }
+    else {
+        glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(Vertex), vertices_.data(), GL_STATIC_DRAW);
+        setupFloatAttributes();
+    }
+
+    glBindVertexArray(0);
+
+    glGenBuffers(1, &indirectBuffer_);
+
+    // The GPU owns the geometry from here on
+    std::vector<Vertex>().swap(vertices_);
+    std::vector<PackedVertex>().swap(packedVertices_);
+    std::vector<PositionDequantization>().swap(dequantization_);
+    std::vector<unsigned int>().swap(indices_);
+}
+
+void StaticBatch::setMaterialIndices(const std::vector<uint32_t>& meshMaterials) {
+    if (vao_ == 0 || meshMaterials.empty()) {
+        return;
+    }
+
+    glBindVertexArray(vao_);
+    if (materialIndexBuffer_ == 0) {
+        glGenBuffers(1, &materialIndexBuffer_);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, materialIndexBuffer_);
+    glBufferData(GL_ARRAY_BUFFER, meshMaterials.size() * sizeof(uint32_t), meshMaterials.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(MATERIAL_INDEX_LOCATION);
+    glVertexAttribIPointer(MATERIAL_INDEX_LOCATION, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+    glVertexAttribDivisor(MATERIAL_INDEX_LOCATION, 1);
+    glBindVertexArray(0);
+}
+
+void StaticBatch::setupFloatAttributes() {
+    // Same attribute layout as Mesh::setupMesh
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, LightmapTexCoords));
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+    glEnableVertexAttribArray(5);
+    glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+}
+
+void StaticBatch::clearDraws() {
+    draws_.clear();
+}
+
+void StaticBatch::submit(const Material& material, const BatchRange& range, float viewDepth) {
+    draws_.push_back({ RenderQueue::makeSortKey(material, vao_, viewDepth, range.meshIndex), &material, range });
+}
+
+void StaticBatch::execute(const FrameConstants& frame, GLStateTracker& state, const glm::mat4* model) {
+    PROFILE_SCOPE("StaticBatch::execute");
+    if (draws_.empty() || vao_ == 0) {
+        return;
+    }
+
+    buildIndirectCommands(draws_, commands_, groups_);
+
+    // Grow the indirect buffer when needed, otherwise orphan and refill it
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer_);
+    size_t commandBytes = commands_.size() * sizeof(DrawElementsIndirectCommand);
+    if (commands_.size() > indirectCapacity_) {
+        indirectCapacity_ = commands_.size();
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commandBytes, commands_.data(), GL_STREAM_DRAW);
+    }
+    else {
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity_ * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandBytes, commands_.data());
+    }
+
+    state.bindVertexArray(vao_);
+    for (const auto& group : groups_) {
+        group.material->apply(model, frame, state);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+            (void*)(group.firstCommand * sizeof(DrawElementsIndirectCommand)),
+            static_cast<GLsizei>(group.commandCount), 0);
+        glCallStats.drawCalls++;
+    }
+}
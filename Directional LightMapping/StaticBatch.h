@@ -0,0 +1,106 @@
+#ifndef STATIC_BATCH_H
+#define STATIC_BATCH_H
+
+#include "GLDispatch.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "Vertex.h"
+#include "VertexPacking.h"
+#include "FrameConstants.h"
+#include "GLStateTracker.h"
+
+class Material;
+
+// Layout consumed by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand must match the GL layout");
+
+// Where one mesh lives inside the shared vertex and index buffers
+struct BatchRange {
+    uint32_t firstVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0; // Indices are relative to firstVertex
+    uint32_t meshIndex = 0;  // Passed as the base instance, selecting the mesh's dequantization
+};
+
+struct BatchDraw {
+    uint64_t sortKey;
+    const Material* material;
+    BatchRange range;
+};
+
+// Consecutive commands that are drawn with one material's state; with the material table
+// this covers every material of the same draw group
+struct IndirectDrawGroup {
+    const Material* material;
+    uint32_t firstCommand;
+    uint32_t commandCount;
+};
+
+// Appends a mesh to the packed vertex/index arrays and returns its range
+BatchRange packMesh(std::vector<Vertex>& packedVertices, std::vector<unsigned int>& packedIndices,
+    const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+
+// Sorts the draws by key and turns them into indirect commands, one group per run of materials sharing draw state
+void buildIndirectCommands(std::vector<BatchDraw>& draws,
+    std::vector<DrawElementsIndirectCommand>& commands, std::vector<IndirectDrawGroup>& groups);
+
+// All static level geometry in one vertex buffer, one index buffer and one VAO.
+// Meshes are packed at load time; every frame the visible meshes are submitted,
+// and each material's meshes are drawn with a single glMultiDrawElementsIndirect.
+// With packVertices the geometry is stored as PackedVertex, quantized per mesh.
+class StaticBatch {
+public:
+    explicit StaticBatch(bool packVertices = false) : packVertices_(packVertices) {}
+
+    // Fills report with the packing error when the batch packs its vertices
+    BatchRange add(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+        VertexPackingReport* report = nullptr);
+
+    // Uploads the packed geometry and releases the CPU copy
+    void upload();
+
+    // Material-table index per mesh, read by the shader through the base instance; call after upload
+    void setMaterialIndices(const std::vector<uint32_t>& meshMaterials);
+
+    GLuint vao() const { return vao_; }
+    bool empty() const { return vao_ == 0; }
+
+    void clearDraws();
+    // viewDepth only orders blended draws
+    void submit(const Material& material, const BatchRange& range, float viewDepth);
+    // A null model matrix marks the batch as world-space geometry
+    void execute(const FrameConstants& frame, GLStateTracker& state, const glm::mat4* model);
+
+private:
+    void setupFloatAttributes();
+
+    bool packVertices_;
+    std::vector<Vertex> vertices_;
+    std::vector<PackedVertex> packedVertices_;
+    std::vector<PositionDequantization> dequantization_;
+    std::vector<unsigned int> indices_;
+    uint32_t meshCount_ = 0;
+    GLuint vao_ = 0;
+    GLuint vbo_ = 0;
+    GLuint ebo_ = 0;
+    GLuint dequantizationBuffer_ = 0;
+    GLuint materialIndexBuffer_ = 0;
+    GLuint indirectBuffer_ = 0;
+    size_t indirectCapacity_ = 0;
+
+    std::vector<BatchDraw> draws_;
+    std::vector<DrawElementsIndirectCommand> commands_;
+    std::vector<IndirectDrawGroup> groups_;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "SubmissionCheck.h"
+#include "Material.h"
+#include <algorithm>
+
+SubmissionCheck::SubmissionCheck(const GLRecorder& recorder)
+    : recorder_(recorder), loadErrors_(recorder.errors()) {
+    checks_ = {
+        { "draws" }, { "program binds" }, { "texture binds" }, { "vertex array binds" },
+        { "uniform lookups" }, { "redundant binds" }, { "GL errors" }, { "GL calls" },
+    };
+}
+
+bool SubmissionCheck::checkFrame(const std::vector<const Material*>& visibleMaterials, unsigned long long extraTextureSlots,
+    std::ostream& errors) {
+    // What this frame could legitimately bind. Opaque draws are sorted by program and texture set, so each
+    // material is applied once; blended draws are sorted by depth and may apply their material every draw.
+    std::vector<const Material*> materials;
+    unsigned long long applications = 0;
+    unsigned long long programBinds = 0;
+    unsigned long long textureSlots = extraTextureSlots;
+    std::vector<GLuint> opaquePrograms;
+    for (const Material* material : visibleMaterials) {
+        if (!material->blendingEnabled) {
+            if (std::find(materials.begin(), materials.end(), material) != materials.end()) {
+                continue;
+            }
+            materials.push_back(material);
+            if (std::find(opaquePrograms.begin(), opaquePrograms.end(), material->shaderProgram) == opaquePrograms.end()) {
+                opaquePrograms.push_back(material->shaderProgram);
+                programBinds++;
+            }
+        }
+        else {
+            programBinds++;
+        }
+        applications++;
+        textureSlots += material->textures.size();
+    }
+    unsigned long long meshCount = visibleMaterials.size();
+
+    unsigned long long values[] = {
+        recorder_.draws(),
+        recorder_.count("glUseProgram"),
+        recorder_.count("glBindTexture"),
+        recorder_.count("glBindVertexArray"),
+        recorder_.count("glGetUniformLocation") + recorder_.count("glGetUniformBlockIndex"),
+        recorder_.redundantBinds().total(),
+        recorder_.errors(),
+        recorder_.totalCalls(),
+    };
+    // The first frame may still resolve lazily created state, so lookups are only checked after it
+    unsigned long long limits[] = {
+        meshCount,
+        programBinds,
+        textureSlots,
+        meshCount + 1,
+        frames_ == 0 ? values[4] : 0,
+        0,
+        0,
+        maxGLCallsPerMaterial * applications + maxGLCallsPerMesh * meshCount + maxGLCallsPerFrame,
+    };
+
+    bool frameOk = true;
+    for (size_t i = 0; i < checks_.size(); i++) {
+        Check& check = checks_[i];
+        if (values[i] > limits[i]) {
+            if (check.failedFrames == 0) {
+                errors << "Frame " << frames_ << ": " << values[i] << " " << check.name << ", limit " << limits[i] << std::endl;
+                recorder_.printCounts(errors);
+            }
+            check.failedFrames++;
+            frameOk = false;
+        }
+        if (values[i] >= check.worst) {
+            check.worst = values[i];
+            check.worstLimit = limits[i];
+        }
+    }
+    frames_++;
+    return frameOk;
+}
+
+bool SubmissionCheck::passed() const {
+    bool passed = loadErrors_ == 0;
+    for (const auto& check : checks_) {
+        passed = passed && check.failedFrames == 0;
+    }
+    return passed;
+}
+
+void SubmissionCheck::printReport(std::ostream& out) const {
+    out << "Submission check over " << frames_ << " frames:" << std::endl;
+    for (const auto& check : checks_) {
+        out << "  " << check.name << ": at most " << check.worst << " per frame (limit there " << check.worstLimit
+            << "), " << (check.failedFrames == 0 ? "ok" : std::to_string(check.failedFrames) + " frames over") << std::endl;
+    }
+    out << (passed() ? "Submission check passed" : "Submission check FAILED") << std::endl;
+}
@@ -0,0 +1,48 @@
+#ifndef SUBMISSION_CHECK_H
+#define SUBMISSION_CHECK_H
+
+#include "GLRecorder.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Material;
+
+// Loose per-frame limits of the submission check, from what is visible: they catch work that grows
+// per draw or per frame, not small changes in fixed costs
+const unsigned int maxGLCallsPerMaterial = 48;
+const unsigned int maxGLCallsPerMesh = 8;
+const unsigned int maxGLCallsPerFrame = 64;
+
+// Checks the GL calls a GLRecorder counted in each frame against limits derived from the visible
+// meshes and their materials. Used by --check-submission and by the unit tests.
+class SubmissionCheck {
+public:
+    // Takes the errors recorded so far as the level load's
+    explicit SubmissionCheck(const GLRecorder& recorder);
+
+    // Checks the calls counted since the recorder's last resetCounters(). visibleMaterials has one entry
+    // per drawn mesh; extraTextureSlots covers textures bound outside the materials (the material table).
+    // Prints the first violation of each check with the call counts. Returns false when a limit is exceeded.
+    bool checkFrame(const std::vector<const Material*>& visibleMaterials, unsigned long long extraTextureSlots,
+        std::ostream& errors);
+
+    unsigned long long loadErrors() const { return loadErrors_; }
+    bool passed() const;
+    void printReport(std::ostream& out) const;
+
+private:
+    struct Check {
+        const char* name;
+        unsigned long long worst = 0;       // Largest value seen
+        unsigned long long worstLimit = 0;  // Limit in that frame
+        unsigned int failedFrames = 0;
+    };
+
+    const GLRecorder& recorder_;
+    unsigned long long loadErrors_;
+    size_t frames_ = 0;
+    std::vector<Check> checks_;
+};
+
+#endif
@@ -0,0 +1,248 @@
+#include "TextureCache.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace {
+
+const char TEXTURE_CACHE_MAGIC[4] = { 'D', 'L', 'T', 'C' };
+
+bool formatMatches(BlockFormat requested, BlockFormat cached) {
+    if (requested == BlockFormat::Auto) {
+        return cached == BlockFormat::BC1 || cached == BlockFormat::BC3;
+    }
+    return requested == cached;
+}
+
+// Larger than any GL implementation accepts; also keeps the level size arithmetic below from overflowing
+const uint32_t MAX_TEXTURE_DIMENSION = 65536;
+
+// The level table must describe exactly the chain compressImage writes: halving down to 1x1, every
+// level holding all of its blocks and lying inside the data section
+bool levelsMatchChain(const TextureCacheHeader& header, const CompressedMipLevel* levels) {
+    if (header.width == 0 || header.height == 0 || header.width > MAX_TEXTURE_DIMENSION || header.height > MAX_TEXTURE_DIMENSION) {
+        return false;
+    }
+
+    uint32_t expectedLevels = 1;
+    for (uint32_t width = header.width, height = header.height; width > 1 || height > 1; expectedLevels++) {
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    if (header.levelCount != expectedLevels) {
+        return false;
+    }
+
+    size_t bytesPerBlock = blockBytes(static_cast<BlockFormat>(header.format));
+    uint32_t width = header.width;
+    uint32_t height = header.height;
+    for (uint32_t i = 0; i < header.levelCount; i++) {
+        const CompressedMipLevel& level = levels[i];
+        uint64_t expectedSize = static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4) * bytesPerBlock;
+        if (level.width != width || level.height != height || level.size != expectedSize ||
+            level.offset > header.dataSize || level.size > header.dataSize - level.offset) {
+            return false;
+        }
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    return true;
+}
+
+// Workers may encode the same source with different mip settings at once, and other processes may be
+// transcoding the same directory, so every write goes through its own temporary file
+std::string uniqueTempPath(const std::string& cachePath) {
+    static const uint64_t processTag = (uint64_t(std::random_device()()) << 32) | std::random_device()();
+    static std::atomic<uint32_t> writeCount{ 0 };
+
+    std::ostringstream path;
+    path << cachePath << "." << std::hex << processTag << "-" << writeCount++ << ".tmp";
+    return path.str();
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+std::string TextureCache::cachePathFor(const std::string& sourcePath) {
+    return sourcePath + ".texcache";
+}
+
+bool TextureCache::write(const std::string& sourcePath, const CompressedImage& image, uint64_t mipSettingsHash, double encodeMs,
+    SourceFingerprint& source) {
+    if (source.hash == 0 && !fingerprintSource(sourcePath, source)) {
+        std::cerr << "Texture cache: cannot fingerprint source " << sourcePath << std::endl;
+        return false;
+    }
+
+    TextureCacheHeader header = {};
+    std::memcpy(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.format = static_cast<uint32_t>(image.format);
+    header.width = image.width;
+    header.height = image.height;
+    header.levelCount = static_cast<uint32_t>(image.levels.size());
+    header.mipSettingsHash = mipSettingsHash;
+    header.sourceHash = source.hash;
+    header.sourceModifiedTime = source.modifiedTime;
+    header.sourceSize = source.size;
+    header.encodeMs = encodeMs;
+    header.levelsOffset = sizeof(TextureCacheHeader);
+    header.dataOffset = header.levelsOffset + image.levels.size() * sizeof(CompressedMipLevel);
+    header.dataSize = image.data.size();
+
+    // Temporary file first, so an interrupted transcode never leaves a truncated cache behind
+    std::string cachePath = cachePathFor(sourcePath);
+    std::string tempPath = uniqueTempPath(cachePath);
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Texture cache: cannot write " << tempPath << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(image.levels.data()), image.levels.size() * sizeof(CompressedMipLevel));
+        out.write(reinterpret_cast<const char*>(image.data.data()), image.data.size());
+        if (!out) {
+            std::cerr << "Texture cache: write failed for " << tempPath << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, cachePath, ec);
+    if (ec) {
+        std::cerr << "Texture cache: cannot replace " << cachePath << ": " << ec.message() << std::endl;
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool TextureCache::read(const std::string& sourcePath, BlockFormat format, uint64_t mipSettingsHash, CompressedImage& image,
+    SourceFingerprint& source) {
+    MappedFile file;
+    if (!file.open(cachePathFor(sourcePath)) || file.size() < sizeof(TextureCacheHeader)) {
+        return false;
+    }
+
+    const TextureCacheHeader* header = reinterpret_cast<const TextureCacheHeader*>(file.data());
+    if (std::memcmp(header->magic, TEXTURE_CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != VERSION ||
+        header->mipSettingsHash != mipSettingsHash ||
+        !formatMatches(format, static_cast<BlockFormat>(header->format))) {
+        return false;
+    }
+
+    SourceFingerprint stored;
+    stored.hash = header->sourceHash;
+    stored.modifiedTime = header->sourceModifiedTime;
+    stored.size = header->sourceSize;
+    if (source.hash != 0 ? !(stored == source) : !sourceMatches(sourcePath, stored)) {
+        return false;
+    }
+
+    if (header->levelsOffset > file.size() ||
+        header->levelCount > (file.size() - header->levelsOffset) / sizeof(CompressedMipLevel) ||
+        header->dataOffset > file.size() ||
+        header->dataSize > file.size() - header->dataOffset) {
+        std::cerr << "Texture cache: truncated cache file for " << sourcePath << std::endl;
+        return false;
+    }
+
+    const CompressedMipLevel* levels = reinterpret_cast<const CompressedMipLevel*>(file.data() + header->levelsOffset);
+    if (!levelsMatchChain(*header, levels)) {
+        std::cerr << "Texture cache: corrupt level table for " << sourcePath << std::endl;
+        return false;
+    }
+
+    image.format = static_cast<BlockFormat>(header->format);
+    image.width = header->width;
+    image.height = header->height;
+    image.levels.assign(levels, levels + header->levelCount);
+    image.data.assign(file.data() + header->dataOffset, file.data() + header->dataOffset + header->dataSize);
+    source = stored;
+    return true;
+}
+
+bool loadCompressedTexture(const std::string& path, BlockFormat format, const MipOptions& mips, CompressedImage& image, bool& cacheHit,
+    SourceFingerprint& source) {
+    cacheHit = TextureCache::read(path, format, mips.hash(), image, source);
+    if (cacheHit) {
+        return true;
+    }
+
+    int width, height, components;
+    unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &components, 0);
+    if (!pixels) {
+        return false;
+    }
+
+    auto encodeStart = std::chrono::steady_clock::now();
+    image = compressImage(pixels, width, height, components, format, mips);
+    double encodeMs = millisecondsSince(encodeStart);
+    stbi_image_free(pixels);
+
+    TextureCache::write(path, image, mips.hash(), encodeMs, source);
+    return true;
+}
+
+void runTextureTranscode(const std::vector<std::string>& paths, BlockFormat format, const MipOptions& mips) {
+    if (paths.empty()) {
+        std::cerr << "Texture transcode: no images to encode" << std::endl;
+        return;
+    }
+
+    std::cout << "Texture transcode: " << paths.size() << " images, format " << blockFormatName(format) << std::endl;
+    double totalEncodeMs = 0.0;
+    double totalSourceBytes = 0.0;
+    double totalCompressedBytes = 0.0;
+    double totalTexels = 0.0;
+    ThreadPool pool;
+
+    for (const auto& path : paths) {
+        int width, height, components;
+        unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &components, 0);
+        if (!pixels) {
+            std::cerr << "  cannot decode " << path << std::endl;
+            continue;
+        }
+
+        auto encodeStart = std::chrono::steady_clock::now();
+        CompressedImage image = compressImage(pixels, width, height, components, format, mips, &pool);
+        double encodeMs = millisecondsSince(encodeStart);
+        double psnr = compressionPsnr(pixels, width, height, components, image);
+        stbi_image_free(pixels);
+        SourceFingerprint source;
+        TextureCache::write(path, image, mips.hash(), encodeMs, source);
+
+        // What the old path kept in VRAM: the 8-bit source plus a third for the generated mips
+        double sourceBytes = static_cast<double>(width) * height * components * 4.0 / 3.0;
+        std::cout << "  " << std::filesystem::path(path).filename().string() << ": " << width << "x" << height
+            << " " << blockFormatName(image.format) << ", " << image.levels.size() << " levels, "
+            << sourceBytes / 1024.0 << " KB -> " << image.data.size() / 1024.0 << " KB, PSNR "
+            << psnr << " dB, " << encodeMs << " ms" << std::endl;
+
+        totalEncodeMs += encodeMs;
+        totalSourceBytes += sourceBytes;
+        totalCompressedBytes += static_cast<double>(image.data.size());
+        totalTexels += static_cast<double>(width) * height;
+    }
+
+    std::cout << "  total: " << totalSourceBytes / (1024.0 * 1024.0) << " MB -> "
+        << totalCompressedBytes / (1024.0 * 1024.0) << " MB ("
+        << totalSourceBytes / std::max(totalCompressedBytes, 1.0) << ":1), "
+        << totalEncodeMs << " ms encode, "
+        << totalTexels / 1e6 / std::max(totalEncodeMs / 1000.0, 1e-6) << " Mtexels/s" << std::endl;
+}
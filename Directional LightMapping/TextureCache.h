@@ -0,0 +1,54 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Hash.h"
+#include "TextureCompression.h"
+
+// On-disk header of a transcoded texture, in the spirit of DDS/KTX2: a fixed header, a level
+// index and the block data of every mip level. Offsets are from the start of the file.
+struct TextureCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t format; // BlockFormat
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint64_t mipSettingsHash; // MipOptions::hash() of the filter the levels were generated with
+    uint64_t sourceHash;
+    int64_t sourceModifiedTime;
+    uint64_t sourceSize;
+    double encodeMs;
+    uint64_t levelsOffset;
+    uint64_t dataOffset;
+    uint64_t dataSize;
+};
+
+// Block-compressed textures stored next to their source image. A cache is used only when the
+// version, format, mip settings and the source's size, modification time and content hash all match.
+// source is the fingerprint of the source image: when it is already known the source file is not
+// touched, otherwise it is taken from the file and returned for the next call.
+class TextureCache {
+public:
+    static const uint32_t VERSION = 2;
+
+    static std::string cachePathFor(const std::string& sourcePath);
+    static bool write(const std::string& sourcePath, const CompressedImage& image, uint64_t mipSettingsHash, double encodeMs,
+        SourceFingerprint& source);
+
+    // Auto accepts either BC1 or BC3, whichever the encoder picked
+    static bool read(const std::string& sourcePath, BlockFormat format, uint64_t mipSettingsHash, CompressedImage& image,
+        SourceFingerprint& source);
+};
+
+// Reads the cached encoding of an image, or decodes, encodes and caches it. No GL calls.
+bool loadCompressedTexture(const std::string& path, BlockFormat format, const MipOptions& mips, CompressedImage& image, bool& cacheHit,
+    SourceFingerprint& source);
+
+// Offline transcode: encodes every image into the texture cache and prints ratio, quality and throughput.
+// Mips are filtered on a pool; the cache is only used at runtime by textures requested with the same options.
+void runTextureTranscode(const std::vector<std::string>& paths, BlockFormat format, const MipOptions& mips);
+
+#endif
@@ -0,0 +1,456 @@
+#include "TextureCompression.h"
+#include "MipGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const int BLOCK_TEXELS = 16;
+
+// 5:6:5 endpoint packing, with bit replication on expansion as the hardware does
+uint16_t packRgb565(const float* color) {
+    int r = static_cast<int>(std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f));
+    int g = static_cast<int>(std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f));
+    int b = static_cast<int>(std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpackRgb565(uint16_t packed, int* color) {
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// Four-color palette of a BC1 block in index order
+void bc1Palette(uint16_t color0, uint16_t color1, int palette[4][3]) {
+    unpackRgb565(color0, palette[0]);
+    unpackRgb565(color1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        if (color0 > color1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+}
+
+int colorDistance(const uint8_t* texel, const int* color) {
+    int dr = texel[0] - color[0];
+    int dg = texel[1] - color[1];
+    int db = texel[2] - color[2];
+    return dr * dr + dg * dg + db * db;
+}
+
+// Picks the nearest palette entry per texel and returns the total squared error
+int selectBC1Indices(const uint8_t* rgba, uint16_t color0, uint16_t color1, uint32_t& indices) {
+    int palette[4][3];
+    bc1Palette(color0, color1, palette);
+
+    int error = 0;
+    indices = 0;
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        int best = 0;
+        int bestDistance = colorDistance(rgba + i * 4, palette[0]);
+        for (int p = 1; p < 4; p++) {
+            int distance = colorDistance(rgba + i * 4, palette[p]);
+            if (distance < bestDistance) {
+                best = p;
+                bestDistance = distance;
+            }
+        }
+        indices |= static_cast<uint32_t>(best) << (i * 2);
+        error += bestDistance;
+    }
+    return error;
+}
+
+// Endpoints along the principal axis of the block's colors, found by power iteration
+void principalAxisEndpoints(const uint8_t* rgba, float* low, float* high) {
+    float mean[3] = {};
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        for (int c = 0; c < 3; c++) {
+            mean[c] += rgba[i * 4 + c];
+        }
+    }
+    for (int c = 0; c < 3; c++) {
+        mean[c] /= BLOCK_TEXELS;
+    }
+
+    float covariance[6] = {}; // rr rg rb gg gb bb
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        float r = rgba[i * 4 + 0] - mean[0];
+        float g = rgba[i * 4 + 1] - mean[1];
+        float b = rgba[i * 4 + 2] - mean[2];
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+        float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+        float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+        float length = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+        if (length < 1e-6f) {
+            break; // Flat block, any axis works
+        }
+        axis[0] = x / length;
+        axis[1] = y / length;
+        axis[2] = z / length;
+    }
+
+    float minT = 0.0f;
+    float maxT = 0.0f;
+    float axisLengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        float t = ((rgba[i * 4 + 0] - mean[0]) * axis[0] + (rgba[i * 4 + 1] - mean[1]) * axis[1] +
+            (rgba[i * 4 + 2] - mean[2]) * axis[2]) / axisLengthSquared;
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    for (int c = 0; c < 3; c++) {
+        low[c] = mean[c] + axis[c] * minT;
+        high[c] = mean[c] + axis[c] * maxT;
+    }
+}
+
+// Least-squares endpoints for fixed indices; returns false if the system is degenerate
+bool refineBC1Endpoints(const uint8_t* rgba, uint32_t indices, float* endpoint0, float* endpoint1) {
+    // Interpolation weight of endpoint1 for each four-color index
+    static const float WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[3] = {}, bx[3] = {};
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        float beta = WEIGHTS[(indices >> (i * 2)) & 3];
+        float alpha = 1.0f - beta;
+        aa += alpha * alpha;
+        ab += alpha * beta;
+        bb += beta * beta;
+        for (int c = 0; c < 3; c++) {
+            ax[c] += alpha * rgba[i * 4 + c];
+            bx[c] += beta * rgba[i * 4 + c];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-6f) {
+        return false;
+    }
+    for (int c = 0; c < 3; c++) {
+        endpoint0[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+        endpoint1[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+    }
+    return true;
+}
+
+void writeBC1(uint16_t color0, uint16_t color1, uint32_t indices, uint8_t* out) {
+    out[0] = static_cast<uint8_t>(color0);
+    out[1] = static_cast<uint8_t>(color0 >> 8);
+    out[2] = static_cast<uint8_t>(color1);
+    out[3] = static_cast<uint8_t>(color1 >> 8);
+    std::memcpy(out + 4, &indices, sizeof(indices)); // Little-endian, like the GPU expects
+}
+
+// Four-color mode needs color0 > color1; indices are picked after ordering
+void orderBC1Endpoints(uint16_t& color0, uint16_t& color1) {
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+}
+
+// BC4 single-channel block (BC3 alpha, each half of BC5); stride is the byte distance between texels
+void encodeBC4Block(const uint8_t* values, int stride, uint8_t* out) {
+    int minValue = 255;
+    int maxValue = 0;
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        minValue = std::min(minValue, static_cast<int>(values[i * stride]));
+        maxValue = std::max(maxValue, static_cast<int>(values[i * stride]));
+    }
+
+    // Eight-value mode: endpoint0 > endpoint1, six interpolated steps between them
+    out[0] = static_cast<uint8_t>(maxValue);
+    out[1] = static_cast<uint8_t>(minValue);
+
+    uint64_t indices = 0;
+    if (maxValue > minValue) {
+        // Position along max..min in sevenths, mapped to the BC4 index order 0, 2, 3, ..., 7, 1
+        static const int STEP_TO_INDEX[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+        float scale = 7.0f / (maxValue - minValue);
+        for (int i = 0; i < BLOCK_TEXELS; i++) {
+            int step = static_cast<int>(std::lround((maxValue - values[i * stride]) * scale));
+            indices |= static_cast<uint64_t>(STEP_TO_INDEX[step]) << (i * 3);
+        }
+    }
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+}
+
+void decodeBC4Block(const uint8_t* block, uint8_t* values, int stride) {
+    int palette[8];
+    palette[0] = block[0];
+    palette[1] = block[1];
+    if (palette[0] > palette[1]) {
+        for (int i = 2; i < 8; i++) {
+            palette[i] = ((8 - i) * palette[0] + (i - 1) * palette[1]) / 7;
+        }
+    }
+    else {
+        for (int i = 2; i < 6; i++) {
+            palette[i] = ((6 - i) * palette[0] + (i - 1) * palette[1]) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++) {
+        indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+    }
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        values[i * stride] = static_cast<uint8_t>(palette[(indices >> (i * 3)) & 7]);
+    }
+}
+
+// Encodes one mip level, clamping reads at the right and bottom edges of partial blocks
+void encodeLevel(const std::vector<uint8_t>& rgba, int width, int height, BlockFormat format, uint8_t* out) {
+    size_t bytesPerBlock = blockBytes(format);
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+    uint8_t block[BLOCK_TEXELS * 4];
+
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            for (int y = 0; y < 4; y++) {
+                int sy = std::min(by * 4 + y, height - 1);
+                for (int x = 0; x < 4; x++) {
+                    int sx = std::min(bx * 4 + x, width - 1);
+                    std::memcpy(block + (y * 4 + x) * 4, rgba.data() + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+                }
+            }
+
+            uint8_t* blockOut = out + (static_cast<size_t>(by) * blocksX + bx) * bytesPerBlock;
+            switch (format) {
+            case BlockFormat::BC1: encodeBC1Block(block, blockOut); break;
+            case BlockFormat::BC3: encodeBC3Block(block, blockOut); break;
+            case BlockFormat::BC5: encodeBC5Block(block, blockOut); break;
+            default: break;
+            }
+        }
+    }
+}
+
+} // namespace
+
+const char* blockFormatName(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::None: return "none";
+    case BlockFormat::Auto: return "auto";
+    case BlockFormat::BC1: return "BC1";
+    case BlockFormat::BC3: return "BC3";
+    case BlockFormat::BC5: return "BC5";
+    }
+    return "unknown";
+}
+
+BlockFormat parseBlockFormat(const std::string& name) {
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == "none") return BlockFormat::None;
+    if (lower == "bc1") return BlockFormat::BC1;
+    if (lower == "bc3") return BlockFormat::BC3;
+    if (lower == "bc5") return BlockFormat::BC5;
+    return BlockFormat::Auto;
+}
+
+size_t blockBytes(BlockFormat format) {
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+GLenum blockFormatInternalFormat(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+    default: return GL_RGBA8;
+    }
+}
+
+BlockFormat defaultBlockFormat(const std::string& samplerType) {
+    return samplerType == "bumpMap" ? BlockFormat::None : BlockFormat::Auto;
+}
+
+void encodeBC1Block(const uint8_t* rgba, uint8_t* out) {
+    float low[3], high[3];
+    principalAxisEndpoints(rgba, low, high);
+
+    uint16_t color0 = packRgb565(high);
+    uint16_t color1 = packRgb565(low);
+    orderBC1Endpoints(color0, color1);
+    if (color0 == color1) {
+        // (Nearly) flat block: straddle it by half a 565 step so the interpolated colors can land closer
+        for (int c = 0; c < 3; c++) {
+            high[c] += c == 1 ? 2.0f : 4.0f;
+            low[c] -= c == 1 ? 2.0f : 4.0f;
+        }
+        color0 = packRgb565(high);
+        color1 = packRgb565(low);
+        orderBC1Endpoints(color0, color1);
+        if (color0 == color1) {
+            writeBC1(color0, color1, 0, out);
+            return;
+        }
+    }
+
+    uint32_t indices;
+    int error = selectBC1Indices(rgba, color0, color1, indices);
+
+    // One least-squares pass usually recovers most of what the endpoint quantization lost
+    float refined0[3], refined1[3];
+    if (refineBC1Endpoints(rgba, indices, refined0, refined1)) {
+        uint16_t candidate0 = packRgb565(refined0);
+        uint16_t candidate1 = packRgb565(refined1);
+        orderBC1Endpoints(candidate0, candidate1);
+        if (candidate0 != candidate1) {
+            uint32_t candidateIndices;
+            int candidateError = selectBC1Indices(rgba, candidate0, candidate1, candidateIndices);
+            if (candidateError < error) {
+                color0 = candidate0;
+                color1 = candidate1;
+                indices = candidateIndices;
+            }
+        }
+    }
+    writeBC1(color0, color1, indices, out);
+}
+
+void encodeBC3Block(const uint8_t* rgba, uint8_t* out) {
+    encodeBC4Block(rgba + 3, 4, out);
+    encodeBC1Block(rgba, out + 8);
+}
+
+void encodeBC5Block(const uint8_t* rgba, uint8_t* out) {
+    encodeBC4Block(rgba + 0, 4, out);
+    encodeBC4Block(rgba + 1, 4, out + 8);
+}
+
+void decodeBC1Block(const uint8_t* block, uint8_t* rgba) {
+    uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+    uint32_t indices;
+    std::memcpy(&indices, block + 4, sizeof(indices));
+
+    int palette[4][3];
+    bc1Palette(color0, color1, palette);
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        int index = (indices >> (i * 2)) & 3;
+        for (int c = 0; c < 3; c++) {
+            rgba[i * 4 + c] = static_cast<uint8_t>(palette[index][c]);
+        }
+        rgba[i * 4 + 3] = (color0 <= color1 && index == 3) ? 0 : 255;
+    }
+}
+
+void decodeBC3Block(const uint8_t* block, uint8_t* rgba) {
+    decodeBC1Block(block + 8, rgba);
+    decodeBC4Block(block, rgba + 3, 4);
+}
+
+void decodeBC5Block(const uint8_t* block, uint8_t* rgba) {
+    decodeBC4Block(block, rgba + 0, 4);
+    decodeBC4Block(block + 8, rgba + 1, 4);
+    for (int i = 0; i < BLOCK_TEXELS; i++) {
+        rgba[i * 4 + 2] = 0;
+        rgba[i * 4 + 3] = 255;
+    }
+}
+
+CompressedImage compressImage(const uint8_t* pixels, int width, int height, int components, BlockFormat format,
+    const MipOptions& mips, ThreadPool* pool) {
+    if (format == BlockFormat::Auto || format == BlockFormat::None) {
+        bool usesAlpha = false;
+        if (components == 2 || components == 4) {
+            size_t count = static_cast<size_t>(width) * height;
+            for (size_t i = 0; i < count && !usesAlpha; i++) {
+                usesAlpha = pixels[i * components + components - 1] != 255;
+            }
+        }
+        format = usesAlpha ? BlockFormat::BC3 : BlockFormat::BC1;
+    }
+    std::vector<MipLevelImage> chain = generateMipChain(pixels, width, height, components, mips, pool);
+
+    CompressedImage image;
+    image.format = format;
+    image.width = static_cast<uint32_t>(width);
+    image.height = static_cast<uint32_t>(height);
+
+    // Size the whole chain first so every level is encoded straight into its final place
+    uint64_t totalSize = 0;
+    for (const MipLevelImage& mip : chain) {
+        CompressedMipLevel level;
+        level.width = static_cast<uint32_t>(mip.width);
+        level.height = static_cast<uint32_t>(mip.height);
+        level.offset = totalSize;
+        level.size = static_cast<uint64_t>((mip.width + 3) / 4) * ((mip.height + 3) / 4) * blockBytes(format);
+        image.levels.push_back(level);
+        totalSize += level.size;
+    }
+    image.data.resize(totalSize);
+
+    for (size_t level = 0; level < chain.size(); level++) {
+        const MipLevelImage& mip = chain[level];
+        encodeLevel(expandToRgba(mip.pixels.data(), mip.width, mip.height, mip.components), mip.width, mip.height,
+            format, image.data.data() + image.levels[level].offset);
+    }
+    return image;
+}
+
+double compressionPsnr(const uint8_t* pixels, int width, int height, int components, const CompressedImage& image) {
+    std::vector<uint8_t> source = expandToRgba(pixels, width, height, components);
+    int channels = image.format == BlockFormat::BC5 ? 2 : (image.format == BlockFormat::BC3 ? 4 : 3);
+    size_t bytesPerBlock = blockBytes(image.format);
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+
+    double squaredError = 0.0;
+    uint8_t decoded[BLOCK_TEXELS * 4];
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            const uint8_t* block = image.levelData(0) + (static_cast<size_t>(by) * blocksX + bx) * bytesPerBlock;
+            switch (image.format) {
+            case BlockFormat::BC1: decodeBC1Block(block, decoded); break;
+            case BlockFormat::BC3: decodeBC3Block(block, decoded); break;
+            case BlockFormat::BC5: decodeBC5Block(block, decoded); break;
+            default: return 0.0;
+            }
+
+            for (int y = 0; y < 4 && by * 4 + y < height; y++) {
+                for (int x = 0; x < 4 && bx * 4 + x < width; x++) {
+                    const uint8_t* original = source.data() + (static_cast<size_t>(by * 4 + y) * width + bx * 4 + x) * 4;
+                    for (int c = 0; c < channels; c++) {
+                        double difference = static_cast<double>(original[c]) - decoded[(y * 4 + x) * 4 + c];
+                        squaredError += difference * difference;
+                    }
+                }
+            }
+        }
+    }
+
+    double meanSquaredError = squaredError / (static_cast<double>(width) * height * channels);
+    if (meanSquaredError <= 0.0) {
+        return 99.0; // Lossless
+    }
+    return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
@@ -0,0 +1,69 @@
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include "GLDispatch.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MipGenerator.h"
+
+// Block-compressed GPU formats the texture pipeline encodes to. All of them store 4x4 texel blocks.
+//   BC1: opaque RGB, 8 bytes per block (6:1 against RGB8)
+//   BC3: RGB plus a separate alpha channel, 16 bytes per block (4:1 against RGBA8)
+//   BC5: two independent channels, 16 bytes per block; tangent-space normal maps store XY and the
+//        shader rebuilds Z, which keeps far more precision than squeezing XYZ into BC1's 565 colors
+// None keeps the 8-bit source pixels; Auto picks BC1 or BC3 depending on whether alpha is used.
+enum class BlockFormat : uint32_t {
+    None = 0,
+    Auto,
+    BC1,
+    BC3,
+    BC5,
+};
+
+const char* blockFormatName(BlockFormat format);
+// Accepts "none", "auto", "bc1", "bc3" and "bc5"; anything else yields Auto
+BlockFormat parseBlockFormat(const std::string& name);
+size_t blockBytes(BlockFormat format);
+GLenum blockFormatInternalFormat(BlockFormat format);
+
+// Default format for a material sampler type. Bump maps stay uncompressed: BC5 only suits normal maps
+// read by a BUMP_MAP_XY shader path, which Material checks before choosing it.
+BlockFormat defaultBlockFormat(const std::string& samplerType);
+
+// Single-block encoders and decoders; blocks are 16 RGBA8 texels in row order
+void encodeBC1Block(const uint8_t* rgba, uint8_t* out);
+void encodeBC3Block(const uint8_t* rgba, uint8_t* out);
+void encodeBC5Block(const uint8_t* rgba, uint8_t* out); // Red and green channels
+void decodeBC1Block(const uint8_t* block, uint8_t* rgba);
+void decodeBC3Block(const uint8_t* block, uint8_t* rgba);
+void decodeBC5Block(const uint8_t* block, uint8_t* rgba); // Blue is 0, alpha 255
+
+struct CompressedMipLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset; // Into CompressedImage::data
+    uint64_t size;
+};
+
+// A block-compressed image with its full mip chain, ready for glCompressedTexImage2D
+struct CompressedImage {
+    BlockFormat format = BlockFormat::None;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<CompressedMipLevel> levels;
+    std::vector<uint8_t> data;
+
+    const uint8_t* levelData(size_t level) const { return data.data() + levels[level].offset; }
+};
+
+// Resolves Auto from the alpha channel, generates the mip chain and encodes every level down to 1x1.
+// components is 1 to 4, as returned by stb_image. The pool, if any, is used for mip filtering.
+CompressedImage compressImage(const uint8_t* pixels, int width, int height, int components, BlockFormat format,
+    const MipOptions& mips, ThreadPool* pool = nullptr);
+
+// Peak signal-to-noise ratio of level 0 against the source over the channels the format keeps
+double compressionPsnr(const uint8_t* pixels, int width, int height, int components, const CompressedImage& image);
+
+#endif
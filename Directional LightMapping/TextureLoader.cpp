@@ -0,0 +1,414 @@
+#include "TextureLoader.h"
+#include "TextureCache.h"
+#include "Profiler.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+double millisecondsBetween(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+} // namespace
+
+TextureLoader::TextureLoader(bool headless, unsigned int workerCount, size_t uploadQueueCapacity)
+    : headless_(headless), workerCount_(workerCount), uploadQueue_(uploadQueueCapacity) {
+}
+
+TextureLoader::~TextureLoader() {
+    // Release anything still in flight; the GL context may already be gone, so nothing is uploaded
+    while (pending_ > 0) {
+        DecodedImage image = uploadQueue_.pop();
+        stbi_image_free(image.pixels);
+        pending_--;
+    }
+    workers_.reset();
+}
+
+ThreadPool& TextureLoader::workers() {
+    if (!workers_) {
+        workers_ = std::make_unique<ThreadPool>(workerCount_);
+    }
+    return *workers_;
+}
+
+GLuint TextureLoader::reserveTexture() {
+    if (headless_) {
+        return nextHeadlessHandle_++;
+    }
+
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    return textureID;
+}
+
+void TextureLoader::queueDecode(GLuint texture, GLenum target, const std::string& path, BlockFormat format,
+    const MipOptions& mips, int layer, int baseLevel) {
+    pending_++;
+    workers().submit([this, texture, target, path, format, mips, layer, baseLevel] {
+        PROFILE_SCOPE("Texture decode");
+        auto start = std::chrono::steady_clock::now();
+
+        DecodedImage image;
+        image.texture = texture;
+        image.target = target;
+        image.layer = layer;
+        image.baseLevel = baseLevel;
+        image.path = path;
+        image.format = format;
+        if (format != BlockFormat::None) {
+            // The source is fingerprinted on its first load only; streaming reloads reuse that fingerprint
+            SourceFingerprint source;
+            {
+                std::lock_guard<std::mutex> lock(sourceFingerprintsMutex_);
+                auto it = sourceFingerprints_.find(path);
+                if (it != sourceFingerprints_.end()) {
+                    source = it->second;
+                }
+            }
+            image.loaded = loadCompressedTexture(path, format, mips, image.compressed, image.cacheHit, source) &&
+                !image.compressed.levels.empty();
+            if (source.hash != 0) {
+                std::lock_guard<std::mutex> lock(sourceFingerprintsMutex_);
+                sourceFingerprints_[path] = source;
+            }
+        }
+        else {
+            image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.components, 0);
+            image.loaded = image.pixels != nullptr;
+            // Cubemap faces are uploaded as decoded; 2D and array textures get their mip chain here
+            bool mipmapped = target == GL_TEXTURE_2D || target == GL_TEXTURE_2D_ARRAY;
+            if (image.loaded && mipmapped) {
+                image.mipChain = generateMipChain(image.pixels, image.width, image.height, image.components, mips);
+                stbi_image_free(image.pixels);
+                image.pixels = nullptr;
+                // The uploads index the chain from its last level; an empty one counts as a failed decode
+                image.loaded = !image.mipChain.empty();
+            }
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        decodeMicroseconds_ += std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+        // Blocks while the GL thread is behind, which caps the amount of decoded pixel data in flight
+        uploadQueue_.push(std::move(image));
+    });
+}
+
+GLuint TextureLoader::load2D(const std::string& path, BlockFormat format, const MipOptions& mips) {
+    processUploads();
+
+    GLuint textureID = reserveTexture();
+    queueDecode(textureID, GL_TEXTURE_2D, path, format, mips);
+    return textureID;
+}
+
+GLuint TextureLoader::loadArray(const std::vector<std::string>& layers, BlockFormat format, const MipOptions& mips,
+    GLuint texture) {
+    processUploads();
+
+    GLuint textureID = texture != 0 ? texture : reserveTexture();
+    if (!headless_) {
+        GLint maxLayers = 0;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+        if (static_cast<GLint>(layers.size()) > maxLayers) {
+            std::cerr << "Texture array: " << layers.size() << " layers exceed the limit of " << maxLayers << std::endl;
+            return textureID;
+        }
+    }
+
+    ArrayTexture& array = arrays_[textureID];
+    array.layerCount = static_cast<int>(layers.size());
+    array.layersRemaining = array.layerCount;
+    for (size_t i = 0; i < layers.size(); i++) {
+        queueDecode(textureID, GL_TEXTURE_2D_ARRAY, layers[i], format, mips, static_cast<int>(i));
+    }
+    return textureID;
+}
+
+void TextureLoader::reload2D(GLuint texture, const std::string& path, BlockFormat format, const MipOptions& mips, int baseLevel) {
+    processUploads();
+
+    reloadBaseLevels_[texture] = baseLevel;
+    queueDecode(texture, GL_TEXTURE_2D, path, format, mips, 0, baseLevel);
+}
+
+GLuint TextureLoader::loadCubemap(const std::vector<std::string>& faces) {
+    processUploads();
+
+    GLuint textureID = reserveTexture();
+    if (!headless_) {
+        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+
+    for (unsigned int i = 0; i < faces.size(); i++) {
+        queueDecode(textureID, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, faces[i], BlockFormat::None, MipOptions());
+    }
+    return textureID;
+}
+
+size_t TextureLoader::processUploads() {
+    size_t uploaded = 0;
+    DecodedImage image;
+    while (pending_ > 0 && uploadQueue_.tryPop(image)) {
+        upload(image);
+        uploaded++;
+    }
+    return uploaded;
+}
+
+void TextureLoader::finish() {
+    while (pending_ > 0) {
+        auto waitStart = std::chrono::steady_clock::now();
+        DecodedImage image = uploadQueue_.pop();
+        waitMs_ += millisecondsBetween(waitStart, std::chrono::steady_clock::now());
+        upload(image);
+    }
+
+    if (imagesUploaded_ > 0) {
+        std::cout << "Texture loader: " << imagesUploaded_ << " images ("
+            << bytesUploaded_ / (1024.0 * 1024.0) << " MB) decoded on " << workers().size() << " threads, "
+            << decodeMicroseconds_ / 1000.0 << " ms decode CPU, "
+            << uploadMs_ << " ms " << (headless_ ? "discard" : "upload") << " on the calling thread, "
+            << waitMs_ << " ms waiting for decodes" << std::endl;
+    }
+    if (compressedImages_ > 0) {
+        std::cout << "Texture loader: " << compressedImages_ << " block-compressed, "
+            << compressedCacheHits_ << " from the texture cache" << std::endl;
+    }
+
+    imagesUploaded_ = 0;
+    bytesUploaded_ = 0;
+    compressedImages_ = 0;
+    compressedCacheHits_ = 0;
+    decodeMicroseconds_ = 0;
+    uploadMs_ = 0.0;
+    waitMs_ = 0.0;
+}
+
+void TextureLoader::upload(DecodedImage& image) {
+    auto start = std::chrono::steady_clock::now();
+    pending_--;
+
+    if (!image.loaded) {
+        if (image.target == GL_TEXTURE_2D_ARRAY) {
+            std::cerr << "Texture array layer failed to load at path: " << image.path << std::endl;
+            if (--arrays_[image.texture].layersRemaining == 0) {
+                arrays_.erase(image.texture);
+            }
+        }
+        else if (image.target == GL_TEXTURE_2D) {
+            std::cerr << "Texture failed to load at path: " << image.path << std::endl;
+        }
+        else {
+            std::cerr << "Cubemap texture failed to load at path: " << image.path << std::endl;
+        }
+        return;
+    }
+
+    if (image.target == GL_TEXTURE_2D_ARRAY) {
+        uploadArrayLayer(image);
+        uploadMs_ += millisecondsBetween(start, std::chrono::steady_clock::now());
+        return;
+    }
+
+    // Decodes may finish out of order; only the latest reload of a texture is uploaded
+    auto reload = reloadBaseLevels_.find(image.texture);
+    if (reload != reloadBaseLevels_.end() && reload->second != image.baseLevel) {
+        return;
+    }
+
+    if (image.format != BlockFormat::None) {
+        if (!headless_) {
+            const CompressedImage& compressed = image.compressed;
+            GLenum internalFormat = blockFormatInternalFormat(compressed.format);
+            size_t baseLevel = std::min(static_cast<size_t>(image.baseLevel), compressed.levels.size() - 1);
+            glBindTexture(GL_TEXTURE_2D, image.texture);
+            for (size_t level = baseLevel; level < compressed.levels.size(); level++) {
+                const CompressedMipLevel& mip = compressed.levels[level];
+                glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level - baseLevel), internalFormat, mip.width, mip.height, 0,
+                    static_cast<GLsizei>(mip.size), compressed.levelData(level));
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(compressed.levels.size() - baseLevel) - 1);
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+
+        imagesUploaded_++;
+        compressedImages_++;
+        compressedCacheHits_ += image.cacheHit ? 1 : 0;
+        bytesUploaded_ += image.compressed.data.size();
+        image.compressed = CompressedImage();
+        uploadMs_ += millisecondsBetween(start, std::chrono::steady_clock::now());
+        return;
+    }
+
+    if (image.target == GL_TEXTURE_2D) {
+        if (!headless_) {
+            GLenum format = GL_RGB;
+            if (image.components == 1)
+                format = GL_RED;
+            else if (image.components == 2)
+                format = GL_RG;
+            else if (image.components == 3)
+                format = GL_RGB;
+            else if (image.components == 4)
+                format = GL_RGBA;
+
+            // The small levels of RGB and RG images have rows that are not 4-byte aligned
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            size_t baseLevel = std::min(static_cast<size_t>(image.baseLevel), image.mipChain.size() - 1);
+            glBindTexture(GL_TEXTURE_2D, image.texture);
+            for (size_t level = baseLevel; level < image.mipChain.size(); level++) {
+                const MipLevelImage& mip = image.mipChain[level];
+                glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level - baseLevel), format, mip.width, mip.height, 0, format,
+                    GL_UNSIGNED_BYTE, mip.pixels.data());
+            }
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.mipChain.size() - baseLevel) - 1);
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+
+        imagesUploaded_++;
+        for (const MipLevelImage& mip : image.mipChain) {
+            bytesUploaded_ += mip.pixels.size();
+        }
+        image.mipChain.clear();
+        uploadMs_ += millisecondsBetween(start, std::chrono::steady_clock::now());
+        return;
+    }
+
+    if (!headless_) {
+        glBindTexture(GL_TEXTURE_CUBE_MAP, image.texture);
+        glTexImage2D(image.target, 0, GL_RGB, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.pixels);
+    }
+
+    imagesUploaded_++;
+    bytesUploaded_ += static_cast<size_t>(image.width) * image.height * image.components;
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+
+    uploadMs_ += millisecondsBetween(start, std::chrono::steady_clock::now());
+}
+
+void TextureLoader::uploadArrayLayer(DecodedImage& image) {
+    static const GLenum UNCOMPRESSED_FORMATS[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    static const GLenum UNCOMPRESSED_INTERNAL_FORMATS[4] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+
+    bool compressed = image.format != BlockFormat::None;
+    int components = compressed ? 0 : image.mipChain[0].components;
+    GLenum internalFormat = compressed ? blockFormatInternalFormat(image.compressed.format)
+        : UNCOMPRESSED_INTERNAL_FORMATS[components - 1];
+    int width = compressed ? static_cast<int>(image.compressed.width) : image.mipChain[0].width;
+    int height = compressed ? static_cast<int>(image.compressed.height) : image.mipChain[0].height;
+    size_t levelCount = compressed ? image.compressed.levels.size() : image.mipChain.size();
+
+    ArrayTexture& array = arrays_[image.texture];
+    if (!array.allocated) {
+        array.allocated = true;
+        array.internalFormat = internalFormat;
+        array.width = width;
+        array.height = height;
+        array.levelCount = levelCount;
+        if (!headless_) {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, image.texture);
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLsizei>(levelCount), internalFormat, width, height, array.layerCount);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+    }
+
+    bool matches = array.internalFormat == internalFormat && array.width == width && array.height == height &&
+        array.levelCount == levelCount;
+    if (!matches) {
+        std::cerr << "Texture array layer " << image.layer << " does not match the size or format of the first layer: "
+            << image.path << std::endl;
+    }
+    else {
+        if (!headless_) {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, image.texture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            for (size_t level = 0; level < levelCount; level++) {
+                if (compressed) {
+                    const CompressedMipLevel& mip = image.compressed.levels[level];
+                    glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), 0, 0, image.layer,
+                        mip.width, mip.height, 1, internalFormat, static_cast<GLsizei>(mip.size), image.compressed.levelData(level));
+                }
+                else {
+                    const MipLevelImage& mip = image.mipChain[level];
+                    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), 0, 0, image.layer, mip.width, mip.height, 1,
+                        UNCOMPRESSED_FORMATS[components - 1], GL_UNSIGNED_BYTE, mip.pixels.data());
+                }
+            }
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        }
+
+        imagesUploaded_++;
+        if (compressed) {
+            compressedImages_++;
+            compressedCacheHits_ += image.cacheHit ? 1 : 0;
+            bytesUploaded_ += image.compressed.data.size();
+        }
+        else {
+            for (const MipLevelImage& mip : image.mipChain) {
+                bytesUploaded_ += mip.pixels.size();
+            }
+        }
+    }
+
+    image.compressed = CompressedImage();
+    image.mipChain.clear();
+    if (--array.layersRemaining == 0) {
+        arrays_.erase(image.texture);
+    }
+}
+
+namespace {
+
+double decodeAll(const std::vector<std::string>& paths, unsigned int workerCount) {
+    auto start = std::chrono::steady_clock::now();
+
+    TextureLoader loader(true, workerCount);
+    for (const auto& path : paths) {
+        loader.load2D(path);
+    }
+    loader.finish();
+
+    return millisecondsBetween(start, std::chrono::steady_clock::now());
+}
+
+} // namespace
+
+void runTextureDecodeBenchmark(const std::vector<std::string>& paths) {
+    if (paths.empty()) {
+        std::cerr << "Texture decode benchmark: no images to decode" << std::endl;
+        return;
+    }
+
+    unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "Texture decode benchmark: " << paths.size() << " images" << std::endl;
+    double serialMs = decodeAll(paths, 1);
+    double parallelMs = decodeAll(paths, threadCount);
+
+    std::cout << "  1 thread:  " << serialMs << " ms" << std::endl;
+    std::cout << "  " << threadCount << " threads: " << parallelMs << " ms ("
+        << serialMs / std::max(parallelMs, 0.001) << "x)" << std::endl;
+}
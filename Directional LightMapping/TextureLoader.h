@@ -0,0 +1,114 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include "GLDispatch.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "BoundedQueue.h"
+#include "Hash.h"
+#include "TextureCompression.h"
+#include "ThreadPool.h"
+
+// Decodes texture images on a worker pool and uploads them on the GL thread.
+// Texture names are reserved as soon as a load is requested so materials can keep
+// the handle right away; the image storage is filled in when processUploads() or
+// finish() drains the decoded images from the bounded upload queue.
+// 2D textures get their mip chain generated on the worker, never with glGenerateMipmap.
+// Those requested with a block format are read from the texture cache, or encoded on the
+// worker and cached, so the GL thread only uploads levels.
+// In headless mode no GL calls are made: handles are placeholders and decoded
+// pixels are discarded, which lets decoding be benchmarked without a GPU.
+class TextureLoader {
+public:
+    explicit TextureLoader(bool headless = false, unsigned int workerCount = 0, size_t uploadQueueCapacity = 8);
+    ~TextureLoader();
+
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    GLuint load2D(const std::string& path, BlockFormat format = BlockFormat::None, const MipOptions& mips = MipOptions());
+    GLuint loadCubemap(const std::vector<std::string>& faces);
+
+    // One GL_TEXTURE_2D_ARRAY with a layer per image. Storage is allocated from the first layer
+    // that finishes decoding; layers with a different size, format or level count are skipped.
+    // Pass a name from glGenTextures as texture to fill a texture that was handed out earlier.
+    GLuint loadArray(const std::vector<std::string>& layers, BlockFormat format, const MipOptions& mips, GLuint texture = 0);
+
+    // Re-specifies a loaded 2D texture with level baseLevel of the source as its level 0, keeping the
+    // texture name. Used by texture streaming; a newer request for the same texture supersedes older ones.
+    // Block-compressed reloads reuse the source fingerprint taken by the first load instead of hashing again.
+    void reload2D(GLuint texture, const std::string& path, BlockFormat format, const MipOptions& mips, int baseLevel);
+
+    // Uploads whatever has finished decoding without blocking; call from the GL thread
+    size_t processUploads();
+
+    // Blocks until every requested texture has been uploaded
+    void finish();
+
+    size_t pendingCount() const { return pending_; }
+
+private:
+    struct DecodedImage {
+        GLuint texture = 0;
+        GLenum target = GL_TEXTURE_2D; // GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY or one GL_TEXTURE_CUBE_MAP_* face
+        int layer = 0;                 // Array layer
+        int baseLevel = 0;             // Source level uploaded as level 0
+        std::string path;
+        int width = 0;
+        int height = 0;
+        int components = 0;
+        unsigned char* pixels = nullptr;            // Cubemap faces only
+        std::vector<MipLevelImage> mipChain;        // Uncompressed 2D and array textures
+        CompressedImage compressed;                 // Block-compressed 2D and array textures
+        BlockFormat format = BlockFormat::None;
+        bool loaded = false;
+        bool cacheHit = false;
+    };
+
+    GLuint reserveTexture();
+    // Storage of an array texture, fixed by the first layer uploaded
+    struct ArrayTexture {
+        int layerCount = 0;
+        int layersRemaining = 0;
+        bool allocated = false;
+        GLenum internalFormat = GL_NONE;
+        int width = 0;
+        int height = 0;
+        size_t levelCount = 0;
+    };
+
+    void queueDecode(GLuint texture, GLenum target, const std::string& path, BlockFormat format, const MipOptions& mips,
+        int layer = 0, int baseLevel = 0);
+    void upload(DecodedImage& image);
+    void uploadArrayLayer(DecodedImage& image);
+    ThreadPool& workers();
+
+    bool headless_;
+    unsigned int workerCount_;
+    std::unique_ptr<ThreadPool> workers_; // Started on the first request
+    BoundedQueue<DecodedImage> uploadQueue_;
+    std::unordered_map<GLuint, ArrayTexture> arrays_;
+    std::unordered_map<GLuint, int> reloadBaseLevels_; // Latest reload2D request per texture
+    std::mutex sourceFingerprintsMutex_;
+    std::unordered_map<std::string, SourceFingerprint> sourceFingerprints_; // Of block-compressed sources, by path
+    size_t pending_ = 0;
+    GLuint nextHeadlessHandle_ = 1;
+
+    // Statistics, reported by finish()
+    std::atomic<long long> decodeMicroseconds_{ 0 };
+    size_t imagesUploaded_ = 0;
+    size_t bytesUploaded_ = 0;
+    size_t compressedImages_ = 0;
+    size_t compressedCacheHits_ = 0;
+    double uploadMs_ = 0.0;
+    double waitMs_ = 0.0;
+};
+
+// Decodes every image with 1 thread and then with the full pool in headless mode and prints the timings
+void runTextureDecodeBenchmark(const std::vector<std::string>& paths);
+
+#endif
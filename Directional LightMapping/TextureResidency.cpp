@@ -0,0 +1,273 @@
+#include "TextureResidency.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+
+void ResidencyStats::print(std::ostream& out) const {
+    double requestCount = static_cast<double>(std::max<unsigned long long>(requests, 1));
+    out << "Texture residency: " << residentBytes / (1024.0 * 1024.0) << " MB resident (peak "
+        << peakResidentBytes / (1024.0 * 1024.0) << " MB), " << requests << " requests, "
+        << 100.0 * hits / requestCount << "% hits, " << misses << " misses, "
+        << levelsStreamedIn << " levels streamed in (" << bytesStreamedIn / (1024.0 * 1024.0) << " MB), "
+        << levelsEvicted << " evicted, " << overBudgetFrames << " frames over budget" << std::endl;
+}
+
+int desiredMipLevel(int width, int height, float tiling, float screenPixels, int levelCount) {
+    if (screenPixels <= 0.0f) {
+        return levelCount - 1;
+    }
+    float texelsAcross = static_cast<float>(std::max(width, height)) * std::max(tiling, 1e-3f);
+    float lod = std::log2(texelsAcross / screenPixels);
+    return std::clamp(static_cast<int>(std::floor(lod)), 0, levelCount - 1);
+}
+
+float projectedSizePixels(const AABB& bounds, const glm::vec3& eye, float projectionScaleY, float viewportHeight) {
+    float radius = glm::length(bounds.extent());
+    float distance = glm::length(bounds.center() - eye);
+    if (distance <= radius) {
+        // The camera is inside the bounds, so the object can cover the whole screen
+        return viewportHeight;
+    }
+    return radius / distance * projectionScaleY * viewportHeight;
+}
+
+uint32_t TextureResidency::addTexture(const std::vector<size_t>& levelBytes, int width, int height) {
+    Entry entry;
+    entry.bytesFrom.assign(levelBytes.size() + 1, 0);
+    for (size_t level = levelBytes.size(); level-- > 0;) {
+        entry.bytesFrom[level] = entry.bytesFrom[level + 1] + levelBytes[level];
+    }
+
+    int levelCount = std::max(static_cast<int>(levelBytes.size()), 1);
+    while (entry.floor < levelCount - 1 &&
+        (std::max(width >> entry.floor, 1) > options_.alwaysResidentSize || std::max(height >> entry.floor, 1) > options_.alwaysResidentSize)) {
+        entry.floor++;
+    }
+
+    stats_.residentBytes += entry.bytesFrom[0];
+    stats_.peakResidentBytes = std::max(stats_.peakResidentBytes, stats_.residentBytes);
+    textures_.push_back(std::move(entry));
+    return static_cast<uint32_t>(textures_.size() - 1);
+}
+
+void TextureResidency::beginFrame() {
+    frame_++;
+    for (auto& entry : textures_) {
+        entry.requested = -1;
+    }
+}
+
+void TextureResidency::request(uint32_t texture, int level) {
+    Entry& entry = textures_[texture];
+    level = std::clamp(level, 0, entry.floor);
+    entry.requested = entry.requested < 0 ? level : std::min(entry.requested, level);
+    entry.lastUsed = frame_;
+}
+
+const std::vector<ResidencyChange>& TextureResidency::update() {
+    changes_.clear();
+    targets_.resize(textures_.size());
+
+    // Textures in view get at least their requested level and keep anything sharper while it fits;
+    // the rest keep what they have until evicted
+    size_t total = 0;
+    for (size_t i = 0; i < textures_.size(); i++) {
+        const Entry& entry = textures_[i];
+        targets_[i] = entry.requested >= 0 ? std::min(entry.requested, entry.resident) : entry.resident;
+        total += bytesAt(entry, targets_[i]);
+    }
+
+    // Over budget: drop the least recently used textures that are out of view to their floor
+    if (total > options_.budgetBytes) {
+        std::vector<uint32_t> idle;
+        for (uint32_t i = 0; i < textures_.size(); i++) {
+            if (textures_[i].requested < 0 && targets_[i] < textures_[i].floor) {
+                idle.push_back(i);
+            }
+        }
+        std::sort(idle.begin(), idle.end(), [this](uint32_t a, uint32_t b) {
+            if (textures_[a].lastUsed != textures_[b].lastUsed) {
+                return textures_[a].lastUsed < textures_[b].lastUsed;
+            }
+            return bytesAt(textures_[a], targets_[a]) > bytesAt(textures_[b], targets_[b]);
+        });
+        for (uint32_t i = 0; i < idle.size() && total > options_.budgetBytes; i++) {
+            const Entry& entry = textures_[idle[i]];
+            total -= bytesAt(entry, targets_[idle[i]]) - bytesAt(entry, entry.floor);
+            targets_[idle[i]] = entry.floor;
+        }
+    }
+
+    // Then give up the largest visible levels one at a time: first those sharper than requested,
+    // and only if the view itself does not fit, requested ones down to the floor
+    auto topLevelBytes = [this](uint32_t i) {
+        return bytesAt(textures_[i], targets_[i]) - bytesAt(textures_[i], targets_[i] + 1);
+    };
+    for (int pass = 0; pass < 2 && total > options_.budgetBytes; pass++) {
+        auto limit = [this, pass](uint32_t i) {
+            return pass == 0 && textures_[i].requested >= 0 ? textures_[i].requested : textures_[i].floor;
+        };
+        std::priority_queue<std::pair<size_t, uint32_t>> largest;
+        for (uint32_t i = 0; i < textures_.size(); i++) {
+            if (targets_[i] < limit(i)) {
+                largest.push({ topLevelBytes(i), i });
+            }
+        }
+        if (pass == 1 && !largest.empty()) {
+            stats_.overBudgetFrames++;
+        }
+        while (total > options_.budgetBytes && !largest.empty()) {
+            uint32_t i = largest.top().second;
+            largest.pop();
+            total -= topLevelBytes(i);
+            targets_[i]++;
+            if (targets_[i] < limit(i)) {
+                largest.push({ topLevelBytes(i), i });
+            }
+        }
+    }
+
+    // Stream in the most blurred textures first, within the per-frame transfer cap
+    std::vector<uint32_t> streaming;
+    for (uint32_t i = 0; i < textures_.size(); i++) {
+        if (targets_[i] < textures_[i].resident) {
+            streaming.push_back(i);
+        }
+    }
+    std::sort(streaming.begin(), streaming.end(), [this](uint32_t a, uint32_t b) {
+        return textures_[a].resident - targets_[a] > textures_[b].resident - targets_[b];
+    });
+    size_t streamedBytes = 0;
+    for (uint32_t i : streaming) {
+        const Entry& entry = textures_[i];
+        int level = entry.resident;
+        while (level > targets_[i]) {
+            size_t cost = bytesAt(entry, level - 1) - bytesAt(entry, level);
+            // At least one level per frame, so a texture larger than the cap still makes progress
+            if (streamedBytes > 0 && streamedBytes + cost > options_.maxStreamInBytesPerFrame) {
+                break;
+            }
+            streamedBytes += cost;
+            level--;
+        }
+        targets_[i] = level;
+    }
+
+    for (uint32_t i = 0; i < textures_.size(); i++) {
+        Entry& entry = textures_[i];
+        if (targets_[i] > entry.resident) {
+            stats_.levelsEvicted += targets_[i] - entry.resident;
+        }
+        else if (targets_[i] < entry.resident) {
+            stats_.levelsStreamedIn += entry.resident - targets_[i];
+            stats_.bytesStreamedIn += bytesAt(entry, targets_[i]) - bytesAt(entry, entry.resident);
+        }
+        if (targets_[i] != entry.resident) {
+            stats_.residentBytes = stats_.residentBytes - bytesAt(entry, entry.resident) + bytesAt(entry, targets_[i]);
+            entry.resident = targets_[i];
+            changes_.push_back({ i, entry.resident });
+        }
+
+        // Counted after the decisions, since that is what this frame samples
+        if (entry.requested >= 0) {
+            stats_.requests++;
+            if (entry.resident <= entry.requested) {
+                stats_.hits++;
+            }
+            else {
+                stats_.misses++;
+            }
+        }
+    }
+    stats_.peakResidentBytes = std::max(stats_.peakResidentBytes, stats_.residentBytes);
+    return changes_;
+}
+
+void TextureResidency::resetStats() {
+    size_t resident = stats_.residentBytes;
+    stats_ = ResidencyStats();
+    stats_.residentBytes = resident;
+    stats_.peakResidentBytes = resident;
+}
+
+void runResidencySimulation(size_t textureCount, size_t frameCount, size_t budgetMegabytes) {
+    const float worldSize = 600.0f;
+    const float fovY = glm::radians(45.0f);
+    const float viewportHeight = 1080.0f;
+
+    // Synthetic level: one BC1 texture per object, 256 to 2048 texels square
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> position(-worldSize * 0.5f, worldSize * 0.5f);
+    std::uniform_real_distribution<float> size(1.0f, 20.0f);
+    std::uniform_int_distribution<int> sizeClass(8, 11);
+
+    ResidencyOptions options;
+    options.budgetBytes = budgetMegabytes << 20;
+    TextureResidency residency(options);
+    std::vector<AABB> bounds(textureCount);
+    std::vector<int> textureSizes(textureCount);
+    std::vector<int> levelCounts(textureCount);
+    size_t fullBytes = 0;
+    for (size_t i = 0; i < textureCount; i++) {
+        glm::vec3 center(position(rng), size(rng), position(rng));
+        glm::vec3 halfSize(size(rng), size(rng), size(rng));
+        bounds[i].min = center - halfSize;
+        bounds[i].max = center + halfSize;
+
+        int texels = 1 << sizeClass(rng);
+        std::vector<size_t> levelBytes;
+        for (int level = texels; level >= 1; level /= 2) {
+            levelBytes.push_back(static_cast<size_t>((level + 3) / 4) * ((level + 3) / 4) * 8);
+        }
+        textureSizes[i] = texels;
+        levelCounts[i] = static_cast<int>(levelBytes.size());
+        residency.addTexture(levelBytes, texels, texels);
+        fullBytes += levelBytes.empty() ? 0 : levelBytes[0] * 4 / 3;
+    }
+
+    // Camera path through the level, looking along the direction of travel
+    std::vector<glm::vec3> path;
+    const int controlPoints = 8;
+    for (int i = 0; i < controlPoints; i++) {
+        float angle = glm::radians(360.0f * i / controlPoints);
+        float radius = worldSize * (i % 2 == 0 ? 0.35f : 0.15f);
+        path.push_back(glm::vec3(std::cos(angle) * radius, 6.0f + 4.0f * (i % 3), std::sin(angle) * radius));
+    }
+    glm::mat4 projection = glm::perspective(fovY, 16.0f / 9.0f, 0.1f, 500.0f);
+
+    // The initial trim to the budget is a load-time cost, not a streaming one
+    residency.beginFrame();
+    residency.update();
+    residency.resetStats();
+
+    double updateMs = 0.0;
+    size_t changes = 0;
+    for (size_t frame = 0; frame < frameCount; frame++) {
+        float t = static_cast<float>(frame) / frameCount;
+        glm::vec3 eye = samplePath(path, t);
+        glm::vec3 target = samplePath(path, t + 0.5f / (controlPoints * 4.0f));
+        Frustum frustum = Frustum::fromMatrix(projection * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+        auto start = std::chrono::steady_clock::now();
+        residency.beginFrame();
+        for (size_t i = 0; i < textureCount; i++) {
+            if (frustum.intersects(bounds[i])) {
+                float pixels = projectedSizePixels(bounds[i], eye, projection[1][1], viewportHeight);
+                residency.request(static_cast<uint32_t>(i), desiredMipLevel(textureSizes[i], textureSizes[i], 1.0f, pixels, levelCounts[i]));
+            }
+        }
+        changes += residency.update().size();
+        updateMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double frames = static_cast<double>(std::max<size_t>(frameCount, 1));
+    std::cout << "Residency simulation: " << textureCount << " textures (" << fullBytes / (1024.0 * 1024.0)
+        << " MB fully resident), " << budgetMegabytes << " MB budget, " << frameCount << " frames" << std::endl;
+    std::cout << "  " << updateMs / frames << " ms/frame deciding, " << changes / frames << " textures changed per frame" << std::endl;
+    std::cout << "  ";
+    residency.stats().print(std::cout);
+}
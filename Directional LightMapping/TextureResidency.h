@@ -0,0 +1,95 @@
+#ifndef TEXTURE_RESIDENCY_H
+#define TEXTURE_RESIDENCY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Culling.h"
+
+struct ResidencyOptions {
+    size_t budgetBytes = size_t(256) << 20;
+    // Levels no larger than this on either side are never evicted, so every texture can be sampled
+    int alwaysResidentSize = 64;
+    // Caps how much is streamed in per frame; evictions are never deferred
+    size_t maxStreamInBytesPerFrame = size_t(8) << 20;
+};
+
+struct ResidencyStats {
+    unsigned long long requests = 0;  // Texture uses, one per texture per frame
+    unsigned long long hits = 0;      // Resident level was at least as sharp as requested
+    unsigned long long misses = 0;
+    unsigned long long levelsStreamedIn = 0;
+    unsigned long long levelsEvicted = 0;
+    unsigned long long bytesStreamedIn = 0;
+    unsigned long long overBudgetFrames = 0; // Frames whose visible textures alone did not fit
+    size_t residentBytes = 0;
+    size_t peakResidentBytes = 0;
+
+    void print(std::ostream& out) const;
+};
+
+// New base level of a texture: levels baseLevel..levelCount-1 are resident
+struct ResidencyChange {
+    uint32_t texture;
+    int baseLevel;
+};
+
+// Sharpest level worth keeping for a texture stretched over an object spanning screenPixels,
+// with tiling repeats across it: one texel per pixel. No samples on screen gives the coarsest level.
+int desiredMipLevel(int width, int height, float tiling, float screenPixels, int levelCount);
+
+// Approximate on-screen diameter in pixels of the bounds' enclosing sphere.
+// projectionScaleY is projection[1][1], i.e. 1 / tan(fovY / 2).
+float projectedSizePixels(const AABB& bounds, const glm::vec3& eye, float projectionScaleY, float viewportHeight);
+
+// Decides which mip levels of every texture stay in video memory. Textures start fully resident.
+// Each frame the renderer requests the level it needs for every texture in view; update() then
+// streams in the missing levels, evicts the least recently used textures down to their always-
+// resident levels while over budget, and only then coarsens textures in view, largest first.
+// Pure bookkeeping, no GL calls: the caller applies the returned changes.
+class TextureResidency {
+public:
+    explicit TextureResidency(const ResidencyOptions& options = ResidencyOptions()) : options_(options) {}
+
+    // Bytes of every level, largest first, and the size of level 0
+    uint32_t addTexture(const std::vector<size_t>& levelBytes, int width, int height);
+
+    void beginFrame();
+    // Called per use; the sharpest request of the frame wins
+    void request(uint32_t texture, int level);
+    // Returns the textures whose resident base level changed this frame
+    const std::vector<ResidencyChange>& update();
+
+    int residentLevel(uint32_t texture) const { return textures_[texture].resident; }
+    int floorLevel(uint32_t texture) const { return textures_[texture].floor; }
+    size_t residentBytes() const { return stats_.residentBytes; }
+    size_t textureCount() const { return textures_.size(); }
+    const ResidencyOptions& options() const { return options_; }
+    const ResidencyStats& stats() const { return stats_; }
+    void resetStats();
+
+private:
+    struct Entry {
+        std::vector<size_t> bytesFrom; // bytesFrom[b]: size of levels b..end, one extra 0 at the end
+        int floor = 0;                 // Coarsest allowed base level, set by alwaysResidentSize
+        int resident = 0;
+        int requested = -1;            // -1 when not used this frame
+        uint64_t lastUsed = 0;
+    };
+
+    size_t bytesAt(const Entry& entry, int level) const { return entry.bytesFrom[level]; }
+
+    ResidencyOptions options_;
+    std::vector<Entry> textures_;
+    std::vector<ResidencyChange> changes_;
+    std::vector<int> targets_;
+    uint64_t frame_ = 0;
+    ResidencyStats stats_;
+};
+
+// Replays a looping camera path over a synthetic level and prints the residency statistics
+void runResidencySimulation(size_t textureCount, size_t frameCount, size_t budgetMegabytes);
+
+#endif
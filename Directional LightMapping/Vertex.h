@@ -0,0 +1,15 @@
+#ifndef VERTEX_H
+#define VERTEX_H
+
+#include <glm/glm.hpp>
+
+struct Vertex {
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;         // For diffuse texture
+    glm::vec2 LightmapTexCoords; // For lightmap texture
+    glm::vec3 Tangent;
+    glm::vec3 Bitangent;
+};
+
+#endif
@@ -0,0 +1,227 @@
+#include "VertexPacking.h"
+#include "Culling.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+
+const float RADIANS_TO_DEGREES = 57.2957795f;
+
+glm::vec3 safeNormalize(const glm::vec3& v) {
+    float length = glm::length(v);
+    return length > 1e-12f ? v / length : glm::vec3(0.0f, 0.0f, 1.0f);
+}
+
+float angleDegrees(const glm::vec3& a, const glm::vec3& b) {
+    float cosine = glm::dot(safeNormalize(a), safeNormalize(b));
+    return std::acos(std::min(std::max(cosine, -1.0f), 1.0f)) * RADIANS_TO_DEGREES;
+}
+
+uint32_t packSnorm(float value, int bits) {
+    int maxValue = (1 << (bits - 1)) - 1;
+    int quantized = static_cast<int>(std::lround(std::min(std::max(value, -1.0f), 1.0f) * maxValue));
+    return static_cast<uint32_t>(quantized) & ((1u << bits) - 1);
+}
+
+float unpackSnorm(uint32_t bitsValue, int bits) {
+    // Sign-extend, then apply the GL 4.2 rule f = max(c / (2^(b-1) - 1), -1)
+    int shift = 32 - bits;
+    int value = static_cast<int>(bitsValue << shift) >> shift;
+    return std::max(value / static_cast<float>((1 << (bits - 1)) - 1), -1.0f);
+}
+
+} // namespace
+
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int exponent = static_cast<int>((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (((bits >> 23) & 0xFF) == 0xFF) {
+        // Infinity or NaN
+        return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    }
+    if (exponent >= 31) {
+        return static_cast<uint16_t>(sign | 0x7C00);
+    }
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return static_cast<uint16_t>(sign);
+        }
+        // Denormal: shift in the implicit bit and round to nearest even
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1))) {
+            half++;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+        half++; // May carry into the exponent, which rounds up to the next power of two or infinity
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+float halfToFloat(uint16_t half) {
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+
+    uint32_t bits;
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        }
+        else {
+            // Denormal: normalize it
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x400) == 0) {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+        }
+    }
+    else if (exponent == 0x1F) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint32_t packSnorm1010102(const glm::vec3& v, float w) {
+    return packSnorm(v.x, 10) | (packSnorm(v.y, 10) << 10) | (packSnorm(v.z, 10) << 20) | (packSnorm(w, 2) << 30);
+}
+
+glm::vec4 unpackSnorm1010102(uint32_t packed) {
+    return glm::vec4(unpackSnorm(packed & 0x3FF, 10), unpackSnorm((packed >> 10) & 0x3FF, 10),
+        unpackSnorm((packed >> 20) & 0x3FF, 10), unpackSnorm(packed >> 30, 2));
+}
+
+PositionDequantization packVertices(const Vertex* vertices, size_t count, PackedVertex* out) {
+    AABB bounds = computeBounds(vertices, count);
+    glm::vec3 extent = bounds.isEmpty() ? glm::vec3(0.0f) : bounds.max - bounds.min;
+
+    PositionDequantization dequantization;
+    dequantization.scale = glm::vec4(extent, 0.0f);
+    dequantization.offset = glm::vec4(bounds.isEmpty() ? glm::vec3(0.0f) : bounds.min, 0.0f);
+
+    for (size_t i = 0; i < count; i++) {
+        const Vertex& v = vertices[i];
+        PackedVertex& p = out[i];
+
+        for (int axis = 0; axis < 3; axis++) {
+            float t = extent[axis] > 0.0f ? (v.Position[axis] - bounds.min[axis]) / extent[axis] : 0.0f;
+            p.Position[axis] = static_cast<uint16_t>(std::lround(std::min(std::max(t, 0.0f), 1.0f) * 65535.0f));
+        }
+        p.Position[3] = 0;
+
+        glm::vec3 normal = safeNormalize(v.Normal);
+        glm::vec3 tangent = safeNormalize(v.Tangent);
+        float bitangentSign = glm::dot(glm::cross(normal, tangent), v.Bitangent) < 0.0f ? -1.0f : 1.0f;
+        p.Normal = packSnorm1010102(normal, 0.0f);
+        p.Tangent = packSnorm1010102(tangent, bitangentSign);
+
+        p.TexCoords[0] = floatToHalf(v.TexCoords.x);
+        p.TexCoords[1] = floatToHalf(v.TexCoords.y);
+        p.LightmapTexCoords[0] = floatToHalf(v.LightmapTexCoords.x);
+        p.LightmapTexCoords[1] = floatToHalf(v.LightmapTexCoords.y);
+    }
+    return dequantization;
+}
+
+VertexPackingReport measurePackingError(const Vertex* vertices, const PackedVertex* packed, size_t count,
+    const PositionDequantization& dequantization) {
+    VertexPackingReport report;
+    report.vertexCount = count;
+
+    for (size_t i = 0; i < count; i++) {
+        const Vertex& v = vertices[i];
+        const PackedVertex& p = packed[i];
+
+        glm::vec3 quantized(p.Position[0] / 65535.0f, p.Position[1] / 65535.0f, p.Position[2] / 65535.0f);
+        glm::vec3 position = glm::vec3(dequantization.offset) + quantized * glm::vec3(dequantization.scale);
+        glm::vec3 positionError = glm::abs(position - v.Position);
+        report.maxPositionError = std::max(report.maxPositionError,
+            std::max(positionError.x, std::max(positionError.y, positionError.z)));
+
+        glm::vec3 normal = glm::vec3(unpackSnorm1010102(p.Normal));
+        glm::vec4 tangent = unpackSnorm1010102(p.Tangent);
+        glm::vec3 bitangent = glm::cross(normal, glm::vec3(tangent)) * tangent.w;
+        report.maxNormalErrorDegrees = std::max(report.maxNormalErrorDegrees, angleDegrees(v.Normal, normal));
+        report.maxTangentErrorDegrees = std::max(report.maxTangentErrorDegrees, angleDegrees(v.Tangent, glm::vec3(tangent)));
+        report.maxBitangentErrorDegrees = std::max(report.maxBitangentErrorDegrees, angleDegrees(v.Bitangent, bitangent));
+
+        for (int c = 0; c < 2; c++) {
+            report.maxTexCoordError = std::max(report.maxTexCoordError,
+                std::fabs(halfToFloat(p.TexCoords[c]) - v.TexCoords[c]));
+            report.maxLightmapTexCoordError = std::max(report.maxLightmapTexCoordError,
+                std::fabs(halfToFloat(p.LightmapTexCoords[c]) - v.LightmapTexCoords[c]));
+        }
+    }
+    return report;
+}
+
+void VertexPackingReport::merge(const VertexPackingReport& other) {
+    vertexCount += other.vertexCount;
+    maxPositionError = std::max(maxPositionError, other.maxPositionError);
+    maxNormalErrorDegrees = std::max(maxNormalErrorDegrees, other.maxNormalErrorDegrees);
+    maxTangentErrorDegrees = std::max(maxTangentErrorDegrees, other.maxTangentErrorDegrees);
+    maxBitangentErrorDegrees = std::max(maxBitangentErrorDegrees, other.maxBitangentErrorDegrees);
+    maxTexCoordError = std::max(maxTexCoordError, other.maxTexCoordError);
+    maxLightmapTexCoordError = std::max(maxLightmapTexCoordError, other.maxLightmapTexCoordError);
+}
+
+void VertexPackingReport::print(std::ostream& out, const std::string& name) const {
+    out << "Vertex packing " << name << ": " << vertexCount << " vertices, "
+        << bytesBefore() / 1024.0 << " KB -> " << bytesAfter() / 1024.0 << " KB (saved "
+        << (bytesBefore() - bytesAfter()) / 1024.0 << " KB)"
+        << "; max error: position " << maxPositionError
+        << ", normal " << maxNormalErrorDegrees << " deg"
+        << ", tangent " << maxTangentErrorDegrees << " deg"
+        << ", bitangent " << maxBitangentErrorDegrees << " deg"
+        << ", uv " << maxTexCoordError
+        << ", lightmap uv " << maxLightmapTexCoordError << std::endl;
+}
+
+void setupPackedVertexAttributes() {
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, LightmapTexCoords));
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Tangent));
+    // The bitangent (location 5) is rebuilt in the shader from the normal, tangent and sign
+    glDisableVertexAttribArray(5);
+}
+
+void setupDequantizationAttributes() {
+    glEnableVertexAttribArray(POSITION_SCALE_LOCATION);
+    glVertexAttribPointer(POSITION_SCALE_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(PositionDequantization),
+        (void*)offsetof(PositionDequantization, scale));
+    glVertexAttribDivisor(POSITION_SCALE_LOCATION, 1);
+    glEnableVertexAttribArray(POSITION_OFFSET_LOCATION);
+    glVertexAttribPointer(POSITION_OFFSET_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(PositionDequantization),
+        (void*)offsetof(PositionDequantization, offset));
+    glVertexAttribDivisor(POSITION_OFFSET_LOCATION, 1);
+}
@@ -0,0 +1,81 @@
+#ifndef VERTEX_PACKING_H
+#define VERTEX_PACKING_H
+
+#include "GLDispatch.h"
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "Vertex.h"
+
+// Attribute locations of the per-mesh dequantization parameters (per-instance attributes)
+const GLuint POSITION_SCALE_LOCATION = 6;
+const GLuint POSITION_OFFSET_LOCATION = 7;
+
+// 24-byte alternative to Vertex (64 bytes). Shaders that consume it declare:
+//
+//   layout(location = 0) in vec3 aPosition;          // unorm16, 0..1 across the mesh bounds
+//   layout(location = 1) in vec3 aNormal;            // snorm 10:10:10:2
+//   layout(location = 2) in vec2 aTexCoords;         // half float
+//   layout(location = 3) in vec2 aLightmapTexCoords; // half float
+//   layout(location = 4) in vec4 aTangent;           // snorm 10:10:10:2, w = bitangent sign
+//   layout(location = 6) in vec3 aPositionScale;     // per instance
+//   layout(location = 7) in vec3 aPositionOffset;    // per instance
+//
+//   vec3 position = aPositionOffset + aPosition * aPositionScale;
+//   vec3 bitangent = cross(aNormal, aTangent.xyz) * aTangent.w;
+struct PackedVertex {
+    uint16_t Position[4]; // Fourth component is padding
+    uint32_t Normal;
+    uint32_t Tangent;
+    uint16_t TexCoords[2];
+    uint16_t LightmapTexCoords[2];
+};
+
+static_assert(sizeof(PackedVertex) == 24, "PackedVertex must stay tightly packed");
+
+// Maps quantized positions back into the mesh's space; w is unused
+struct PositionDequantization {
+    glm::vec4 scale;
+    glm::vec4 offset;
+};
+
+// Worst-case error of a packed mesh against its float source, and the memory it saves
+struct VertexPackingReport {
+    size_t vertexCount = 0;
+    float maxPositionError = 0.0f;          // In mesh units
+    float maxNormalErrorDegrees = 0.0f;
+    float maxTangentErrorDegrees = 0.0f;
+    float maxBitangentErrorDegrees = 0.0f;  // Rebuilt bitangent against the imported one
+    float maxTexCoordError = 0.0f;
+    float maxLightmapTexCoordError = 0.0f;
+
+    size_t bytesBefore() const { return vertexCount * sizeof(Vertex); }
+    size_t bytesAfter() const { return vertexCount * sizeof(PackedVertex); }
+
+    void merge(const VertexPackingReport& other);
+    void print(std::ostream& out, const std::string& name) const;
+};
+
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t half);
+
+// Signed normalized GL_INT_2_10_10_10_REV, as the GL 4.2+ conversion rules decode it
+uint32_t packSnorm1010102(const glm::vec3& v, float w);
+glm::vec4 unpackSnorm1010102(uint32_t packed);
+
+// Packs count vertices into out and returns the dequantization for the mesh's bounds
+PositionDequantization packVertices(const Vertex* vertices, size_t count, PackedVertex* out);
+
+// Decodes the packed vertices the way the GPU would and compares them with the source
+VertexPackingReport measurePackingError(const Vertex* vertices, const PackedVertex* packed, size_t count,
+    const PositionDequantization& dequantization);
+
+// Attribute pointers for PackedVertex on the bound VAO and GL_ARRAY_BUFFER
+void setupPackedVertexAttributes();
+
+// Per-instance dequantization attributes on the bound VAO, read from the bound GL_ARRAY_BUFFER
+void setupDequantizationAttributes();
+
+#endif